@@ -0,0 +1,164 @@
+#include "allocator.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <new>
+
+namespace
+{
+    AllocatorHooks const default_hooks = { 0, 0, 0 };
+
+    // the hooks are replaced as a whole, so that a thread never sees the
+    // allocate function of one registration with the free function or the
+    // context of another
+    std::atomic<AllocatorHooks const *> current_hooks(&default_hooks);
+
+    std::mutex registered_hooks_mutex;
+
+    thread_local Workspace * thread_workspace = 0;
+
+    // sizes in units of std::max_align_t
+    std::size_t const unit_size = sizeof(std::max_align_t);
+
+    std::size_t get_n_units(std::size_t const size)
+    {
+        return (size + unit_size - 1) / unit_size;
+    }
+}
+
+AllocatorHooks const * get_allocator_hooks()
+{
+    return current_hooks.load(std::memory_order_acquire);
+}
+
+void * allocate_memory(std::size_t const size, AllocatorHooks const & hooks)
+{
+    if (thread_workspace)
+    {
+        void * const pointer = thread_workspace->allocate(size);
+
+        if (pointer)
+            return pointer;
+    }
+
+    if (!hooks.allocate)
+        return ::operator new(size);
+
+    void * const pointer = hooks.allocate(size, hooks.context);
+
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void free_memory(void * const pointer, std::size_t const size, AllocatorHooks const & hooks)
+{
+    if (thread_workspace && thread_workspace->owns(pointer))
+    {
+        thread_workspace->free(pointer);
+        return;
+    }
+
+    if (!hooks.free)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+
+    hooks.free(pointer, size, hooks.context);
+}
+
+// each distinct set of hooks is registered once and kept until the process
+// exits, as buffers allocated by it may outlive its replacement
+void set_allocator(
+    cpufit_allocate_function const allocate,
+    cpufit_free_function const free,
+    void * const context)
+{
+    if (!allocate)
+    {
+        current_hooks.store(&default_hooks, std::memory_order_release);
+        return;
+    }
+
+    std::lock_guard<std::mutex> const lock(registered_hooks_mutex);
+
+    static std::list<AllocatorHooks> & registered_hooks = *new std::list<AllocatorHooks>;
+
+    for (AllocatorHooks const & hooks : registered_hooks)
+    {
+        if (hooks.allocate == allocate && hooks.free == free && hooks.context == context)
+        {
+            current_hooks.store(&hooks, std::memory_order_release);
+            return;
+        }
+    }
+
+    AllocatorHooks const hooks = { allocate, free, context };
+    registered_hooks.push_back(hooks);
+
+    current_hooks.store(&registered_hooks.back(), std::memory_order_release);
+}
+
+// the memory is zeroed to map all its pages before the first fit
+Workspace::Workspace(std::size_t const size) :
+    n_units_(get_n_units(size)),
+    memory_(new std::max_align_t[n_units_]()),
+    top_(0),
+    offset_(0)
+{
+}
+
+Workspace::Header & Workspace::header(std::size_t const offset) const
+{
+    return *reinterpret_cast<Header *>(memory_.get() + offset);
+}
+
+// each block starts with a header which links it to the block below
+void * Workspace::allocate(std::size_t const size)
+{
+    std::size_t const n_block_units = get_n_units(sizeof(Header)) + get_n_units(size);
+
+    if (n_units_ - offset_ < n_block_units)
+        return 0;
+
+    Header & block = header(offset_);
+    block.previous = top_;
+    block.freed = false;
+
+    top_ = offset_;
+    offset_ += n_block_units;
+
+    return memory_.get() + top_ + get_n_units(sizeof(Header));
+}
+
+void Workspace::free(void * const pointer)
+{
+    std::size_t const block_offset
+        = static_cast<std::max_align_t *>(pointer) - memory_.get() - get_n_units(sizeof(Header));
+
+    header(block_offset).freed = true;
+
+    while (offset_ > 0 && header(top_).freed)
+    {
+        offset_ = top_;
+        top_ = header(top_).previous;
+    }
+}
+
+bool Workspace::owns(void const * const pointer) const
+{
+    std::max_align_t const * const unit = static_cast<std::max_align_t const *>(pointer);
+
+    return unit >= memory_.get() && unit < memory_.get() + n_units_;
+}
+
+Workspace * set_thread_workspace(Workspace * const workspace)
+{
+    Workspace * const previous = thread_workspace;
+    thread_workspace = workspace;
+
+    return previous;
+}
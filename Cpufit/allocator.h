@@ -0,0 +1,110 @@
+#ifndef CPUFIT_ALLOCATOR_H_INCLUDED
+#define CPUFIT_ALLOCATOR_H_INCLUDED
+
+#include "cpufit.h"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// the functions registered with cpufit_set_allocator(), or null functions
+// for operator new and delete; registered hooks are never changed or
+// destroyed, so that memory is always freed by the hooks it was allocated by
+struct AllocatorHooks
+{
+    cpufit_allocate_function allocate;
+    cpufit_free_function free;
+    void * context;
+};
+
+// internal buffers are allocated by the hooks registered at the time their
+// allocator is created
+AllocatorHooks const * get_allocator_hooks();
+void * allocate_memory(std::size_t const size, AllocatorHooks const & hooks);
+void free_memory(void * pointer, std::size_t const size, AllocatorHooks const & hooks);
+void set_allocator(cpufit_allocate_function allocate, cpufit_free_function free, void * context);
+
+// a preallocated buffer from which one thread allocates in stack order; a
+// block freed out of order is reclaimed when the blocks above it are freed
+class Workspace
+{
+public:
+    explicit Workspace(std::size_t const size);
+
+    // returns a null pointer if the workspace is full
+    void * allocate(std::size_t const size);
+    void free(void * pointer);
+    bool owns(void const * pointer) const;
+
+private:
+    struct Header
+    {
+        std::size_t previous;
+        bool freed;
+    };
+
+    Header & header(std::size_t const offset) const;
+
+    std::size_t const n_units_;
+    std::unique_ptr<std::max_align_t[]> const memory_;
+    std::size_t top_;
+    std::size_t offset_;
+};
+
+// while a workspace is set for a thread, internal buffers of that thread are
+// taken from it before the allocator hooks are used; returns the previous
+// workspace
+Workspace * set_thread_workspace(Workspace * workspace);
+
+// keeps the hooks it was created with; buffers take the hooks of the buffer
+// they are assigned or swapped with together with its memory
+template<typename T>
+class Allocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    Allocator() : hooks_(get_allocator_hooks()) {}
+
+    template<typename U>
+    Allocator(Allocator<U> const & other) : hooks_(other.hooks()) {}
+
+    T * allocate(std::size_t const n)
+    {
+        return static_cast<T *>(allocate_memory(n * sizeof(T), *hooks_));
+    }
+
+    void deallocate(T * const pointer, std::size_t const n)
+    {
+        free_memory(pointer, n * sizeof(T), *hooks_);
+    }
+
+    AllocatorHooks const * hooks() const
+    {
+        return hooks_;
+    }
+
+private:
+    AllocatorHooks const * hooks_;
+};
+
+template<typename T, typename U>
+bool operator==(Allocator<T> const & a, Allocator<U> const & b)
+{
+    return a.hooks() == b.hooks();
+}
+
+template<typename T, typename U>
+bool operator!=(Allocator<T> const & a, Allocator<U> const & b)
+{
+    return a.hooks() != b.hooks();
+}
+
+template<typename T>
+using Buffer = std::vector<T, Allocator<T>>;
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef CPUFIT_CANCELLATION_H_INCLUDED
+#define CPUFIT_CANCELLATION_H_INCLUDED
+
+#include <atomic>
+
+// set by cpufit_cancel() on any thread, read by the thread running the
+// cancellable fit call between its chunks
+struct cpufit_cancellation_token
+{
+    std::atomic<bool> cancelled;
+};
+
+#endif
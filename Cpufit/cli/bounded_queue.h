@@ -0,0 +1,76 @@
+#ifndef CPUFIT_CLI_BOUNDED_QUEUE_H_INCLUDED
+#define CPUFIT_CLI_BOUNDED_QUEUE_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// passes items between the stages of the pipeline; push waits while the queue
+// is full and pop waits while it is empty
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t const capacity) : capacity_(capacity), closed_(false) {}
+
+    // returns false if the queue was closed
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+
+        if (closed_)
+            return false;
+
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+
+        return true;
+    }
+
+    // returns false if the queue was closed and all items are taken
+    bool pop(T & item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+        if (items_.empty())
+            return false;
+
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+
+        return true;
+    }
+
+    // no more items are pushed; the remaining items can still be taken
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    // closes the queue and drops the remaining items
+    void abort()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        items_.clear();
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::size_t const capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif
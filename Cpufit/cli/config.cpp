@@ -0,0 +1,354 @@
+#include "config.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    std::string trim(std::string const & text)
+    {
+        std::size_t begin = 0;
+        std::size_t end = text.size();
+
+        while (begin < end && std::isspace(static_cast<unsigned char>(text[begin])))
+            begin++;
+
+        while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1])))
+            end--;
+
+        return text.substr(begin, end - begin);
+    }
+
+    // a recursive descent parser for the objects, arrays, strings, numbers
+    // and literals of JSON, which stores every value under its dotted key
+    class JsonParser
+    {
+    public:
+        JsonParser(std::string const & text, std::map<std::string, std::string> & values) :
+            text_(text),
+            position_(0),
+            values_(values)
+        {
+        }
+
+        void parse()
+        {
+            parse_value("");
+            skip_space();
+
+            if (position_ != text_.size())
+                fail("unexpected characters after the end");
+        }
+
+    private:
+        void fail(std::string const & what) const
+        {
+            throw std::runtime_error("JSON error at character " + std::to_string(position_) + ": " + what);
+        }
+
+        void skip_space()
+        {
+            while (position_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[position_])))
+                position_++;
+        }
+
+        char peek()
+        {
+            skip_space();
+
+            if (position_ == text_.size())
+                fail("unexpected end");
+
+            return text_[position_];
+        }
+
+        void expect(char const c)
+        {
+            if (peek() != c)
+                fail(std::string("expected '") + c + "'");
+
+            position_++;
+        }
+
+        std::string parse_string()
+        {
+            expect('"');
+            std::string value;
+
+            while (position_ < text_.size() && text_[position_] != '"')
+            {
+                char c = text_[position_++];
+
+                if (c == '\\' && position_ < text_.size())
+                {
+                    c = text_[position_++];
+
+                    if (c == 'n')
+                        c = '\n';
+                    else if (c == 't')
+                        c = '\t';
+                    else if (c == 'u')
+                        fail("unicode escapes are not supported");
+                }
+
+                value += c;
+            }
+
+            expect('"');
+
+            return value;
+        }
+
+        // numbers and the literals true, false and null
+        std::string parse_word()
+        {
+            std::size_t const begin = position_;
+
+            while (position_ < text_.size()
+                && (std::isalnum(static_cast<unsigned char>(text_[position_]))
+                    || text_[position_] == '-' || text_[position_] == '+' || text_[position_] == '.'))
+            {
+                position_++;
+            }
+
+            if (position_ == begin)
+                fail("unexpected character");
+
+            std::string const word = text_.substr(begin, position_ - begin);
+
+            if (word == "true")
+                return "1";
+
+            if (word == "false")
+                return "0";
+
+            return word == "null" ? "" : word;
+        }
+
+        // arrays are flattened into comma separated values
+        std::string parse_array()
+        {
+            expect('[');
+            std::string values;
+
+            if (peek() == ']')
+            {
+                position_++;
+                return values;
+            }
+
+            for (;;)
+            {
+                std::string const value = peek() == '"' ? parse_string() : parse_word();
+                values += values.empty() ? value : ", " + value;
+
+                if (peek() == ']')
+                    break;
+
+                expect(',');
+            }
+
+            position_++;
+
+            return values;
+        }
+
+        void parse_value(std::string const & key)
+        {
+            char const c = peek();
+
+            if (c == '{')
+            {
+                position_++;
+
+                if (peek() == '}')
+                {
+                    position_++;
+                    return;
+                }
+
+                for (;;)
+                {
+                    std::string const name = parse_string();
+                    expect(':');
+                    parse_value(key.empty() ? name : key + "." + name);
+
+                    if (peek() == '}')
+                        break;
+
+                    expect(',');
+                }
+
+                position_++;
+            }
+            else if (c == '[')
+            {
+                values_[key] = parse_array();
+            }
+            else if (c == '"')
+            {
+                values_[key] = parse_string();
+            }
+            else
+            {
+                values_[key] = parse_word();
+            }
+        }
+
+        std::string const & text_;
+        std::size_t position_;
+        std::map<std::string, std::string> & values_;
+    };
+}
+
+Config::Config(std::string const & path)
+{
+    std::ifstream file(path);
+
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    std::size_t const slash = path.rfind('/');
+    directory_ = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+    std::string const content = text.str();
+
+    if (trim(content).compare(0, 1, "{") == 0)
+        parse_json(content);
+    else
+        parse_ini(content);
+}
+
+void Config::parse_ini(std::string const & text)
+{
+    std::istringstream lines(text);
+    std::string line;
+    std::string section;
+    std::size_t line_number = 0;
+
+    while (std::getline(lines, line))
+    {
+        line_number++;
+
+        // comments start with ; or #
+        std::size_t const comment = line.find_first_of(";#");
+        line = trim(line.substr(0, comment));
+
+        if (line.empty())
+            continue;
+
+        if (line.front() == '[' && line.back() == ']')
+        {
+            section = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+
+        std::size_t const equals = line.find('=');
+
+        if (equals == std::string::npos)
+        {
+            throw std::runtime_error("INI error in line " + std::to_string(line_number) + ": expected key = value");
+        }
+
+        std::string const name = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+            value = value.substr(1, value.size() - 2);
+
+        values_[section.empty() ? name : section + "." + name] = value;
+    }
+}
+
+void Config::parse_json(std::string const & text)
+{
+    JsonParser(text, values_).parse();
+}
+
+bool Config::has(std::string const & key) const
+{
+    std::map<std::string, std::string>::const_iterator const value = values_.find(key);
+
+    return value != values_.end() && !value->second.empty();
+}
+
+std::string Config::get_string(std::string const & key) const
+{
+    if (!has(key))
+    {
+        throw std::runtime_error("missing setting " + key);
+    }
+
+    return values_.find(key)->second;
+}
+
+std::string Config::get_string(std::string const & key, std::string const & default_value) const
+{
+    return has(key) ? get_string(key) : default_value;
+}
+
+double Config::get_number(std::string const & key) const
+{
+    std::string const value = get_string(key);
+    char * end = 0;
+    double const number = std::strtod(value.c_str(), &end);
+
+    if (end == value.c_str() || *end)
+    {
+        throw std::runtime_error("setting " + key + " is not a number: " + value);
+    }
+
+    return number;
+}
+
+double Config::get_number(std::string const & key, double const default_value) const
+{
+    return has(key) ? get_number(key) : default_value;
+}
+
+std::vector<std::string> Config::get_list(std::string const & key) const
+{
+    std::vector<std::string> list;
+    std::istringstream values(get_string(key));
+    std::string value;
+
+    while (std::getline(values, value, ','))
+        list.push_back(trim(value));
+
+    return list;
+}
+
+std::vector<double> Config::get_numbers(std::string const & key) const
+{
+    std::vector<double> numbers;
+
+    for (std::string const & value : get_list(key))
+    {
+        char * end = 0;
+        double const number = std::strtod(value.c_str(), &end);
+
+        if (end == value.c_str() || *end)
+        {
+            throw std::runtime_error("setting " + key + " contains a value which is not a number: " + value);
+        }
+
+        numbers.push_back(number);
+    }
+
+    return numbers;
+}
+
+std::string Config::get_path(std::string const & key) const
+{
+    std::string const path = get_string(key);
+
+    return path.empty() || path[0] == '/' ? path : directory_ + path;
+}
@@ -0,0 +1,47 @@
+#ifndef CPUFIT_CLI_CONFIG_H_INCLUDED
+#define CPUFIT_CLI_CONFIG_H_INCLUDED
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// the settings of cpufit_cli, read from an INI file
+//
+//     [fit]
+//     model = GAUSS_2D
+//     parameters_to_fit = 1, 1, 1, 1, 1
+//
+// or from the equivalent JSON file
+//
+//     { "fit": { "model": "GAUSS_2D", "parameters_to_fit": [1, 1, 1, 1, 1] } }
+//
+// Keys are named by their section, like "fit.model", and lists are stored as
+// comma separated values.
+class Config
+{
+public:
+    explicit Config(std::string const & path);
+
+    bool has(std::string const & key) const;
+
+    // throw if a key without default is missing or a value is invalid
+    std::string get_string(std::string const & key) const;
+    std::string get_string(std::string const & key, std::string const & default_value) const;
+    double get_number(std::string const & key) const;
+    double get_number(std::string const & key, double const default_value) const;
+    std::vector<std::string> get_list(std::string const & key) const;
+    std::vector<double> get_numbers(std::string const & key) const;
+
+    // a path relative to the directory of the configuration file
+    std::string get_path(std::string const & key) const;
+
+private:
+    void parse_ini(std::string const & text);
+    void parse_json(std::string const & text);
+
+    std::string directory_;
+    std::map<std::string, std::string> values_;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "config.h"
+#include "pipeline.h"
+#include "roi_source.h"
+#include "tiff_stack.h"
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    bool ends_with(std::string const & text, std::string const & end)
+    {
+        return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+    }
+
+    std::unique_ptr<RoiSource> create_roi_source(Config const & config)
+    {
+        std::string const path = config.get_path("input.data_file");
+        bool const tiff_file = ends_with(path, ".tif") || ends_with(path, ".tiff")
+            || ends_with(path, ".TIF") || ends_with(path, ".TIFF");
+        std::string const format = config.get_string("input.format", tiff_file ? "tiff" : "raw");
+
+        if (format == "tiff")
+        {
+            return std::unique_ptr<RoiSource>(new TiffRoiSource(path));
+        }
+
+        if (format != "raw")
+        {
+            throw std::runtime_error("setting input.format has an unknown value " + format);
+        }
+
+        return std::unique_ptr<RoiSource>(new RawRoiSource(
+            path,
+            get_data_type(config.get_string("input.data_type", "float32")),
+            static_cast<std::size_t>(config.get_number("input.n_points")),
+            static_cast<std::size_t>(config.get_number("input.n_fits", 0)),
+            static_cast<std::size_t>(config.get_number("input.width", 0))));
+    }
+}
+
+// cpufit_cli <configuration file>
+//
+// fits the ROIs of a data file with the settings of an INI or JSON file:
+//
+//     [input]
+//     data_file = rois.raw           ; relative to the configuration file
+//     format = raw                   ; raw or tiff, by default tiff for files
+//                                    ; ending in .tif or .tiff
+//     data_type = uint16             ; uint8, uint16, int16, uint32, float32
+//                                    ; or float64
+//     n_points = 25                  ; samples of each ROI
+//     n_fits = 1000000               ; optional, taken from the file size
+//     width = 5                      ; optional, of the rows of the ROIs
+//     ; the pages of a TIFF stack are the ROIs, with the data type and the
+//     ; number of points of the file
+//     camera_offset = 100            ; data = (sample - offset) * gain
+//     gain = 0.5
+//     initial_parameters = 100, 2, 2, 1, 0
+//     ; or a file of REAL values, n_parameters for each fit
+//     ; initial_parameters_file = initial.raw
+//
+//     [fit]
+//     model = GAUSS_2D
+//     estimator = MLE
+//     tolerance = 1e-4
+//     max_iterations = 20
+//     parameters_to_fit = 1, 1, 1, 1, 1
+//     constraint_types = LOWER, NONE, NONE, LOWER, NONE
+//     constraints = 0, 0, 0, 0, 0, 0, 0.5, 0, 0, 0
+//     spline_file = psf.spline       ; user info of the spline models
+//
+//     [detection]                    ; optional, fits the spots of frames
+//     sigma = 1.3                    ; of the PSF in pixels
+//     threshold = 5                  ; in units of the noise
+//     roi_size = 9                   ; of the square ROIs around the spots
+//     ; the items of the input are frames of n_points samples in rows of
+//     ; the width, and the initial parameters are estimated for each ROI
+//
+//     [output]
+//     file = results.cpufitr         ; a Cpufit result file
+//     encodings = raw, raw, raw, raw, raw, bit_packed, raw, bit_packed
+//     roi_file = results.rois        ; the frame and the corner of each ROI,
+//                                    ; by default the result file name + .rois
+//
+//     [pipeline]
+//     batch_size = 10000             ; ROIs, or frames with detection
+//
+//     [cache]                        ; optional, skips batches fitted before
+//     directory = cache              ; of the stored results
+//     max_size = 1024                ; MiB, the least recently used results
+//                                    ; are removed
+int main(int argc, char * argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: cpufit_cli <configuration file>\n";
+        return 2;
+    }
+
+    try
+    {
+        Config const config(argv[1]);
+
+        std::unique_ptr<RoiSource> const source = create_roi_source(config);
+
+        Pipeline pipeline(config, *source);
+        pipeline.run();
+        pipeline.print_statistics(std::cout);
+    }
+    catch (std::exception & exception)
+    {
+        std::cerr << "cpufit_cli: " << exception.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,644 @@
+#include "pipeline.h"
+#include "../model_parameters.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    char const * const model_names[] = {
+        "GAUSS_1D",
+        "GAUSS_2D",
+        "GAUSS_2D_ELLIPTIC",
+        "GAUSS_2D_ROTATED",
+        "CAUCHY_2D_ELLIPTIC",
+        "LINEAR_1D",
+        "FLETCHER_POWELL_HELIX",
+        "BROWN_DENNIS",
+        "SPLINE_1D",
+        "SPLINE_2D",
+        "SPLINE_3D",
+        "SPLINE_3D_MULTICHANNEL",
+        "SPLINE_3D_PHASE_MULTICHANNEL" };
+
+    char const * const estimator_names[] = {
+        "LSE",
+        "MLE",
+        "LSE_POISSON_NEYMAN",
+        "LSE_POISSON_PEARSON" };
+
+    char const * const constraint_type_names[] = {
+        "NONE",
+        "LOWER",
+        "UPPER",
+        "LOWER_UPPER" };
+
+    char const * const state_names[] = {
+        "converged",
+        "max iteration",
+        "singular hessian",
+        "neg curvature MLE",
+        "gpu not ready",
+        "deadline exceeded",
+        "cancelled" };
+
+    char const * const encoding_names[] = {
+        "raw",
+        "bit_packed",
+        "delta" };
+
+    template<std::size_t n_names>
+    int find_name(char const * const (&names)[n_names], std::string const & name, std::string const & key)
+    {
+        for (std::size_t i = 0; i < n_names; i++)
+        {
+            if (name == names[i])
+                return static_cast<int>(i);
+        }
+
+        throw std::runtime_error("setting " + key + " has an unknown value " + name);
+    }
+
+    void check_status(int const status)
+    {
+        if (status != ReturnState::OK)
+        {
+            throw std::runtime_error(cpufit_get_last_error());
+        }
+    }
+
+    std::vector<char> read_file(std::string const & path)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+}
+
+Pipeline::Pipeline(Config const & config, RoiSource & source)
+    : source_(source)
+    , n_items_(source.n_fits())
+    , detecting_(config.has("detection.roi_size"))
+    , batch_size_(static_cast<std::size_t>(config.get_number(
+        "pipeline.batch_size", detecting_ ? default_detection_batch_size : default_batch_size)))
+    , n_points_(source.n_points())
+    , offset_(config.get_number("input.camera_offset", 0.))
+    , gain_(config.get_number("input.gain", 1.))
+    , sigma_(0)
+    , threshold_(0)
+    , roi_size_(0)
+    , writer_(0)
+    , result_cache_(0)
+    , free_batches_(n_batches)
+    , read_batches_(1)
+    , converted_batches_(1)
+    , detected_batches_(1)
+    , fitted_batches_(1)
+    , seconds_(0.)
+    , n_fits_(0)
+    , state_counts_(sizeof(state_names) / sizeof(state_names[0]), 0)
+{
+    if (batch_size_ == 0)
+    {
+        throw std::runtime_error("setting pipeline.batch_size must be positive");
+    }
+
+    model_id_ = static_cast<ModelID>(find_name(model_names, config.get_string("fit.model"), "fit.model"));
+    estimator_id_ = static_cast<EstimatorID>(
+        find_name(estimator_names, config.get_string("fit.estimator", "LSE"), "fit.estimator"));
+    n_parameters_ = get_number_of_parameters(model_id_);
+    if (detecting_)
+    {
+        sigma_ = static_cast<REAL>(config.get_number("detection.sigma"));
+        threshold_ = static_cast<REAL>(config.get_number("detection.threshold", 5.));
+        roi_size_ = static_cast<std::size_t>(config.get_number("detection.roi_size"));
+        n_points_ = roi_size_ * roi_size_;
+
+        if (source_.width() == 0 || source_.n_points() % source_.width())
+        {
+            throw std::runtime_error("the frames have no width");
+        }
+    }
+
+    tolerance_ = static_cast<REAL>(config.get_number("fit.tolerance", 1e-4));
+    max_n_iterations_ = static_cast<int>(config.get_number("fit.max_iterations", 20));
+
+    // all parameters are fitted by default
+    parameters_to_fit_.assign(n_parameters_, 1);
+
+    if (config.has("fit.parameters_to_fit"))
+    {
+        std::vector<double> const parameters_to_fit = config.get_numbers("fit.parameters_to_fit");
+
+        if (parameters_to_fit.size() != n_parameters_)
+        {
+            throw std::runtime_error("setting fit.parameters_to_fit needs one value for each parameter");
+        }
+
+        std::copy(parameters_to_fit.begin(), parameters_to_fit.end(), parameters_to_fit_.begin());
+    }
+
+    // the same lower and upper bound of each parameter for all fits
+    if (config.has("fit.constraint_types"))
+    {
+        for (std::string const & name : config.get_list("fit.constraint_types"))
+            constraint_types_.push_back(find_name(constraint_type_names, name, "fit.constraint_types"));
+
+        std::vector<double> const constraints = config.get_numbers("fit.constraints");
+
+        if (constraint_types_.size() != n_parameters_ || constraints.size() != 2 * n_parameters_)
+        {
+            throw std::runtime_error(
+                "settings fit.constraint_types and fit.constraints need one type and a lower and an upper bound for each parameter");
+        }
+
+        bounds_.assign(constraints.begin(), constraints.end());
+    }
+
+    if (config.has("fit.spline_file"))
+    {
+        user_info_ = read_file(config.get_path("fit.spline_file"));
+    }
+
+    // detected spots have initial parameters from their moments
+    if (!detecting_ && config.has("input.initial_parameters_file"))
+    {
+        std::string const path = config.get_path("input.initial_parameters_file");
+        initial_parameters_file_.open(path, std::ios::binary);
+
+        if (!initial_parameters_file_)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+
+        initial_parameters_file_.seekg(0, std::ios::end);
+
+        if (static_cast<std::size_t>(initial_parameters_file_.tellg()) < n_items_ * n_parameters_ * sizeof(REAL))
+        {
+            throw std::runtime_error(path + " does not hold initial parameters for all fits");
+        }
+    }
+    else if (!detecting_)
+    {
+        std::vector<double> const initial_parameters = config.get_numbers("input.initial_parameters");
+
+        if (initial_parameters.size() != n_parameters_)
+        {
+            throw std::runtime_error("setting input.initial_parameters needs one value for each parameter");
+        }
+
+        initial_parameters_.assign(initial_parameters.begin(), initial_parameters.end());
+    }
+
+    std::vector<int> column_encodings(n_parameters_ + 3, RAW_ENCODING);
+
+    if (config.has("output.encodings"))
+    {
+        std::vector<std::string> const encodings = config.get_list("output.encodings");
+
+        if (encodings.size() != column_encodings.size())
+        {
+            throw std::runtime_error("setting output.encodings needs one encoding for each column");
+        }
+
+        for (std::size_t i = 0; i < encodings.size(); i++)
+            column_encodings[i] = find_name(encoding_names, encodings[i], "output.encodings");
+    }
+
+    std::string const output_file = config.get_path("output.file");
+    writer_ = cpufit_open_result_writer(output_file.c_str(), model_id_, column_encodings.data());
+
+    if (!writer_)
+    {
+        throw std::runtime_error(cpufit_get_last_error());
+    }
+
+    if (detecting_)
+    {
+        std::string const roi_file = config.has("output.roi_file")
+            ? config.get_path("output.roi_file")
+            : output_file + ".rois";
+        roi_file_.open(roi_file, std::ios::binary | std::ios::trunc);
+
+        if (!roi_file_)
+        {
+            throw std::runtime_error("cannot open " + roi_file);
+        }
+    }
+
+    if (config.has("cache.directory"))
+    {
+        std::string const directory = config.get_path("cache.directory");
+        result_cache_ = cpufit_open_result_cache(
+            directory.c_str(),
+            static_cast<std::size_t>(config.get_number("cache.max_size", 1024.) * 1024 * 1024));
+
+        if (!result_cache_)
+        {
+            throw std::runtime_error(cpufit_get_last_error());
+        }
+    }
+
+    std::fill(stage_seconds_, stage_seconds_ + N_STAGES, 0.);
+
+    for (std::size_t i = 0; i < n_batches; i++)
+    {
+        std::unique_ptr<Batch> batch(new Batch);
+        batch->samples.resize(batch_size_ * source_.n_points() * get_data_type_size(source_.data_type()));
+
+        // the outputs of detection grow with the number of spots
+        if (detecting_)
+        {
+            batch->frames.resize(batch_size_ * source_.n_points());
+            resize_fits(*batch, batch_size_ * initial_n_spots_per_frame);
+        }
+        else
+        {
+            resize_fits(*batch, batch_size_);
+        }
+
+        free_batches_.push(std::move(batch));
+    }
+}
+
+Pipeline::~Pipeline()
+{
+    // an unfinished file keeps the blocks written so far
+    if (writer_)
+        cpufit_close_result_writer(writer_);
+
+    if (result_cache_)
+        cpufit_close_result_cache(result_cache_);
+}
+
+void Pipeline::run()
+{
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+    std::thread read_thread(&Pipeline::run_stage, this, READ, &Pipeline::read_batches);
+    std::thread convert_thread(&Pipeline::run_stage, this, CONVERT, &Pipeline::convert_batches);
+    std::thread detect_thread(&Pipeline::run_stage, this, DETECT, &Pipeline::detect_batches);
+    std::thread fit_thread(&Pipeline::run_stage, this, FIT, &Pipeline::fit_batches);
+    run_stage(WRITE, &Pipeline::write_batches);
+
+    read_thread.join();
+    convert_thread.join();
+    detect_thread.join();
+    fit_thread.join();
+
+    if (error_)
+        std::rethrow_exception(error_);
+
+    cpufit_result_writer * const writer = writer_;
+    writer_ = 0;
+    check_status(cpufit_close_result_writer(writer));
+
+    if (detecting_)
+    {
+        roi_file_.close();
+
+        if (!roi_file_)
+        {
+            throw std::runtime_error("cannot write the ROI corners");
+        }
+    }
+
+    seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Pipeline::run_stage(Stage const stage, void (Pipeline::*work)())
+{
+    try
+    {
+        (this->*work)();
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (!error_)
+                error_ = std::current_exception();
+        }
+
+        free_batches_.abort();
+        read_batches_.abort();
+        converted_batches_.abort();
+        detected_batches_.abort();
+        fitted_batches_.abort();
+    }
+
+    // the next stage finishes when it has taken the remaining batches
+    switch (stage)
+    {
+    case READ:      read_batches_.close(); break;
+    case CONVERT:   converted_batches_.close(); break;
+    case DETECT:    detected_batches_.close(); break;
+    case FIT:       fitted_batches_.close(); break;
+    default:        break;
+    }
+}
+
+void Pipeline::add_stage_time(Stage const stage, std::chrono::steady_clock::time_point const start)
+{
+    // each stage adds to its own time only
+    stage_seconds_[stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Pipeline::resize_fits(Batch & batch, std::size_t const n_fits) const
+{
+    batch.data.resize(n_fits * n_points_);
+    batch.initial_parameters.resize(n_fits * n_parameters_);
+    batch.parameters.resize(n_fits * n_parameters_);
+    batch.states.resize(n_fits);
+    batch.chi_squares.resize(n_fits);
+    batch.n_iterations.resize(n_fits);
+
+    if (detecting_)
+        batch.roi_corners.resize(3 * n_fits);
+}
+
+void Pipeline::read_batches()
+{
+    for (std::size_t first_item = 0; first_item < n_items_; first_item += batch_size_)
+    {
+        std::unique_ptr<Batch> batch;
+
+        if (!free_batches_.pop(batch))
+            return;
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        batch->first_item = first_item;
+        batch->n_items = std::min(batch_size_, n_items_ - first_item);
+        source_.read(first_item, batch->n_items, batch->samples.data());
+
+        if (initial_parameters_file_.is_open())
+        {
+            std::size_t const size = n_parameters_ * sizeof(REAL);
+
+            initial_parameters_file_.seekg(static_cast<std::streamoff>(first_item * size));
+            initial_parameters_file_.read(
+                reinterpret_cast<char *>(batch->initial_parameters.data()),
+                static_cast<std::streamsize>(batch->n_items * size));
+
+            if (!initial_parameters_file_)
+            {
+                throw std::runtime_error("cannot read the initial parameters");
+            }
+        }
+
+        add_stage_time(READ, start);
+
+        if (!read_batches_.push(std::move(batch)))
+            return;
+    }
+}
+
+void Pipeline::convert_batches()
+{
+    std::unique_ptr<Batch> batch;
+
+    while (read_batches_.pop(batch))
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        convert_samples(
+            batch->samples.data(),
+            source_.data_type(),
+            batch->n_items * source_.n_points(),
+            offset_,
+            gain_,
+            detecting_ ? batch->frames.data() : batch->data.data());
+
+        if (!detecting_)
+            batch->n_fits = batch->n_items;
+
+        if (!detecting_ && !initial_parameters_file_.is_open())
+        {
+            for (std::size_t i = 0; i < batch->n_fits * n_parameters_; i++)
+                batch->initial_parameters[i] = initial_parameters_[i % n_parameters_];
+        }
+
+        add_stage_time(CONVERT, start);
+
+        if (!converted_batches_.push(std::move(batch)))
+            return;
+    }
+}
+
+void Pipeline::detect_batches()
+{
+    std::unique_ptr<Batch> batch;
+
+    while (converted_batches_.pop(batch))
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        // the outputs of a batch grow when there are more spots than they
+        // hold, and the detection is repeated
+        for (bool detected = !detecting_; !detected;)
+        {
+            std::size_t const max_n_spots = batch->states.size();
+            std::size_t n_spots = 0;
+
+            check_status(cpufit_detect_spots(
+                batch->n_items,
+                source_.width(),
+                source_.n_points() / source_.width(),
+                batch->frames.data(),
+                sigma_,
+                threshold_,
+                roi_size_,
+                model_id_,
+                max_n_spots,
+                &n_spots,
+                batch->roi_corners.data(),
+                batch->data.data(),
+                batch->initial_parameters.data()));
+
+            detected = n_spots <= max_n_spots;
+
+            if (detected)
+                batch->n_fits = n_spots;
+            else
+                resize_fits(*batch, n_spots + n_spots / 2);
+        }
+
+        add_stage_time(DETECT, start);
+
+        if (!detected_batches_.push(std::move(batch)))
+            return;
+    }
+}
+
+void Pipeline::fit_batches()
+{
+    std::unique_ptr<Batch> batch;
+
+    // the cache is a setting of the fitting thread
+    if (result_cache_)
+        check_status(cpufit_set_result_cache(result_cache_));
+
+    while (detected_batches_.pop(batch))
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        // frames without spots give batches without fits
+        int status = ReturnState::OK;
+
+        if (batch->n_fits && constraint_types_.empty())
+        {
+            status = cpufit(
+                batch->n_fits,
+                n_points_,
+                batch->data.data(),
+                0,
+                model_id_,
+                batch->initial_parameters.data(),
+                tolerance_,
+                max_n_iterations_,
+                parameters_to_fit_.data(),
+                estimator_id_,
+                user_info_.size(),
+                user_info_.empty() ? 0 : user_info_.data(),
+                batch->parameters.data(),
+                batch->states.data(),
+                batch->chi_squares.data(),
+                batch->n_iterations.data());
+        }
+        else if (batch->n_fits)
+        {
+            if (constraints_.size() < batch->n_fits * bounds_.size())
+            {
+                constraints_.resize(batch->n_fits * bounds_.size());
+
+                for (std::size_t i = 0; i < constraints_.size(); i++)
+                    constraints_[i] = bounds_[i % bounds_.size()];
+            }
+
+            status = cpufit_constrained(
+                batch->n_fits,
+                n_points_,
+                batch->data.data(),
+                0,
+                model_id_,
+                batch->initial_parameters.data(),
+                constraints_.data(),
+                constraint_types_.data(),
+                tolerance_,
+                max_n_iterations_,
+                parameters_to_fit_.data(),
+                estimator_id_,
+                user_info_.size(),
+                user_info_.empty() ? 0 : user_info_.data(),
+                batch->parameters.data(),
+                batch->states.data(),
+                batch->chi_squares.data(),
+                batch->n_iterations.data());
+        }
+
+        check_status(status);
+        add_stage_time(FIT, start);
+
+        if (!fitted_batches_.push(std::move(batch)))
+            return;
+    }
+}
+
+void Pipeline::write_batches()
+{
+    std::unique_ptr<Batch> batch;
+
+    while (fitted_batches_.pop(batch))
+    {
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+        if (batch->n_fits)
+        {
+            check_status(cpufit_write_results(
+                writer_,
+                batch->n_fits,
+                batch->parameters.data(),
+                batch->states.data(),
+                batch->chi_squares.data(),
+                batch->n_iterations.data()));
+        }
+
+        if (detecting_)
+        {
+            std::vector<std::uint64_t> corners(batch->roi_corners.begin(), batch->roi_corners.begin() + 3 * batch->n_fits);
+
+            for (std::size_t i = 0; i < corners.size(); i += 3)
+                corners[i] += batch->first_item;
+
+            roi_file_.write(
+                reinterpret_cast<char const *>(corners.data()),
+                static_cast<std::streamsize>(corners.size() * sizeof(std::uint64_t)));
+
+            if (!roi_file_)
+            {
+                throw std::runtime_error("cannot write the ROI corners");
+            }
+        }
+
+        n_fits_ += batch->n_fits;
+
+        for (std::size_t i = 0; i < batch->n_fits; i++)
+        {
+            std::size_t const state = static_cast<std::size_t>(batch->states[i]);
+
+            if (state < state_counts_.size())
+                state_counts_[state]++;
+        }
+
+        add_stage_time(WRITE, start);
+
+        if (!free_batches_.push(std::move(batch)))
+            return;
+    }
+}
+
+void Pipeline::print_statistics(std::ostream & stream) const
+{
+    char const * const stage_names[N_STAGES] = { "read", "convert", "detect", "fit", "write" };
+
+    stream << std::fixed << std::setprecision(3);
+    stream << n_fits_ << " fits in " << seconds_ << " s, "
+        << std::setprecision(0) << (seconds_ > 0. ? n_fits_ / seconds_ : 0.) << " fits/s\n";
+
+    if (detecting_)
+        stream << "  " << n_fits_ << " spots in " << n_items_ << " frames\n";
+
+    stream << std::setprecision(3);
+    for (std::size_t stage = 0; stage < N_STAGES; stage++)
+    {
+        if (stage == DETECT && !detecting_)
+            continue;
+
+        stream << "  " << std::left << std::setw(9) << (std::string(stage_names[stage]) + ":")
+            << std::right << std::setw(10) << stage_seconds_[stage] << " s\n";
+    }
+
+    if (result_cache_)
+    {
+        std::size_t n_hits, n_misses, n_entries, size;
+        cpufit_get_result_cache_statistics(result_cache_, &n_hits, &n_misses, &n_entries, &size);
+        stream << "  cache: " << n_hits << " hits, " << n_misses << " misses\n";
+    }
+
+    for (std::size_t state = 0; state < state_counts_.size(); state++)
+    {
+        if (state_counts_[state])
+            stream << "  " << state_names[state] << ": " << state_counts_[state] << "\n";
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef CPUFIT_CLI_PIPELINE_H_INCLUDED
+#define CPUFIT_CLI_PIPELINE_H_INCLUDED
+
+#include "bounded_queue.h"
+#include "config.h"
+#include "roi_source.h"
+#include "../cpufit.h"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// fits the ROIs of a source in batches and writes the results to a result
+// file; reading, conversion to REAL, spot detection, fitting and writing run
+// in five threads, which pass batches through bounded queues, so that the
+// stages overlap and only a few batches are in memory at a time
+//
+// With spot detection, the items of the source are frames, and the ROIs of
+// the spots of a batch of frames are fitted with initial parameters from their
+// moments. The corners of the ROIs are written to a file of 64 bit frame
+// indices, x and y coordinates, in the order of the results.
+class Pipeline
+{
+public:
+    Pipeline(Config const & config, RoiSource & source);
+    ~Pipeline();
+
+    // returns when all fits are written; rethrows the first error of a stage
+    void run();
+
+    // throughput and the time each stage spent working, not waiting
+    void print_statistics(std::ostream & stream) const;
+
+private:
+    Pipeline(Pipeline const &);
+    Pipeline & operator=(Pipeline const &);
+
+    enum Stage { READ = 0, CONVERT = 1, DETECT = 2, FIT = 3, WRITE = 4, N_STAGES = 5 };
+
+    static std::size_t const default_batch_size = 10000;
+    static std::size_t const default_detection_batch_size = 16;
+    static std::size_t const initial_n_spots_per_frame = 64;
+    // a batch in each stage and one in each queue
+    static std::size_t const n_batches = 2 * N_STAGES - 1;
+
+    struct Batch
+    {
+        // ROIs or frames of the source
+        std::size_t first_item;
+        std::size_t n_items;
+        std::size_t n_fits;
+        std::vector<char> samples;
+        std::vector<REAL> frames;
+        std::vector<std::size_t> roi_corners;
+        std::vector<REAL> data;
+        std::vector<REAL> initial_parameters;
+        std::vector<REAL> parameters;
+        std::vector<int> states;
+        std::vector<REAL> chi_squares;
+        std::vector<int> n_iterations;
+    };
+
+    typedef BoundedQueue<std::unique_ptr<Batch>> BatchQueue;
+
+    void read_batches();
+    void convert_batches();
+    void detect_batches();
+    void fit_batches();
+    void write_batches();
+
+    void run_stage(Stage const stage, void (Pipeline::*work)());
+    void add_stage_time(Stage const stage, std::chrono::steady_clock::time_point const start);
+    void resize_fits(Batch & batch, std::size_t const n_fits) const;
+
+    RoiSource & source_;
+    std::size_t const n_items_;
+    bool const detecting_;
+    std::size_t const batch_size_;
+    std::size_t n_points_;
+
+    double const offset_;
+    double const gain_;
+
+    ModelID model_id_;
+    EstimatorID estimator_id_;
+    std::size_t n_parameters_;
+    REAL tolerance_;
+    int max_n_iterations_;
+    std::vector<int> parameters_to_fit_;
+    // lower and upper bounds of each parameter, replicated for the fits of
+    // a batch in constraints_
+    std::vector<REAL> bounds_;
+    std::vector<REAL> constraints_;
+    std::vector<int> constraint_types_;
+    std::vector<char> user_info_;
+
+    // either one set for all fits or a file with a set for each fit
+    std::vector<REAL> initial_parameters_;
+    std::ifstream initial_parameters_file_;
+
+    // of the detection
+    REAL sigma_;
+    REAL threshold_;
+    std::size_t roi_size_;
+
+    cpufit_result_writer * writer_;
+    std::ofstream roi_file_;
+    cpufit_result_cache * result_cache_;
+
+    BatchQueue free_batches_;
+    BatchQueue read_batches_;
+    BatchQueue converted_batches_;
+    BatchQueue detected_batches_;
+    BatchQueue fitted_batches_;
+
+    std::mutex mutex_;
+    std::exception_ptr error_;
+    double stage_seconds_[N_STAGES];
+    double seconds_;
+    std::size_t n_fits_;
+    std::vector<std::size_t> state_counts_;
+};
+
+#endif
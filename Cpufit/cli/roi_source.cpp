@@ -0,0 +1,137 @@
+#include "roi_source.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    template<typename Sample>
+    void convert(
+        char const * samples,
+        std::size_t const n_samples,
+        double const offset,
+        double const gain,
+        REAL * values)
+    {
+        for (std::size_t i = 0; i < n_samples; i++)
+        {
+            Sample sample;
+            std::memcpy(&sample, samples + i * sizeof(Sample), sizeof(Sample));
+            values[i] = static_cast<REAL>((static_cast<double>(sample) - offset) * gain);
+        }
+    }
+}
+
+DataType get_data_type(std::string const & name)
+{
+    if (name == "uint8")
+        return UINT8;
+    if (name == "uint16")
+        return UINT16;
+    if (name == "int16")
+        return INT16;
+    if (name == "uint32")
+        return UINT32;
+    if (name == "float32")
+        return FLOAT32;
+    if (name == "float64")
+        return FLOAT64;
+
+    throw std::runtime_error("unknown data type " + name);
+}
+
+std::size_t get_data_type_size(DataType const data_type)
+{
+    switch (data_type)
+    {
+    case UINT8:     return 1;
+    case UINT16:    return 2;
+    case INT16:     return 2;
+    case UINT32:    return 4;
+    case FLOAT32:   return 4;
+    case FLOAT64:   return 8;
+    default:        throw std::runtime_error("invalid data type");
+    }
+}
+
+void convert_samples(
+    char const * samples,
+    DataType const data_type,
+    std::size_t const n_samples,
+    double const offset,
+    double const gain,
+    REAL * values)
+{
+    switch (data_type)
+    {
+    case UINT8:     convert<std::uint8_t>(samples, n_samples, offset, gain, values); break;
+    case UINT16:    convert<std::uint16_t>(samples, n_samples, offset, gain, values); break;
+    case INT16:     convert<std::int16_t>(samples, n_samples, offset, gain, values); break;
+    case UINT32:    convert<std::uint32_t>(samples, n_samples, offset, gain, values); break;
+    case FLOAT32:   convert<float>(samples, n_samples, offset, gain, values); break;
+    case FLOAT64:   convert<double>(samples, n_samples, offset, gain, values); break;
+    default:        throw std::runtime_error("invalid data type");
+    }
+}
+
+RawRoiSource::RawRoiSource(
+    std::string const & path,
+    DataType const data_type,
+    std::size_t const n_points,
+    std::size_t const n_fits,
+    std::size_t const width)
+    : path_(path)
+    , file_(path, std::ios::binary)
+    , data_type_(data_type)
+    , n_points_(n_points)
+    , n_fits_(n_fits)
+    , width_(width ? width : n_points)
+{
+    if (!file_)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    if (n_points_ == 0)
+    {
+        throw std::runtime_error("n_points must be positive");
+    }
+
+    if (n_points_ % width_)
+    {
+        throw std::runtime_error("n_points must be a multiple of the width");
+    }
+
+    std::size_t const roi_size = n_points_ * get_data_type_size(data_type_);
+
+    file_.seekg(0, std::ios::end);
+    std::size_t const file_size = static_cast<std::size_t>(file_.tellg());
+
+    if (n_fits_ == 0)
+    {
+        if (file_size % roi_size)
+        {
+            throw std::runtime_error(path + " does not hold a whole number of ROIs");
+        }
+
+        n_fits_ = file_size / roi_size;
+    }
+    else if (file_size < n_fits_ * roi_size)
+    {
+        throw std::runtime_error(path + " is smaller than " + std::to_string(n_fits_ * roi_size) + " bytes");
+    }
+}
+
+void RawRoiSource::read(std::size_t const first_fit, std::size_t const n_fits, char * samples)
+{
+    std::size_t const roi_size = n_points_ * get_data_type_size(data_type_);
+
+    file_.seekg(static_cast<std::streamoff>(first_fit * roi_size));
+    file_.read(samples, static_cast<std::streamsize>(n_fits * roi_size));
+
+    if (!file_)
+    {
+        throw std::runtime_error("cannot read " + path_);
+    }
+}
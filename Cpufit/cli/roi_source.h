@@ -0,0 +1,70 @@
+#ifndef CPUFIT_CLI_ROI_SOURCE_H_INCLUDED
+#define CPUFIT_CLI_ROI_SOURCE_H_INCLUDED
+
+#include "../../Gpufit/definitions.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+// sample type of the ROIs in an input file
+enum DataType { UINT8 = 0, UINT16 = 1, INT16 = 2, UINT32 = 3, FLOAT32 = 4, FLOAT64 = 5 };
+
+DataType get_data_type(std::string const & name);
+std::size_t get_data_type_size(DataType const data_type);
+
+// converts samples to REAL values with (sample - offset) * gain
+void convert_samples(
+    char const * samples,
+    DataType const data_type,
+    std::size_t const n_samples,
+    double const offset,
+    double const gain,
+    REAL * values);
+
+// a stack of ROIs of n_points samples each, read in consecutive ranges of fits
+class RoiSource
+{
+public:
+    virtual ~RoiSource() {}
+
+    virtual std::size_t n_fits() const = 0;
+    virtual std::size_t n_points() const = 0;
+    // of a row of a ROI
+    virtual std::size_t width() const = 0;
+    virtual DataType data_type() const = 0;
+
+    // reads the samples of n_fits ROIs starting at first_fit
+    virtual void read(std::size_t const first_fit, std::size_t const n_fits, char * samples) = 0;
+};
+
+// ROIs stored back to back in a headerless file
+class RawRoiSource : public RoiSource
+{
+public:
+    // n_fits is taken from the size of the file if it is 0, and the ROIs are
+    // single rows if width is 0
+    RawRoiSource(
+        std::string const & path,
+        DataType const data_type,
+        std::size_t const n_points,
+        std::size_t const n_fits,
+        std::size_t const width);
+
+    std::size_t n_fits() const { return n_fits_; }
+    std::size_t n_points() const { return n_points_; }
+    std::size_t width() const { return width_; }
+    DataType data_type() const { return data_type_; }
+
+    void read(std::size_t const first_fit, std::size_t const n_fits, char * samples);
+
+private:
+    std::string const path_;
+    std::ifstream file_;
+    DataType const data_type_;
+    std::size_t const n_points_;
+    std::size_t n_fits_;
+    std::size_t const width_;
+};
+
+#endif
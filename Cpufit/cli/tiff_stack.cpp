@@ -0,0 +1,370 @@
+#include "tiff_stack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+    enum TiffTag
+    {
+        IMAGE_WIDTH = 256,
+        IMAGE_LENGTH = 257,
+        BITS_PER_SAMPLE = 258,
+        COMPRESSION = 259,
+        STRIP_OFFSETS = 273,
+        SAMPLES_PER_PIXEL = 277,
+        ROWS_PER_STRIP = 278,
+        STRIP_BYTE_COUNTS = 279,
+        PLANAR_CONFIGURATION = 284,
+        TILE_WIDTH = 322,
+        SAMPLE_FORMAT = 339
+    };
+
+    enum TiffType { BYTE = 1, SHORT = 3, LONG = 4, LONG8 = 16, IFD8 = 18 };
+
+    std::size_t get_type_size(int const type)
+    {
+        switch (type)
+        {
+        case BYTE:  return 1;
+        case SHORT: return 2;
+        case LONG:  return 4;
+        case LONG8: return 8;
+        case IFD8:  return 8;
+        default:    return 0;
+        }
+    }
+
+    bool is_little_endian()
+    {
+        std::uint16_t const one = 1;
+        char first_byte;
+        std::memcpy(&first_byte, &one, 1);
+
+        return first_byte == 1;
+    }
+
+    // an IFD entry with integer values, which are either in the entry or at
+    // an offset
+    struct Entry
+    {
+        int tag;
+        int type;
+        std::uint64_t count;
+        std::uint64_t values_offset;
+    };
+}
+
+TiffStack::TiffStack(std::string const & path) :
+    path_(path),
+    file_(path.c_str(), MappedFile::READ, 8),
+    data_(0),
+    big_tiff_(false),
+    swap_bytes_(false),
+    width_(0),
+    height_(0),
+    data_type_(UINT16)
+{
+    mapping_.reset(new MappedFile::Window(file_, 0, file_.size()));
+    data_ = mapping_->data();
+
+    bool little_endian_file;
+
+    if (data_[0] == 'I' && data_[1] == 'I')
+        little_endian_file = true;
+    else if (data_[0] == 'M' && data_[1] == 'M')
+        little_endian_file = false;
+    else
+        throw std::runtime_error(path_ + " is not a TIFF file");
+
+    swap_bytes_ = little_endian_file != is_little_endian();
+
+    std::uint64_t const version = read_integer(2, 2);
+    std::uint64_t ifd_offset = 0;
+
+    if (version == 42)
+    {
+        ifd_offset = read_integer(4, 4);
+    }
+    else if (version == 43 && read_integer(4, 2) == 8 && file_.size() >= 16)
+    {
+        big_tiff_ = true;
+        ifd_offset = read_integer(8, 8);
+    }
+    else
+    {
+        throw std::runtime_error(path_ + " is not a TIFF file");
+    }
+
+    // the IFDs are a linked list, which must not be circular
+    std::unordered_set<std::uint64_t> ifd_offsets;
+
+    while (ifd_offset)
+    {
+        if (!ifd_offsets.insert(ifd_offset).second)
+        {
+            throw std::runtime_error(path_ + " has a circular list of pages");
+        }
+
+        ifd_offset = read_page(ifd_offset);
+    }
+
+    if (pages_.empty())
+    {
+        throw std::runtime_error(path_ + " has no pages");
+    }
+}
+
+std::uint64_t TiffStack::read_integer(std::uint64_t const offset, std::size_t const size) const
+{
+    if (offset > file_.size() || file_.size() - offset < size)
+    {
+        throw std::runtime_error(path_ + " is truncated");
+    }
+
+    unsigned char const * const bytes = reinterpret_cast<unsigned char const *>(data_ + offset);
+    bool const little_endian_file = is_little_endian() != swap_bytes_;
+    std::uint64_t value = 0;
+
+    for (std::size_t i = 0; i < size; i++)
+    {
+        std::size_t const shift = 8 * (little_endian_file ? i : size - 1 - i);
+        value |= std::uint64_t(bytes[i]) << shift;
+    }
+
+    return value;
+}
+
+std::uint64_t TiffStack::read_page(std::uint64_t const ifd_offset)
+{
+    std::size_t const count_size = big_tiff_ ? 8 : 2;
+    std::size_t const entry_size = big_tiff_ ? 20 : 12;
+    std::size_t const value_size = big_tiff_ ? 8 : 4;
+
+    std::uint64_t const n_entries = read_integer(ifd_offset, count_size);
+    std::uint64_t const entries_offset = ifd_offset + count_size;
+
+    if (n_entries > file_.size() / entry_size)
+    {
+        throw std::runtime_error(path_ + " is truncated");
+    }
+
+    std::vector<Entry> entries;
+
+    for (std::uint64_t i = 0; i < n_entries; i++)
+    {
+        std::uint64_t const entry_offset = entries_offset + i * entry_size;
+
+        Entry entry;
+        entry.tag = int(read_integer(entry_offset, 2));
+        entry.type = int(read_integer(entry_offset + 2, 2));
+        entry.count = read_integer(entry_offset + 4, big_tiff_ ? 8 : 4);
+
+        std::uint64_t const field_offset = entry_offset + (big_tiff_ ? 12 : 8);
+        std::size_t const type_size = get_type_size(entry.type);
+
+        // values which fit into the entry are stored there
+        entry.values_offset = type_size && entry.count * type_size <= value_size
+            ? field_offset
+            : read_integer(field_offset, value_size);
+
+        entries.push_back(entry);
+    }
+
+    std::uint64_t const next_ifd_offset = read_integer(entries_offset + n_entries * entry_size, value_size);
+
+    // the values of an entry
+    auto values = [this](Entry const & entry) {
+        std::size_t const type_size = get_type_size(entry.type);
+
+        if (type_size == 0)
+        {
+            throw std::runtime_error(path_ + " has a tag " + std::to_string(entry.tag) + " of unsupported type");
+        }
+
+        std::vector<std::uint64_t> result(entry.count);
+
+        for (std::uint64_t i = 0; i < entry.count; i++)
+            result[i] = read_integer(entry.values_offset + i * type_size, type_size);
+
+        return result;
+    };
+
+    auto value = [&](int const tag, std::uint64_t const default_value) {
+        for (Entry const & entry : entries)
+        {
+            if (entry.tag == tag)
+            {
+                std::vector<std::uint64_t> const tag_values = values(entry);
+
+                // a value per sample, which is the same for the one sample
+                return tag_values.empty() ? default_value : tag_values[0];
+            }
+        }
+
+        return default_value;
+    };
+
+    std::size_t const width = std::size_t(value(IMAGE_WIDTH, 0));
+    std::size_t const height = std::size_t(value(IMAGE_LENGTH, 0));
+    std::uint64_t const bits_per_sample = value(BITS_PER_SAMPLE, 1);
+    std::uint64_t const sample_format = value(SAMPLE_FORMAT, 1);
+
+    if (value(COMPRESSION, 1) != 1)
+    {
+        throw std::runtime_error(path_ + " is compressed; only uncompressed TIFF files are supported");
+    }
+
+    if (value(SAMPLES_PER_PIXEL, 1) != 1 || value(PLANAR_CONFIGURATION, 1) != 1)
+    {
+        throw std::runtime_error(path_ + " has more than one sample per pixel");
+    }
+
+    if (value(TILE_WIDTH, 0) != 0)
+    {
+        throw std::runtime_error(path_ + " is tiled; only TIFF files with strips are supported");
+    }
+
+    DataType data_type;
+
+    if (sample_format == 1 && bits_per_sample == 8)
+        data_type = UINT8;
+    else if (sample_format == 1 && bits_per_sample == 16)
+        data_type = UINT16;
+    else if (sample_format == 2 && bits_per_sample == 16)
+        data_type = INT16;
+    else if (sample_format == 1 && bits_per_sample == 32)
+        data_type = UINT32;
+    else if (sample_format == 3 && bits_per_sample == 32)
+        data_type = FLOAT32;
+    else if (sample_format == 3 && bits_per_sample == 64)
+        data_type = FLOAT64;
+    else
+        throw std::runtime_error(path_ + " has an unsupported sample type");
+
+    if (width == 0 || height == 0)
+    {
+        throw std::runtime_error(path_ + " has a page without size");
+    }
+
+    if (pages_.empty())
+    {
+        width_ = width;
+        height_ = height;
+        data_type_ = data_type;
+    }
+    else if (width != width_ || height != height_ || data_type != data_type_)
+    {
+        throw std::runtime_error(
+            path_ + " has pages of different sizes or sample types, page " + std::to_string(pages_.size()));
+    }
+
+    std::vector<std::uint64_t> strip_offsets;
+    std::vector<std::uint64_t> strip_byte_counts;
+
+    for (Entry const & entry : entries)
+    {
+        if (entry.tag == STRIP_OFFSETS)
+            strip_offsets = values(entry);
+        else if (entry.tag == STRIP_BYTE_COUNTS)
+            strip_byte_counts = values(entry);
+    }
+
+    std::size_t const row_size = width * get_data_type_size(data_type);
+    std::size_t const rows_per_strip = std::size_t(std::min<std::uint64_t>(value(ROWS_PER_STRIP, height), height));
+    std::size_t const n_strips = rows_per_strip ? (height + rows_per_strip - 1) / rows_per_strip : 0;
+
+    if (n_strips == 0 || strip_offsets.size() != n_strips || strip_byte_counts.size() != n_strips)
+    {
+        throw std::runtime_error(path_ + " has a page with invalid strips");
+    }
+
+    Page page;
+    page.first_strip = strips_.size();
+    page.n_strips = n_strips;
+
+    for (std::size_t i = 0; i < n_strips; i++)
+    {
+        Strip strip;
+        strip.offset = strip_offsets[i];
+        // the last strip may have fewer rows
+        strip.size = std::min(rows_per_strip, height - i * rows_per_strip) * row_size;
+
+        if (strip_byte_counts[i] < strip.size || strip.offset > file_.size() || file_.size() - strip.offset < strip.size)
+        {
+            throw std::runtime_error(path_ + " is truncated");
+        }
+
+        strips_.push_back(strip);
+    }
+
+    pages_.push_back(page);
+
+    return next_ifd_offset;
+}
+
+void TiffStack::copy_page(std::size_t const page_index, char * samples) const
+{
+    Page const & page = pages_[page_index];
+
+    for (std::size_t i = 0; i < page.n_strips; i++)
+    {
+        Strip const & strip = strips_[page.first_strip + i];
+        std::memcpy(samples, data_ + strip.offset, strip.size);
+        samples += strip.size;
+    }
+
+    if (swap_bytes_)
+    {
+        std::size_t const sample_size = get_data_type_size(data_type_);
+        std::size_t const page_size = width_ * height_ * sample_size;
+
+        for (char * sample = samples - page_size; sample != samples; sample += sample_size)
+            std::reverse(sample, sample + sample_size);
+    }
+}
+
+void TiffStack::read_pages(std::size_t const first_page, std::size_t const n_pages, char * samples) const
+{
+    if (first_page > pages_.size() || pages_.size() - first_page < n_pages)
+    {
+        throw std::runtime_error("pages out of range");
+    }
+
+    std::size_t const page_size = width_ * height_ * get_data_type_size(data_type_);
+
+    // contiguous ranges of pages in parallel, which mostly wait for the pages
+    // of the mapping to be read from disk
+    std::size_t const n_threads = std::max<std::size_t>(
+        1, std::min<std::size_t>(std::thread::hardware_concurrency(), n_pages / 16));
+
+    auto copy_pages = [&](std::size_t const thread_index) {
+        std::size_t const begin = n_pages * thread_index / n_threads;
+        std::size_t const end = n_pages * (thread_index + 1) / n_threads;
+
+        for (std::size_t i = begin; i < end; i++)
+            copy_page(first_page + i, samples + i * page_size);
+    };
+
+    std::vector<std::thread> threads;
+
+    for (std::size_t thread_index = 1; thread_index < n_threads; thread_index++)
+        threads.emplace_back(copy_pages, thread_index);
+
+    copy_pages(0);
+
+    for (std::thread & thread : threads)
+        thread.join();
+}
+
+TiffRoiSource::TiffRoiSource(std::string const & path) : stack_(path)
+{
+}
+
+void TiffRoiSource::read(std::size_t const first_fit, std::size_t const n_fits, char * samples)
+{
+    stack_.read_pages(first_fit, n_fits, samples);
+}
@@ -0,0 +1,84 @@
+#ifndef CPUFIT_CLI_TIFF_STACK_H_INCLUDED
+#define CPUFIT_CLI_TIFF_STACK_H_INCLUDED
+
+#include "roi_source.h"
+#include "../mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the pages of an uncompressed baseline TIFF or BigTIFF file in either byte
+// order, with one sample per pixel in strips anywhere in the file; all pages
+// must have the same size and sample type
+//
+// The file is memory mapped, and the strips of the pages are copied from
+// the mapping, in parallel, without converting the samples.
+class TiffStack
+{
+public:
+    explicit TiffStack(std::string const & path);
+
+    std::size_t n_pages() const { return pages_.size(); }
+    std::size_t width() const { return width_; }
+    std::size_t height() const { return height_; }
+    DataType data_type() const { return data_type_; }
+
+    // copies the samples of n_pages pages starting at first_page row by row
+    // in the byte order of the machine
+    void read_pages(std::size_t const first_page, std::size_t const n_pages, char * samples) const;
+
+private:
+    struct Strip
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct Page
+    {
+        // index of the first strip of the page in strips_
+        std::size_t first_strip;
+        std::size_t n_strips;
+    };
+
+    std::uint64_t read_integer(std::uint64_t const offset, std::size_t const size) const;
+    std::uint64_t read_page(std::uint64_t const ifd_offset);
+    void copy_page(std::size_t const page_index, char * samples) const;
+
+    std::string const path_;
+    MappedFile file_;
+    std::unique_ptr<MappedFile::Window> mapping_;
+    char const * data_;
+
+    bool big_tiff_;
+    bool swap_bytes_;
+
+    std::size_t width_;
+    std::size_t height_;
+    DataType data_type_;
+
+    std::vector<Page> pages_;
+    std::vector<Strip> strips_;
+};
+
+// the pages of a TIFF stack as ROIs
+class TiffRoiSource : public RoiSource
+{
+public:
+    explicit TiffRoiSource(std::string const & path);
+
+    std::size_t n_fits() const { return stack_.n_pages(); }
+    std::size_t n_points() const { return stack_.width() * stack_.height(); }
+    std::size_t width() const { return stack_.width(); }
+    DataType data_type() const { return stack_.data_type(); }
+
+    void read(std::size_t const first_fit, std::size_t const n_fits, char * samples);
+
+private:
+    TiffStack stack_;
+};
+
+#endif
@@ -1,10 +1,31 @@
 #include "cpufit.h"
 #include "../Gpufit/constants.h"
 #include "interface.h"
+#include "filtered_fit.h"
+#include "executor.h"
+#include "allocator.h"
+#include "latency_histogram.h"
+#include "thread_pool.h"
+#include "scheduler.h"
+#include "cancellation.h"
+#include "spot_detection.h"
+#include "model_parameters.h"
 
+#ifndef _WIN32
+#include "shard_coordinator.h"
+#include "file_fit.h"
+#include "result_file.h"
+#include "result_cache.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
-std::string last_error ;
+thread_local std::string last_error ;
 
 int cpufit
 (
@@ -31,14 +52,12 @@ try
         data,
         weights,
         n_fits,
-        static_cast<int>(n_points),
+        n_points,
         tolerance,
         max_n_iterations,
         static_cast<EstimatorID>(estimator_id),
         initial_parameters,
         parameters_to_fit,
-        NULL,
-        NULL,
         user_info,
         user_info_size,
         output_parameters,
@@ -86,24 +105,27 @@ int cpufit_constrained
 )
 try
 {
+    FitOptions options;
+    options.constraints = constraints;
+    options.constraint_types = constraint_types;
+
     FitInterface fi(
         data,
         weights,
         n_fits,
-        static_cast<int>( n_points ),
+        n_points,
         tolerance,
         max_n_iterations,
         static_cast<EstimatorID>( estimator_id ),
         initial_parameters,
         parameters_to_fit,
-        constraints,
-        constraint_types,
         user_info,
         user_info_size,
         output_parameters,
         output_states,
         output_chi_squares,
-        output_n_iterations );
+        output_n_iterations,
+        options);
 
     fi.fit( static_cast<ModelID>( model_id ) );
 
@@ -122,7 +144,1559 @@ catch( ... )
     return ReturnState::ERROR;
 }
 
+int cpufit_ragged
+(
+    std::size_t n_fits,
+    std::size_t const * point_offsets,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    FitOptions options;
+    options.point_offsets = point_offsets;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        0,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_masked
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t n_point_masks,
+    char * point_mask,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    FitOptions options;
+    options.point_mask = point_mask;
+    options.n_point_masks = n_point_masks;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_per_fit_parameters_to_fit
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    FitOptions options;
+    options.per_fit_parameters_to_fit = true;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
 char const * cpufit_get_last_error()
 {
     return last_error.c_str();
 }
+
+int cpufit_mixed_models
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int * model_ids,
+    std::size_t * parameter_offsets,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    FitOptions options;
+    options.per_fit_parameters_to_fit = true;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(model_ids, parameter_offsets);
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_deadline
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    double time_budget,
+    int * fit_priorities,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    if (std::isnan(time_budget))
+    {
+        throw std::runtime_error("time budget is not a number");
+    }
+
+    if (!(time_budget > 0))
+    {
+        throw std::runtime_error("time budget must be positive");
+    }
+
+    FitOptions options;
+    options.time_budget = time_budget;
+    options.fit_priorities = fit_priorities;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_cancellable
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    cpufit_cancellation_token * cancellation_token,
+    cpufit_progress_function progress,
+    void * progress_context,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    FitOptions options;
+    options.cancellation_token = cancellation_token;
+    options.progress = progress;
+    options.progress_context = progress_context;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_filtered
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    int accepted_states,
+    REAL max_chi_square,
+    REAL * parameter_ranges,
+    std::size_t * output_n_fits,
+    std::size_t * output_fit_indices,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    if (!output_n_fits || !output_fit_indices)
+    {
+        throw std::runtime_error("no output for the number or the indices of accepted fits");
+    }
+
+    ResultFilter const filter(
+        accepted_states,
+        max_chi_square,
+        parameter_ranges,
+        get_number_of_parameters(static_cast<ModelID>(model_id)));
+
+    FilteredFit filtered_fit(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        static_cast<ModelID>(model_id),
+        initial_parameters,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        static_cast<EstimatorID>(estimator_id),
+        user_info_size,
+        user_info,
+        filter,
+        output_fit_indices,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations);
+
+    *output_n_fits = filtered_fit.run();
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_with_statistics
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations,
+    REAL * output_variances,
+    REAL * output_reduced_chi_squares,
+    REAL * output_residual_rms
+)
+try
+{
+    FitOptions options;
+    options.output_variances = output_variances;
+    options.output_reduced_chi_squares = output_reduced_chi_squares;
+    options.output_residual_rms = output_residual_rms;
+
+    FitInterface fi(
+        data,
+        weights,
+        n_fits,
+        n_points,
+        tolerance,
+        max_n_iterations,
+        static_cast<EstimatorID>(estimator_id),
+        initial_parameters,
+        parameters_to_fit,
+        user_info,
+        user_info_size,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        options);
+
+    fi.fit(static_cast<ModelID>(model_id));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_sharded
+(
+    std::size_t n_workers,
+    char const * worker_path,
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("sharding across worker processes requires POSIX shared memory");
+#else
+    ShardCoordinator coordinator(
+        n_workers,
+        worker_path,
+        data,
+        weights,
+        n_fits,
+        n_points,
+        model_id,
+        initial_parameters,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info,
+        user_info_size);
+
+    coordinator.run(
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations);
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_fit_files
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    char const * data_file,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t memory_budget,
+    char const * output_parameters_file,
+    char const * output_states_file,
+    char const * output_chi_squares_file,
+    char const * output_n_iterations_file
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("fitting from files requires POSIX memory mapping");
+#else
+    FileFit file_fit(
+        n_fits,
+        n_points,
+        data_file,
+        weights_file,
+        static_cast<ModelID>(model_id),
+        initial_parameters_file,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        static_cast<EstimatorID>(estimator_id),
+        user_info_size,
+        user_info,
+        memory_budget,
+        output_parameters_file,
+        output_states_file,
+        output_chi_squares_file,
+        output_n_iterations_file,
+        0,
+        0.);
+
+    file_fit.run();
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_fit_files_resumable
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    char const * data_file,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t memory_budget,
+    char const * output_parameters_file,
+    char const * output_states_file,
+    char const * output_chi_squares_file,
+    char const * output_n_iterations_file,
+    char const * journal_file,
+    double checkpoint_interval
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("fitting from files requires POSIX memory mapping");
+#else
+    if (!journal_file)
+    {
+        throw std::runtime_error("no journal file name");
+    }
+
+    FileFit file_fit(
+        n_fits,
+        n_points,
+        data_file,
+        weights_file,
+        static_cast<ModelID>(model_id),
+        initial_parameters_file,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        static_cast<EstimatorID>(estimator_id),
+        user_info_size,
+        user_info,
+        memory_budget,
+        output_parameters_file,
+        output_states_file,
+        output_chi_squares_file,
+        output_n_iterations_file,
+        journal_file,
+        checkpoint_interval);
+
+    file_fit.run();
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+cpufit_result_writer * cpufit_open_result_writer
+(
+    char const * path,
+    int model_id,
+    int * column_encodings
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    return new cpufit_result_writer(path, static_cast<ModelID>(model_id), column_encodings);
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_write_results
+(
+    cpufit_result_writer * writer,
+    std::size_t n_fits,
+    REAL * parameters,
+    int * states,
+    REAL * chi_squares,
+    int * n_iterations
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!writer)
+    {
+        throw std::runtime_error("no result writer");
+    }
+
+    writer->write(n_fits, parameters, states, chi_squares, n_iterations);
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_close_result_writer(cpufit_result_writer * writer)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!writer)
+    {
+        throw std::runtime_error("no result writer");
+    }
+
+    // the writer is destroyed even if the last blocks cannot be written
+    std::unique_ptr<cpufit_result_writer> const closed_writer(writer);
+    closed_writer->close();
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+cpufit_result_reader * cpufit_open_result_reader(char const * path)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    return new cpufit_result_reader(path);
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_get_result_header
+(
+    cpufit_result_reader * reader,
+    int * model_id,
+    std::size_t * n_parameters,
+    std::size_t * n_fits,
+    std::size_t * n_blocks
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!reader)
+    {
+        throw std::runtime_error("no result reader");
+    }
+
+    *model_id = reader->model_id();
+    *n_parameters = reader->n_parameters();
+    *n_fits = reader->n_fits();
+    *n_blocks = reader->n_blocks();
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+char const * cpufit_get_result_parameter_name
+(
+    cpufit_result_reader * reader,
+    std::size_t parameter_index
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!reader)
+    {
+        throw std::runtime_error("no result reader");
+    }
+
+    return reader->parameter_name(parameter_index).c_str();
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_read_results
+(
+    cpufit_result_reader * reader,
+    std::size_t first_fit,
+    std::size_t n_fits,
+    REAL * parameters,
+    int * states,
+    REAL * chi_squares,
+    int * n_iterations
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!reader)
+    {
+        throw std::runtime_error("no result reader");
+    }
+
+    reader->read(first_fit, n_fits, parameters, states, chi_squares, n_iterations);
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+void const * cpufit_map_result_column
+(
+    cpufit_result_reader * reader,
+    std::size_t block_index,
+    std::size_t column_index,
+    std::size_t * n_values
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!reader)
+    {
+        throw std::runtime_error("no result reader");
+    }
+
+    return reader->map_column(block_index, column_index, *n_values);
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_close_result_reader(cpufit_result_reader * reader)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("result files require POSIX memory mapping");
+#else
+    if (!reader)
+    {
+        throw std::runtime_error("no result reader");
+    }
+
+    delete reader;
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+cpufit_result_cache * cpufit_open_result_cache(char const * directory, std::size_t max_size)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("the result cache requires POSIX memory mapping");
+#else
+    return new cpufit_result_cache(directory, max_size);
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_set_result_cache(cpufit_result_cache * cache)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("the result cache requires POSIX memory mapping");
+#else
+    set_thread_result_cache(cache);
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_clear_result_cache(cpufit_result_cache * cache)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("the result cache requires POSIX memory mapping");
+#else
+    if (!cache)
+    {
+        throw std::runtime_error("no result cache");
+    }
+
+    cache->clear();
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_get_result_cache_statistics
+(
+    cpufit_result_cache * cache,
+    std::size_t * n_hits,
+    std::size_t * n_misses,
+    std::size_t * n_entries,
+    std::size_t * size
+)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("the result cache requires POSIX memory mapping");
+#else
+    if (!cache)
+    {
+        throw std::runtime_error("no result cache");
+    }
+
+    ResultCache::Statistics const statistics = cache->statistics();
+
+    if (n_hits)
+        *n_hits = statistics.n_hits;
+    if (n_misses)
+        *n_misses = statistics.n_misses;
+    if (n_entries)
+        *n_entries = statistics.n_entries;
+    if (size)
+        *size = statistics.size;
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_close_result_cache(cpufit_result_cache * cache)
+try
+{
+#ifdef _WIN32
+    throw std::runtime_error("the result cache requires POSIX memory mapping");
+#else
+    if (!cache)
+    {
+        throw std::runtime_error("no result cache");
+    }
+
+    // the calling thread stops using the cache, other threads must have
+    // stopped before
+    if (get_thread_result_cache() == cache)
+        set_thread_result_cache(0);
+
+    delete cache;
+
+    return ReturnState::OK;
+#endif
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_detect_spots
+(
+    std::size_t n_frames,
+    std::size_t width,
+    std::size_t height,
+    REAL * frames,
+    REAL sigma,
+    REAL threshold,
+    std::size_t roi_size,
+    int model_id,
+    std::size_t max_n_spots,
+    std::size_t * output_n_spots,
+    std::size_t * output_roi_corners,
+    REAL * output_rois,
+    REAL * output_initial_parameters
+)
+try
+{
+    if (!frames || !output_n_spots || (max_n_spots && !output_roi_corners))
+    {
+        throw std::runtime_error("no frames or outputs");
+    }
+
+    SpotDetector const detector(width, height, sigma, threshold, roi_size);
+
+    Buffer<Spot> spots;
+    detector.detect(n_frames, frames, spots);
+
+    // all spots are counted, the first max_n_spots are returned
+    *output_n_spots = spots.size();
+
+    std::size_t const n_points = roi_size * roi_size;
+    std::size_t const n_parameters
+        = output_initial_parameters ? get_number_of_parameters(static_cast<ModelID>(model_id)) : 0;
+    Buffer<REAL> roi(n_points);
+
+    for (std::size_t i = 0; i < std::min(max_n_spots, spots.size()); i++)
+    {
+        output_roi_corners[3 * i] = spots[i].frame;
+        output_roi_corners[3 * i + 1] = spots[i].x;
+        output_roi_corners[3 * i + 2] = spots[i].y;
+
+        REAL * const spot_roi = output_rois ? output_rois + i * n_points : roi.data();
+        detector.extract(frames, spots[i], spot_roi);
+
+        if (output_initial_parameters)
+        {
+            detector.estimate_parameters(
+                static_cast<ModelID>(model_id),
+                spot_roi,
+                output_initial_parameters + i * n_parameters);
+        }
+    }
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+cpufit_cancellation_token * cpufit_create_cancellation_token()
+try
+{
+    cpufit_cancellation_token * const cancellation_token = new cpufit_cancellation_token;
+    cancellation_token->cancelled = false;
+
+    return cancellation_token;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return NULL;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return NULL;
+}
+
+int cpufit_cancel(cpufit_cancellation_token * cancellation_token)
+try
+{
+    if (!cancellation_token)
+    {
+        throw std::runtime_error("cancellation token is null");
+    }
+
+    cancellation_token->cancelled = true;
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_destroy_cancellation_token(cpufit_cancellation_token * cancellation_token)
+try
+{
+    delete cancellation_token;
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_set_executor
+(
+    cpufit_parallel_for_function parallel_for,
+    cpufit_submit_function submit,
+    std::size_t n_threads,
+    void * executor_context
+)
+try
+{
+    if (!parallel_for)
+    {
+        set_executor(std::shared_ptr<Executor>());
+
+        return ReturnState::OK;
+    }
+
+    if (n_threads == 0)
+    {
+        throw std::runtime_error("number of executor threads is zero");
+    }
+
+    set_executor(std::make_shared<ExternalExecutor>(parallel_for, submit, n_threads, executor_context));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_set_allocator
+(
+    cpufit_allocate_function allocate,
+    cpufit_free_function free,
+    void * allocator_context
+)
+try
+{
+    if (!allocate != !free)
+    {
+        throw std::runtime_error("allocate and free functions must be set together");
+    }
+
+    set_allocator(allocate, free, allocator_context);
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_set_real_time_mode
+(
+    int enable,
+    std::size_t n_threads,
+    std::size_t workspace_size
+)
+try
+{
+    if (!enable)
+    {
+        set_real_time_executor(std::shared_ptr<Executor>());
+
+        return ReturnState::OK;
+    }
+
+    if (n_threads == 0)
+    {
+        throw std::runtime_error("number of real-time threads is zero");
+    }
+
+    if (workspace_size == 0)
+    {
+        throw std::runtime_error("workspace size is zero");
+    }
+
+    set_real_time_executor(create_real_time_thread_pool(n_threads, workspace_size));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_get_latency_statistics
+(
+    std::size_t * n_batches,
+    double * p50,
+    double * p99,
+    double * max
+)
+try
+{
+    LatencyHistogram const & latency_histogram = get_latency_histogram();
+
+    // latencies are reported in microseconds
+    if (n_batches)
+        *n_batches = latency_histogram.n_values();
+    if (p50)
+        *p50 = latency_histogram.quantile(.5) / 1000.;
+    if (p99)
+        *p99 = latency_histogram.quantile(.99) / 1000.;
+    if (max)
+        *max = latency_histogram.max() / 1000.;
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_reset_latency_statistics()
+try
+{
+    get_latency_histogram().reset();
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_set_scheduling
+(
+    int priority_class,
+    double weight
+)
+try
+{
+    if (priority_class < HIGH_PRIORITY || priority_class > LOW_PRIORITY)
+    {
+        throw std::runtime_error("unknown priority class");
+    }
+
+    if (!(weight > 0))
+    {
+        throw std::runtime_error("weight must be positive");
+    }
+
+    set_thread_scheduling(priority_class, weight);
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_get_scheduler_statistics
+(
+    int priority_class,
+    std::size_t * n_batches,
+    std::size_t * n_chunks,
+    double * queueing_time,
+    double * service_time
+)
+try
+{
+    if (priority_class < HIGH_PRIORITY || priority_class > LOW_PRIORITY)
+    {
+        throw std::runtime_error("unknown priority class");
+    }
+
+    std::size_t batches, chunks;
+    double queueing, service;
+    get_scheduler().get_statistics(priority_class, batches, chunks, queueing, service);
+
+    if (n_batches)
+        *n_batches = batches;
+    if (n_chunks)
+        *n_chunks = chunks;
+    if (queueing_time)
+        *queueing_time = queueing;
+    if (service_time)
+        *service_time = service;
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_reset_scheduler_statistics()
+try
+{
+    get_scheduler().reset_statistics();
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
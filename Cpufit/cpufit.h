@@ -17,6 +17,39 @@
 extern "C" {
 #endif
 
+typedef void (*cpufit_task_function)(void * task_context, std::size_t task_index);
+
+typedef void (*cpufit_job_function)(void * job_context);
+
+typedef void (*cpufit_parallel_for_function)
+(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void * executor_context
+);
+
+typedef void (*cpufit_submit_function)
+(
+    cpufit_job_function job,
+    void * job_context,
+    void * executor_context
+);
+
+typedef void * (*cpufit_allocate_function)(std::size_t size, void * allocator_context);
+
+typedef void (*cpufit_free_function)(void * pointer, std::size_t size, void * allocator_context);
+
+typedef void (*cpufit_progress_function)(std::size_t n_finished_fits, std::size_t n_fits, void * progress_context);
+
+struct cpufit_cancellation_token;
+
+struct cpufit_result_writer;
+
+struct cpufit_result_reader;
+
+struct cpufit_result_cache;
+
 VISIBLE int cpufit
 (
     std::size_t n_fits,
@@ -59,6 +92,403 @@ VISIBLE int cpufit_constrained
     int* output_n_iterations
 );
 
+VISIBLE int cpufit_ragged
+(
+    std::size_t n_fits,
+    std::size_t const * point_offsets,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_masked
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t n_point_masks,
+    char * point_mask,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_per_fit_parameters_to_fit
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_mixed_models
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int * model_ids,
+    std::size_t * parameter_offsets,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_deadline
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    double time_budget,
+    int * fit_priorities,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_cancellable
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    cpufit_cancellation_token * cancellation_token,
+    cpufit_progress_function progress,
+    void * progress_context,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_filtered
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    int accepted_states,
+    REAL max_chi_square,
+    REAL * parameter_ranges,
+    std::size_t * output_n_fits,
+    std::size_t * output_fit_indices,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_with_statistics
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations,
+    REAL * output_variances,
+    REAL * output_reduced_chi_squares,
+    REAL * output_residual_rms
+);
+
+VISIBLE int cpufit_sharded
+(
+    std::size_t n_workers,
+    char const * worker_path,
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_fit_files
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    char const * data_file,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t memory_budget,
+    char const * output_parameters_file,
+    char const * output_states_file,
+    char const * output_chi_squares_file,
+    char const * output_n_iterations_file
+);
+
+VISIBLE int cpufit_fit_files_resumable
+(
+    std::size_t n_fits,
+    std::size_t n_points,
+    char const * data_file,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    std::size_t memory_budget,
+    char const * output_parameters_file,
+    char const * output_states_file,
+    char const * output_chi_squares_file,
+    char const * output_n_iterations_file,
+    char const * journal_file,
+    double checkpoint_interval
+);
+
+VISIBLE cpufit_result_writer * cpufit_open_result_writer
+(
+    char const * path,
+    int model_id,
+    int * column_encodings
+);
+
+VISIBLE int cpufit_write_results
+(
+    cpufit_result_writer * writer,
+    std::size_t n_fits,
+    REAL * parameters,
+    int * states,
+    REAL * chi_squares,
+    int * n_iterations
+);
+
+VISIBLE int cpufit_close_result_writer(cpufit_result_writer * writer);
+
+VISIBLE cpufit_result_reader * cpufit_open_result_reader(char const * path);
+
+VISIBLE int cpufit_get_result_header
+(
+    cpufit_result_reader * reader,
+    int * model_id,
+    std::size_t * n_parameters,
+    std::size_t * n_fits,
+    std::size_t * n_blocks
+);
+
+VISIBLE char const * cpufit_get_result_parameter_name
+(
+    cpufit_result_reader * reader,
+    std::size_t parameter_index
+);
+
+VISIBLE int cpufit_read_results
+(
+    cpufit_result_reader * reader,
+    std::size_t first_fit,
+    std::size_t n_fits,
+    REAL * parameters,
+    int * states,
+    REAL * chi_squares,
+    int * n_iterations
+);
+
+VISIBLE void const * cpufit_map_result_column
+(
+    cpufit_result_reader * reader,
+    std::size_t block_index,
+    std::size_t column_index,
+    std::size_t * n_values
+);
+
+VISIBLE int cpufit_close_result_reader(cpufit_result_reader * reader);
+
+VISIBLE cpufit_result_cache * cpufit_open_result_cache(char const * directory, std::size_t max_size);
+
+// fit calls of the calling thread use the cache, unless allocator hooks are
+// registered
+VISIBLE int cpufit_set_result_cache(cpufit_result_cache * cache);
+
+VISIBLE int cpufit_clear_result_cache(cpufit_result_cache * cache);
+
+VISIBLE int cpufit_get_result_cache_statistics
+(
+    cpufit_result_cache * cache,
+    std::size_t * n_hits,
+    std::size_t * n_misses,
+    std::size_t * n_entries,
+    std::size_t * size
+);
+
+VISIBLE int cpufit_close_result_cache(cpufit_result_cache * cache);
+
+VISIBLE int cpufit_detect_spots
+(
+    std::size_t n_frames,
+    std::size_t width,
+    std::size_t height,
+    REAL * frames,
+    REAL sigma,
+    REAL threshold,
+    std::size_t roi_size,
+    int model_id,
+    std::size_t max_n_spots,
+    std::size_t * output_n_spots,
+    std::size_t * output_roi_corners,
+    REAL * output_rois,
+    REAL * output_initial_parameters
+);
+
+VISIBLE cpufit_cancellation_token * cpufit_create_cancellation_token();
+
+VISIBLE int cpufit_cancel(cpufit_cancellation_token * cancellation_token);
+
+VISIBLE int cpufit_destroy_cancellation_token(cpufit_cancellation_token * cancellation_token);
+
+VISIBLE int cpufit_set_executor
+(
+    cpufit_parallel_for_function parallel_for,
+    cpufit_submit_function submit,
+    std::size_t n_threads,
+    void * executor_context
+);
+
+// internal buffers are allocated by the hooks registered when the buffer is
+// created and freed by the free function and context of the same hooks, also
+// if other hooks have been registered since; the hooks may be changed while
+// fits run, but all registered hooks must stay valid until those fits return;
+// while hooks are registered, fit calls bypass the result cache
+VISIBLE int cpufit_set_allocator
+(
+    cpufit_allocate_function allocate,
+    cpufit_free_function free,
+    void * allocator_context
+);
+
+VISIBLE int cpufit_set_real_time_mode
+(
+    int enable,
+    std::size_t n_threads,
+    std::size_t workspace_size
+);
+
+// outputs which are null pointers are not written
+VISIBLE int cpufit_get_latency_statistics
+(
+    std::size_t * n_batches,
+    double * p50,
+    double * p99,
+    double * max
+);
+
+VISIBLE int cpufit_reset_latency_statistics();
+
+VISIBLE int cpufit_set_scheduling
+(
+    int priority_class,
+    double weight
+);
+
+// outputs which are null pointers are not written
+VISIBLE int cpufit_get_scheduler_statistics
+(
+    int priority_class,
+    std::size_t * n_batches,
+    std::size_t * n_chunks,
+    double * queueing_time,
+    double * service_time
+);
+
+VISIBLE int cpufit_reset_scheduler_statistics();
+
 VISIBLE char const * cpufit_get_last_error() ;
 
 #ifdef __cplusplus
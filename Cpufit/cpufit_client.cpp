@@ -0,0 +1,243 @@
+#include "cpufit_client.h"
+#include "daemon_protocol.h"
+#include "model_parameters.h"
+#include "shard_protocol.h"
+#include "shared_memory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+thread_local std::string last_error ;
+
+// a connection to cpufitd with the memory file its batches are passed in
+struct cpufit_client
+{
+    int socket;
+    std::unique_ptr<SharedMemory> memory;
+    bool memory_sent;
+
+    // one batch at a time
+    std::mutex mutex;
+};
+
+// the memory file grows to the largest batch so far and is kept for the
+// next ones
+static void reserve_memory(cpufit_client & client, std::size_t const size)
+{
+    if (client.memory && client.memory->size() >= size)
+        return;
+
+    client.memory.reset();
+    client.memory.reset(new SharedMemory(size + size / 2, "cpufit_client"));
+    client.memory_sent = false;
+}
+
+static DaemonReply send_batch(cpufit_client & client, DaemonRequest const & request)
+{
+    int const file_descriptor = client.memory_sent ? -1 : client.memory->file_descriptor();
+
+    DaemonReply reply;
+
+    if (!send_request(client.socket, request, file_descriptor)
+        || !receive_message(client.socket, &reply, sizeof(reply)))
+    {
+        throw std::runtime_error("connection to cpufitd lost");
+    }
+
+    client.memory_sent = true;
+    reply.error[sizeof(reply.error) - 1] = 0;
+
+    return reply;
+}
+
+cpufit_client * cpufit_client_connect(char const * socket_path)
+try
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (std::strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("socket path too long");
+    }
+
+    std::strcpy(address.sun_path, socket_path);
+
+    int const socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (socket < 0 || connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        std::string const error = std::strerror(errno);
+
+        if (socket >= 0)
+            close(socket);
+
+        throw std::runtime_error("cannot connect to cpufitd at " + std::string(socket_path) + ": " + error);
+    }
+
+    cpufit_client * const client = new cpufit_client;
+    client->socket = socket;
+    client->memory_sent = false;
+
+    return client;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return 0;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return 0;
+}
+
+int cpufit_remote
+(
+    cpufit_client * client,
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+)
+try
+{
+    if (!client)
+    {
+        throw std::runtime_error("no client");
+    }
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+
+    ShardHeader h = ShardHeader();
+    h.magic = shard_magic;
+    h.real_size = sizeof(REAL);
+    h.n_fits = n_fits;
+    h.n_points = n_points;
+    h.n_parameters = get_number_of_parameters(static_cast<ModelID>(model_id));
+    h.user_info_size = user_info ? user_info_size : 0;
+    h.model_id = model_id;
+    h.estimator_id = estimator_id;
+    h.max_n_iterations = max_n_iterations;
+    h.has_weights = weights ? 1 : 0;
+    h.tolerance = tolerance;
+
+    set_shard_layout(h);
+    reserve_memory(*client, h.size);
+
+    char * const memory = static_cast<char *>(client->memory->data());
+
+    std::memcpy(memory, &h, sizeof(h));
+    std::memcpy(memory + h.data, data, n_fits * n_points * sizeof(REAL));
+    std::memcpy(memory + h.initial_parameters, initial_parameters, n_fits * h.n_parameters * sizeof(REAL));
+    std::memcpy(memory + h.parameters_to_fit, parameters_to_fit, h.n_parameters * sizeof(int));
+
+    if (weights)
+        std::memcpy(memory + h.weights, weights, n_fits * n_points * sizeof(REAL));
+
+    DaemonRequest request = DaemonRequest();
+    request.magic = daemon_magic;
+    request.has_user_info = 1;
+
+    // large user info is first looked up in the cache of the daemon, which
+    // keeps it once it is sent
+    if (h.user_info_size >= min_cached_user_info_size)
+    {
+        request.user_info_key = get_user_info_key(user_info, h.user_info_size);
+        request.has_user_info = 0;
+    }
+    else if (h.user_info_size)
+    {
+        std::memcpy(memory + h.user_info, user_info, h.user_info_size);
+    }
+
+    request.has_memory_file = client->memory_sent ? 0 : 1;
+    DaemonReply reply = send_batch(*client, request);
+
+    if (reply.user_info_missing)
+    {
+        std::memcpy(memory + h.user_info, user_info, h.user_info_size);
+
+        request.has_user_info = 1;
+        request.has_memory_file = 0;
+        reply = send_batch(*client, request);
+    }
+
+    if (reply.status != ReturnState::OK)
+    {
+        throw std::runtime_error(reply.error);
+    }
+
+    std::memcpy(output_parameters, memory + h.output_parameters, n_fits * h.n_parameters * sizeof(REAL));
+    std::memcpy(output_states, memory + h.output_states, n_fits * sizeof(int));
+    std::memcpy(output_chi_squares, memory + h.output_chi_squares, n_fits * sizeof(REAL));
+    std::memcpy(output_n_iterations, memory + h.output_n_iterations, n_fits * sizeof(int));
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+int cpufit_client_disconnect(cpufit_client * client)
+try
+{
+    if (!client)
+    {
+        throw std::runtime_error("no client");
+    }
+
+    close(client->socket);
+    delete client;
+
+    return ReturnState::OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return ReturnState::ERROR;
+}
+catch (...)
+{
+    last_error = "Unknown Error";
+
+    return ReturnState::ERROR;
+}
+
+char const * cpufit_client_get_last_error()
+{
+    return last_error.c_str();
+}
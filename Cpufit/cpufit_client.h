@@ -0,0 +1,49 @@
+#ifndef CPUFIT_CLIENT_H_INCLUDED
+#define CPUFIT_CLIENT_H_INCLUDED
+
+#ifdef __linux__
+#define VISIBLE __attribute__((visibility("default")))
+#endif
+
+#include <cstddef>
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cpufit_client;
+
+VISIBLE cpufit_client * cpufit_client_connect(char const * socket_path);
+
+VISIBLE int cpufit_remote
+(
+    cpufit_client * client,
+    std::size_t n_fits,
+    std::size_t n_points,
+    REAL * data,
+    REAL * weights,
+    int model_id,
+    REAL * initial_parameters,
+    REAL tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    std::size_t user_info_size,
+    char * user_info,
+    REAL * output_parameters,
+    int * output_states,
+    REAL * output_chi_squares,
+    int * output_n_iterations
+);
+
+VISIBLE int cpufit_client_disconnect(cpufit_client * client);
+
+VISIBLE char const * cpufit_client_get_last_error();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CPUFIT_CLIENT_H_INCLUDED
@@ -0,0 +1,107 @@
+// worker process of cpufit_sharded: fits the shards of a batch in shared
+// memory which the coordinator sends over a socket
+
+#include "cpufit.h"
+#include "model_parameters.h"
+#include "shard_protocol.h"
+#include "shared_memory.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+static int fit_shard(ShardHeader const & h, char * const memory, ShardRequest const & request)
+{
+    if (request.first_fit + request.n_fits > h.n_fits)
+    {
+        throw std::runtime_error("shard out of range");
+    }
+
+    std::size_t const first_value = request.first_fit * h.n_points;
+    std::size_t const first_parameter = request.first_fit * h.n_parameters;
+
+    REAL * const data = reinterpret_cast<REAL *>(memory + h.data) + first_value;
+    REAL * const weights = h.has_weights ? reinterpret_cast<REAL *>(memory + h.weights) + first_value : 0;
+
+    char * user_info = h.user_info_size ? memory + h.user_info : 0;
+    std::size_t user_info_size = h.user_info_size;
+    slice_user_info(
+        static_cast<ModelID>(h.model_id),
+        h.n_points,
+        request.first_fit,
+        request.n_fits,
+        user_info,
+        user_info_size);
+
+    return cpufit(
+        request.n_fits,
+        h.n_points,
+        data,
+        weights,
+        h.model_id,
+        reinterpret_cast<REAL *>(memory + h.initial_parameters) + first_parameter,
+        REAL(h.tolerance),
+        h.max_n_iterations,
+        reinterpret_cast<int *>(memory + h.parameters_to_fit),
+        h.estimator_id,
+        user_info_size,
+        user_info,
+        reinterpret_cast<REAL *>(memory + h.output_parameters) + first_parameter,
+        reinterpret_cast<int *>(memory + h.output_states) + request.first_fit,
+        reinterpret_cast<REAL *>(memory + h.output_chi_squares) + request.first_fit,
+        reinterpret_cast<int *>(memory + h.output_n_iterations) + request.first_fit);
+}
+
+int main(int argc, char * argv[])
+try
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: cpufit_worker <socket> <shared memory>" << std::endl
+            << "started by cpufit_sharded" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    int const socket = std::atoi(argv[1]);
+    int const file_descriptor = std::atoi(argv[2]);
+
+    SharedMemory memory(file_descriptor);
+    char * const bytes = static_cast<char *>(memory.data());
+    ShardHeader const & header = *static_cast<ShardHeader const *>(memory.data());
+
+    if (memory.size() < sizeof(ShardHeader)
+        || header.magic != shard_magic
+        || header.real_size != sizeof(REAL)
+        || header.size > memory.size())
+    {
+        throw std::runtime_error("shared memory of a different Cpufit version");
+    }
+
+    ShardRequest request;
+
+    while (receive_message(socket, &request, sizeof(request)))
+    {
+        ShardReply reply;
+        std::memset(&reply, 0, sizeof(reply));
+
+        reply.first_fit = request.first_fit;
+        reply.status = fit_shard(header, bytes, request);
+
+        if (reply.status != ReturnState::OK)
+            std::strncpy(reply.error, cpufit_get_last_error(), sizeof(reply.error) - 1);
+
+        if (!send_message(socket, &reply, sizeof(reply)))
+            break;
+    }
+
+    return EXIT_SUCCESS;
+}
+catch (std::exception & exception)
+{
+    std::cerr << "cpufit_worker: " << exception.what() << std::endl;
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,293 @@
+// cpufitd: fits the batches of local clients in one process, which keeps its
+// thread pool running and large user info like spline coefficients loaded
+// for all clients; clients connect with cpufit_client_connect
+//
+// usage: cpufitd <socket path>
+
+#include "cpufit.h"
+#include "daemon_protocol.h"
+#include "model_parameters.h"
+#include "shard_protocol.h"
+#include "shared_memory.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// user info sent by any client, most recently used first
+class UserInfoCache
+{
+public:
+    typedef std::shared_ptr<std::vector<char> const> UserInfo;
+
+    UserInfo find(ResultKey const & key, std::size_t const size)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto entry = entries_.begin(); entry != entries_.end(); ++entry)
+        {
+            if (entry->first.hash[0] == key.hash[0]
+                && entry->first.hash[1] == key.hash[1]
+                && entry->second->size() == size)
+            {
+                entries_.splice(entries_.begin(), entries_, entry);
+                return entries_.front().second;
+            }
+        }
+
+        return UserInfo();
+    }
+
+    // the key is computed from the content rather than taken from the client
+    void insert(char const * const user_info, std::size_t const size)
+    {
+        ResultKey const key = get_user_info_key(user_info, size);
+        UserInfo const copy = std::make_shared<std::vector<char> const>(user_info, user_info + size);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        entries_.push_front(std::make_pair(key, copy));
+
+        if (entries_.size() > max_n_entries)
+            entries_.pop_back();
+    }
+
+private:
+    static std::size_t const max_n_entries = 16;
+
+    std::mutex mutex_;
+    std::list<std::pair<ResultKey, UserInfo>> entries_;
+};
+
+static int fit_batch(
+    DaemonRequest const & request,
+    SharedMemory const * const memory,
+    UserInfoCache & cache,
+    std::int32_t & user_info_missing)
+{
+    if (request.magic != daemon_magic || !memory || memory->size() < sizeof(ShardHeader))
+    {
+        throw std::runtime_error("invalid request");
+    }
+
+    char * const bytes = static_cast<char *>(memory->data());
+
+    ShardHeader h;
+    std::memcpy(&h, bytes, sizeof(h));
+
+    if (h.magic != shard_magic || h.real_size != sizeof(REAL))
+    {
+        throw std::runtime_error("batch of a different Cpufit version");
+    }
+
+    // the number of parameters and the offsets are computed here rather than
+    // trusted, and the sizes are bounded by the memory file before they are
+    // multiplied
+    h.n_parameters = get_number_of_parameters(static_cast<ModelID>(h.model_id));
+
+    std::uint64_t const memory_size = memory->size();
+
+    if (h.n_fits > memory_size
+        || h.user_info_size > memory_size
+        || (h.n_points && h.n_fits > memory_size / sizeof(REAL) / h.n_points))
+    {
+        throw std::runtime_error("batch larger than its memory file");
+    }
+
+    set_shard_layout(h);
+
+    if (h.size > memory_size)
+    {
+        throw std::runtime_error("batch larger than its memory file");
+    }
+
+    UserInfoCache::UserInfo cached_user_info;
+    char * user_info = h.user_info_size ? bytes + h.user_info : 0;
+
+    if (h.user_info_size && !request.has_user_info)
+    {
+        cached_user_info = cache.find(request.user_info_key, h.user_info_size);
+
+        if (!cached_user_info)
+        {
+            user_info_missing = 1;
+            return ReturnState::OK;
+        }
+
+        user_info = const_cast<char *>(cached_user_info->data());
+    }
+    else if (h.user_info_size >= min_cached_user_info_size)
+    {
+        cache.insert(user_info, h.user_info_size);
+    }
+
+    return cpufit(
+        h.n_fits,
+        h.n_points,
+        reinterpret_cast<REAL *>(bytes + h.data),
+        h.has_weights ? reinterpret_cast<REAL *>(bytes + h.weights) : 0,
+        h.model_id,
+        reinterpret_cast<REAL *>(bytes + h.initial_parameters),
+        REAL(h.tolerance),
+        h.max_n_iterations,
+        reinterpret_cast<int *>(bytes + h.parameters_to_fit),
+        h.estimator_id,
+        h.user_info_size,
+        user_info,
+        reinterpret_cast<REAL *>(bytes + h.output_parameters),
+        reinterpret_cast<int *>(bytes + h.output_states),
+        reinterpret_cast<REAL *>(bytes + h.output_chi_squares),
+        reinterpret_cast<int *>(bytes + h.output_n_iterations));
+}
+
+static void serve_client(int const socket, UserInfoCache & cache)
+{
+    std::unique_ptr<SharedMemory> memory;
+    DaemonRequest request;
+    int file_descriptor;
+
+    while (receive_request(socket, request, file_descriptor))
+    {
+        DaemonReply reply;
+        std::memset(&reply, 0, sizeof(reply));
+
+        try
+        {
+            if (file_descriptor >= 0)
+            {
+                memory.reset();
+                memory.reset(new SharedMemory(file_descriptor));
+
+                // a client could otherwise truncate the file during a fit
+                if (!memory->cannot_shrink())
+                {
+                    memory.reset();
+                    throw std::runtime_error("memory file not sealed against shrinking");
+                }
+            }
+
+            reply.status = fit_batch(request, memory.get(), cache, reply.user_info_missing);
+
+            if (reply.status != ReturnState::OK)
+                std::strncpy(reply.error, cpufit_get_last_error(), sizeof(reply.error) - 1);
+        }
+        catch (std::exception & exception)
+        {
+            reply.status = ReturnState::ERROR;
+            std::strncpy(reply.error, exception.what(), sizeof(reply.error) - 1);
+        }
+
+        if (!send_message(socket, &reply, sizeof(reply)))
+            break;
+    }
+
+    close(socket);
+}
+
+static char const * socket_path = 0;
+
+static void remove_socket(int)
+{
+    unlink(socket_path);
+    _exit(EXIT_SUCCESS);
+}
+
+// creates the thread pool before the first client connects
+static void warm_up()
+{
+    REAL data[] = { 1, 2 };
+    REAL initial_parameters[] = { 0, 0 };
+    int parameters_to_fit[] = { 1, 1 };
+    REAL parameters[2];
+    REAL chi_square;
+    int state;
+    int n_iterations;
+
+    cpufit(1, 2, data, 0, LINEAR_1D, initial_parameters, 1e-6f, 10, parameters_to_fit, LSE, 0, 0,
+        parameters, &state, &chi_square, &n_iterations);
+}
+
+int main(int argc, char * argv[])
+try
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: cpufitd <socket path>" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    socket_path = argv[1];
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (std::strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("socket path too long");
+    }
+
+    std::strcpy(address.sun_path, socket_path);
+
+    warm_up();
+
+    int const server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (server < 0)
+    {
+        throw std::runtime_error(std::string("cannot create socket: ") + std::strerror(errno));
+    }
+
+    unlink(socket_path);
+
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || listen(server, SOMAXCONN) != 0)
+    {
+        throw std::runtime_error("cannot listen on " + std::string(socket_path) + ": " + std::strerror(errno));
+    }
+
+    std::signal(SIGINT, remove_socket);
+    std::signal(SIGTERM, remove_socket);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "cpufitd: listening on " << socket_path << std::endl;
+
+    UserInfoCache cache;
+
+    for (;;)
+    {
+        int const client = accept(server, 0, 0);
+
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            throw std::runtime_error(std::string("cannot accept clients: ") + std::strerror(errno));
+        }
+
+        std::thread(serve_client, client, std::ref(cache)).detach();
+    }
+}
+catch (std::exception & exception)
+{
+    std::cerr << "cpufitd: " << exception.what() << std::endl;
+
+    return EXIT_FAILURE;
+}
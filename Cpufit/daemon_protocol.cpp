@@ -0,0 +1,96 @@
+#include "daemon_protocol.h"
+#include "shard_protocol.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+ResultKey get_user_info_key(char const * const user_info, std::size_t const size)
+{
+    ResultKeyBuilder builder;
+    builder.add(user_info, size);
+
+    return builder.key();
+}
+
+bool send_request(int const socket, DaemonRequest const & request, int const file_descriptor)
+{
+    iovec data = { const_cast<DaemonRequest *>(&request), sizeof(request) };
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+
+    union
+    {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    if (file_descriptor >= 0)
+    {
+        std::memset(&control, 0, sizeof(control));
+        message.msg_control = control.bytes;
+        message.msg_controllen = sizeof(control.bytes);
+
+        cmsghdr * const header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &file_descriptor, sizeof(int));
+    }
+
+    ssize_t n;
+    while ((n = sendmsg(socket, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return false;
+
+    // the file descriptor goes with the first byte
+    return send_message(socket, reinterpret_cast<char const *>(&request) + n, sizeof(request) - std::size_t(n));
+}
+
+bool receive_request(int const socket, DaemonRequest & request, int & file_descriptor)
+{
+    iovec data = { &request, sizeof(request) };
+
+    union
+    {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.bytes;
+    message.msg_controllen = sizeof(control.bytes);
+
+    ssize_t n;
+    while ((n = recvmsg(socket, &message, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR);
+
+    if (n <= 0)
+        return false;
+
+    file_descriptor = -1;
+
+    for (cmsghdr * header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+            std::memcpy(&file_descriptor, CMSG_DATA(header), sizeof(int));
+    }
+
+    if (!receive_message(socket, reinterpret_cast<char *>(&request) + n, sizeof(request) - std::size_t(n)))
+    {
+        if (file_descriptor >= 0)
+            close(file_descriptor);
+
+        return false;
+    }
+
+    return true;
+}
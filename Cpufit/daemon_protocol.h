@@ -0,0 +1,55 @@
+#ifndef CPUFIT_DAEMON_PROTOCOL_H_INCLUDED
+#define CPUFIT_DAEMON_PROTOCOL_H_INCLUDED
+
+#include "result_key.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// the messages between cpufitd and its clients; a client puts each batch into
+// a memory file in the layout of ShardHeader, passes the file to the daemon
+// with the first request and again only after it has grown, and the daemon
+// writes the results into the same file
+
+std::uint32_t const daemon_magic = 0x44464643;
+
+// user info of at least this size, like spline coefficients, is kept by the
+// daemon and sent only once for all clients; the daemon computes the key of
+// user info it receives itself, so that a client cannot store user info under
+// the key of other user info
+std::size_t const min_cached_user_info_size = 64 * 1024;
+
+struct DaemonRequest
+{
+    std::uint32_t magic;
+
+    // a memory file is attached to the request and replaces the previous one
+    std::int32_t has_memory_file;
+
+    // the user info is in the memory file; otherwise the daemon takes it from
+    // its cache
+    std::int32_t has_user_info;
+
+    // identifies cached user info which is not in the memory file
+    ResultKey user_info_key;
+};
+
+struct DaemonReply
+{
+    std::int32_t status;
+
+    // the user info is not in the cache and has to be sent
+    std::int32_t user_info_missing;
+
+    char error[256];
+};
+
+// a 128 bit hash of the content
+ResultKey get_user_info_key(char const * const user_info, std::size_t const size);
+
+// transfer a request with an optional file descriptor, -1 for none; false if
+// the other process has gone
+bool send_request(int const socket, DaemonRequest const & request, int const file_descriptor);
+bool receive_request(int const socket, DaemonRequest & request, int & file_descriptor);
+
+#endif
@@ -0,0 +1,61 @@
+#include "deadline.h"
+
+#include <algorithm>
+
+// time budgets beyond the range of the clock, including infinite ones, never
+// expire
+Deadline::clock::time_point Deadline::get_end(clock::time_point const start, double const time_budget)
+{
+    clock::duration const max_duration = clock::time_point::max() - start;
+    std::chrono::duration<double, clock::period> const duration = std::chrono::duration<double>(time_budget);
+
+    if (duration.count() >= double(max_duration.count()))
+        return clock::time_point::max();
+
+    return start + std::chrono::duration_cast<clock::duration>(duration);
+}
+
+Deadline::Deadline(double const time_budget, std::size_t const n_fits) :
+    start_(clock::now()),
+    end_(get_end(start_, time_budget)),
+    n_fits_(n_fits),
+    n_finished_fits_(0),
+    n_iterations_(0)
+{
+}
+
+bool Deadline::expired() const
+{
+    return clock::now() >= end_;
+}
+
+int Deadline::get_max_n_iterations(int const max_n_iterations) const
+{
+    std::size_t const n_iterations = n_iterations_;
+
+    if (n_iterations == 0)
+        return max_n_iterations;
+
+    clock::time_point const now = clock::now();
+    double const elapsed_time = std::chrono::duration<double>(now - start_).count();
+    double const remaining_time = std::chrono::duration<double>(end_ - now).count();
+
+    std::size_t const n_remaining_fits
+        = std::max(std::size_t(1), n_fits_ - std::min(n_fits_, std::size_t(n_finished_fits_)));
+
+    // iterations of all threads per second, shared by the remaining fits
+    double const n_affordable_iterations
+        = remaining_time * (n_iterations / elapsed_time) / n_remaining_fits;
+
+    if (n_affordable_iterations >= max_n_iterations)
+        return max_n_iterations;
+
+    return std::max(1, int(n_affordable_iterations));
+}
+
+void Deadline::add_finished_fit(int const n_iterations)
+{
+    // the evaluation of the initial parameters counts as one iteration
+    n_iterations_ += std::size_t(n_iterations) + 1;
+    n_finished_fits_++;
+}
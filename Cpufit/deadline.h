@@ -0,0 +1,36 @@
+#ifndef CPUFIT_DEADLINE_H_INCLUDED
+#define CPUFIT_DEADLINE_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+// the time budget of a batch of fits, shared by all threads working on it
+class Deadline
+{
+public:
+    Deadline(double const time_budget, std::size_t const n_fits);
+
+    bool expired() const;
+
+    // lowers the maximum number of iterations of the next fit if the
+    // remaining fits would not finish in time at the measured rate of
+    // iterations
+    int get_max_n_iterations(int const max_n_iterations) const;
+
+    void add_finished_fit(int const n_iterations);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static clock::time_point get_end(clock::time_point const start, double const time_budget);
+
+    clock::time_point const start_;
+    clock::time_point const end_;
+    std::size_t const n_fits_;
+
+    std::atomic<std::size_t> n_finished_fits_;
+    std::atomic<std::size_t> n_iterations_;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "executor.h"
+#include "thread_pool.h"
+
+#include <exception>
+#include <mutex>
+
+namespace
+{
+    struct ParallelForContext
+    {
+        cpufit_task_function task;
+        void * task_context;
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    // exceptions must not propagate through the host application's executor
+    void run_task(void * const context, std::size_t const task_index)
+    {
+        ParallelForContext & parallel_for_context = *static_cast<ParallelForContext *>(context);
+
+        try
+        {
+            parallel_for_context.task(parallel_for_context.task_context, task_index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(parallel_for_context.mutex);
+            if (!parallel_for_context.error)
+                parallel_for_context.error = std::current_exception();
+        }
+    }
+
+    void run_job(void * const context)
+    {
+        std::unique_ptr<std::function<void()>> const job(static_cast<std::function<void()> *>(context));
+
+        try
+        {
+            (*job)();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    std::mutex executor_mutex;
+    std::shared_ptr<Executor> external_executor;
+    std::shared_ptr<Executor> real_time_executor;
+    std::shared_ptr<Executor> executor_before_real_time;
+}
+
+ExternalExecutor::ExternalExecutor(
+    cpufit_parallel_for_function const parallel_for,
+    cpufit_submit_function const submit,
+    std::size_t const n_threads,
+    void * const executor_context) :
+    parallel_for_(parallel_for),
+    submit_(submit),
+    n_threads_(n_threads),
+    executor_context_(executor_context)
+{
+}
+
+std::size_t ExternalExecutor::n_threads() const
+{
+    return n_threads_;
+}
+
+void ExternalExecutor::run(std::size_t const n_tasks, cpufit_task_function task, void * task_context)
+{
+    ParallelForContext context;
+    context.task = task;
+    context.task_context = task_context;
+
+    parallel_for_(n_tasks, run_task, &context, executor_context_);
+
+    if (context.error)
+        std::rethrow_exception(context.error);
+}
+
+// without a submit function, jobs run on the calling thread
+void ExternalExecutor::submit(std::function<void()> job)
+{
+    if (!submit_)
+    {
+        job();
+        return;
+    }
+
+    submit_(run_job, new std::function<void()>(std::move(job)), executor_context_);
+}
+
+// the internal thread pool is only created if no executor is registered
+std::shared_ptr<Executor> get_executor()
+{
+    {
+        std::lock_guard<std::mutex> lock(executor_mutex);
+
+        if (external_executor)
+            return external_executor;
+    }
+
+    return get_thread_pool();
+}
+
+void set_executor(std::shared_ptr<Executor> executor)
+{
+    std::lock_guard<std::mutex> lock(executor_mutex);
+
+    external_executor = executor;
+}
+
+// an executor set by the host while real-time mode is enabled is kept when it
+// is disabled
+void set_real_time_executor(std::shared_ptr<Executor> executor)
+{
+    std::lock_guard<std::mutex> lock(executor_mutex);
+
+    if (executor)
+    {
+        if (!real_time_executor || external_executor != real_time_executor)
+            executor_before_real_time = external_executor;
+
+        real_time_executor = executor;
+        external_executor = executor;
+    }
+    else if (real_time_executor)
+    {
+        if (external_executor == real_time_executor)
+            external_executor = executor_before_real_time;
+
+        real_time_executor.reset();
+        executor_before_real_time.reset();
+    }
+}
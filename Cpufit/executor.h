@@ -0,0 +1,107 @@
+#ifndef CPUFIT_EXECUTOR_H_INCLUDED
+#define CPUFIT_EXECUTOR_H_INCLUDED
+
+#include "cpufit.h"
+#include "allocator.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+// runs the parallel work of Cpufit, either on the internal thread pool or on
+// an executor registered by the host application
+class Executor
+{
+public:
+    virtual ~Executor() {}
+
+    virtual std::size_t n_threads() const = 0;
+
+    // runs task(task_context, 0) ... task(task_context, n_tasks - 1) and
+    // returns when all are finished
+    virtual void run(std::size_t const n_tasks, cpufit_task_function task, void * task_context) = 0;
+
+    // false if run() would process n_tasks on the calling thread only
+    virtual bool uses_workers(std::size_t const /*n_tasks*/) const { return true; }
+
+    // runs a job asynchronously, or on the calling thread if the executor
+    // has no thread for it; run() does not wait for jobs
+    virtual void submit(std::function<void()> job) = 0;
+
+    // a preallocated workspace for the thread calling run(), or a null
+    // pointer if there is none or it is in use by another thread
+    virtual Workspace * acquire_workspace() { return 0; }
+    virtual void release_workspace(Workspace *) {}
+
+    // runs task(0) ... task(n_tasks - 1) without allocating memory
+    template<typename Task>
+    void parallel_for(std::size_t const n_tasks, Task const & task)
+    {
+        run(n_tasks, &call_task<Task>, const_cast<Task *>(&task));
+    }
+
+private:
+    template<typename Task>
+    static void call_task(void * const task, std::size_t const task_index)
+    {
+        (*static_cast<Task const *>(task))(task_index);
+    }
+};
+
+// sets the workspace of an executor for the calling thread while in scope
+class WorkspaceScope
+{
+public:
+    explicit WorkspaceScope(Executor & executor) :
+        executor_(executor),
+        workspace_(executor.acquire_workspace()),
+        previous_(workspace_ ? set_thread_workspace(workspace_) : 0)
+    {
+    }
+
+    ~WorkspaceScope()
+    {
+        if (!workspace_)
+            return;
+
+        set_thread_workspace(previous_);
+        executor_.release_workspace(workspace_);
+    }
+
+private:
+    WorkspaceScope(WorkspaceScope const &);
+    WorkspaceScope & operator=(WorkspaceScope const &);
+
+    Executor & executor_;
+    Workspace * const workspace_;
+    Workspace * const previous_;
+};
+
+class ExternalExecutor : public Executor
+{
+public:
+    ExternalExecutor(
+        cpufit_parallel_for_function parallel_for,
+        cpufit_submit_function submit,
+        std::size_t const n_threads,
+        void * executor_context);
+
+    std::size_t n_threads() const;
+    void run(std::size_t const n_tasks, cpufit_task_function task, void * task_context);
+    void submit(std::function<void()> job);
+
+private:
+    cpufit_parallel_for_function const parallel_for_;
+    cpufit_submit_function const submit_;
+    std::size_t const n_threads_;
+    void * const executor_context_;
+};
+
+std::shared_ptr<Executor> get_executor();
+void set_executor(std::shared_ptr<Executor> executor);
+
+// the real-time pool replaces the executor until real-time mode is disabled,
+// which restores the executor set before; a null pointer disables it
+void set_real_time_executor(std::shared_ptr<Executor> executor);
+
+#endif
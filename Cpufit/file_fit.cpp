@@ -0,0 +1,225 @@
+#include "file_fit.h"
+#include "interface.h"
+#include "model_parameters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    MappedFile::Mode get_output_mode(char const * const journal_file)
+    {
+        return journal_file ? MappedFile::UPDATE : MappedFile::WRITE;
+    }
+
+    // the number of bytes at each end of an input file which identify it, the
+    // same for any memory budget, so that a batch can be resumed with another
+    std::size_t const key_size = std::size_t(1) << 20;
+
+    // identifies an input file by its size and its first and last bytes
+    void add_input_file(ResultKeyBuilder & builder, MappedFile const & file, std::size_t const input_size)
+    {
+        builder.add_value(file.size());
+
+        std::size_t const size = std::min(key_size, input_size);
+
+        if (size == 0)
+            return;
+
+        MappedFile::Window const first(file, 0, size);
+        builder.add(first.data(), size);
+
+        MappedFile::Window const last(file, input_size - size, size);
+        builder.add(last.data(), size);
+    }
+}
+
+FileFit::FileFit(
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    char const * const data_file,
+    char const * const weights_file,
+    ModelID const model_id,
+    char const * const initial_parameters_file,
+    REAL const tolerance,
+    int const max_n_iterations,
+    int const * const parameters_to_fit,
+    EstimatorID const estimator_id,
+    std::size_t const user_info_size,
+    char * const user_info,
+    std::size_t const memory_budget,
+    char const * const output_parameters_file,
+    char const * const output_states_file,
+    char const * const output_chi_squares_file,
+    char const * const output_n_iterations_file,
+    char const * const journal_file,
+    double const checkpoint_interval)
+    :
+    n_fits_(n_fits),
+    n_points_(n_points),
+    n_parameters_(get_number_of_parameters(model_id)),
+    model_id_(model_id),
+    tolerance_(tolerance),
+    max_n_iterations_(max_n_iterations),
+    parameters_to_fit_(parameters_to_fit),
+    estimator_id_(estimator_id),
+    user_info_size_(user_info ? user_info_size : 0),
+    user_info_(user_info),
+    data_(data_file, MappedFile::READ, n_fits * n_points * sizeof(REAL)),
+    weights_(weights_file ? new MappedFile(weights_file, MappedFile::READ, n_fits * n_points * sizeof(REAL)) : 0),
+    initial_parameters_(initial_parameters_file, MappedFile::READ, n_fits * n_parameters_ * sizeof(REAL)),
+    // the outputs of completed fits are kept for a resumed batch
+    output_parameters_(output_parameters_file, get_output_mode(journal_file), n_fits * n_parameters_ * sizeof(REAL)),
+    output_states_(output_states_file, get_output_mode(journal_file), n_fits * sizeof(int)),
+    output_chi_squares_(output_chi_squares_file, get_output_mode(journal_file), n_fits * sizeof(REAL)),
+    output_n_iterations_(output_n_iterations_file, get_output_mode(journal_file), n_fits * sizeof(int)),
+    window_size_(0),
+    checkpoint_interval_(checkpoint_interval)
+{
+    std::size_t const input_size_per_fit
+        = (weights_ ? 2 : 1) * n_points_ * sizeof(REAL) + n_parameters_ * sizeof(REAL);
+
+    std::size_t const output_size_per_fit
+        = n_parameters_ * sizeof(REAL) + sizeof(REAL) + 2 * sizeof(int);
+
+    // the window being fitted and the inputs of the next one share the budget
+    std::size_t const budget = memory_budget ? memory_budget : default_memory_budget;
+
+    window_size_ = std::max(std::size_t(1), budget / (2 * input_size_per_fit + output_size_per_fit));
+
+    if (journal_file)
+        journal_.reset(new FitJournal(journal_file, get_batch_key(), n_fits_));
+}
+
+// the settings which change the results; the inputs are identified by their
+// sizes and their first and last bytes, as hashing all of the data would
+// take as long as a part of the fits
+ResultKey FileFit::get_batch_key() const
+{
+    ResultKeyBuilder builder;
+
+    builder.add(CPUFIT_VERSION, std::strlen(CPUFIT_VERSION));
+    builder.add_value(sizeof(REAL));
+    builder.add_value(n_fits_);
+    builder.add_value(n_points_);
+    builder.add_value(int(model_id_));
+    builder.add_value(int(estimator_id_));
+    builder.add_value(tolerance_);
+    builder.add_value(max_n_iterations_);
+    builder.add_value(weights_ != 0);
+    builder.add(parameters_to_fit_, n_parameters_ * sizeof(int));
+    builder.add(user_info_, user_info_size_);
+
+    add_input_file(builder, data_, n_fits_ * n_points_ * sizeof(REAL));
+    add_input_file(builder, initial_parameters_, n_fits_ * n_parameters_ * sizeof(REAL));
+
+    if (weights_)
+        add_input_file(builder, *weights_, n_fits_ * n_points_ * sizeof(REAL));
+
+    return builder.key();
+}
+
+void FileFit::map_inputs(InputWindows & windows, std::size_t const first_fit, std::size_t const n_fits) const
+{
+    std::size_t const data_offset = first_fit * n_points_ * sizeof(REAL);
+    std::size_t const data_size = n_fits * n_points_ * sizeof(REAL);
+
+    windows.data.reset(new MappedFile::Window(data_, data_offset, data_size));
+
+    if (weights_)
+        windows.weights.reset(new MappedFile::Window(*weights_, data_offset, data_size));
+
+    windows.initial_parameters.reset(new MappedFile::Window(
+        initial_parameters_,
+        first_fit * n_parameters_ * sizeof(REAL),
+        n_fits * n_parameters_ * sizeof(REAL)));
+
+    windows.data->prefetch();
+    windows.initial_parameters->prefetch();
+
+    if (weights_)
+        windows.weights->prefetch();
+}
+
+void FileFit::fit_window(InputWindows const & inputs, std::size_t const first_fit, std::size_t const n_fits)
+{
+    MappedFile::Window const parameters(
+        output_parameters_, first_fit * n_parameters_ * sizeof(REAL), n_fits * n_parameters_ * sizeof(REAL));
+    MappedFile::Window const states(
+        output_states_, first_fit * sizeof(int), n_fits * sizeof(int));
+    MappedFile::Window const chi_squares(
+        output_chi_squares_, first_fit * sizeof(REAL), n_fits * sizeof(REAL));
+    MappedFile::Window const n_iterations(
+        output_n_iterations_, first_fit * sizeof(int), n_fits * sizeof(int));
+
+    char * user_info = user_info_;
+    std::size_t user_info_size = user_info_size_;
+    slice_user_info(model_id_, n_points_, first_fit, n_fits, user_info, user_info_size);
+
+    FitInterface fi(
+        reinterpret_cast<REAL const *>(inputs.data->data()),
+        inputs.weights ? reinterpret_cast<REAL const *>(inputs.weights->data()) : NULL,
+        n_fits,
+        n_points_,
+        tolerance_,
+        max_n_iterations_,
+        estimator_id_,
+        reinterpret_cast<REAL const *>(inputs.initial_parameters->data()),
+        parameters_to_fit_,
+        user_info,
+        user_info_size,
+        reinterpret_cast<REAL *>(parameters.data()),
+        reinterpret_cast<int *>(states.data()),
+        reinterpret_cast<REAL *>(chi_squares.data()),
+        reinterpret_cast<int *>(n_iterations.data()));
+
+    fi.fit(model_id_);
+}
+
+void FileFit::checkpoint(std::size_t const n_completed_fits)
+{
+    output_parameters_.sync();
+    output_states_.sync();
+    output_chi_squares_.sync();
+    output_n_iterations_.sync();
+
+    journal_->record(n_completed_fits);
+}
+
+void FileFit::run()
+{
+    typedef std::chrono::steady_clock clock;
+
+    InputWindows current;
+    InputWindows next;
+
+    std::size_t const n_completed_fits = journal_ ? journal_->n_completed_fits() : 0;
+    clock::time_point last_checkpoint = clock::now();
+
+    if (n_completed_fits < n_fits_)
+        map_inputs(next, n_completed_fits, std::min(window_size_, n_fits_ - n_completed_fits));
+
+    for (std::size_t first_fit = n_completed_fits; first_fit < n_fits_; first_fit += window_size_)
+    {
+        std::size_t const n_fits = std::min(window_size_, n_fits_ - first_fit);
+        std::size_t const next_first_fit = first_fit + n_fits;
+
+        // unmaps the window fitted before
+        std::swap(current, next);
+        next = InputWindows();
+
+        if (next_first_fit < n_fits_)
+            map_inputs(next, next_first_fit, std::min(window_size_, n_fits_ - next_first_fit));
+
+        fit_window(current, first_fit, n_fits);
+
+        if (journal_
+            && (next_first_fit == n_fits_
+                || std::chrono::duration<double>(clock::now() - last_checkpoint).count() >= checkpoint_interval_))
+        {
+            checkpoint(next_first_fit);
+            last_checkpoint = clock::now();
+        }
+    }
+}
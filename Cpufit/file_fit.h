@@ -0,0 +1,88 @@
+#ifndef CPUFIT_FILE_FIT_H_INCLUDED
+#define CPUFIT_FILE_FIT_H_INCLUDED
+
+#include "fit_journal.h"
+#include "mapped_file.h"
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+#include <memory>
+
+// fits a batch stored in raw files of REAL and int values window by window;
+// the inputs of the next window are read ahead while a window is fitted, and
+// windows are unmapped once fitted, so that the memory in use is bounded by
+// the memory budget and not by the size of the batch
+//
+// With a journal, the outputs written so far are synchronized to the disk
+// and recorded in the journal after the first window which ends at least
+// checkpoint_interval seconds after the last checkpoint; a batch with a
+// journal of earlier, interrupted runs is resumed after the recorded fits.
+class FileFit
+{
+public:
+    FileFit(
+        std::size_t n_fits,
+        std::size_t n_points,
+        char const * data_file,
+        char const * weights_file,
+        ModelID model_id,
+        char const * initial_parameters_file,
+        REAL tolerance,
+        int max_n_iterations,
+        int const * parameters_to_fit,
+        EstimatorID estimator_id,
+        std::size_t user_info_size,
+        char * user_info,
+        std::size_t memory_budget,
+        char const * output_parameters_file,
+        char const * output_states_file,
+        char const * output_chi_squares_file,
+        char const * output_n_iterations_file,
+        char const * journal_file,
+        double checkpoint_interval);
+
+    void run();
+
+private:
+    static std::size_t const default_memory_budget = std::size_t(256) << 20;
+
+    struct InputWindows
+    {
+        std::unique_ptr<MappedFile::Window> data;
+        std::unique_ptr<MappedFile::Window> weights;
+        std::unique_ptr<MappedFile::Window> initial_parameters;
+    };
+
+    void map_inputs(InputWindows & windows, std::size_t const first_fit, std::size_t const n_fits) const;
+    void fit_window(InputWindows const & inputs, std::size_t const first_fit, std::size_t const n_fits);
+    ResultKey get_batch_key() const;
+    void checkpoint(std::size_t const n_completed_fits);
+
+    std::size_t const n_fits_;
+    std::size_t const n_points_;
+    std::size_t const n_parameters_;
+    ModelID const model_id_;
+    REAL const tolerance_;
+    int const max_n_iterations_;
+    int const * const parameters_to_fit_;
+    EstimatorID const estimator_id_;
+    std::size_t const user_info_size_;
+    char * const user_info_;
+
+    MappedFile data_;
+    std::unique_ptr<MappedFile> weights_;
+    MappedFile initial_parameters_;
+
+    MappedFile output_parameters_;
+    MappedFile output_states_;
+    MappedFile output_chi_squares_;
+    MappedFile output_n_iterations_;
+
+    std::size_t window_size_;
+
+    std::unique_ptr<FitJournal> journal_;
+    double const checkpoint_interval_;
+};
+
+#endif
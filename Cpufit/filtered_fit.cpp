@@ -0,0 +1,137 @@
+#include "filtered_fit.h"
+#include "interface.h"
+#include "model_parameters.h"
+
+#include <algorithm>
+#include <cstring>
+
+ResultFilter::ResultFilter(
+    int const accepted_states,
+    REAL const max_chi_square,
+    REAL const * const parameter_ranges,
+    std::size_t const n_parameters)
+    :
+    accepted_states_(accepted_states),
+    max_chi_square_(max_chi_square),
+    parameter_ranges_(parameter_ranges ? parameter_ranges : 0, parameter_ranges ? parameter_ranges + 2 * n_parameters : 0)
+{
+}
+
+std::size_t const FilteredFit::block_size;
+
+FilteredFit::FilteredFit(
+    REAL const * const data,
+    REAL const * const weights,
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    ModelID const model_id,
+    REAL const * const initial_parameters,
+    REAL const tolerance,
+    int const max_n_iterations,
+    int const * const parameters_to_fit,
+    EstimatorID const estimator_id,
+    std::size_t const user_info_size,
+    char * const user_info,
+    ResultFilter const & filter,
+    std::size_t * const output_fit_indices,
+    REAL * const output_parameters,
+    int * const output_states,
+    REAL * const output_chi_squares,
+    int * const output_n_iterations)
+    :
+    data_(data),
+    weights_(weights),
+    n_fits_(n_fits),
+    n_points_(n_points),
+    n_parameters_(get_number_of_parameters(model_id)),
+    model_id_(model_id),
+    initial_parameters_(initial_parameters),
+    tolerance_(tolerance),
+    max_n_iterations_(max_n_iterations),
+    parameters_to_fit_(parameters_to_fit),
+    estimator_id_(estimator_id),
+    user_info_size_(user_info ? user_info_size : 0),
+    user_info_(user_info),
+    filter_(filter),
+    output_fit_indices_(output_fit_indices),
+    output_parameters_(output_parameters),
+    output_states_(output_states),
+    output_chi_squares_(output_chi_squares),
+    output_n_iterations_(output_n_iterations)
+{
+    std::size_t const n_block_fits = std::min(block_size, n_fits_);
+
+    block_parameters_.resize(n_block_fits * n_parameters_);
+    block_states_.resize(n_block_fits);
+    block_chi_squares_.resize(n_block_fits);
+    block_n_iterations_.resize(n_block_fits);
+}
+
+void FilteredFit::fit_block(std::size_t const first_fit, std::size_t const n_fits)
+{
+    char * user_info = user_info_;
+    std::size_t user_info_size = user_info_size_;
+    slice_user_info(model_id_, n_points_, first_fit, n_fits, user_info, user_info_size);
+
+    FitInterface fi(
+        data_ + first_fit * n_points_,
+        weights_ ? weights_ + first_fit * n_points_ : NULL,
+        n_fits,
+        n_points_,
+        tolerance_,
+        max_n_iterations_,
+        estimator_id_,
+        initial_parameters_ + first_fit * n_parameters_,
+        parameters_to_fit_,
+        user_info,
+        user_info_size,
+        block_parameters_.data(),
+        block_states_.data(),
+        block_chi_squares_.data(),
+        block_n_iterations_.data());
+
+    fi.fit(model_id_);
+}
+
+std::size_t FilteredFit::compact_block(
+    std::size_t const first_fit,
+    std::size_t const n_fits,
+    std::size_t n_accepted_fits)
+{
+    for (std::size_t i = 0; i < n_fits; i++)
+    {
+        REAL const * const parameters = block_parameters_.data() + i * n_parameters_;
+
+        if (!filter_.accepts(parameters, block_states_[i], block_chi_squares_[i]))
+            continue;
+
+        std::memcpy(
+            output_parameters_ + n_accepted_fits * n_parameters_,
+            parameters,
+            n_parameters_ * sizeof(REAL));
+
+        output_fit_indices_[n_accepted_fits] = first_fit + i;
+        output_states_[n_accepted_fits] = block_states_[i];
+        output_chi_squares_[n_accepted_fits] = block_chi_squares_[i];
+        output_n_iterations_[n_accepted_fits] = block_n_iterations_[i];
+
+        n_accepted_fits++;
+    }
+
+    return n_accepted_fits;
+}
+
+std::size_t FilteredFit::run()
+{
+    std::size_t n_accepted_fits = 0;
+
+    for (std::size_t first_fit = 0; first_fit < n_fits_; first_fit += block_size)
+    {
+        std::size_t const n_fits = std::min(block_size, n_fits_ - first_fit);
+
+        fit_block(first_fit, n_fits);
+        n_accepted_fits = compact_block(first_fit, n_fits, n_accepted_fits);
+    }
+
+    return n_accepted_fits;
+}
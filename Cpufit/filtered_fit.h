@@ -0,0 +1,106 @@
+#ifndef CPUFIT_FILTERED_FIT_H_INCLUDED
+#define CPUFIT_FILTERED_FIT_H_INCLUDED
+
+#include "allocator.h"
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+
+// the rules a fit has to pass to be returned: its state is one of the
+// accepted states, given as a bit mask of 1 << state, its chi-square is at
+// most the maximum, and each parameter lies within its lower and upper
+// bound; NaN values fail every rule
+class ResultFilter
+{
+public:
+    ResultFilter(
+        int accepted_states,
+        REAL max_chi_square,
+        REAL const * parameter_ranges,
+        std::size_t n_parameters);
+
+    bool accepts(REAL const * const parameters, int const state, REAL const chi_square) const
+    {
+        if (!(accepted_states_ & (1 << state)) || !(chi_square <= max_chi_square_))
+            return false;
+
+        for (std::size_t i = 0; i < parameter_ranges_.size() / 2; i++)
+        {
+            if (!(parameters[i] >= parameter_ranges_[2 * i] && parameters[i] <= parameter_ranges_[2 * i + 1]))
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    int const accepted_states_;
+    REAL const max_chi_square_;
+    Buffer<REAL> const parameter_ranges_;
+};
+
+// fits a batch block by block and copies the fits of each block accepted by
+// the filter to the compacted outputs, with their indices in the batch, so
+// that only the outputs of one block exist in full
+class FilteredFit
+{
+public:
+    FilteredFit(
+        REAL const * data,
+        REAL const * weights,
+        std::size_t n_fits,
+        std::size_t n_points,
+        ModelID model_id,
+        REAL const * initial_parameters,
+        REAL tolerance,
+        int max_n_iterations,
+        int const * parameters_to_fit,
+        EstimatorID estimator_id,
+        std::size_t user_info_size,
+        char * user_info,
+        ResultFilter const & filter,
+        std::size_t * output_fit_indices,
+        REAL * output_parameters,
+        int * output_states,
+        REAL * output_chi_squares,
+        int * output_n_iterations);
+
+    // returns the number of accepted fits
+    std::size_t run();
+
+private:
+    static std::size_t const block_size = 16384;
+
+    void fit_block(std::size_t const first_fit, std::size_t const n_fits);
+    std::size_t compact_block(std::size_t const first_fit, std::size_t const n_fits, std::size_t n_accepted_fits);
+
+    REAL const * const data_;
+    REAL const * const weights_;
+    std::size_t const n_fits_;
+    std::size_t const n_points_;
+    std::size_t const n_parameters_;
+    ModelID const model_id_;
+    REAL const * const initial_parameters_;
+    REAL const tolerance_;
+    int const max_n_iterations_;
+    int const * const parameters_to_fit_;
+    EstimatorID const estimator_id_;
+    std::size_t const user_info_size_;
+    char * const user_info_;
+    ResultFilter const & filter_;
+
+    std::size_t * const output_fit_indices_;
+    REAL * const output_parameters_;
+    int * const output_states_;
+    REAL * const output_chi_squares_;
+    int * const output_n_iterations_;
+
+    // the full outputs of one block
+    Buffer<REAL> block_parameters_;
+    Buffer<int> block_states_;
+    Buffer<REAL> block_chi_squares_;
+    Buffer<int> block_n_iterations_;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "fit_journal.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    char const journal_magic[8] = "CPUFITJ";
+
+    struct JournalHeader
+    {
+        char magic[8];
+        std::uint64_t batch[2];
+        std::uint64_t n_fits;
+    };
+
+    struct JournalRecord
+    {
+        std::uint64_t n_completed_fits;
+        // tells complete records from records cut off by a crash
+        std::uint64_t check;
+    };
+
+    std::uint64_t get_check(ResultKey const & batch, std::uint64_t const n_completed_fits)
+    {
+        return ~(batch.hash[0] ^ n_completed_fits);
+    }
+}
+
+FitJournal::FitJournal(char const * const path, ResultKey const & batch, std::size_t const n_fits) :
+    path_(path ? path : ""),
+    batch_(batch),
+    file_descriptor_(-1),
+    n_completed_fits_(0),
+    n_records_(0)
+{
+    if (!path)
+    {
+        throw std::runtime_error("no journal file name");
+    }
+
+    file_descriptor_ = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+
+    if (file_descriptor_ < 0)
+    {
+        throw std::runtime_error("cannot open " + path_ + ": " + std::strerror(errno));
+    }
+
+    struct stat status;
+
+    if (fstat(file_descriptor_, &status) != 0)
+    {
+        std::string const error = std::strerror(errno);
+        close(file_descriptor_);
+        throw std::runtime_error("cannot read " + path_ + ": " + error);
+    }
+
+    JournalHeader header;
+
+    // a journal without a complete header has no completed fits
+    if (std::size_t(status.st_size) < sizeof(header))
+    {
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, journal_magic, sizeof(header.magic));
+        header.batch[0] = batch.hash[0];
+        header.batch[1] = batch.hash[1];
+        header.n_fits = n_fits;
+
+        try
+        {
+            write(&header, sizeof(header), 0);
+        }
+        catch (...)
+        {
+            close(file_descriptor_);
+            throw;
+        }
+
+        return;
+    }
+
+    if (pread(file_descriptor_, &header, sizeof(header), 0) != ssize_t(sizeof(header))
+        || std::memcmp(header.magic, journal_magic, sizeof(journal_magic)) != 0)
+    {
+        close(file_descriptor_);
+        throw std::runtime_error(path_ + " is not a Cpufit journal");
+    }
+
+    if (header.batch[0] != batch.hash[0] || header.batch[1] != batch.hash[1] || header.n_fits != n_fits)
+    {
+        close(file_descriptor_);
+        throw std::runtime_error(path_ + " is the journal of a different batch");
+    }
+
+    JournalRecord record;
+
+    while (pread(file_descriptor_, &record, sizeof(record), off_t(sizeof(header) + n_records_ * sizeof(record)))
+            == ssize_t(sizeof(record))
+        && record.check == get_check(batch, record.n_completed_fits)
+        && record.n_completed_fits <= n_fits)
+    {
+        n_completed_fits_ = std::size_t(record.n_completed_fits);
+        n_records_++;
+    }
+}
+
+FitJournal::~FitJournal()
+{
+    close(file_descriptor_);
+}
+
+void FitJournal::write(void const * const data, std::size_t const size, std::size_t const offset)
+{
+    if (pwrite(file_descriptor_, data, size, off_t(offset)) != ssize_t(size) || fdatasync(file_descriptor_) != 0)
+    {
+        throw std::runtime_error("cannot write " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+void FitJournal::record(std::size_t const n_completed_fits)
+{
+    JournalRecord const record = { n_completed_fits, get_check(batch_, n_completed_fits) };
+
+    // overwrites a record cut off before
+    write(&record, sizeof(record), sizeof(JournalHeader) + n_records_ * sizeof(record));
+
+    n_completed_fits_ = n_completed_fits;
+    n_records_++;
+}
@@ -0,0 +1,42 @@
+#ifndef CPUFIT_FIT_JOURNAL_H_INCLUDED
+#define CPUFIT_FIT_JOURNAL_H_INCLUDED
+
+#include "result_key.h"
+
+#include <cstddef>
+#include <string>
+
+// records how many fits of a batch are completed, so that a batch which was
+// interrupted, e.g. by a killed process, is resumed after the completed fits
+//
+// The journal starts with a header identifying the batch by a hash of its
+// settings and is followed by one record for each checkpoint. A record is
+// only written after the outputs of the fits it covers are on disk, and a
+// record which was not completely written is ignored.
+class FitJournal
+{
+public:
+    // creates the journal if it does not exist, or reads the fits completed
+    // so far
+    FitJournal(char const * const path, ResultKey const & batch, std::size_t const n_fits);
+    ~FitJournal();
+
+    std::size_t n_completed_fits() const { return n_completed_fits_; }
+
+    // records the fits before n_completed_fits as completed
+    void record(std::size_t const n_completed_fits);
+
+private:
+    FitJournal(FitJournal const &);
+    FitJournal & operator=(FitJournal const &);
+
+    void write(void const * const data, std::size_t const size, std::size_t const offset);
+
+    std::string const path_;
+    ResultKey const batch_;
+    int file_descriptor_;
+    std::size_t n_completed_fits_;
+    std::size_t n_records_;
+};
+
+#endif
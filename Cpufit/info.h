@@ -18,6 +18,7 @@ public:
     int n_parameters_;
     int n_parameters_to_fit_;
     bool use_constraints_;
+    bool per_fit_parameters_to_fit_;
     std::size_t n_fits_;
     std::size_t n_points_;
     int max_n_iterations_;
@@ -1,45 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <limits>
+#include <string>
 #include <stdexcept>
 
 #include "cpufit.h"
 #include "interface.h"
+#include "allocator.h"
+#include "deadline.h"
+#include "latency_histogram.h"
+#include "model_parameters.h"
+
+#ifndef _WIN32
+#include "result_cache.h"
+#endif
+
+FitOptions::FitOptions() :
+    point_offsets(NULL),
+    per_fit_parameters_to_fit(false),
+    constraints(NULL),
+    constraint_types(NULL),
+    point_mask(NULL),
+    n_point_masks(0),
+    time_budget(0),
+    fit_priorities(NULL),
+    cancellation_token(NULL),
+    progress(NULL),
+    progress_context(NULL),
+    output_variances(NULL),
+    output_reduced_chi_squares(NULL),
+    output_residual_rms(NULL)
+{}
 
 FitInterface::FitInterface(
     REAL const * data,
     REAL const * weights,
     std::size_t n_fits,
-    int n_points,
+    std::size_t n_points,
     REAL tolerance,
     int max_n_iterations,
     EstimatorID estimator_id,
     REAL const * initial_parameters,
     int const * parameters_to_fit,
-    REAL* constraints,
-    int* constraint_types,
     char * user_info,
     std::size_t user_info_size,
     REAL * output_parameters,
     int * output_states,
     REAL * output_chi_squares,
-    int * output_n_iterations) :
+    int * output_n_iterations,
+    FitOptions const & options) :
+    n_parameters_(0),
     data_(data),
     weight_(weights),
     n_fits_(n_fits),
     n_points_(n_points),
+    point_offsets_(options.point_offsets),
     tolerance_(tolerance),
     max_n_iterations_(max_n_iterations),
     estimator_id_(estimator_id),
     initial_parameters_(initial_parameters),
     parameters_to_fit_(parameters_to_fit),
-    constraints_(constraints),
-    constraint_types_(constraint_types),
+    per_fit_parameters_to_fit_(options.per_fit_parameters_to_fit),
+    constraints_(options.constraints),
+    constraint_types_(options.constraint_types),
+    point_mask_(options.point_mask),
+    n_point_masks_(options.n_point_masks),
     user_info_(user_info),
     user_info_size_(user_info_size),
+    time_budget_(options.time_budget),
+    fit_priorities_(options.fit_priorities),
+    cancellation_token_(options.cancellation_token),
+    progress_(options.progress),
+    progress_context_(options.progress_context),
     output_parameters_(output_parameters),
     output_states_(output_states),
     output_chi_squares_(output_chi_squares),
     output_n_iterations_(output_n_iterations),
-    n_parameters_(0)
+    output_variances_(options.output_variances),
+    output_reduced_chi_squares_(options.output_reduced_chi_squares),
+    output_residual_rms_(options.output_residual_rms)
 {}
 
 FitInterface::~FitInterface()
@@ -49,7 +89,7 @@ void FitInterface::check_sizes()
 {
     std::size_t maximum_size = std::numeric_limits< std::size_t >::max();
 
-    if (n_fits_ > maximum_size / n_points_ / sizeof(REAL))
+    if (!point_offsets_ && n_fits_ > maximum_size / n_points_ / sizeof(REAL))
     {
         throw std::runtime_error("maximum absolute number of data points exceeded");
     }
@@ -60,6 +100,101 @@ void FitInterface::check_sizes()
     }
 }
 
+void FitInterface::check_point_offsets(ModelID const model_id)
+{
+    std::size_t maximum_size = std::numeric_limits< std::size_t >::max();
+
+    for (std::size_t fit_index = 0; fit_index < n_fits_; fit_index++)
+    {
+        if (point_offsets_[fit_index + 1] <= point_offsets_[fit_index])
+        {
+            throw std::runtime_error("point offsets must be strictly increasing");
+        }
+    }
+
+    std::size_t const n_points_total = point_offsets_[n_fits_];
+
+    if (n_points_total > maximum_size / sizeof(REAL))
+    {
+        throw std::runtime_error("maximum absolute number of data points exceeded");
+    }
+
+    // 2D models read each fit as a square image, and spline models as an
+    // image of the spline dimensions
+    bool const model_is_square
+        = model_id == GAUSS_2D
+        || model_id == GAUSS_2D_ELLIPTIC
+        || model_id == GAUSS_2D_ROTATED
+        || model_id == CAUCHY_2D_ELLIPTIC;
+
+    std::size_t const n_spline_points = get_spline_n_points(model_id);
+
+    for (std::size_t fit_index = 0; fit_index < n_fits_; fit_index++)
+    {
+        std::size_t const n_points = point_offsets_[fit_index + 1] - point_offsets_[fit_index];
+        std::size_t const size = std::size_t(std::sqrt(double(n_points)) + .5);
+
+        if (model_is_square && size * size != n_points)
+        {
+            throw std::runtime_error(
+                "number of points of fit " + std::to_string(fit_index) + " is not a square number");
+        }
+
+        if (n_spline_points && n_points != n_spline_points)
+        {
+            throw std::runtime_error(
+                "number of points of fit " + std::to_string(fit_index) + " does not match the spline dimensions");
+        }
+    }
+
+    // custom x coordinates of ragged batches are only unique per data point
+    std::size_t const n_user_info_values = user_info_size_ / sizeof(REAL);
+    bool const model_uses_x_coordinates
+        = model_id == GAUSS_1D || model_id == LINEAR_1D;
+
+    if (model_uses_x_coordinates && user_info_ && n_user_info_values != n_points_total)
+    {
+        throw std::runtime_error("user info of ragged batches must contain one x value per data point");
+    }
+}
+
+// the number of points of the image a 2D or 3D spline model reads, from the
+// dimensions at the start of the user info, or 0 for other models
+std::size_t FitInterface::get_spline_n_points(ModelID const model_id) const
+{
+    // leading values of the user info: (channels,) points per dimension
+    std::size_t n_dimension_values = 0;
+
+    switch (model_id)
+    {
+    case SPLINE_2D: n_dimension_values = 2; break;
+    case SPLINE_3D: n_dimension_values = 3; break;
+    case SPLINE_3D_MULTICHANNEL: n_dimension_values = 4; break;
+    default: return 0;
+    }
+
+    if (!user_info_ || user_info_size_ < n_dimension_values * sizeof(REAL))
+    {
+        throw std::runtime_error("user info of spline models must start with the spline dimensions");
+    }
+
+    REAL const * const dimensions = reinterpret_cast<REAL const *>(user_info_);
+    std::size_t n_points = 1;
+
+    for (std::size_t i = 0; i < n_dimension_values; i++)
+        n_points *= std::size_t(dimensions[i]);
+
+    return n_points;
+}
+
+void FitInterface::check_point_mask()
+{
+    if (n_point_masks_ != 1 && n_point_masks_ != n_fits_)
+    {
+        throw std::runtime_error("number of point masks must be 1 or the number of fits");
+    }
+}
+
 void FitInterface::configure_info(Info & info, ModelID const model_id)
 {
     info.model_id_ = model_id;
@@ -70,80 +205,190 @@ void FitInterface::configure_info(Info & info, ModelID const model_id)
     info.user_info_size_ = user_info_size_;
     info.n_parameters_ = n_parameters_;
     info.use_constraints_ = constraints_ ? true : false;
+    info.per_fit_parameters_to_fit_ = per_fit_parameters_to_fit_;
 
-    info.set_number_of_parameters_to_fit(parameters_to_fit_);
+    // with parameters to fit per fit, the number is set for each group of fits
+    if (!per_fit_parameters_to_fit_)
+        info.set_number_of_parameters_to_fit(parameters_to_fit_);
 }
 
-void FitInterface::set_number_of_parameters(ModelID const model_id)
+void FitInterface::check_models(int const * model_ids, std::size_t const * parameter_offsets)
 {
-    switch (model_id)
+    if (parameter_offsets[0] != 0)
     {
-    case GAUSS_1D:
-        n_parameters_ = 4;
-        break;
-    case GAUSS_2D:
-        n_parameters_ = 5;
-        break;
-    case GAUSS_2D_ELLIPTIC:
-        n_parameters_ = 6;
-        break;
-    case GAUSS_2D_ROTATED:
-        n_parameters_ = 7;
-        break;
-    case CAUCHY_2D_ELLIPTIC:
-        n_parameters_ = 6;
-        break;
-    case LINEAR_1D:
-        n_parameters_ = 2;
-        break;
-    case FLETCHER_POWELL_HELIX:
-        n_parameters_ = 3;
-        break;
-    case BROWN_DENNIS:
-        n_parameters_ = 4;
-        break;
-    case SPLINE_1D:
-        n_parameters_ = 3;
-        break;
-    case SPLINE_2D:
-        n_parameters_ = 4;
-        break;
-    case SPLINE_3D:
-        n_parameters_ = 5;
-        break;
-    case SPLINE_3D_MULTICHANNEL:
-        n_parameters_ = 5;
-        break;
-    case SPLINE_3D_PHASE_MULTICHANNEL:
-        n_parameters_ = 6;
-        break;
-    default:
-        throw std::runtime_error("unknown model ID");
+        throw std::runtime_error("parameter offsets must start at zero");
+    }
+
+    n_parameters_ = 0;
+
+    for (std::size_t fit_index = 0; fit_index < n_fits_; fit_index++)
+    {
+        int const n_parameters = get_number_of_parameters(static_cast<ModelID>(model_ids[fit_index]));
+
+        if (parameter_offsets[fit_index + 1] - parameter_offsets[fit_index] != std::size_t(n_parameters))
+        {
+            throw std::runtime_error("parameter offsets do not match the number of model parameters");
+        }
+
+        n_parameters_ = std::max(n_parameters_, n_parameters);
     }
 }
 
-void FitInterface::fit(ModelID const model_id)
+// everything which changes the results of a single model call
+ResultKey FitInterface::get_result_cache_key(ModelID const model_id) const
 {
-    set_number_of_parameters(model_id);
+    std::size_t const n_points_total = point_offsets_ ? point_offsets_[n_fits_] : n_fits_ * n_points_;
+    std::size_t n_points_max = n_points_;
 
-    check_sizes();
+    for (std::size_t fit_index = 0; point_offsets_ && fit_index < n_fits_; fit_index++)
+        n_points_max = std::max(n_points_max, point_offsets_[fit_index + 1] - point_offsets_[fit_index]);
 
-    Info info;
-    configure_info(info, model_id);
+    std::size_t const n_parameters = std::size_t(n_parameters_);
+    std::string const version = CPUFIT_VERSION;
+
+    ResultKeyBuilder key;
+    key.add(version.data(), version.size());
+    key.add_value(sizeof(REAL));
+    key.add_value(int(model_id));
+    key.add_value(int(estimator_id_));
+    key.add_value(tolerance_);
+    key.add_value(max_n_iterations_);
+    key.add_value(n_fits_);
+    key.add_value(n_points_);
+    key.add_value(per_fit_parameters_to_fit_);
+    key.add_value(n_point_masks_);
+    key.add(data_, n_points_total * sizeof(REAL));
+    key.add(weight_, weight_ ? n_points_total * sizeof(REAL) : 0);
+    key.add(point_offsets_, point_offsets_ ? (n_fits_ + 1) * sizeof(std::size_t) : 0);
+    key.add(initial_parameters_, n_fits_ * n_parameters * sizeof(REAL));
+    key.add(parameters_to_fit_, (per_fit_parameters_to_fit_ ? n_fits_ : 1) * n_parameters * sizeof(int));
+    key.add(constraints_, constraints_ ? n_fits_ * 2 * n_parameters * sizeof(REAL) : 0);
+    key.add(constraint_types_, constraint_types_ ? n_parameters * sizeof(int) : 0);
+    key.add(point_mask_, point_mask_ ? (n_point_masks_ == 1 ? n_points_max : n_points_total) : 0);
+    key.add(user_info_, user_info_ ? user_info_size_ : 0);
+
+    return key.key();
+}
+
+void FitInterface::run(Info const & info, int const * model_ids, std::size_t const * parameter_offsets)
+{
+    std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+#ifndef _WIN32
+    // results of calls with a time budget depend on the speed of the fits,
+    // and calls with several models or statistics outputs are not cached;
+    // neither are calls with allocator hooks, as the cache allocates its keys,
+    // paths and entries outside the hooks
+    bool const statistics = output_variances_ || output_reduced_chi_squares_ || output_residual_rms_;
+    bool const hooked = get_allocator_hooks()->allocate != 0;
+    ResultCache * const cache
+        = model_ids || time_budget_ > 0 || statistics || hooked ? 0 : get_thread_result_cache();
+    ResultKey key = {};
+
+    if (cache)
+    {
+        key = get_result_cache_key(info.model_id_);
+
+        if (cache->find(
+            key,
+            n_fits_,
+            std::size_t(n_parameters_),
+            output_parameters_,
+            output_states_,
+            output_chi_squares_,
+            output_n_iterations_))
+        {
+            if (progress_)
+                progress_(n_fits_, n_fits_, progress_context_);
+
+            return;
+        }
+    }
+#endif
+
+    Deadline deadline(time_budget_, n_fits_);
 
     LMFit lmfit(
         data_,
         weight_,
+        point_offsets_,
+        model_ids,
+        parameter_offsets,
+        fit_priorities_,
+        time_budget_ > 0 ? &deadline : 0,
+        cancellation_token_,
+        progress_,
+        progress_context_,
         info,
         initial_parameters_,
         parameters_to_fit_,
         constraints_,
         constraint_types_,
+        point_mask_,
+        n_point_masks_,
         user_info_,
         output_parameters_,
         output_states_,
         output_chi_squares_,
-        output_n_iterations_);
+        output_n_iterations_,
+        output_variances_,
+        output_reduced_chi_squares_,
+        output_residual_rms_);
 
     lmfit.run(tolerance_);
+
+    std::chrono::nanoseconds const latency = std::chrono::steady_clock::now() - start;
+    get_latency_histogram().add(std::uint64_t(latency.count()));
+
+#ifndef _WIN32
+    // results of cancelled calls are incomplete
+    if (cache && std::find(output_states_, output_states_ + n_fits_, int(CANCELLED)) == output_states_ + n_fits_)
+    {
+        cache->store(
+            key,
+            n_fits_,
+            std::size_t(n_parameters_),
+            output_parameters_,
+            output_states_,
+            output_chi_squares_,
+            output_n_iterations_);
+    }
+#endif
+}
+
+void FitInterface::fit(ModelID const model_id)
+{
+    n_parameters_ = get_number_of_parameters(model_id);
+
+    check_sizes();
+
+    if (point_offsets_)
+        check_point_offsets(model_id);
+
+    if (point_mask_)
+        check_point_mask();
+
+    Info info;
+    configure_info(info, model_id);
+
+    run(info, NULL, NULL);
+}
+
+void FitInterface::fit(int const * model_ids, std::size_t const * parameter_offsets)
+{
+    if (n_fits_ == 0)
+        return;
+
+    check_models(model_ids, parameter_offsets);
+
+    check_sizes();
+
+    if (point_mask_)
+        check_point_mask();
+
+    // the model ID and number of parameters are set for each group of fits
+    Info info;
+    configure_info(info, static_cast<ModelID>(model_ids[0]));
+
+    run(info, model_ids, parameter_offsets);
 }
@@ -2,6 +2,29 @@
 #define CPUFIT_INTERFACE_H_INCLUDED
 
 #include "lm_fit.h"
+#include "result_key.h"
+
+// the optional inputs and outputs of a fit call; each entry point sets the
+// ones it takes, the others keep their defaults
+struct FitOptions
+{
+    FitOptions();
+
+    std::size_t const * point_offsets;
+    bool per_fit_parameters_to_fit;
+    REAL * constraints;
+    int * constraint_types;
+    char const * point_mask;
+    std::size_t n_point_masks;
+    double time_budget;
+    int const * fit_priorities;
+    cpufit_cancellation_token const * cancellation_token;
+    cpufit_progress_function progress;
+    void * progress_context;
+    REAL * output_variances;
+    REAL * output_reduced_chi_squares;
+    REAL * output_residual_rms;
+};
 
 class FitInterface
 {
@@ -10,29 +33,34 @@ public:
         REAL const * data,
         REAL const * weights,
         std::size_t n_fits,
-        int n_points,
+        std::size_t n_points,
         REAL tolerance,
         int max_n_iterations,
         EstimatorID estimator_id,
         REAL const * initial_parameters,
         int const * parameters_to_fit,
-        REAL* constraints,
-		int* constraint_types,
         char * user_info,
         std::size_t user_info_size,
         REAL * output_parameters,
         int * output_states,
         REAL * output_chi_squares,
-        int * output_n_iterations);
+        int * output_n_iterations,
+        FitOptions const & options = FitOptions());
 
     virtual ~FitInterface();
 
     void fit(ModelID const model_id);
+    void fit(int const * model_ids, std::size_t const * parameter_offsets);
 
 private:
-    void set_number_of_parameters(ModelID const model_id);
     void check_sizes();
+    void check_models(int const * model_ids, std::size_t const * parameter_offsets);
+    void check_point_offsets(ModelID const model_id);
+    std::size_t get_spline_n_points(ModelID const model_id) const;
+    void check_point_mask();
     void configure_info(Info & info, ModelID const model_id);
+    void run(Info const & info, int const * model_ids, std::size_t const * parameter_offsets);
+    ResultKey get_result_cache_key(ModelID const model_id) const;
 
 public:
 
@@ -41,21 +69,33 @@ private:
     REAL const * const data_;
     REAL const * const weight_;
     std::size_t const n_fits_;
-    int const n_points_;
+    std::size_t const n_points_;
+    std::size_t const * const point_offsets_;
     REAL const tolerance_;
     int const max_n_iterations_;
     EstimatorID estimator_id_;
     REAL const * const initial_parameters_;
     int const * const parameters_to_fit_;
+    bool const per_fit_parameters_to_fit_;
     REAL const* const constraints_;
     int const * const constraint_types_;
+    char const * const point_mask_;
+    std::size_t const n_point_masks_;
     char * const user_info_;
     std::size_t const user_info_size_;
+    double const time_budget_;
+    int const * const fit_priorities_;
+    cpufit_cancellation_token const * const cancellation_token_;
+    cpufit_progress_function const progress_;
+    void * const progress_context_;
 
     REAL * output_parameters_;
     int * output_states_;
     REAL * output_chi_squares_;
     int * output_n_iterations_;
+    REAL * output_variances_;
+    REAL * output_reduced_chi_squares_;
+    REAL * output_residual_rms_;
 };
 
 #endif
@@ -0,0 +1,97 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+// values below n_sub_bins have a bin each, larger values are split into
+// ranges of [2^k, 2^(k+1)) with n_sub_bins bins each
+std::size_t LatencyHistogram::get_bin(std::uint64_t const nanoseconds)
+{
+    if (nanoseconds < n_sub_bins)
+        return std::size_t(nanoseconds);
+
+    std::size_t exponent = 0;
+    while (nanoseconds >> (exponent + 1))
+        exponent++;
+
+    std::size_t const sub_bin = std::size_t(nanoseconds >> (exponent - 4)) - n_sub_bins;
+
+    return (exponent - 3) * n_sub_bins + sub_bin;
+}
+
+std::uint64_t LatencyHistogram::get_upper_bound(std::size_t const bin)
+{
+    if (bin < n_sub_bins)
+        return bin;
+
+    std::size_t const exponent = bin / n_sub_bins + 3;
+    std::uint64_t const lower_bound = std::uint64_t(n_sub_bins + bin % n_sub_bins) << (exponent - 4);
+
+    return lower_bound + (std::uint64_t(1) << (exponent - 4)) - 1;
+}
+
+void LatencyHistogram::add(std::uint64_t const nanoseconds)
+{
+    counts_[get_bin(nanoseconds)]++;
+    n_values_++;
+
+    std::uint64_t current_max = max_;
+    while (nanoseconds > current_max && !max_.compare_exchange_weak(current_max, nanoseconds))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<std::uint64_t> & count : counts_)
+        count = 0;
+
+    n_values_ = 0;
+    max_ = 0;
+}
+
+std::size_t LatencyHistogram::n_values() const
+{
+    return std::size_t(n_values_);
+}
+
+std::uint64_t LatencyHistogram::max() const
+{
+    return max_;
+}
+
+std::uint64_t LatencyHistogram::quantile(double const fraction) const
+{
+    std::uint64_t const n_values = n_values_;
+
+    if (n_values == 0)
+        return 0;
+
+    std::uint64_t const rank = std::max(
+        std::uint64_t(1),
+        std::uint64_t(std::ceil(fraction * double(n_values))));
+
+    std::uint64_t n_smaller_values = 0;
+
+    for (std::size_t bin = 0; bin < n_bins; bin++)
+    {
+        n_smaller_values += counts_[bin];
+
+        if (n_smaller_values >= rank)
+            return std::min(get_upper_bound(bin), std::uint64_t(max_));
+    }
+
+    return max_;
+}
+
+LatencyHistogram & get_latency_histogram()
+{
+    static LatencyHistogram latency_histogram;
+
+    return latency_histogram;
+}
@@ -0,0 +1,39 @@
+#ifndef CPUFIT_LATENCY_HISTOGRAM_H_INCLUDED
+#define CPUFIT_LATENCY_HISTOGRAM_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// counts latencies in log-linear bins of at most 1/16 of their value, so that
+// adding a latency takes neither a lock nor memory
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(std::uint64_t const nanoseconds);
+    void reset();
+
+    std::size_t n_values() const;
+    std::uint64_t max() const;
+
+    // upper bound of the bin holding the given fraction of the values
+    std::uint64_t quantile(double const fraction) const;
+
+private:
+    static std::size_t const n_sub_bins = 16;
+    static std::size_t const n_bins = 61 * n_sub_bins;
+
+    static std::size_t get_bin(std::uint64_t const nanoseconds);
+    static std::uint64_t get_upper_bound(std::size_t const bin);
+
+    std::atomic<std::uint64_t> counts_[n_bins];
+    std::atomic<std::uint64_t> n_values_;
+    std::atomic<std::uint64_t> max_;
+};
+
+// latencies of all fit calls
+LatencyHistogram & get_latency_histogram();
+
+#endif
@@ -4,33 +4,63 @@
 #include <algorithm>
 #include <utility>
 #include <vector>
+#include <memory>
 #include <numeric>
 
+int const LMFit::progress_report_interval;
+
 LMFit::LMFit(
     REAL const * const data,
     REAL const * const weights,
+    std::size_t const * const point_offsets,
+    int const * const model_ids,
+    std::size_t const * const parameter_offsets,
+    int const * const fit_priorities,
+    Deadline * const deadline,
+    cpufit_cancellation_token const * const cancellation_token,
+    cpufit_progress_function const progress,
+    void * const progress_context,
     Info const & info,
     REAL const * const initial_parameters,
     int const * const parameters_to_fit,
     REAL const * const constraints,
     int const * const constraint_types,
+    char const * const point_mask,
+    std::size_t const n_point_masks,
     char * const user_info,
     REAL * output_parameters,
     int * output_states,
     REAL * output_chi_squares,
-    int * output_n_iterations
+    int * output_n_iterations,
+    REAL * output_variances,
+    REAL * output_reduced_chi_squares,
+    REAL * output_residual_rms
     ) :
     data_(data),
     weights_(weights),
+    point_offsets_(point_offsets),
+    model_ids_(model_ids),
+    parameter_offsets_(parameter_offsets),
+    fit_priorities_(fit_priorities),
+    deadline_(deadline),
+    cancellation_token_(cancellation_token),
+    progress_(progress),
+    progress_context_(progress_context),
+    last_progress_report_(std::chrono::steady_clock::now()),
     initial_parameters_(initial_parameters),
     parameters_to_fit_(parameters_to_fit),
     constraints_(constraints),
     constraint_types_(constraint_types),
+    point_mask_(point_mask),
+    n_point_masks_(n_point_masks),
     user_info_(user_info),
     output_parameters_(output_parameters),
     output_states_(output_states),
     output_chi_squares_(output_chi_squares),
     output_n_iterations_(output_n_iterations),
+    output_variances_(output_variances),
+    output_reduced_chi_squares_(output_reduced_chi_squares),
+    output_residual_rms_(output_residual_rms),
     info_(info)
 {}
 
@@ -38,26 +68,293 @@ LMFit::~LMFit()
 {
 }
 
+std::size_t LMFit::get_n_points(std::size_t const fit_index) const
+{
+    if (!point_offsets_)
+        return info_.n_points_;
+
+    return point_offsets_[fit_index + 1] - point_offsets_[fit_index];
+}
+
+std::size_t LMFit::get_parameter_offset(std::size_t const fit_index) const
+{
+    if (!parameter_offsets_)
+        return fit_index * info_.n_parameters_;
+
+    return parameter_offsets_[fit_index];
+}
+
+ModelID LMFit::get_model_id(std::size_t const fit_index) const
+{
+    if (!model_ids_)
+        return info_.model_id_;
+
+    return static_cast<ModelID>(model_ids_[fit_index]);
+}
+
+int const * LMFit::get_parameters_to_fit(std::size_t const fit_index) const
+{
+    if (!info_.per_fit_parameters_to_fit_)
+        return parameters_to_fit_;
+
+    return parameters_to_fit_ + get_parameter_offset(fit_index);
+}
+
+// orders fits by their priority, highest first, their model, their number of
+// points and their parameters to fit
+bool LMFit::precedes(std::size_t const fit_a, std::size_t const fit_b) const
+{
+    if (fit_priorities_ && fit_priorities_[fit_a] != fit_priorities_[fit_b])
+        return fit_priorities_[fit_a] > fit_priorities_[fit_b];
+
+    ModelID const model_id_a = get_model_id(fit_a);
+    ModelID const model_id_b = get_model_id(fit_b);
+
+    if (model_id_a != model_id_b)
+        return model_id_a < model_id_b;
+
+    std::size_t const n_points_a = get_n_points(fit_a);
+    std::size_t const n_points_b = get_n_points(fit_b);
+
+    if (n_points_a != n_points_b)
+        return n_points_a < n_points_b;
+
+    int const * const parameters_to_fit_a = get_parameters_to_fit(fit_a);
+    int const * const parameters_to_fit_b = get_parameters_to_fit(fit_b);
+
+    int const n_parameters
+        = parameter_offsets_
+        ? int(parameter_offsets_[fit_a + 1] - parameter_offsets_[fit_a])
+        : info_.n_parameters_;
+
+    for (int i = 0; i < n_parameters; i++)
+    {
+        bool const fit_parameter_a = parameters_to_fit_a[i] != 0;
+        bool const fit_parameter_b = parameters_to_fit_b[i] != 0;
+
+        if (fit_parameter_a != fit_parameter_b)
+            return fit_parameter_a < fit_parameter_b;
+    }
+
+    return false;
+}
+
+void LMFit::run_fit(
+    std::size_t const fit_index,
+    Info const & info,
+    REAL const tolerance,
+    Executor * const executor)
+{
+    std::size_t const first_point
+        = point_offsets_
+        ? point_offsets_[fit_index]
+        : fit_index * info.n_points_;
+
+    // a single point mask is shared by all fits
+    char const * const point_mask
+        = !point_mask_ || n_point_masks_ == 1
+        ? point_mask_
+        : point_mask_ + first_point;
+
+    std::size_t const first_parameter = get_parameter_offset(fit_index);
+
+    if (deadline_ && deadline_->expired())
+    {
+        skip_fit(fit_index, info, FitState::DEADLINE_EXCEEDED);
+        return;
+    }
+
+    LMFitCPP gf_cpp(
+        tolerance,
+        fit_index,
+        first_point,
+        data_ + first_point,
+        weights_ ? weights_ + first_point : 0,
+        info,
+        initial_parameters_ + first_parameter,
+        get_parameters_to_fit(fit_index),
+        constraints_,
+        constraint_types_,
+        point_mask,
+        user_info_,
+        executor,
+        deadline_,
+        output_parameters_ + first_parameter,
+        output_states_ + fit_index,
+        output_chi_squares_ + fit_index,
+        output_n_iterations_ + fit_index,
+        output_variances_ ? output_variances_ + first_parameter : 0,
+        output_reduced_chi_squares_ ? output_reduced_chi_squares_ + fit_index : 0,
+        output_residual_rms_ ? output_residual_rms_ + fit_index : 0);
+
+    gf_cpp.run();
+}
+
+// skipped fits return their initial parameters
+void LMFit::skip_fit(std::size_t const fit_index, Info const & info, FitState const state)
+{
+    std::size_t const first_parameter = get_parameter_offset(fit_index);
+
+    std::copy(
+        initial_parameters_ + first_parameter,
+        initial_parameters_ + first_parameter + info.n_parameters_,
+        output_parameters_ + first_parameter);
+
+    output_states_[fit_index] = state;
+    output_chi_squares_[fit_index] = 0;
+    output_n_iterations_[fit_index] = 0;
+
+    if (output_variances_)
+    {
+        std::fill(
+            output_variances_ + first_parameter,
+            output_variances_ + first_parameter + info.n_parameters_,
+            REAL(0));
+    }
+
+    if (output_reduced_chi_squares_)
+        output_reduced_chi_squares_[fit_index] = 0;
+
+    if (output_residual_rms_)
+        output_residual_rms_[fit_index] = 0;
+}
+
+bool LMFit::cancelled() const
+{
+    return cancellation_token_ && cancellation_token_->cancelled;
+}
+
+// progress is reported from the calling thread, at most every
+// progress_report_interval and once after the last chunk; the job gives up
+// the executor first, so that a slow callback does not hold up other batches
+void LMFit::report_progress(Scheduler::Job & job, std::size_t const n_finished_fits, bool const last_report)
+{
+    if (!progress_)
+        return;
+
+    std::chrono::steady_clock::time_point const now = std::chrono::steady_clock::now();
+
+    if (!last_report && now - last_progress_report_ < std::chrono::milliseconds(progress_report_interval))
+        return;
+
+    last_progress_report_ = now;
+    job.release();
+    progress_(n_finished_fits, info_.n_fits_, progress_context_);
+}
+
 void LMFit::run(REAL const tolerance)
 {
+    std::shared_ptr<Executor> const executor = get_executor();
+    WorkspaceScope const workspace(*executor);
+
+    // fits are processed in groups with the same model, the same number of
+    // points and the same parameters to fit, each group sharing one Info
+    Buffer<std::size_t> fit_order(info_.n_fits_);
+    std::iota(fit_order.begin(), fit_order.end(), std::size_t(0));
+
+    // equal fits keep their order, std::stable_sort is not used because it
+    // allocates its buffer outside the allocator hooks
+    if (model_ids_ || point_offsets_ || info_.per_fit_parameters_to_fit_ || fit_priorities_)
+    {
+        std::sort(
+            fit_order.begin(),
+            fit_order.end(),
+            [this](std::size_t const a, std::size_t const b)
+            { return precedes(a, b) || (!precedes(b, a) && a < b); });
+    }
+
+    Buffer<Info> group_infos;
+    Buffer<std::size_t> fit_groups(fit_order.size());
+
+    for (std::size_t i = 0; i < fit_order.size(); i++)
+    {
+        std::size_t const fit_index = fit_order[i];
+
+        if (i == 0 || precedes(fit_order[i - 1], fit_index))
+        {
+            Info group_info = info_;
+
+            if (model_ids_)
+            {
+                group_info.model_id_ = get_model_id(fit_index);
+                group_info.n_parameters_
+                    = int(parameter_offsets_[fit_index + 1] - parameter_offsets_[fit_index]);
+            }
+
+            group_info.n_points_ = get_n_points(fit_index);
+            group_info.set_number_of_parameters_to_fit(get_parameters_to_fit(fit_index));
+
+            group_infos.push_back(group_info);
+        }
+
+        fit_groups[i] = group_infos.size() - 1;
+    }
+
+    // the points of each fit are split across the threads and each fit is one
+    // chunk only if that gives more tasks than splitting the fits, i.e. for
+    // fewer fits than threads with more than one chunk of points per fit,
+    // otherwise the fits are split; cancellation is checked before each chunk
+    std::size_t n_points = 0;
     for (std::size_t fit_index = 0; fit_index < info_.n_fits_; fit_index++)
+        n_points += get_n_points(fit_index);
+
+    std::size_t const n_point_chunks
+        = (n_points + LMFitCPP::n_points_per_chunk - 1) / LMFitCPP::n_points_per_chunk;
+
+    bool const split_points = info_.n_fits_ < executor->n_threads() && n_point_chunks > info_.n_fits_;
+    std::size_t const n_fits_per_chunk = n_fits_per_thread_and_chunk * executor->n_threads();
+
+    // concurrent calls take turns on the executor, one chunk at a time, unless
+    // all of their chunks run on the calling thread
+    bool const uses_workers
+        = executor->uses_workers(split_points ? n_point_chunks : std::min(fit_order.size(), n_fits_per_chunk));
+
+    Scheduler::Job job(
+        get_scheduler(),
+        uses_workers ? executor.get() : 0,
+        get_thread_priority_class(),
+        get_thread_weight());
+
+    std::size_t n_finished_fits = 0;
+
+    if (split_points)
     {
-        LMFitCPP gf_cpp(
-            tolerance,
-            fit_index,
-            data_ + fit_index*info_.n_points_,
-            weights_ ? weights_ + fit_index*info_.n_points_ : 0,
-            info_,
-            initial_parameters_ + fit_index*info_.n_parameters_,
-            parameters_to_fit_,
-            constraints_,
-            constraint_types_,
-            user_info_,
-            output_parameters_ + fit_index*info_.n_parameters_,
-            output_states_ + fit_index,
-            output_chi_squares_ + fit_index,
-            output_n_iterations_ + fit_index);
-
-        gf_cpp.run();
+        for (; n_finished_fits < fit_order.size() && !cancelled(); n_finished_fits++)
+        {
+            {
+                Scheduler::Turn const turn(job);
+                run_fit(
+                    fit_order[n_finished_fits],
+                    group_infos[fit_groups[n_finished_fits]],
+                    tolerance,
+                    executor.get());
+            }
+
+            report_progress(job, n_finished_fits + 1, false);
+        }
     }
-}
\ No newline at end of file
+    else
+    {
+        while (n_finished_fits < fit_order.size() && !cancelled())
+        {
+            std::size_t const begin = n_finished_fits;
+            std::size_t const end = std::min(fit_order.size(), begin + n_fits_per_chunk);
+
+            {
+                Scheduler::Turn const turn(job);
+                executor->parallel_for(
+                    end - begin,
+                    [&](std::size_t const i)
+                    { run_fit(fit_order[begin + i], group_infos[fit_groups[begin + i]], tolerance, 0); });
+            }
+
+            n_finished_fits = end;
+            report_progress(job, n_finished_fits, false);
+        }
+    }
+
+    for (std::size_t i = n_finished_fits; i < fit_order.size(); i++)
+        skip_fit(fit_order[i], group_infos[fit_groups[i]], FitState::CANCELLED);
+
+    report_progress(job, n_finished_fits, true);
+}
@@ -8,6 +8,13 @@
 #endif // _WIN64
 
 #include "info.h"
+#include "allocator.h"
+#include "executor.h"
+#include "deadline.h"
+#include "scheduler.h"
+#include "cancellation.h"
+
+#include <chrono>
 
 class LMFitCPP;
 
@@ -17,36 +24,83 @@ public:
     LMFit(
         REAL const * data,
         REAL const * weights,
+        std::size_t const * point_offsets,
+        int const * model_ids,
+        std::size_t const * parameter_offsets,
+        int const * fit_priorities,
+        Deadline * deadline,
+        cpufit_cancellation_token const * cancellation_token,
+        cpufit_progress_function progress,
+        void * progress_context,
         Info const& info,
         REAL const * initial_parameters,
         int const * parameters_to_fit,
         REAL const* constraints,
         int const* constraint_types,
+        char const * point_mask,
+        std::size_t n_point_masks,
         char * user_info,
         REAL * output_parameters,
         int * output_states,
         REAL * output_chi_squares,
-        int * output_n_iterations);
+        int * output_n_iterations,
+        REAL * output_variances,
+        REAL * output_reduced_chi_squares,
+        REAL * output_residual_rms);
 
     virtual ~LMFit();
 
     void run(REAL const tolerance);
         
 private:
+    std::size_t get_n_points(std::size_t const fit_index) const;
+    std::size_t get_parameter_offset(std::size_t const fit_index) const;
+    ModelID get_model_id(std::size_t const fit_index) const;
+    int const * get_parameters_to_fit(std::size_t const fit_index) const;
+    bool precedes(std::size_t const fit_a, std::size_t const fit_b) const;
+    void run_fit(
+        std::size_t const fit_index,
+        Info const & info,
+        REAL const tolerance,
+        Executor * executor);
+    void skip_fit(std::size_t const fit_index, Info const & info, FitState const state);
+    bool cancelled() const;
+    void report_progress(Scheduler::Job & job, std::size_t const n_finished_fits, bool const last_report);
+
     REAL const * const data_;
     REAL const * const weights_;
+    std::size_t const * const point_offsets_;
+    int const * const model_ids_;
+    std::size_t const * const parameter_offsets_;
+    int const * const fit_priorities_;
+    Deadline * const deadline_;
+    cpufit_cancellation_token const * const cancellation_token_;
+    cpufit_progress_function const progress_;
+    void * const progress_context_;
+    std::chrono::steady_clock::time_point last_progress_report_;
     REAL const * const initial_parameters_;
     int const * const parameters_to_fit_;
     REAL const* const constraints_;
     int const* const constraint_types_;
+    char const * const point_mask_;
+    std::size_t const n_point_masks_;
     char * const user_info_;
 
     REAL * output_parameters_;
     int * output_states_;
     REAL * output_chi_squares_;
     int * output_n_iterations_;
+    REAL * output_variances_;
+    REAL * output_reduced_chi_squares_;
+    REAL * output_residual_rms_;
 
     Info const & info_;
+
+    // number of fits per thread run in one turn of the scheduler
+    static std::size_t const n_fits_per_thread_and_chunk = 256;
+
+    // minimum time between two progress reports in milliseconds
+    static int const progress_report_interval = 100;
 };
 
 class LMFitCPP
@@ -55,6 +109,7 @@ public:
     LMFitCPP(
         REAL const tolerance,
         std::size_t const fit_index,
+        std::size_t const first_point,
         REAL const * data,
         REAL const * weight,
         Info const & info,
@@ -62,69 +117,107 @@ public:
         int const * parameters_to_fit,
         REAL const* const constraints,
         int const* const constraint_types,
+        char const * point_mask,
         char * user_info,
+        Executor * executor,
+        Deadline * deadline,
         REAL * output_parameters,
         int * output_states,
         REAL * output_chi_squares,
-        int * output_n_iterations);
+        int * output_n_iterations,
+        REAL * output_variances,
+        REAL * output_reduced_chi_square,
+        REAL * output_residual_rms);
 
     virtual ~LMFitCPP()
     {};
 
     void run();
 
+    // number of points evaluated and summed up by one thread
+    static std::size_t const n_points_per_chunk = 16384;
+
 private:
 	void calc_model();
     void calc_coefficients();
 
-    void calc_curve_values(std::vector<REAL>& curve, std::vector<REAL>& derivatives);
+    void calc_values(Buffer<REAL>& curve, std::size_t const begin, std::size_t const end);
+    void calc_derivatives(Buffer<REAL>& derivatives, std::size_t const begin, std::size_t const end);
+    void calc_curve_values(Buffer<REAL>& curve, Buffer<REAL>& derivatives);
 
-    void calc_values_gauss2d(std::vector<REAL>& gaussian);
-    void calc_derivatives_gauss2d(std::vector<REAL> & derivatives);
+    void calc_values_gauss2d(Buffer<REAL>& gaussian, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_gauss2d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_gauss2delliptic(std::vector<REAL>& gaussian);
-    void calc_derivatives_gauss2delliptic(std::vector<REAL> & derivatives);
+    void calc_values_gauss2delliptic(Buffer<REAL>& gaussian, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_gauss2delliptic(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_gauss2drotated(std::vector<REAL>& gaussian);
-    void calc_derivatives_gauss2drotated(std::vector<REAL> & derivatives);
+    void calc_values_gauss2drotated(Buffer<REAL>& gaussian, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_gauss2drotated(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_gauss1d(std::vector<REAL>& gaussian);
-    void calc_derivatives_gauss1d(std::vector<REAL> & derivatives);
+    void calc_values_gauss1d(Buffer<REAL>& gaussian, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_gauss1d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_cauchy2delliptic(std::vector<REAL>& cauchy);
-    void calc_derivatives_cauchy2delliptic(std::vector<REAL> & derivatives);
+    void calc_values_cauchy2delliptic(Buffer<REAL>& cauchy, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_cauchy2delliptic(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_linear1d(std::vector<REAL>& line);
-    void calc_derivatives_linear1d(std::vector<REAL> & derivatives);
+    void calc_values_linear1d(Buffer<REAL>& line, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_linear1d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_fletcher_powell_helix(std::vector<REAL>& values);
-    void calc_derivatives_fletcher_powell_helix(std::vector<REAL> & derivatives);
+    void calc_values_fletcher_powell_helix(Buffer<REAL>& values);
+    void calc_derivatives_fletcher_powell_helix(Buffer<REAL> & derivatives);
 
-    void calc_values_brown_dennis(std::vector<REAL>& values);
-    void calc_derivatives_brown_dennis(std::vector<REAL> & derivatives);
+    void calc_values_brown_dennis(Buffer<REAL>& values, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_brown_dennis(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
     
-    void calc_values_spline1d(std::vector<REAL>& values);
-    void calc_derivatives_spline1d(std::vector<REAL> & derivatives);
+    void calc_values_spline1d(Buffer<REAL>& values, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_spline1d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
+
+    void calc_values_spline2d(Buffer<REAL>& values, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_spline2d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
+
+    void calc_values_spline3d(Buffer<REAL>& values, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_spline3d(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
+
+    void calc_values_spline3d_multichannel(Buffer<REAL>& values, std::size_t const begin, std::size_t const end);
+    void calc_derivatives_spline3d_multichannel(Buffer<REAL> & derivatives, std::size_t const begin, std::size_t const end);
 
-    void calc_values_spline2d(std::vector<REAL>& values);
-    void calc_derivatives_spline2d(std::vector<REAL> & derivatives);
+    bool skip_point(std::size_t const point_index) const;
+    std::size_t get_point_index(std::size_t const point) const;
 
-    void calc_values_spline3d(std::vector<REAL>& values);
-    void calc_derivatives_spline3d(std::vector<REAL> & derivatives);
+    REAL calc_poisson_weight(std::size_t const pixel_index,
+        Buffer<REAL> const & curve) const;
 
-    void calc_values_spline3d_multichannel(std::vector<REAL>& values);
-    void calc_derivatives_spline3d_multichannel(std::vector<REAL> & derivatives);
+    template<typename SumChunk>
+    double const * sum_chunks(std::size_t const n_sums, SumChunk const & sum_chunk);
 
-    void calculate_hessian(std::vector<REAL> const & derivatives,
-        std::vector<REAL> const & curve);
+    void sum_hessian(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve,
+        std::size_t const begin, std::size_t const end, double * sums) const;
 
-    void calc_gradient(std::vector<REAL> const & derivatives,
-        std::vector<REAL> const & curve);
+    void sum_gradient(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve,
+        std::size_t const begin, std::size_t const end, double * sums) const;
+
+    void sum_chi_square(Buffer<REAL> const & values,
+        std::size_t const begin, std::size_t const end, double * sums) const;
+
+    void sum_fisher_information(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve,
+        std::size_t const begin, std::size_t const end, double * sums) const;
+
+    void calculate_hessian(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve);
+
+    void calc_gradient(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve);
+
+    void calc_fisher_information(Buffer<REAL> const & derivatives,
+        Buffer<REAL> const & curve);
 
     void calc_chi_square(
-        std::vector<REAL> const & curve);
+        Buffer<REAL> const & curve);
 
-    void decompose_hessian_LUP(std::vector<REAL> const & hessian);
+    void decompose_hessian_LUP(Buffer<REAL> const & hessian);
 
     void modify_step_width();
     void solve_equation_system_gj();
@@ -135,39 +228,64 @@ private:
     bool check_for_convergence();
     void evaluate_iteration(int const iteration);
     void prepare_next_iteration();
+    void calc_statistics();
 
 public:
 
 private:
 
     std::size_t const fit_index_;
+    std::size_t const first_point_;
     REAL const * const data_;
     REAL const * const weight_;
     REAL const * const initial_parameters_;
     int const * const parameters_to_fit_;
     REAL const* const constraints_;
     int const* const constraint_types_;
+    char const * const point_mask_;
+    Buffer<std::size_t> point_indices_;
+    std::size_t n_used_points_;
+
+    Executor * const executor_;
+    std::size_t n_chunks_;
+
+    // lowered if the deadline of the batch is near
+    Deadline * const deadline_;
+    int max_n_iterations_;
+
+    Buffer<double> partial_sums_;
 
     bool converged_;
+
     REAL * parameters_;
     int * state_;
     REAL * chi_square_;
     int * n_iterations_;
 
-    std::vector<REAL> prev_parameters_;
+    // optional outputs calculated from the Hessian, the Fisher information
+    // with MLE, and the residuals of the accepted parameters
+    REAL * variances_;
+    REAL * reduced_chi_square_;
+    REAL * residual_rms_;
+
+    Buffer<REAL> prev_parameters_;
     Info const & info_;
 
     REAL lambda_;
-    std::vector<REAL> curve_;
-    std::vector<REAL> derivatives_;
-    std::vector<REAL> hessian_;
-    std::vector<REAL> decomposed_hessian_;
-    std::vector<int> pivot_array_;
-    std::vector<REAL> modified_hessian_;
-    std::vector<REAL> gradient_;
-    std::vector<REAL> delta_;
-    std::vector<REAL> scaling_vector_;
+    Buffer<REAL> curve_;
+    Buffer<REAL> derivatives_;
+    Buffer<REAL> hessian_;
+    // of the last accepted parameters, only for the variances with MLE
+    Buffer<double> fisher_information_;
+    Buffer<REAL> decomposed_hessian_;
+    Buffer<int> pivot_array_;
+    Buffer<REAL> modified_hessian_;
+    Buffer<REAL> gradient_;
+    Buffer<REAL> delta_;
+    Buffer<REAL> scaling_vector_;
     REAL prev_chi_square_;
+    double residual_sum_of_squares_;
+    double prev_residual_sum_of_squares_;
     REAL const tolerance_;
 
     char * const user_info_;
@@ -6,6 +6,7 @@
 #include <numeric>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 // TODO if std::size_t and int are not the same, we will get lots of C26451 warnings here related to it, they can be ignored or
 // int should be converted to size_t but be careful, there is at least one for loop that checks for >=0 which only works with int that way
@@ -14,6 +15,7 @@
 LMFitCPP::LMFitCPP(
     REAL const tolerance,
     std::size_t const fit_index,
+    std::size_t const first_point,
     REAL const * data,
     REAL const * weight,
     Info const & info,
@@ -21,13 +23,20 @@ LMFitCPP::LMFitCPP(
     int const * parameters_to_fit,
     REAL const* const constraints,
     int const* const constraint_types,
+    char const * point_mask,
     char * user_info,
+    Executor * executor,
+    Deadline * deadline,
     REAL * output_parameters,
     int * output_state,
     REAL * output_chi_square,
-    int * output_n_iterations
+    int * output_n_iterations,
+    REAL * output_variances,
+    REAL * output_reduced_chi_square,
+    REAL * output_residual_rms
     ) :
     fit_index_(fit_index),
+    first_point_(first_point),
     data_(data),
     weight_(weight),
     initial_parameters_(initial_parameters),
@@ -37,9 +46,17 @@ LMFitCPP::LMFitCPP(
     parameters_to_fit_(parameters_to_fit),
     constraints_(constraints),
     constraint_types_(constraint_types),
+    point_mask_(point_mask),
+    n_used_points_(info.n_points_),
+    executor_(executor),
+    n_chunks_(1),
+    deadline_(deadline),
+    max_n_iterations_(info.max_n_iterations_),
     curve_(info.n_points_),
     derivatives_(info.n_points_*info.n_parameters_),
     hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
+    fisher_information_(
+        output_variances && info.estimator_id_ == MLE ? info.n_parameters_to_fit_*info.n_parameters_to_fit_ : 0),
     modified_hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
     decomposed_hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
     pivot_array_(info_.n_parameters_to_fit_),
@@ -47,17 +64,35 @@ LMFitCPP::LMFitCPP(
     delta_(info.n_parameters_to_fit_),
     scaling_vector_(info.n_parameters_to_fit_),
     prev_chi_square_(0),
+    residual_sum_of_squares_(0),
+    prev_residual_sum_of_squares_(0),
     lambda_(0.001f),
     prev_parameters_(info.n_parameters_),
     user_info_(user_info),
     parameters_(output_parameters),
     state_(output_state),
     chi_square_(output_chi_square),
-    n_iterations_(output_n_iterations)
-{}
+    n_iterations_(output_n_iterations),
+    variances_(output_variances),
+    reduced_chi_square_(output_reduced_chi_square),
+    residual_rms_(output_residual_rms)
+{
+    if (point_mask_)
+    {
+        for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+        {
+            if (point_mask_[point_index])
+                point_indices_.push_back(point_index);
+        }
+        n_used_points_ = point_indices_.size();
+    }
+
+    if (n_used_points_ > n_points_per_chunk)
+        n_chunks_ = (n_used_points_ + n_points_per_chunk - 1) / n_points_per_chunk;
+}
 
 template<class T>
-int decompose_LUP(std::vector<T> & matrix, int const N, double const Tol, std::vector<int> & permutation_vector) {
+int decompose_LUP(Buffer<T> & matrix, int const N, double const Tol, Buffer<int> & permutation_vector) {
 
     for (int i = 0; i < N; i++)
         permutation_vector[i] = i;
@@ -104,11 +139,11 @@ int decompose_LUP(std::vector<T> & matrix, int const N, double const Tol, std::v
 
 template<class T>
 void solve_LUP(
-    std::vector<T> const & matrix,
-    std::vector<int> const & permutation_vector,
-    std::vector<T> const & vector,
+    Buffer<T> const & matrix,
+    Buffer<int> const & permutation_vector,
+    Buffer<T> const & vector,
     int const N,
-    std::vector<T> & solution)
+    Buffer<T> & solution)
 {
     for (int i = 0; i < N; i++)
     {
@@ -131,7 +166,7 @@ void solve_LUP(
     }
 }
 
-void LMFitCPP::decompose_hessian_LUP(std::vector<REAL> const & hessian)
+void LMFitCPP::decompose_hessian_LUP(Buffer<REAL> const & hessian)
 {
     decomposed_hessian_ = hessian;
 
@@ -143,62 +178,78 @@ void LMFitCPP::decompose_hessian_LUP(std::vector<REAL> const & hessian)
 }
 
 void LMFitCPP::calc_derivatives_gauss2d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
 
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            REAL const argx = (x - parameters_[1]) * (x - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
-            REAL const argy = (y - parameters_[2]) * (y - parameters_[2]) / (2 * parameters_[3] * parameters_[3]);
-            REAL const ex = exp(-(argx + argy));
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = ex;
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (x - parameters_[1])*ex) / (parameters_[3] * parameters_[3]);
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (y - parameters_[2])*ex) / (parameters_[3] * parameters_[3]);
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0]
-                * ((x - parameters_[1])*(x - parameters_[1])
-                + (y - parameters_[2])*(y - parameters_[2]))*ex)
-                / (parameters_[3] * parameters_[3] * parameters_[3]);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x]
-                = 1;
-        }
+    for (std::size_t point_index = begin; point_index < end; point_index++)
+    {
+        std::size_t const x = point_index % fit_size_x;
+        std::size_t const y = point_index / fit_size_x;
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const argx = (x - parameters_[1]) * (x - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
+        REAL const argy = (y - parameters_[2]) * (y - parameters_[2]) / (2 * parameters_[3] * parameters_[3]);
+        REAL const ex = exp(-(argx + argy));
+
+        derivatives[0 * info_.n_points_ + point_index]
+            = ex;
+        derivatives[1 * info_.n_points_ + point_index]
+            = (parameters_[0] * (x - parameters_[1])*ex) / (parameters_[3] * parameters_[3]);
+        derivatives[2 * info_.n_points_ + point_index]
+            = (parameters_[0] * (y - parameters_[2])*ex) / (parameters_[3] * parameters_[3]);
+        derivatives[3 * info_.n_points_ + point_index]
+            = (parameters_[0]
+            * ((x - parameters_[1])*(x - parameters_[1])
+            + (y - parameters_[2])*(y - parameters_[2]))*ex)
+            / (parameters_[3] * parameters_[3] * parameters_[3]);
+        derivatives[4 * info_.n_points_ + point_index]
+            = 1;
+    }
 }
 
 void LMFitCPP::calc_derivatives_gauss2delliptic(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
 
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            REAL const argx = (x - parameters_[1]) * (x - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
-            REAL const argy = (y - parameters_[2]) * (y - parameters_[2]) / (2 * parameters_[4] * parameters_[4]);
-            REAL const ex = exp(-(argx +argy));
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = ex;
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (x - parameters_[1])*ex) / (parameters_[3] * parameters_[3]);
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (y - parameters_[2])*ex) / (parameters_[4] * parameters_[4]);
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (x - parameters_[1])*(x - parameters_[1])*ex) / (parameters_[3] * parameters_[3] * parameters_[3]);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x]
-                = (parameters_[0] * (y - parameters_[2])*(y - parameters_[2])*ex) / (parameters_[4] * parameters_[4] * parameters_[4]);
-            derivatives[5 * info_.n_points_ + y*fit_size_x + x]
-                = 1;
-        }
+    for (std::size_t point_index = begin; point_index < end; point_index++)
+    {
+        std::size_t const x = point_index % fit_size_x;
+        std::size_t const y = point_index / fit_size_x;
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const argx = (x - parameters_[1]) * (x - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
+        REAL const argy = (y - parameters_[2]) * (y - parameters_[2]) / (2 * parameters_[4] * parameters_[4]);
+        REAL const ex = exp(-(argx +argy));
+
+        derivatives[0 * info_.n_points_ + point_index]
+            = ex;
+        derivatives[1 * info_.n_points_ + point_index]
+            = (parameters_[0] * (x - parameters_[1])*ex) / (parameters_[3] * parameters_[3]);
+        derivatives[2 * info_.n_points_ + point_index]
+            = (parameters_[0] * (y - parameters_[2])*ex) / (parameters_[4] * parameters_[4]);
+        derivatives[3 * info_.n_points_ + point_index]
+            = (parameters_[0] * (x - parameters_[1])*(x - parameters_[1])*ex) / (parameters_[3] * parameters_[3] * parameters_[3]);
+        derivatives[4 * info_.n_points_ + point_index]
+            = (parameters_[0] * (y - parameters_[2])*(y - parameters_[2])*ex) / (parameters_[4] * parameters_[4] * parameters_[4]);
+        derivatives[5 * info_.n_points_ + point_index]
+            = 1;
+    }
 }
 
 void LMFitCPP::calc_derivatives_gauss2drotated(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
 
@@ -211,38 +262,48 @@ void LMFitCPP::calc_derivatives_gauss2drotated(
     REAL const rot_sin = sin(parameters_[6]);
     REAL const rot_cos = cos(parameters_[6]);
 
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            REAL const arga = ((x - x0) * rot_cos) - ((y - y0) * rot_sin);
-            REAL const argb = ((x - x0) * rot_sin) + ((y - y0) * rot_cos);
-            REAL const ex = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = ex;
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x]
-                = ex * (amplitude * rot_cos * arga / (sig_x*sig_x) + amplitude * rot_sin *argb / (sig_y*sig_y));
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x]
-                = ex * (-amplitude * rot_sin * arga / (sig_x*sig_x) + amplitude * rot_cos *argb / (sig_y*sig_y));
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * arga * arga / (sig_x*sig_x*sig_x);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * argb * argb / (sig_y*sig_y*sig_y);
-            derivatives[5 * info_.n_points_ + y*fit_size_x + x]
-                = 1.f;
-            derivatives[6 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * arga * argb * (1.f / (sig_x*sig_x) - 1.f / (sig_y*sig_y));
-        }
+    for (std::size_t point_index = begin; point_index < end; point_index++)
+    {
+        std::size_t const x = point_index % fit_size_x;
+        std::size_t const y = point_index / fit_size_x;
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const arga = ((x - x0) * rot_cos) - ((y - y0) * rot_sin);
+        REAL const argb = ((x - x0) * rot_sin) + ((y - y0) * rot_cos);
+        REAL const ex = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
+
+        derivatives[0 * info_.n_points_ + point_index]
+            = ex;
+        derivatives[1 * info_.n_points_ + point_index]
+            = ex * (amplitude * rot_cos * arga / (sig_x*sig_x) + amplitude * rot_sin *argb / (sig_y*sig_y));
+        derivatives[2 * info_.n_points_ + point_index]
+            = ex * (-amplitude * rot_sin * arga / (sig_x*sig_x) + amplitude * rot_cos *argb / (sig_y*sig_y));
+        derivatives[3 * info_.n_points_ + point_index]
+            = ex * amplitude * arga * arga / (sig_x*sig_x*sig_x);
+        derivatives[4 * info_.n_points_ + point_index]
+            = ex * amplitude * argb * argb / (sig_y*sig_y*sig_y);
+        derivatives[5 * info_.n_points_ + point_index]
+            = 1.f;
+        derivatives[6 * info_.n_points_ + point_index]
+            = ex * amplitude * arga * argb * (1.f / (sig_x*sig_x) - 1.f / (sig_y*sig_y));
+    }
 }
 
 void LMFitCPP::calc_derivatives_gauss1d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL * user_info_float = (REAL*)user_info_;
     REAL x = 0.;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         if (!user_info_float)
         {
             x = REAL(point_index);
@@ -253,8 +314,7 @@ void LMFitCPP::calc_derivatives_gauss1d(
         }
         else if (info_.user_info_size_ / sizeof(REAL) > info_.n_points_)
         {
-            std::size_t const fit_begin = fit_index_ * info_.n_points_;
-            x = user_info_float[fit_begin + point_index];
+            x = user_info_float[first_point_ + point_index];
         }
 
         REAL argx = ((x - parameters_[1])*(x - parameters_[1])) / (2 * parameters_[2] * parameters_[2]);
@@ -268,47 +328,59 @@ void LMFitCPP::calc_derivatives_gauss1d(
 }
 
 void LMFitCPP::calc_derivatives_cauchy2delliptic(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
 
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            REAL const argx =
-                ((parameters_[1] - x) / parameters_[3])
-                *((parameters_[1] - x) / parameters_[3]) + 1.f;
-            REAL const argy =
-                ((parameters_[2] - y) / parameters_[4])
-                *((parameters_[2] - y) / parameters_[4]) + 1.f;
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = 1.f / (argx*argy);
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x] =
-                -2.f * parameters_[0] * (parameters_[1] - x)
-                / (parameters_[3] * parameters_[3] * argx*argx*argy);
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x] =
-                -2.f * parameters_[0] * (parameters_[2] - y)
-                / (parameters_[4] * parameters_[4] * argy*argy*argx);
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x] =
-                2.f * parameters_[0] * (parameters_[1] - x) * (parameters_[1] - x)
-                / (parameters_[3] * parameters_[3] * parameters_[3] * argx*argx*argy);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x] =
-                2.f * parameters_[0] * (parameters_[2] - y) * (parameters_[2] - y)
-                / (parameters_[4] * parameters_[4] * parameters_[4] * argy*argy*argx);
-            derivatives[5 * info_.n_points_ + y*fit_size_x + x]
-                = 1.f;
-        }
+    for (std::size_t point_index = begin; point_index < end; point_index++)
+    {
+        std::size_t const x = point_index % fit_size_x;
+        std::size_t const y = point_index / fit_size_x;
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const argx =
+            ((parameters_[1] - x) / parameters_[3])
+            *((parameters_[1] - x) / parameters_[3]) + 1.f;
+        REAL const argy =
+            ((parameters_[2] - y) / parameters_[4])
+            *((parameters_[2] - y) / parameters_[4]) + 1.f;
+
+        derivatives[0 * info_.n_points_ + point_index]
+            = 1.f / (argx*argy);
+        derivatives[1 * info_.n_points_ + point_index] =
+            -2.f * parameters_[0] * (parameters_[1] - x)
+            / (parameters_[3] * parameters_[3] * argx*argx*argy);
+        derivatives[2 * info_.n_points_ + point_index] =
+            -2.f * parameters_[0] * (parameters_[2] - y)
+            / (parameters_[4] * parameters_[4] * argy*argy*argx);
+        derivatives[3 * info_.n_points_ + point_index] =
+            2.f * parameters_[0] * (parameters_[1] - x) * (parameters_[1] - x)
+            / (parameters_[3] * parameters_[3] * parameters_[3] * argx*argx*argy);
+        derivatives[4 * info_.n_points_ + point_index] =
+            2.f * parameters_[0] * (parameters_[2] - y) * (parameters_[2] - y)
+            / (parameters_[4] * parameters_[4] * parameters_[4] * argy*argy*argx);
+        derivatives[5 * info_.n_points_ + point_index]
+            = 1.f;
+    }
 }
 
 void LMFitCPP::calc_derivatives_linear1d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL * user_info_float = (REAL*)user_info_;
     REAL x = 0.;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         if (!user_info_float)
         {
             x = REAL(point_index);
@@ -319,8 +391,7 @@ void LMFitCPP::calc_derivatives_linear1d(
         }
         else if (info_.user_info_size_ / sizeof(REAL) > info_.n_points_)
         {
-            std::size_t const fit_begin = fit_index_ * info_.n_points_;
-            x = user_info_float[fit_begin + point_index];
+            x = user_info_float[first_point_ + point_index];
         }
 
         derivatives[0 * info_.n_points_ + point_index] = 1.;
@@ -329,7 +400,7 @@ void LMFitCPP::calc_derivatives_linear1d(
 }
 
 void LMFitCPP::calc_derivatives_fletcher_powell_helix(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives)
 {
     REAL const pi = 3.14159f;
 
@@ -354,12 +425,17 @@ void LMFitCPP::calc_derivatives_fletcher_powell_helix(
 }
 
 void LMFitCPP::calc_derivatives_brown_dennis(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * p = parameters_;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         REAL const t = static_cast<REAL>(point_index) / 5.f;
 
         REAL const arg1 = p[0] + p[1] * t - std::exp(t);
@@ -374,7 +450,9 @@ void LMFitCPP::calc_derivatives_brown_dennis(
 
 // derivatives are only computed for those points inside the spline area
 void LMFitCPP::calc_derivatives_spline1d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
@@ -385,8 +463,11 @@ void LMFitCPP::calc_derivatives_spline1d(
 
     REAL const * p = parameters_;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         REAL const x = static_cast<REAL>(point_index);
         REAL const position = x - p[1];
         int i = static_cast<int>(floor(position)); // can be negative
@@ -429,12 +510,13 @@ void LMFitCPP::calc_derivatives_spline1d(
 
 // derivatives are only computed for those points inside the spline area
 void LMFitCPP::calc_derivatives_spline2d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 0));
-    std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 1));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 2));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 3));
     std::size_t const n_coefficients_per_interval = 16;
@@ -443,94 +525,96 @@ void LMFitCPP::calc_derivatives_spline2d(
 
     REAL const * p = parameters_;
 
-    for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
-        {
-            std::size_t const point_index = point_index_y * n_points_x + point_index_x;
+        std::size_t const point_index_x = point_index % n_points_x;
+        std::size_t const point_index_y = point_index / n_points_x;
 
-            REAL const x = static_cast<REAL>(point_index_x);
-            REAL const y = static_cast<REAL>(point_index_y);
+        if (skip_point(point_index))
+            continue;
 
-            REAL const pos_x = x - p[1];
-            REAL const pos_y = y - p[2];
+        REAL const x = static_cast<REAL>(point_index_x);
+        REAL const y = static_cast<REAL>(point_index_y);
 
-            int i = static_cast<int>(floor(pos_x));
-            int j = static_cast<int>(floor(pos_y));
+        REAL const pos_x = x - p[1];
+        REAL const pos_y = y - p[2];
 
-            // adjust i and j to their bounds
-            i = i >= 0 ? i : 0;
-            i = i < n_intervals_x ? i : n_intervals_x - 1;
-            j = j >= 0 ? j : 0;
-            j = j < n_intervals_y ? j : n_intervals_y - 1;
+        int i = static_cast<int>(floor(pos_x));
+        int j = static_cast<int>(floor(pos_y));
 
-            // coefficients of the current point
-            REAL const * current_coefficients
-                = coefficients + (i * n_intervals_y + j) * n_coefficients_per_interval;
+        // adjust i and j to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
 
-            REAL const x_diff = pos_x - static_cast<REAL>(i);
-            REAL const y_diff = pos_y - static_cast<REAL>(j);
+        // coefficients of the current point
+        REAL const * current_coefficients
+            = coefficients + (i * n_intervals_y + j) * n_coefficients_per_interval;
+
+        REAL const x_diff = pos_x - static_cast<REAL>(i);
+        REAL const y_diff = pos_y - static_cast<REAL>(j);
 
-            REAL temp_value = 0;
-            REAL temp_derivative_1 = 0;
-            REAL temp_derivative_2 = 0;
+        REAL temp_value = 0;
+        REAL temp_derivative_1 = 0;
+        REAL temp_derivative_2 = 0;
 
-            REAL power_factor_i = 1;
-            // TODO replace 4 by constant like n_coefficients_per_interval1D or so (everywhere)
-            for (std::size_t order_i = 0; order_i < 4; order_i++)
+        REAL power_factor_i = 1;
+        // TODO replace 4 by constant like n_coefficients_per_interval1D or so (everywhere)
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
+        {
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                REAL power_factor_j = 1;
-                for (std::size_t order_j = 0; order_j < 4; order_j++)
+                // intermediate function value without amplitude and offset
+                temp_value
+                    += current_coefficients[order_i * 4 + order_j]
+                    * power_factor_i
+                    * power_factor_j;
+
+                // intermediate derivative value with respect to paramater 1 (center position)
+                if (order_i < 3)
                 {
-                    // intermediate function value without amplitude and offset
-                    temp_value
-                        += current_coefficients[order_i * 4 + order_j]
+                    temp_derivative_1
+                        += (REAL(order_i) + 1)
+                        * current_coefficients[(order_i + 1) * 4 + order_j]
                         * power_factor_i
                         * power_factor_j;
+                }
 
-                    // intermediate derivative value with respect to paramater 1 (center position)
-                    if (order_i < 3)
-                    {
-                        temp_derivative_1
-                            += (REAL(order_i) + 1)
-                            * current_coefficients[(order_i + 1) * 4 + order_j]
-                            * power_factor_i
-                            * power_factor_j;
-                    }
-
-                    if (order_j < 3)
-                    {
-                        temp_derivative_2
-                            += (REAL(order_j) + 1)
-                            * current_coefficients[order_i * 4 + (order_j + 1)]
-                            * power_factor_i
-                            * power_factor_j;
-                    }
-
-                    power_factor_j *= y_diff;
+                if (order_j < 3)
+                {
+                    temp_derivative_2
+                        += (REAL(order_j) + 1)
+                        * current_coefficients[order_i * 4 + (order_j + 1)]
+                        * power_factor_i
+                        * power_factor_j;
                 }
-                power_factor_i *= x_diff;
+
+                power_factor_j *= y_diff;
             }
+            power_factor_i *= x_diff;
+        }
 
-            // derivative
+        // derivative
 
-            derivatives[0 * info_.n_points_ + point_index] = temp_value;
-            derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
-            derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
-            derivatives[3 * info_.n_points_ + point_index] = 1;
-        }
+        derivatives[0 * info_.n_points_ + point_index] = temp_value;
+        derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
+        derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
+        derivatives[3 * info_.n_points_ + point_index] = 1;
     }
 }
 
 // derivatives are only computed for those points inside the spline area
 void LMFitCPP::calc_derivatives_spline3d(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 0));
     std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 1));
-    std::size_t const n_points_z = static_cast<std::size_t>(*(user_info_REAL + 2));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 3));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 4));
     int const n_intervals_z = static_cast<int>(*(user_info_REAL + 5));
@@ -539,116 +623,116 @@ void LMFitCPP::calc_derivatives_spline3d(
 
     REAL const * p = parameters_;
 
-    for (std::size_t point_index_z = 0; point_index_z < n_points_z; point_index_z++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+        std::size_t const point_index_x = point_index % n_points_x;
+        std::size_t const point_index_y = point_index / n_points_x % n_points_y;
+        std::size_t const point_index_z = point_index / (n_points_x * n_points_y);
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const position_x = point_index_x - p[1];
+        REAL const position_y = point_index_y - p[2];
+        REAL const position_z = point_index_z - p[3];
+        int i = static_cast<int>(floor(position_x));
+        int j = static_cast<int>(floor(position_y));
+        int k = static_cast<int>(floor(position_z));
+
+        // adjust i, j and k to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
+        k = k >= 0 ? k : 0;
+        k = k < n_intervals_z ? k : n_intervals_z - 1;
+
+        // coefficients of the current point
+        REAL const * current_coefficients
+            = coefficients
+            + (i * n_intervals_y * n_intervals_z + j * n_intervals_z + k)
+            * n_coefficients_per_interval;
+
+        REAL const x_diff = position_x - i;
+        REAL const y_diff = position_y - j;
+        REAL const z_diff = position_z - k;
+
+        REAL temp_value = 0;
+        REAL temp_derivative_1 = 0;
+        REAL temp_derivative_2 = 0;
+        REAL temp_derivative_3 = 0;
+
+        REAL power_factor_i = 1;
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
         {
-            for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                std::size_t const point_index = point_index_y * n_points_x + point_index_x;
-
-                REAL const position_x = point_index_x - p[1];
-                REAL const position_y = point_index_y - p[2];
-                REAL const position_z = point_index_z - p[3];
-                int i = static_cast<int>(floor(position_x));
-                int j = static_cast<int>(floor(position_y));
-                int k = static_cast<int>(floor(position_z));
-
-                // adjust i, j and k to their bounds
-                i = i >= 0 ? i : 0;
-                i = i < n_intervals_x ? i : n_intervals_x - 1;
-                j = j >= 0 ? j : 0;
-                j = j < n_intervals_y ? j : n_intervals_y - 1;
-                k = k >= 0 ? k : 0;
-                k = k < n_intervals_z ? k : n_intervals_z - 1;
-
-                // coefficients of the current point
-                REAL const * current_coefficients
-                    = coefficients
-                    + (i * n_intervals_y * n_intervals_z + j * n_intervals_z + k)
-                    * n_coefficients_per_interval;
-
-                REAL const x_diff = position_x - i;
-                REAL const y_diff = position_y - j;
-                REAL const z_diff = position_z - k;
-
-                REAL temp_value = 0;
-                REAL temp_derivative_1 = 0;
-                REAL temp_derivative_2 = 0;
-                REAL temp_derivative_3 = 0;
-
-                REAL power_factor_i = 1;
-                for (std::size_t order_i = 0; order_i < 4; order_i++)
+                REAL power_factor_k = 1;
+                for (std::size_t order_k = 0; order_k < 4; order_k++)
                 {
-                    REAL power_factor_j = 1;
-                    for (std::size_t order_j = 0; order_j < 4; order_j++)
-                    {
-                        REAL power_factor_k = 1;
-                        for (std::size_t order_k = 0; order_k < 4; order_k++)
-                        {
-                            // intermediate function value without amplitude and offset
-                            temp_value
-                                += current_coefficients[order_i * 16 + order_j * 4 + order_k]
-                                * power_factor_i
-                                * power_factor_j
-                                * power_factor_k;
-
-                            if (order_i < 3)
-                            {
-                                temp_derivative_1
-                                    += (REAL(order_i) + 1)
-                                    * current_coefficients[(order_i + 1) * 16 + order_j * 4 + order_k]
-                                    * power_factor_i
-                                    * power_factor_j
-                                    * power_factor_k;
-                            }
+                    // intermediate function value without amplitude and offset
+                    temp_value
+                        += current_coefficients[order_i * 16 + order_j * 4 + order_k]
+                        * power_factor_i
+                        * power_factor_j
+                        * power_factor_k;
 
-                            if (order_j < 3)
-                            {
-                                temp_derivative_2
-                                    += (REAL(order_j) + 1)
-                                    * current_coefficients[order_i * 16 + (order_j + 1) * 4 + order_k]
-                                    * power_factor_i
-                                    * power_factor_j
-                                    * power_factor_k;
-                            }
+                    if (order_i < 3)
+                    {
+                        temp_derivative_1
+                            += (REAL(order_i) + 1)
+                            * current_coefficients[(order_i + 1) * 16 + order_j * 4 + order_k]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
+                    }
 
-                            if (order_k < 3)
-                            {
-                                temp_derivative_3
-                                    += (REAL(order_k) + 1)
-                                    * current_coefficients[order_i * 16 + order_j * 4 + (order_k + 1)]
-                                    * power_factor_i
-                                    * power_factor_j
-                                    * power_factor_k;
-                            }
+                    if (order_j < 3)
+                    {
+                        temp_derivative_2
+                            += (REAL(order_j) + 1)
+                            * current_coefficients[order_i * 16 + (order_j + 1) * 4 + order_k]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
+                    }
 
-                            power_factor_k *= z_diff;
-                        }
-                        power_factor_j *= y_diff;
+                    if (order_k < 3)
+                    {
+                        temp_derivative_3
+                            += (REAL(order_k) + 1)
+                            * current_coefficients[order_i * 16 + order_j * 4 + (order_k + 1)]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
                     }
-                    power_factor_i *= x_diff;
-                }
 
-                derivatives[0 * info_.n_points_ + point_index] = temp_value;
-                derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
-                derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
-                derivatives[3 * info_.n_points_ + point_index] = -p[0] * temp_derivative_3;
-                derivatives[4 * info_.n_points_ + point_index] = 1;
+                    power_factor_k *= z_diff;
+                }
+                power_factor_j *= y_diff;
             }
+            power_factor_i *= x_diff;
         }
+
+        derivatives[0 * info_.n_points_ + point_index] = temp_value;
+        derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
+        derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
+        derivatives[3 * info_.n_points_ + point_index] = -p[0] * temp_derivative_3;
+        derivatives[4 * info_.n_points_ + point_index] = 1;
     }
 }
 
 void LMFitCPP::calc_derivatives_spline3d_multichannel(
-    std::vector<REAL> & derivatives)
+    Buffer<REAL> & derivatives,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_channels = static_cast<std::size_t>(*(user_info_REAL + 0));
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 1));
     std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 2));
-    std::size_t const n_points_z = static_cast<std::size_t>(*(user_info_REAL + 3));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 4));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 5));
     int const n_intervals_z = static_cast<int>(*(user_info_REAL + 6));
@@ -660,178 +744,188 @@ void LMFitCPP::calc_derivatives_spline3d_multichannel(
 
     REAL const * p = parameters_;
 
-    for (std::size_t channel = 0; channel < n_channels; channel++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_z = 0; point_index_z < n_points_z; point_index_z++)
+        std::size_t const channel = point_index / n_points_per_channel;
+        std::size_t const point_index_x = point_index % n_points_per_channel % n_points_x;
+        std::size_t const point_index_y = point_index % n_points_per_channel / n_points_x % n_points_y;
+        std::size_t const point_index_z = point_index % n_points_per_channel / (n_points_x * n_points_y);
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const position_x = point_index_x - p[1];
+        REAL const position_y = point_index_y - p[2];
+        REAL const position_z = point_index_z - p[3];
+        int i = static_cast<int>(floor(position_x));
+        int j = static_cast<int>(floor(position_y));
+        int k = static_cast<int>(floor(position_z));
+
+        // adjust i, j and k to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
+        k = k >= 0 ? k : 0;
+        k = k < n_intervals_z ? k : n_intervals_z - 1;
+
+        // coefficients of the current interval
+        std::size_t const interval_index
+            = channel * n_intervals
+            + i       * n_intervals_y * n_intervals_z
+            + j       * n_intervals_z
+            + k;
+
+        REAL const * current_coefficients
+            = coefficients + interval_index * n_coefficients_per_interval;
+
+        REAL const x_diff = position_x - i;
+        REAL const y_diff = position_y - j;
+        REAL const z_diff = position_z - k;
+
+        REAL temp_value = 0;
+        REAL temp_derivative_1 = 0;
+        REAL temp_derivative_2 = 0;
+        REAL temp_derivative_3 = 0;
+
+        REAL power_factor_i = 1;
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
         {
-            for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
+                REAL power_factor_k = 1;
+                for (std::size_t order_k = 0; order_k < 4; order_k++)
                 {
-                    std::size_t const point_index
-                        = channel * n_points_per_channel
-                        + point_index_z * n_points_x * n_points_y
-                        + point_index_y * n_points_x
-                        + point_index_x;
-
-                    REAL const position_x = point_index_x - p[1];
-                    REAL const position_y = point_index_y - p[2];
-                    REAL const position_z = point_index_z - p[3];
-                    int i = static_cast<int>(floor(position_x));
-                    int j = static_cast<int>(floor(position_y));
-                    int k = static_cast<int>(floor(position_z));
-
-                    // adjust i, j and k to their bounds
-                    i = i >= 0 ? i : 0;
-                    i = i < n_intervals_x ? i : n_intervals_x - 1;
-                    j = j >= 0 ? j : 0;
-                    j = j < n_intervals_y ? j : n_intervals_y - 1;
-                    k = k >= 0 ? k : 0;
-                    k = k < n_intervals_z ? k : n_intervals_z - 1;
-
-                    // coefficients of the current interval
-                    std::size_t const interval_index
-                        = channel * n_intervals
-                        + i       * n_intervals_y * n_intervals_z
-                        + j       * n_intervals_z
-                        + k;
-
-                    REAL const * current_coefficients
-                        = coefficients + interval_index * n_coefficients_per_interval;
-
-                    REAL const x_diff = position_x - i;
-                    REAL const y_diff = position_y - j;
-                    REAL const z_diff = position_z - k;
-
-                    REAL temp_value = 0;
-                    REAL temp_derivative_1 = 0;
-                    REAL temp_derivative_2 = 0;
-                    REAL temp_derivative_3 = 0;
-
-                    REAL power_factor_i = 1;
-                    for (std::size_t order_i = 0; order_i < 4; order_i++)
+                    // intermediate function value without amplitude and offset
+                    temp_value
+                        += current_coefficients[order_i * 16 + order_j * 4 + order_k]
+                        * power_factor_i
+                        * power_factor_j
+                        * power_factor_k;
+
+                    if (order_i < 3)
                     {
-                        REAL power_factor_j = 1;
-                        for (std::size_t order_j = 0; order_j < 4; order_j++)
-                        {
-                            REAL power_factor_k = 1;
-                            for (std::size_t order_k = 0; order_k < 4; order_k++)
-                            {
-                                // intermediate function value without amplitude and offset
-                                temp_value
-                                    += current_coefficients[order_i * 16 + order_j * 4 + order_k]
-                                    * power_factor_i
-                                    * power_factor_j
-                                    * power_factor_k;
-
-                                if (order_i < 3)
-                                {
-                                    temp_derivative_1
-                                        += (REAL(order_i) + 1)
-                                        * current_coefficients[(order_i + 1) * 16 + order_j * 4 + order_k]
-                                        * power_factor_i
-                                        * power_factor_j
-                                        * power_factor_k;
-                                }
-
-                                if (order_j < 3)
-                                {
-                                    temp_derivative_2
-                                        += (REAL(order_j) + 1)
-                                        * current_coefficients[order_i * 16 + (order_j + 1) * 4 + order_k]
-                                        * power_factor_i
-                                        * power_factor_j
-                                        * power_factor_k;
-                                }
-
-                                if (order_k < 3)
-                                {
-                                    temp_derivative_3
-                                        += (REAL(order_k) + 1)
-                                        * current_coefficients[order_i * 16 + order_j * 4 + (order_k + 1)]
-                                        * power_factor_i
-                                        * power_factor_j
-                                        * power_factor_k;
-                                }
-                                power_factor_k *= z_diff;
-                            }
-                            power_factor_j *= y_diff;
-                        }
-                        power_factor_i *= x_diff;
+                        temp_derivative_1
+                            += (REAL(order_i) + 1)
+                            * current_coefficients[(order_i + 1) * 16 + order_j * 4 + order_k]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
                     }
 
-                    derivatives[0 * info_.n_points_ + point_index] = temp_value;
-                    derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
-                    derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
-                    derivatives[3 * info_.n_points_ + point_index] = -p[0] * temp_derivative_3;
-                    derivatives[4 * info_.n_points_ + point_index] = 1;
+                    if (order_j < 3)
+                    {
+                        temp_derivative_2
+                            += (REAL(order_j) + 1)
+                            * current_coefficients[order_i * 16 + (order_j + 1) * 4 + order_k]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
+                    }
+
+                    if (order_k < 3)
+                    {
+                        temp_derivative_3
+                            += (REAL(order_k) + 1)
+                            * current_coefficients[order_i * 16 + order_j * 4 + (order_k + 1)]
+                            * power_factor_i
+                            * power_factor_j
+                            * power_factor_k;
+                    }
+                    power_factor_k *= z_diff;
                 }
+                power_factor_j *= y_diff;
             }
+            power_factor_i *= x_diff;
         }
+
+        derivatives[0 * info_.n_points_ + point_index] = temp_value;
+        derivatives[1 * info_.n_points_ + point_index] = -p[0] * temp_derivative_1;
+        derivatives[2 * info_.n_points_ + point_index] = -p[0] * temp_derivative_2;
+        derivatives[3 * info_.n_points_ + point_index] = -p[0] * temp_derivative_3;
+        derivatives[4 * info_.n_points_ + point_index] = 1;
     }
 }
 
-void LMFitCPP::calc_values_cauchy2delliptic(std::vector<REAL>& cauchy)
+void LMFitCPP::calc_values_cauchy2delliptic(
+    Buffer<REAL>& cauchy,
+    std::size_t const begin,
+    std::size_t const end)
 {
     int const size_x = int(std::sqrt(REAL(info_.n_points_)));
-    int const size_y = size_x;
 
-    for (int iy = 0; iy < size_y; iy++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            REAL const argx =
-                ((parameters_[1] - ix) / parameters_[3])
-                *((parameters_[1] - ix) / parameters_[3]) + 1.f;
-            REAL const argy =
-                ((parameters_[2] - iy) / parameters_[4])
-                *((parameters_[2] - iy) / parameters_[4]) + 1.f;
-
-            cauchy[iy*size_x + ix] = parameters_[0] / (argx * argy) + parameters_[5];
-        }
+        int const ix = int(point_index % size_x);
+        int const iy = int(point_index / size_x);
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const argx =
+            ((parameters_[1] - ix) / parameters_[3])
+            *((parameters_[1] - ix) / parameters_[3]) + 1.f;
+        REAL const argy =
+            ((parameters_[2] - iy) / parameters_[4])
+            *((parameters_[2] - iy) / parameters_[4]) + 1.f;
+
+        cauchy[point_index] = parameters_[0] / (argx * argy) + parameters_[5];
     }
 }
 
-void LMFitCPP::calc_values_gauss2d(std::vector<REAL>& gaussian)
+void LMFitCPP::calc_values_gauss2d(
+    Buffer<REAL>& gaussian,
+    std::size_t const begin,
+    std::size_t const end)
 {
     int const size_x = int(std::sqrt(REAL(info_.n_points_)));
-    int const size_y = size_x;
 
-    for (int iy = 0; iy < size_y; iy++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            REAL argx = (ix - parameters_[1]) * (ix - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
-            REAL argy = (iy - parameters_[2]) * (iy - parameters_[2]) / (2 * parameters_[3] * parameters_[3]);
-            REAL ex = exp(-(argx +argy));
+        int const ix = int(point_index % size_x);
+        int const iy = int(point_index / size_x);
 
-            gaussian[iy*size_x + ix] = parameters_[0] * ex + parameters_[4];
-        }
+        if (skip_point(point_index))
+            continue;
+
+        REAL argx = (ix - parameters_[1]) * (ix - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
+        REAL argy = (iy - parameters_[2]) * (iy - parameters_[2]) / (2 * parameters_[3] * parameters_[3]);
+        REAL ex = exp(-(argx +argy));
+
+        gaussian[point_index] = parameters_[0] * ex + parameters_[4];
     }
 }
 
-void LMFitCPP::calc_values_gauss2delliptic(std::vector<REAL>& gaussian)
+void LMFitCPP::calc_values_gauss2delliptic(
+    Buffer<REAL>& gaussian,
+    std::size_t const begin,
+    std::size_t const end)
 {
     int const size_x = int(std::sqrt(REAL(info_.n_points_)));
-    int const size_y = size_x;
-    for (int iy = 0; iy < size_y; iy++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            REAL argx = (ix - parameters_[1]) * (ix - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
-            REAL argy = (iy - parameters_[2]) * (iy - parameters_[2]) / (2 * parameters_[4] * parameters_[4]);
-            REAL ex = exp(-(argx + argy));
+        int const ix = int(point_index % size_x);
+        int const iy = int(point_index / size_x);
 
-            gaussian[iy*size_x + ix]
-                = parameters_[0] * ex + parameters_[5];
-        }
+        if (skip_point(point_index))
+            continue;
+
+        REAL argx = (ix - parameters_[1]) * (ix - parameters_[1]) / (2 * parameters_[3] * parameters_[3]);
+        REAL argy = (iy - parameters_[2]) * (iy - parameters_[2]) / (2 * parameters_[4] * parameters_[4]);
+        REAL ex = exp(-(argx + argy));
+
+        gaussian[point_index]
+            = parameters_[0] * ex + parameters_[5];
     }
 }
     
-void LMFitCPP::calc_values_gauss2drotated(std::vector<REAL>& gaussian)
+void LMFitCPP::calc_values_gauss2drotated(
+    Buffer<REAL>& gaussian,
+    std::size_t const begin,
+    std::size_t const end)
 {
     int const size_x = int(std::sqrt(REAL(info_.n_points_)));
-    int const size_y = size_x;
 
     REAL amplitude = parameters_[0];
     REAL background = parameters_[5];
@@ -842,29 +936,36 @@ void LMFitCPP::calc_values_gauss2drotated(std::vector<REAL>& gaussian)
     REAL rot_sin = sin(parameters_[6]);
     REAL rot_cos = cos(parameters_[6]);
 
-    for (int iy = 0; iy < size_y; iy++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            int const pixel_index = iy*size_x + ix;
+        int const ix = int(point_index % size_x);
+        int const iy = int(point_index / size_x);
 
-            REAL arga = ((ix - x0) * rot_cos) - ((iy - y0) * rot_sin);
-            REAL argb = ((ix - x0) * rot_sin) + ((iy - y0) * rot_cos);
+        if (skip_point(point_index))
+            continue;
 
-            REAL ex
-                = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
+        REAL arga = ((ix - x0) * rot_cos) - ((iy - y0) * rot_sin);
+        REAL argb = ((ix - x0) * rot_sin) + ((iy - y0) * rot_cos);
 
-            gaussian[pixel_index] = amplitude * ex + background;
-        }
+        REAL ex
+            = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
+
+        gaussian[point_index] = amplitude * ex + background;
     }
 }
 
-void LMFitCPP::calc_values_gauss1d(std::vector<REAL>& gaussian)
+void LMFitCPP::calc_values_gauss1d(
+    Buffer<REAL>& gaussian,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL * user_info_float = (REAL*)user_info_;
     REAL x = 0.f;
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         if (!user_info_float)
         {
             x = REAL(point_index);
@@ -875,8 +976,7 @@ void LMFitCPP::calc_values_gauss1d(std::vector<REAL>& gaussian)
         }
         else if (info_.user_info_size_ / sizeof(REAL) > info_.n_points_)
         {
-            std::size_t const fit_begin = fit_index_ * info_.n_points_;
-            x = user_info_float[fit_begin + point_index];
+            x = user_info_float[first_point_ + point_index];
         }
 
         REAL argx
@@ -887,12 +987,18 @@ void LMFitCPP::calc_values_gauss1d(std::vector<REAL>& gaussian)
     }
 }
 
-void LMFitCPP::calc_values_linear1d(std::vector<REAL>& line)
+void LMFitCPP::calc_values_linear1d(
+    Buffer<REAL>& line,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL * user_info_float = (REAL*)user_info_;
     REAL x = 0.f;
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         if (!user_info_float)
         {
             x = REAL(point_index);
@@ -903,14 +1009,13 @@ void LMFitCPP::calc_values_linear1d(std::vector<REAL>& line)
         }
         else if (info_.user_info_size_ / sizeof(REAL) > info_.n_points_)
         {
-            std::size_t const fit_begin = fit_index_ * info_.n_points_;
-            x = user_info_float[fit_begin + point_index];
+            x = user_info_float[first_point_ + point_index];
         }
         line[point_index] = parameters_[0] + parameters_[1] * x;
     }
 }
 
-void LMFitCPP::calc_values_fletcher_powell_helix(std::vector<REAL>& values)
+void LMFitCPP::calc_values_fletcher_powell_helix(Buffer<REAL>& values)
 {
     REAL const * p = parameters_;
 
@@ -934,12 +1039,18 @@ void LMFitCPP::calc_values_fletcher_powell_helix(std::vector<REAL>& values)
     values[2] = p[2];
 }
 
-void LMFitCPP::calc_values_brown_dennis(std::vector<REAL>& values)
+void LMFitCPP::calc_values_brown_dennis(
+    Buffer<REAL>& values,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * p = parameters_;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         REAL const t = static_cast<REAL>(point_index) / 5.f;
 
         REAL const arg1 = p[0] + p[1] * t - std::exp(t);
@@ -949,7 +1060,10 @@ void LMFitCPP::calc_values_brown_dennis(std::vector<REAL>& values)
     }
 }
 
-void LMFitCPP::calc_values_spline1d(std::vector<REAL>& values)
+void LMFitCPP::calc_values_spline1d(
+    Buffer<REAL>& values,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
@@ -960,8 +1074,11 @@ void LMFitCPP::calc_values_spline1d(std::vector<REAL>& values)
     REAL const * coefficients = user_info_REAL + 1;
     REAL const * p = parameters_;
 
-    for (std::size_t point_index = 0; point_index < info_.n_points_; point_index++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
+        if (skip_point(point_index))
+            continue;
+
         REAL const x = static_cast<REAL>(point_index);
         REAL const position = x - p[1];
         int i = static_cast<int>(floor(position)); // can be negative
@@ -991,12 +1108,14 @@ void LMFitCPP::calc_values_spline1d(std::vector<REAL>& values)
     }
 }
 
-void LMFitCPP::calc_values_spline2d(std::vector<REAL>& values)
+void LMFitCPP::calc_values_spline2d(
+    Buffer<REAL>& values,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 0));
-    std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 1));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 2));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 3));
 
@@ -1006,66 +1125,69 @@ void LMFitCPP::calc_values_spline2d(std::vector<REAL>& values)
 
     REAL const * p = parameters_;
 
-    for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
-        {
-            std::size_t const point_index = point_index_y * n_points_x + point_index_x;
+        std::size_t const point_index_x = point_index % n_points_x;
+        std::size_t const point_index_y = point_index / n_points_x;
 
-            REAL const x = static_cast<REAL>(point_index_x);
-            REAL const y = static_cast<REAL>(point_index_y);
+        if (skip_point(point_index))
+            continue;
 
-            REAL const pos_x = x - p[1];
-            REAL const pos_y = y - p[2];
+        REAL const x = static_cast<REAL>(point_index_x);
+        REAL const y = static_cast<REAL>(point_index_y);
 
-            int i = static_cast<int>(floor(pos_x));
-            int j = static_cast<int>(floor(pos_y));
+        REAL const pos_x = x - p[1];
+        REAL const pos_y = y - p[2];
 
-            // adjust i and j to their bounds
-            i = i >= 0 ? i : 0;
-            i = i < n_intervals_x ? i : n_intervals_x - 1;
-            j = j >= 0 ? j : 0;
-            j = j < n_intervals_y ? j : n_intervals_y - 1;
+        int i = static_cast<int>(floor(pos_x));
+        int j = static_cast<int>(floor(pos_y));
 
-            // coefficients of the current point
-            REAL const * current_coefficients
-                = coefficients
-                + (i * n_intervals_y + j) * n_coefficients_per_interval;
+        // adjust i and j to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
+
+        // coefficients of the current point
+        REAL const * current_coefficients
+            = coefficients
+            + (i * n_intervals_y + j) * n_coefficients_per_interval;
 
-            REAL const x_diff = pos_x - static_cast<REAL>(i);
-            REAL const y_diff = pos_y - static_cast<REAL>(j);
+        REAL const x_diff = pos_x - static_cast<REAL>(i);
+        REAL const y_diff = pos_y - static_cast<REAL>(j);
 
-            REAL temp_value = 0;
+        REAL temp_value = 0;
 
-            REAL power_factor_i = 1;
-            for (std::size_t order_i = 0; order_i < 4; order_i++)
+        REAL power_factor_i = 1;
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
+        {
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                REAL power_factor_j = 1;
-                for (std::size_t order_j = 0; order_j < 4; order_j++)
-                {
-                    // intermediate function value without amplitude and offset
-                    temp_value
-                        += current_coefficients[order_i * 4 + order_j]
-                        * power_factor_i
-                        * power_factor_j;
+                // intermediate function value without amplitude and offset
+                temp_value
+                    += current_coefficients[order_i * 4 + order_j]
+                    * power_factor_i
+                    * power_factor_j;
 
-                    power_factor_j *= y_diff;
-                }
-                power_factor_i *= x_diff;
+                power_factor_j *= y_diff;
             }
-            // scale and add offset
-            values[point_index] = p[0] * temp_value + p[3];
+            power_factor_i *= x_diff;
         }
+        // scale and add offset
+        values[point_index] = p[0] * temp_value + p[3];
     }
 }
 
-void LMFitCPP::calc_values_spline3d(std::vector<REAL>& values)
+void LMFitCPP::calc_values_spline3d(
+    Buffer<REAL>& values,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 0));
     std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 1));
-    std::size_t const n_points_z = static_cast<std::size_t>(*(user_info_REAL + 2));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 3));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 4));
     int const n_intervals_z = static_cast<int>(*(user_info_REAL + 5));
@@ -1074,82 +1196,80 @@ void LMFitCPP::calc_values_spline3d(std::vector<REAL>& values)
 
     REAL const * p = parameters_;
 
-    for (std::size_t point_index_z = 0; point_index_z < n_points_z; point_index_z++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+        std::size_t const point_index_x = point_index % n_points_x;
+        std::size_t const point_index_y = point_index / n_points_x % n_points_y;
+        std::size_t const point_index_z = point_index / (n_points_x * n_points_y);
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const position_x = point_index_x - p[1];
+        REAL const position_y = point_index_y - p[2];
+        REAL const position_z = point_index_z - p[3];
+        int i = static_cast<int>(floor(position_x));
+        int j = static_cast<int>(floor(position_y));
+        int k = static_cast<int>(floor(position_z));
+
+        // adjust i, j and k to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
+        k = k >= 0 ? k : 0;
+        k = k < n_intervals_z ? k : n_intervals_z - 1;
+
+        // coefficients of the current point
+        REAL const * current_coefficients
+            = coefficients
+            + (i * n_intervals_y * n_intervals_z + j * n_intervals_z + k)
+            * n_coefficients_per_interval;
+
+        REAL const x_diff = position_x - i;
+        REAL const y_diff = position_y - j;
+        REAL const z_diff = position_z - k;
+
+        REAL temp_value = 0;
+
+        REAL power_factor_i = 1;
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
         {
-            for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                std::size_t const point_index
-                    = point_index_z * n_points_x * n_points_y 
-                    + point_index_y * n_points_x
-                    + point_index_x;
-
-                REAL const position_x = point_index_x - p[1];
-                REAL const position_y = point_index_y - p[2];
-                REAL const position_z = point_index_z - p[3];
-                int i = static_cast<int>(floor(position_x));
-                int j = static_cast<int>(floor(position_y));
-                int k = static_cast<int>(floor(position_z));
-
-                // adjust i, j and k to their bounds
-                i = i >= 0 ? i : 0;
-                i = i < n_intervals_x ? i : n_intervals_x - 1;
-                j = j >= 0 ? j : 0;
-                j = j < n_intervals_y ? j : n_intervals_y - 1;
-                k = k >= 0 ? k : 0;
-                k = k < n_intervals_z ? k : n_intervals_z - 1;
-
-                // coefficients of the current point
-                REAL const * current_coefficients
-                    = coefficients
-                    + (i * n_intervals_y * n_intervals_z + j * n_intervals_z + k)
-                    * n_coefficients_per_interval;
-
-                REAL const x_diff = position_x - i;
-                REAL const y_diff = position_y - j;
-                REAL const z_diff = position_z - k;
-
-                REAL temp_value = 0;
-
-                REAL power_factor_i = 1;
-                for (std::size_t order_i = 0; order_i < 4; order_i++)
+                REAL power_factor_k = 1;
+                for (std::size_t order_k = 0; order_k < 4; order_k++)
                 {
-                    REAL power_factor_j = 1;
-                    for (std::size_t order_j = 0; order_j < 4; order_j++)
-                    {
-                        REAL power_factor_k = 1;
-                        for (std::size_t order_k = 0; order_k < 4; order_k++)
-                        {
-                            // intermediate function value without amplitude and offset
-                            temp_value
-                                += current_coefficients[order_i * 16 + order_j * 4 + order_k]
-                                * power_factor_i
-                                * power_factor_j
-                                * power_factor_k;
-
-                            power_factor_k *= z_diff;
-                        }
-                        power_factor_j *= y_diff;
-                    }
-                    power_factor_i *= x_diff;
-                }
+                    // intermediate function value without amplitude and offset
+                    temp_value
+                        += current_coefficients[order_i * 16 + order_j * 4 + order_k]
+                        * power_factor_i
+                        * power_factor_j
+                        * power_factor_k;
 
-                // scale and add offset
-                values[point_index] = p[0] * temp_value + p[4];
+                    power_factor_k *= z_diff;
+                }
+                power_factor_j *= y_diff;
             }
+            power_factor_i *= x_diff;
         }
+
+        // scale and add offset
+        values[point_index] = p[0] * temp_value + p[4];
     }
 }
 
-void LMFitCPP::calc_values_spline3d_multichannel(std::vector<REAL>& values)
+void LMFitCPP::calc_values_spline3d_multichannel(
+    Buffer<REAL>& values,
+    std::size_t const begin,
+    std::size_t const end)
 {
     REAL const * user_info_REAL = (REAL *)user_info_;
 
     std::size_t const n_channels = static_cast<std::size_t>(*(user_info_REAL + 0));
     std::size_t const n_points_x = static_cast<std::size_t>(*(user_info_REAL + 1));
     std::size_t const n_points_y = static_cast<std::size_t>(*(user_info_REAL + 2));
-    std::size_t const n_points_z = static_cast<std::size_t>(*(user_info_REAL + 3));
     int const n_intervals_x = static_cast<int>(*(user_info_REAL + 4));
     int const n_intervals_y = static_cast<int>(*(user_info_REAL + 5));
     int const n_intervals_z = static_cast<int>(*(user_info_REAL + 6));
@@ -1161,149 +1281,238 @@ void LMFitCPP::calc_values_spline3d_multichannel(std::vector<REAL>& values)
 
     REAL const * p = parameters_;
 
-    for (std::size_t channel = 0; channel < n_channels; channel++)
+    for (std::size_t point_index = begin; point_index < end; point_index++)
     {
-        for (std::size_t point_index_z = 0; point_index_z < n_points_z; point_index_z++)
+        std::size_t const channel = point_index / n_points_per_channel;
+        std::size_t const point_index_x = point_index % n_points_per_channel % n_points_x;
+        std::size_t const point_index_y = point_index % n_points_per_channel / n_points_x % n_points_y;
+        std::size_t const point_index_z = point_index % n_points_per_channel / (n_points_x * n_points_y);
+
+        if (skip_point(point_index))
+            continue;
+
+        REAL const position_x = point_index_x - p[1];
+        REAL const position_y = point_index_y - p[2];
+        REAL const position_z = point_index_z - p[3];
+        int i = static_cast<int>(floor(position_x));
+        int j = static_cast<int>(floor(position_y));
+        int k = static_cast<int>(floor(position_z));
+
+        // adjust i, j and k to their bounds
+        i = i >= 0 ? i : 0;
+        i = i < n_intervals_x ? i : n_intervals_x - 1;
+        j = j >= 0 ? j : 0;
+        j = j < n_intervals_y ? j : n_intervals_y - 1;
+        k = k >= 0 ? k : 0;
+        k = k < n_intervals_z ? k : n_intervals_z - 1;
+
+        std::size_t const interval_index
+            = channel * n_intervals
+            + i       * n_intervals_y * n_intervals_z
+            + j       * n_intervals_z
+            + k;
+
+        REAL const x_diff = position_x - i;
+        REAL const y_diff = position_y - j;
+        REAL const z_diff = position_z - k;
+
+        // coefficients of the current point
+        REAL const * current_coefficients
+            = coefficients + interval_index * n_coefficients_per_point;
+
+        REAL temp_value = 0;
+
+        REAL power_factor_i = 1;
+        for (std::size_t order_i = 0; order_i < 4; order_i++)
         {
-            for (std::size_t point_index_y = 0; point_index_y < n_points_y; point_index_y++)
+            REAL power_factor_j = 1;
+            for (std::size_t order_j = 0; order_j < 4; order_j++)
             {
-                for (std::size_t point_index_x = 0; point_index_x < n_points_x; point_index_x++)
+                REAL power_factor_k = 1;
+                for (std::size_t order_k = 0; order_k < 4; order_k++)
                 {
-                    std::size_t const point_index
-                        = channel * n_points_per_channel
-                        + point_index_z * n_points_x * n_points_y
-                        + point_index_y * n_points_x
-                        + point_index_x;
-
-                    REAL const position_x = point_index_x - p[1];
-                    REAL const position_y = point_index_y - p[2];
-                    REAL const position_z = point_index_z - p[3];
-                    int i = static_cast<int>(floor(position_x));
-                    int j = static_cast<int>(floor(position_y));
-                    int k = static_cast<int>(floor(position_z));
-
-                    // adjust i, j and k to their bounds
-                    i = i >= 0 ? i : 0;
-                    i = i < n_intervals_x ? i : n_intervals_x - 1;
-                    j = j >= 0 ? j : 0;
-                    j = j < n_intervals_y ? j : n_intervals_y - 1;
-                    k = k >= 0 ? k : 0;
-                    k = k < n_intervals_z ? k : n_intervals_z - 1;
-
-                    std::size_t const interval_index
-                        = channel * n_intervals
-                        + i       * n_intervals_y * n_intervals_z
-                        + j       * n_intervals_z
-                        + k;
-
-                    REAL const x_diff = position_x - i;
-                    REAL const y_diff = position_y - j;
-                    REAL const z_diff = position_z - k;
-
-                    // coefficients of the current point
-                    REAL const * current_coefficients
-                        = coefficients + interval_index * n_coefficients_per_point;
-
-                    REAL temp_value = 0;
-
-                    REAL power_factor_i = 1;
-                    for (std::size_t order_i = 0; order_i < 4; order_i++)
-                    {
-                        REAL power_factor_j = 1;
-                        for (std::size_t order_j = 0; order_j < 4; order_j++)
-                        {
-                            REAL power_factor_k = 1;
-                            for (std::size_t order_k = 0; order_k < 4; order_k++)
-                            {
-                                // intermediate function value without amplitude and offset
-                                temp_value
-                                    += current_coefficients[order_i * 16 + order_j * 4 + order_k]
-                                    * power_factor_i
-                                    * power_factor_j
-                                    * power_factor_k;
-
-                                power_factor_k *= z_diff;
-                            }
-                            power_factor_j *= y_diff;
-                        }
-                        power_factor_i *= x_diff;
-                    }
-                    // scale and add offset
-                    values[point_index] = p[0] * temp_value + p[4];
+                    // intermediate function value without amplitude and offset
+                    temp_value
+                        += current_coefficients[order_i * 16 + order_j * 4 + order_k]
+                        * power_factor_i
+                        * power_factor_j
+                        * power_factor_k;
+
+                    power_factor_k *= z_diff;
                 }
+                power_factor_j *= y_diff;
             }
+            power_factor_i *= x_diff;
         }
+        // scale and add offset
+        values[point_index] = p[0] * temp_value + p[4];
     }
 }
 
-// depending on the model Id, calls functions to calculate model function values and derivatives
-void LMFitCPP::calc_curve_values(std::vector<REAL>& curve, std::vector<REAL>& derivatives)
-{           
+// depending on the model Id, calls functions to calculate model function values
+// and derivatives of the points in [begin, end); the three points of the
+// Fletcher-Powell helix are never split and always calculated together
+void LMFitCPP::calc_values(
+    Buffer<REAL>& curve,
+    std::size_t const begin,
+    std::size_t const end)
+{
     if (info_.model_id_ == GAUSS_1D)
-    {
-        calc_values_gauss1d(curve);
-        calc_derivatives_gauss1d(derivatives);
-    }
+        calc_values_gauss1d(curve, begin, end);
     else if (info_.model_id_ == GAUSS_2D)
-    {
-        calc_values_gauss2d(curve);
-        calc_derivatives_gauss2d(derivatives);
-    }
+        calc_values_gauss2d(curve, begin, end);
     else if (info_.model_id_ == GAUSS_2D_ELLIPTIC)
-    {
-        calc_values_gauss2delliptic(curve);
-        calc_derivatives_gauss2delliptic(derivatives);
-    }
+        calc_values_gauss2delliptic(curve, begin, end);
     else if (info_.model_id_ == GAUSS_2D_ROTATED)
-    {
-        calc_values_gauss2drotated(curve);
-        calc_derivatives_gauss2drotated(derivatives);
-    }
+        calc_values_gauss2drotated(curve, begin, end);
     else if (info_.model_id_ == CAUCHY_2D_ELLIPTIC)
-    {
-        calc_values_cauchy2delliptic(curve);
-        calc_derivatives_cauchy2delliptic(derivatives);
-    }
+        calc_values_cauchy2delliptic(curve, begin, end);
     else if (info_.model_id_ == LINEAR_1D)
-    {
-        calc_values_linear1d(curve);
-        calc_derivatives_linear1d(derivatives);
-    }
+        calc_values_linear1d(curve, begin, end);
     else if (info_.model_id_ == FLETCHER_POWELL_HELIX)
-    {
         calc_values_fletcher_powell_helix(curve);
+    else if (info_.model_id_ == BROWN_DENNIS)
+        calc_values_brown_dennis(curve, begin, end);
+    else if (info_.model_id_ == SPLINE_1D)
+        calc_values_spline1d(curve, begin, end);
+    else if (info_.model_id_ == SPLINE_2D)
+        calc_values_spline2d(curve, begin, end);
+    else if (info_.model_id_ == SPLINE_3D)
+        calc_values_spline3d(curve, begin, end);
+    else if (info_.model_id_ == SPLINE_3D_MULTICHANNEL)
+        calc_values_spline3d_multichannel(curve, begin, end);
+}
+
+void LMFitCPP::calc_derivatives(
+    Buffer<REAL>& derivatives,
+    std::size_t const begin,
+    std::size_t const end)
+{
+    if (info_.model_id_ == GAUSS_1D)
+        calc_derivatives_gauss1d(derivatives, begin, end);
+    else if (info_.model_id_ == GAUSS_2D)
+        calc_derivatives_gauss2d(derivatives, begin, end);
+    else if (info_.model_id_ == GAUSS_2D_ELLIPTIC)
+        calc_derivatives_gauss2delliptic(derivatives, begin, end);
+    else if (info_.model_id_ == GAUSS_2D_ROTATED)
+        calc_derivatives_gauss2drotated(derivatives, begin, end);
+    else if (info_.model_id_ == CAUCHY_2D_ELLIPTIC)
+        calc_derivatives_cauchy2delliptic(derivatives, begin, end);
+    else if (info_.model_id_ == LINEAR_1D)
+        calc_derivatives_linear1d(derivatives, begin, end);
+    else if (info_.model_id_ == FLETCHER_POWELL_HELIX)
         calc_derivatives_fletcher_powell_helix(derivatives);
-    }
     else if (info_.model_id_ == BROWN_DENNIS)
+        calc_derivatives_brown_dennis(derivatives, begin, end);
+    else if (info_.model_id_ == SPLINE_1D)
+        calc_derivatives_spline1d(derivatives, begin, end);
+    else if (info_.model_id_ == SPLINE_2D)
+        calc_derivatives_spline2d(derivatives, begin, end);
+    else if (info_.model_id_ == SPLINE_3D)
+        calc_derivatives_spline3d(derivatives, begin, end);
+    else if (info_.model_id_ == SPLINE_3D_MULTICHANNEL)
+        calc_derivatives_spline3d_multichannel(derivatives, begin, end);
+}
+
+void LMFitCPP::calc_curve_values(Buffer<REAL>& curve, Buffer<REAL>& derivatives)
+{
+    // for a fit split into chunks, each task calculates values and derivatives
+    // of one range of points, as in sum_chunks
+    std::size_t const n_point_chunks = (info_.n_points_ + n_points_per_chunk - 1) / n_points_per_chunk;
+
+    auto const process_chunk = [&](std::size_t const chunk)
     {
-        calc_values_brown_dennis(curve);
-        calc_derivatives_brown_dennis(derivatives);
+        std::size_t const begin = chunk * n_points_per_chunk;
+        std::size_t const end = std::min(begin + n_points_per_chunk, info_.n_points_);
+        calc_values(curve, begin, end);
+        calc_derivatives(derivatives, begin, end);
+    };
+
+    if (executor_ && n_chunks_ > 1)
+    {
+        executor_->parallel_for(n_point_chunks, process_chunk);
     }
-    else if (info_.model_id_ == SPLINE_1D)
+    else
     {
-        calc_values_spline1d(curve);
-        calc_derivatives_spline1d(derivatives);
+        calc_values(curve, 0, info_.n_points_);
+        calc_derivatives(derivatives, 0, info_.n_points_);
     }
-    else if (info_.model_id_ == SPLINE_2D)
+}
+
+// points excluded by the point mask are neither evaluated nor summed up
+bool LMFitCPP::skip_point(std::size_t const point_index) const
+{
+    return point_mask_ && !point_mask_[point_index];
+}
+
+std::size_t LMFitCPP::get_point_index(std::size_t const point) const
+{
+    return point_mask_ ? point_indices_[point] : point;
+}
+
+// implicit weight of the Poisson weighted LSE estimators: the inverse of the
+// variance estimated from the data (Neyman) or from the model (Pearson)
+REAL LMFitCPP::calc_poisson_weight(
+    std::size_t const pixel_index,
+    Buffer<REAL> const & curve) const
+{
+    REAL const variance
+        = info_.estimator_id_ == LSE_POISSON_PEARSON
+        ? curve[pixel_index]
+        : data_[pixel_index];
+
+    return 1 / std::max(variance, REAL(1));
+}
+
+// sums are calculated for fixed chunks of points and combined by a pairwise
+// tree reduction, so the result doesn't depend on the number of threads
+template<typename SumChunk>
+double const * LMFitCPP::sum_chunks(
+    std::size_t const n_sums,
+    SumChunk const & sum_chunk)
+{
+    partial_sums_.resize(n_chunks_ * n_sums);
+    std::fill(partial_sums_.begin(), partial_sums_.end(), 0.);
+
+    auto const process_chunk = [&](std::size_t const chunk)
     {
-        calc_values_spline2d(curve);
-        calc_derivatives_spline2d(derivatives);
+        std::size_t const begin = chunk * n_points_per_chunk;
+        std::size_t const end = std::min(begin + n_points_per_chunk, n_used_points_);
+
+        sum_chunk(begin, end, partial_sums_.data() + chunk * n_sums);
+    };
+
+    if (executor_ && n_chunks_ > 1)
+    {
+        executor_->parallel_for(n_chunks_, process_chunk);
     }
-    else if (info_.model_id_ == SPLINE_3D)
+    else
     {
-        calc_values_spline3d(curve);
-        calc_derivatives_spline3d(derivatives);
+        for (std::size_t chunk = 0; chunk < n_chunks_; chunk++)
+            process_chunk(chunk);
     }
-    else if (info_.model_id_ == SPLINE_3D_MULTICHANNEL)
+
+    for (std::size_t stride = 1; stride < n_chunks_; stride *= 2)
     {
-        calc_values_spline3d_multichannel(curve);
-        calc_derivatives_spline3d_multichannel(derivatives);
+        for (std::size_t chunk = 0; chunk + stride < n_chunks_; chunk += 2 * stride)
+        {
+            double * sums = partial_sums_.data() + chunk * n_sums;
+            double const * other_sums = sums + stride * n_sums;
+
+            for (std::size_t i = 0; i < n_sums; i++)
+                sums[i] += other_sums[i];
+        }
     }
+
+    return partial_sums_.data();
 }
 
-void LMFitCPP::calculate_hessian(
-    std::vector<REAL> const & derivatives,
-    std::vector<REAL> const & curve)
+void LMFitCPP::sum_hessian(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve,
+    std::size_t const begin,
+    std::size_t const end,
+    double * sums) const
 {
     for (int jp = 0, jhessian = 0; jp < info_.n_parameters_; jp++)
     {
@@ -1315,14 +1524,14 @@ void LMFitCPP::calculate_hessian(
                 {
                     std::size_t const ijhessian
                         = ihessian * info_.n_parameters_to_fit_ + jhessian;
-                    std::size_t const jihessian
-                        = jhessian * info_.n_parameters_to_fit_ + ihessian;
                     std::size_t const derivatives_index_i = ip*info_.n_points_;
                     std::size_t const derivatives_index_j = jp*info_.n_points_;
                     
                     double sum = 0.0;
-                    for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
+                    for (std::size_t point = begin; point < end; point++)
                     {
+                        std::size_t const pixel_index = get_point_index(point);
+
                         if (info_.estimator_id_ == LSE)
                         {
                             if (!weight_)
@@ -1339,6 +1548,13 @@ void LMFitCPP::calculate_hessian(
                                     * weight_[pixel_index];
                             }
                         }
+                        else if (info_.estimator_id_ == LSE_POISSON_NEYMAN || info_.estimator_id_ == LSE_POISSON_PEARSON)
+                        {
+                            sum
+                                += derivatives[derivatives_index_i + pixel_index]
+                                * derivatives[derivatives_index_j + pixel_index]
+                                * calc_poisson_weight(pixel_index, curve);
+                        }
                         else if (info_.estimator_id_ == MLE)
                         {
                             sum
@@ -1347,34 +1563,56 @@ void LMFitCPP::calculate_hessian(
                                 * derivatives[derivatives_index_j + pixel_index];
                         }
                     }
-                    hessian_[ijhessian] = REAL(sum);
-                    if (ijhessian != jihessian)
-                    {
-                        hessian_[jihessian]
-                            = hessian_[ijhessian];
-                    }
+                    sums[ijhessian] = sum;
                     ihessian++;
                 }
             }
             jhessian++;
         }
     }
-
 }
 
-void LMFitCPP::calc_gradient(
-    std::vector<REAL> const & derivatives,
-    std::vector<REAL> const & curve)
+void LMFitCPP::calculate_hessian(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve)
 {
+    std::size_t const n_parameters_to_fit = info_.n_parameters_to_fit_;
+
+    double const * sums = sum_chunks(
+        hessian_.size(),
+        [&](std::size_t const begin, std::size_t const end, double * chunk_sums)
+        { sum_hessian(derivatives, curve, begin, end, chunk_sums); });
+
+    for (std::size_t jhessian = 0; jhessian < n_parameters_to_fit; jhessian++)
+    {
+        for (std::size_t ihessian = 0; ihessian <= jhessian; ihessian++)
+        {
+            std::size_t const ijhessian = ihessian * n_parameters_to_fit + jhessian;
+            std::size_t const jihessian = jhessian * n_parameters_to_fit + ihessian;
 
+            hessian_[ijhessian] = REAL(sums[ijhessian]);
+            hessian_[jihessian] = hessian_[ijhessian];
+        }
+    }
+}
+
+void LMFitCPP::sum_gradient(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve,
+    std::size_t const begin,
+    std::size_t const end,
+    double * sums) const
+{
     for (int ip = 0, gradient_index = 0; ip < info_.n_parameters_; ip++)
     {
         if (parameters_to_fit_[ip])
         {
             std::size_t const derivatives_index = ip*info_.n_points_;
             double sum = 0.;
-            for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
+            for (std::size_t point = begin; point < end; point++)
             {
+                std::size_t const pixel_index = get_point_index(point);
+
                 REAL deviant = data_[pixel_index] - curve[pixel_index];
 
                 if (info_.estimator_id_ == LSE)
@@ -1391,26 +1629,52 @@ void LMFitCPP::calc_gradient(
                     }
 
                 }
+                else if (info_.estimator_id_ == LSE_POISSON_NEYMAN || info_.estimator_id_ == LSE_POISSON_PEARSON)
+                {
+                    sum
+                        += deviant * derivatives[derivatives_index + pixel_index] * calc_poisson_weight(pixel_index, curve);
+                }
                 else if (info_.estimator_id_ == MLE)
                 {
                     sum
                         += -derivatives[derivatives_index + pixel_index] * (1 - data_[pixel_index] / curve[pixel_index]);
                 }
             }
-            gradient_[gradient_index] = REAL(sum);
+            sums[gradient_index] = sum;
             gradient_index++;
         }
     }
+}
+
+void LMFitCPP::calc_gradient(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve)
+{
+    double const * sums = sum_chunks(
+        gradient_.size(),
+        [&](std::size_t const begin, std::size_t const end, double * chunk_sums)
+        { sum_gradient(derivatives, curve, begin, end, chunk_sums); });
 
+    for (std::size_t gradient_index = 0; gradient_index < gradient_.size(); gradient_index++)
+        gradient_[gradient_index] = REAL(sums[gradient_index]);
 }
 
-void LMFitCPP::calc_chi_square(
-    std::vector<REAL> const & values)
+// the second sum flags a negative curvature with the MLE estimator, the
+// third is the unweighted sum of squared residuals
+void LMFitCPP::sum_chi_square(
+    Buffer<REAL> const & values,
+    std::size_t const begin,
+    std::size_t const end,
+    double * sums) const
 {
     double sum = 0.0;
-    for (size_t pixel_index = 0; pixel_index < values.size(); pixel_index++)
+    double residual_sum = 0.0;
+    for (std::size_t point = begin; point < end; point++)
     {
+        std::size_t const pixel_index = get_point_index(point);
+
         REAL deviant = values[pixel_index] - data_[pixel_index];
+        residual_sum += deviant * deviant;
         if (info_.estimator_id_ == LSE)
         {
             if (!weight_)
@@ -1422,11 +1686,15 @@ void LMFitCPP::calc_chi_square(
                 sum += deviant * deviant * weight_[pixel_index];
             }
         }
+        else if (info_.estimator_id_ == LSE_POISSON_NEYMAN || info_.estimator_id_ == LSE_POISSON_PEARSON)
+        {
+            sum += deviant * deviant * calc_poisson_weight(pixel_index, values);
+        }
         else if (info_.estimator_id_ == MLE)
         {
             if (values[pixel_index] <= 0.f)
             {
-                *state_ = FitState::NEG_CURVATURE_MLE;
+                sums[1] = 1.;
                 return;
             }
             if (data_[pixel_index] != 0.f)
@@ -1440,21 +1708,104 @@ void LMFitCPP::calc_chi_square(
             }
         }
     }
-    *chi_square_ = REAL(sum);
+    sums[0] = sum;
+    sums[2] = residual_sum;
+}
+
+// the expected information of Poisson distributed data, the sum of
+// df/dp_i * df/dp_j / f over the used points; points without counts add to it
+// as much as any other
+void LMFitCPP::sum_fisher_information(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve,
+    std::size_t const begin,
+    std::size_t const end,
+    double * sums) const
+{
+    for (int jp = 0, jhessian = 0; jp < info_.n_parameters_; jp++)
+    {
+        if (parameters_to_fit_[jp])
+        {
+            for (int ip = 0, ihessian = 0; ip < jp + 1; ip++)
+            {
+                if (parameters_to_fit_[ip])
+                {
+                    std::size_t const derivatives_index_i = ip*info_.n_points_;
+                    std::size_t const derivatives_index_j = jp*info_.n_points_;
+
+                    double sum = 0.0;
+                    for (std::size_t point = begin; point < end; point++)
+                    {
+                        std::size_t const pixel_index = get_point_index(point);
+
+                        if (curve[pixel_index] > 0)
+                        {
+                            sum
+                                += double(derivatives[derivatives_index_i + pixel_index])
+                                * derivatives[derivatives_index_j + pixel_index]
+                                / curve[pixel_index];
+                        }
+                    }
+                    sums[ihessian * info_.n_parameters_to_fit_ + jhessian] = sum;
+                    ihessian++;
+                }
+            }
+            jhessian++;
+        }
+    }
+}
+
+void LMFitCPP::calc_fisher_information(
+    Buffer<REAL> const & derivatives,
+    Buffer<REAL> const & curve)
+{
+    std::size_t const n_parameters_to_fit = info_.n_parameters_to_fit_;
+
+    double const * sums = sum_chunks(
+        fisher_information_.size(),
+        [&](std::size_t const begin, std::size_t const end, double * chunk_sums)
+        { sum_fisher_information(derivatives, curve, begin, end, chunk_sums); });
+
+    for (std::size_t j = 0; j < n_parameters_to_fit; j++)
+    {
+        for (std::size_t i = 0; i <= j; i++)
+        {
+            fisher_information_[i * n_parameters_to_fit + j] = sums[i * n_parameters_to_fit + j];
+            fisher_information_[j * n_parameters_to_fit + i] = sums[i * n_parameters_to_fit + j];
+        }
+    }
+}
+
+void LMFitCPP::calc_chi_square(
+    Buffer<REAL> const & values)
+{
+    double const * sums = sum_chunks(
+        3,
+        [&](std::size_t const begin, std::size_t const end, double * chunk_sums)
+        { sum_chi_square(values, begin, end, chunk_sums); });
+
+    if (sums[1] != 0.)
+    {
+        *state_ = FitState::NEG_CURVATURE_MLE;
+        return;
+    }
+
+    *chi_square_ = REAL(sums[0]);
+    residual_sum_of_squares_ = sums[2];
 }
 
 void LMFitCPP::calc_model()
 {
-	std::vector<REAL> & curve = curve_;
-	std::vector<REAL> & derivatives = derivatives_;
+	Buffer<REAL> & curve = curve_;
+	Buffer<REAL> & derivatives = derivatives_;
 
 	calc_curve_values(curve, derivatives);
 }
     
 void LMFitCPP::calc_coefficients()
 {
-    std::vector<REAL> & curve = curve_;
-    std::vector<REAL> & derivatives = derivatives_;
+    Buffer<REAL> & curve = curve_;
+    Buffer<REAL> & derivatives = derivatives_;
 
     calc_chi_square(curve);
 
@@ -1462,6 +1813,9 @@ void LMFitCPP::calc_coefficients()
     {
         calculate_hessian(derivatives, curve);
         calc_gradient(derivatives, curve);
+
+        if (!fisher_information_.empty())
+            calc_fisher_information(derivatives, curve);
     }
 }
 
@@ -1469,15 +1823,15 @@ void LMFitCPP::solve_equation_system_gj()
 {
     delta_ = gradient_;
 
-    std::vector<REAL> & alpha = modified_hessian_;
-    std::vector<REAL> & beta = delta_;
+    Buffer<REAL> & alpha = modified_hessian_;
+    Buffer<REAL> & beta = delta_;
 
     int icol, irow;
     REAL big, dum, pivinv;
 
-    std::vector<int> indxc(info_.n_parameters_to_fit_, 0);
-    std::vector<int> indxr(info_.n_parameters_to_fit_, 0);
-    std::vector<int> ipiv(info_.n_parameters_to_fit_, 0);
+    Buffer<int> indxc(info_.n_parameters_to_fit_, 0);
+    Buffer<int> indxr(info_.n_parameters_to_fit_, 0);
+    Buffer<int> ipiv(info_.n_parameters_to_fit_, 0);
 
     for (int kp = 0; kp < info_.n_parameters_to_fit_; kp++)
     {
@@ -1597,13 +1951,19 @@ bool LMFitCPP::check_for_convergence()
 
 void LMFitCPP::evaluate_iteration(int const iteration)
 {
-    bool const max_iterations_reached = iteration == info_.max_n_iterations_ - 1;
-    if (converged_ || max_iterations_reached)
+    bool const max_iterations_reached = iteration == max_n_iterations_ - 1;
+    bool const deadline_exceeded = deadline_ && deadline_->expired();
+    if (converged_ || max_iterations_reached || deadline_exceeded)
     {
         (*n_iterations_) = iteration + 1;
         if (!converged_)
         {
-            *state_ = FitState::MAX_ITERATION;
+            bool const iterations_lowered = max_n_iterations_ < info_.max_n_iterations_;
+
+            *state_
+                = deadline_exceeded || iterations_lowered
+                ? FitState::DEADLINE_EXCEEDED
+                : FitState::MAX_ITERATION;
         }
     }
 }
@@ -1614,11 +1974,13 @@ void LMFitCPP::prepare_next_iteration()
     {
         lambda_ *= 0.1f;
         prev_chi_square_ = (*chi_square_);
+        prev_residual_sum_of_squares_ = residual_sum_of_squares_;
     }
     else
     {
         lambda_ *= 10.;
         (*chi_square_) = prev_chi_square_;
+        residual_sum_of_squares_ = prev_residual_sum_of_squares_;
         for (int parameter_index = 0, delta_index = 0; parameter_index < info_.n_parameters_; parameter_index++)
         {
             if (parameters_to_fit_[parameter_index])
@@ -1652,6 +2014,73 @@ void LMFitCPP::modify_step_width()
     }
 }
 
+// the variances are the diagonal of the inverse Fisher information at the
+// last accepted parameters. With LSE, this is the inverse Hessian, which is
+// kept from these parameters and which is scaled by the reduced chi-square
+// without weights. With MLE, the Hessian is the observed information, data /
+// curve², so the Fisher information, which is summed from the curve and the
+// derivatives of each accepted step, is inverted instead; this is the CRLB
+void LMFitCPP::calc_statistics()
+{
+    std::size_t const n_parameters_to_fit = std::size_t(info_.n_parameters_to_fit_);
+
+    REAL const reduced_chi_square
+        = n_used_points_ > n_parameters_to_fit
+        ? REAL(*chi_square_ / double(n_used_points_ - n_parameters_to_fit))
+        : std::numeric_limits<REAL>::quiet_NaN();
+
+    if (reduced_chi_square_)
+        *reduced_chi_square_ = reduced_chi_square;
+
+    if (residual_rms_)
+        *residual_rms_ = REAL(std::sqrt(residual_sum_of_squares_ / double(std::max(n_used_points_, std::size_t(1)))));
+
+    if (!variances_)
+        return;
+
+    std::fill(variances_, variances_ + info_.n_parameters_, REAL(0));
+
+    if (n_parameters_to_fit == 0)
+        return;
+
+    Buffer<double> matrix
+        = info_.estimator_id_ == MLE
+        ? fisher_information_
+        : Buffer<double>(hessian_.begin(), hessian_.end());
+
+    Buffer<int> permutation(n_parameters_to_fit);
+    Buffer<double> unit_vector(n_parameters_to_fit, 0.);
+    Buffer<double> column(n_parameters_to_fit);
+
+    bool const decomposed = decompose_LUP(matrix, int(n_parameters_to_fit), 0., permutation) != 0;
+
+    REAL const scale
+        = info_.estimator_id_ == LSE && !weight_
+        ? reduced_chi_square
+        : REAL(1);
+
+    for (int parameter_index = 0, hessian_index = 0; parameter_index < info_.n_parameters_; parameter_index++)
+    {
+        if (!parameters_to_fit_[parameter_index])
+            continue;
+
+        if (decomposed)
+        {
+            unit_vector[hessian_index] = 1.;
+            solve_LUP(matrix, permutation, unit_vector, int(n_parameters_to_fit), column);
+            unit_vector[hessian_index] = 0.;
+
+            variances_[parameter_index] = REAL(column[hessian_index]) * scale;
+        }
+        else
+        {
+            variances_[parameter_index] = std::numeric_limits<REAL>::quiet_NaN();
+        }
+
+        hessian_index++;
+    }
+}
+
 void LMFitCPP::run()
 {
     for (int i = 0; i < info_.n_parameters_; i++)
@@ -1660,16 +2089,28 @@ void LMFitCPP::run()
     if( info_.use_constraints_ )
         project_parameters_to_box();
 
+    if (deadline_)
+        max_n_iterations_ = deadline_->get_max_n_iterations(info_.max_n_iterations_);
+
     *state_ = FitState::CONVERGED;
 	calc_model();
     calc_coefficients();
 
     if (info_.n_parameters_to_fit_ == 0)
+    {
+        calc_statistics();
+
+        if (deadline_)
+            deadline_->add_finished_fit(0);
         return;
+    }
 
     prev_chi_square_ = (*chi_square_);
-        
-    for (int iteration = 0; (*state_) == 0; iteration++)
+    prev_residual_sum_of_squares_ = residual_sum_of_squares_;
+
+    int iteration = 0;
+
+    for (; (*state_) == 0; iteration++)
     {
         modify_step_width();
         
@@ -1691,7 +2132,13 @@ void LMFitCPP::run()
 
         if (converged_ || *state_ != FitState::CONVERGED)
         {
+            iteration++;
             break;
         }
     }
+
+    calc_statistics();
+
+    if (deadline_)
+        deadline_->add_finished_fit(iteration);
 }
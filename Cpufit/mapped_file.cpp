@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(char const * const path, Mode const mode, std::size_t const size) :
+    path_(path ? path : ""),
+    mode_(mode),
+    file_descriptor_(-1),
+    size_(size)
+{
+    if (!path)
+    {
+        throw std::runtime_error("no file name");
+    }
+
+    switch (mode_)
+    {
+    case READ: file_descriptor_ = open(path, O_RDONLY | O_CLOEXEC); break;
+    case WRITE: file_descriptor_ = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666); break;
+    case UPDATE: file_descriptor_ = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666); break;
+    }
+
+    if (file_descriptor_ < 0)
+    {
+        throw std::runtime_error("cannot open " + path_ + ": " + std::strerror(errno));
+    }
+
+    if (mode_ == READ)
+    {
+        struct stat status;
+
+        if (fstat(file_descriptor_, &status) != 0 || std::size_t(status.st_size) < size)
+        {
+            close(file_descriptor_);
+            throw std::runtime_error(path_ + " is smaller than " + std::to_string(size) + " bytes");
+        }
+
+        size_ = std::size_t(status.st_size);
+    }
+    else if (ftruncate(file_descriptor_, off_t(size)) != 0)
+    {
+        std::string const error = std::strerror(errno);
+        close(file_descriptor_);
+        throw std::runtime_error("cannot resize " + path_ + ": " + error);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close(file_descriptor_);
+}
+
+void MappedFile::sync() const
+{
+    if (fdatasync(file_descriptor_) != 0)
+    {
+        throw std::runtime_error("cannot write " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+MappedFile::Window::Window(MappedFile const & file, std::size_t const offset, std::size_t const size) :
+    mapping_(0),
+    mapping_size_(0),
+    data_(0)
+{
+    // mappings start at a page boundary
+    std::size_t const page_size = std::size_t(sysconf(_SC_PAGESIZE));
+    std::size_t const mapping_offset = offset / page_size * page_size;
+
+    mapping_size_ = offset - mapping_offset + size;
+
+    if (size == 0)
+        return;
+
+    int const protection = file.mode_ == READ ? PROT_READ : PROT_READ | PROT_WRITE;
+
+    mapping_ = mmap(0, mapping_size_, protection, MAP_SHARED, file.file_descriptor_, off_t(mapping_offset));
+
+    if (mapping_ == MAP_FAILED)
+    {
+        mapping_ = 0;
+        throw std::runtime_error("cannot map " + file.path_ + ": " + std::strerror(errno));
+    }
+
+    data_ = static_cast<char *>(mapping_) + (offset - mapping_offset);
+
+    madvise(mapping_, mapping_size_, MADV_SEQUENTIAL);
+}
+
+MappedFile::Window::~Window()
+{
+    if (mapping_)
+        munmap(mapping_, mapping_size_);
+}
+
+void MappedFile::Window::prefetch() const
+{
+    if (mapping_)
+        madvise(mapping_, mapping_size_, MADV_WILLNEED);
+}
@@ -0,0 +1,58 @@
+#ifndef CPUFIT_MAPPED_FILE_H_INCLUDED
+#define CPUFIT_MAPPED_FILE_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+// a file of which windows are mapped into the address space one at a time,
+// so that files larger than the memory can be processed
+class MappedFile
+{
+public:
+    enum Mode { READ, WRITE, UPDATE };
+
+    // a file to read must have at least the given size; a file to write is
+    // created or truncated to the given size; a file to update is created or
+    // resized to the given size and keeps its contents
+    MappedFile(char const * const path, Mode const mode, std::size_t const size);
+    ~MappedFile();
+
+    std::size_t size() const { return size_; }
+
+    // writes the changes of all windows, including unmapped ones, to the disk
+    void sync() const;
+
+    // a part of the file, mapped while the window exists; pages of a window
+    // to read are loaded when they are first accessed, or ahead by
+    // prefetch()
+    class Window
+    {
+    public:
+        Window(MappedFile const & file, std::size_t const offset, std::size_t const size);
+        ~Window();
+
+        char * data() const { return data_; }
+
+        // starts reading the window in the background
+        void prefetch() const;
+
+    private:
+        Window(Window const &);
+        Window & operator=(Window const &);
+
+        void * mapping_;
+        std::size_t mapping_size_;
+        char * data_;
+    };
+
+private:
+    MappedFile(MappedFile const &);
+    MappedFile & operator=(MappedFile const &);
+
+    std::string const path_;
+    Mode const mode_;
+    int file_descriptor_;
+    std::size_t size_;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "model_parameters.h"
+
+#include <stdexcept>
+
+int get_number_of_parameters(ModelID const model_id)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        return 4;
+    case GAUSS_2D:
+        return 5;
+    case GAUSS_2D_ELLIPTIC:
+        return 6;
+    case GAUSS_2D_ROTATED:
+        return 7;
+    case CAUCHY_2D_ELLIPTIC:
+        return 6;
+    case LINEAR_1D:
+        return 2;
+    case FLETCHER_POWELL_HELIX:
+        return 3;
+    case BROWN_DENNIS:
+        return 4;
+    case SPLINE_1D:
+        return 3;
+    case SPLINE_2D:
+        return 4;
+    case SPLINE_3D:
+        return 5;
+    case SPLINE_3D_MULTICHANNEL:
+        return 5;
+    case SPLINE_3D_PHASE_MULTICHANNEL:
+        return 6;
+    default:
+        throw std::runtime_error("unknown model ID");
+    }
+}
+
+std::vector<std::string> get_parameter_names(ModelID const model_id)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        return { "amplitude", "center", "width", "offset" };
+    case GAUSS_2D:
+        return { "amplitude", "center_x", "center_y", "width", "offset" };
+    case GAUSS_2D_ELLIPTIC:
+    case CAUCHY_2D_ELLIPTIC:
+        return { "amplitude", "center_x", "center_y", "width_x", "width_y", "offset" };
+    case GAUSS_2D_ROTATED:
+        return { "amplitude", "center_x", "center_y", "width_x", "width_y", "offset", "rotation_angle" };
+    case LINEAR_1D:
+        return { "offset", "slope" };
+    case SPLINE_1D:
+        return { "amplitude", "center", "offset" };
+    case SPLINE_2D:
+        return { "amplitude", "center_x", "center_y", "offset" };
+    case SPLINE_3D:
+    case SPLINE_3D_MULTICHANNEL:
+        return { "amplitude", "center_x", "center_y", "center_z", "offset" };
+    case SPLINE_3D_PHASE_MULTICHANNEL:
+        return { "amplitude", "center_x", "center_y", "center_z", "offset", "phase" };
+    default:
+        break;
+    }
+
+    // models without names for their parameters
+    std::vector<std::string> names;
+
+    for (int i = 0; i < get_number_of_parameters(model_id); i++)
+        names.push_back("p" + std::to_string(i));
+
+    return names;
+}
+
+void slice_user_info(
+    ModelID const model_id,
+    std::size_t const n_points,
+    std::size_t const first_fit,
+    std::size_t const n_fits,
+    char * & user_info,
+    std::size_t & user_info_size)
+{
+    bool const model_uses_x_coordinates = model_id == GAUSS_1D || model_id == LINEAR_1D;
+
+    if (!user_info || !model_uses_x_coordinates || user_info_size / sizeof(REAL) <= n_points)
+        return;
+
+    user_info += first_fit * n_points * sizeof(REAL);
+    user_info_size = n_fits * n_points * sizeof(REAL);
+}
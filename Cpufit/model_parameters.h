@@ -0,0 +1,28 @@
+#ifndef CPUFIT_MODEL_PARAMETERS_H_INCLUDED
+#define CPUFIT_MODEL_PARAMETERS_H_INCLUDED
+
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// throws for an unknown model
+int get_number_of_parameters(ModelID const model_id);
+
+// as in the documentation of the model functions
+std::vector<std::string> get_parameter_names(ModelID const model_id);
+
+// narrows the user info of a batch to the fits first_fit ... first_fit +
+// n_fits - 1: custom x coordinates of each fit are sliced, user info shared by
+// all fits is kept
+void slice_user_info(
+    ModelID const model_id,
+    std::size_t const n_points,
+    std::size_t const first_fit,
+    std::size_t const n_fits,
+    char * & user_info,
+    std::size_t & user_info_size);
+
+#endif
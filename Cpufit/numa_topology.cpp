@@ -0,0 +1,146 @@
+#include "numa_topology.h"
+
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+
+// parses a sysfs CPU or node list like "0-3,8-11"
+static std::vector<int> parse_list(std::string const & list)
+{
+    std::vector<int> values;
+    std::istringstream stream(list);
+    std::string range;
+
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+
+        std::size_t const dash = range.find('-');
+        int const first = std::stoi(range.substr(0, dash));
+        int const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int value = first; value <= last; value++)
+            values.push_back(value);
+    }
+
+    return values;
+}
+
+static bool read_list(std::string const & path, std::vector<int> & values)
+{
+    std::ifstream file(path);
+    std::string list;
+
+    if (!std::getline(file, list))
+        return false;
+
+    values = parse_list(list);
+
+    return true;
+}
+
+static std::vector<std::vector<int>> read_numa_nodes()
+{
+    std::vector<std::vector<int>> nodes;
+
+    std::vector<int> node_ids;
+    if (!read_list("/sys/devices/system/node/online", node_ids))
+        return nodes;
+
+    cpu_set_t allowed_cpus;
+    CPU_ZERO(&allowed_cpus);
+    if (sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) != 0)
+        return nodes;
+
+    for (int const node_id : node_ids)
+    {
+        std::vector<int> cpus;
+        std::string const path
+            = "/sys/devices/system/node/node" + std::to_string(node_id) + "/cpulist";
+
+        if (!read_list(path, cpus))
+            continue;
+
+        std::vector<int> node_cpus;
+        for (int const cpu : cpus)
+        {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed_cpus))
+                node_cpus.push_back(cpu);
+        }
+
+        // nodes without usable CPUs, e.g. memory only nodes, are left out
+        if (!node_cpus.empty())
+            nodes.push_back(node_cpus);
+    }
+
+    return nodes;
+}
+
+std::vector<std::vector<int>> get_numa_nodes()
+{
+    try
+    {
+        return read_numa_nodes();
+    }
+    catch (std::exception &)
+    {
+        return std::vector<std::vector<int>>();
+    }
+}
+
+std::vector<int> get_allowed_cpus()
+{
+    std::vector<int> cpus;
+
+    cpu_set_t allowed_cpus;
+    CPU_ZERO(&allowed_cpus);
+    if (sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) != 0)
+        return cpus;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &allowed_cpus))
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+void pin_thread(std::thread & thread, std::vector<int> const & cpus)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (int const cpu : cpus)
+        CPU_SET(cpu, &cpu_set);
+
+    // pinning is an optimization, a failure leaves the thread unpinned
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+}
+
+#else
+
+std::vector<std::vector<int>> get_numa_nodes()
+{
+    return std::vector<std::vector<int>>();
+}
+
+std::vector<int> get_allowed_cpus()
+{
+    return std::vector<int>();
+}
+
+void pin_thread(std::thread &, std::vector<int> const &)
+{
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef CPUFIT_NUMA_TOPOLOGY_H_INCLUDED
+#define CPUFIT_NUMA_TOPOLOGY_H_INCLUDED
+
+#include <thread>
+#include <vector>
+
+// CPUs of each NUMA node, restricted to the CPUs the process may run on;
+// empty if the topology is unknown
+std::vector<std::vector<int>> get_numa_nodes();
+
+// the CPUs the process may run on; empty if they are unknown
+std::vector<int> get_allowed_cpus();
+
+void pin_thread(std::thread & thread, std::vector<int> const & cpus);
+
+#endif
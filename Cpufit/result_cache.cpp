@@ -0,0 +1,338 @@
+#include "result_cache.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    thread_local ResultCache * thread_result_cache = 0;
+
+    char const entry_magic[8] = { 'C', 'P', 'U', 'F', 'I', 'T', 'C', 0 };
+    char const entry_extension[] = ".cpufitc";
+
+    struct EntryHeader
+    {
+        char magic[8];
+        std::uint64_t key[2];
+        std::uint64_t n_fits;
+        std::uint32_t n_parameters;
+        std::uint32_t real_size;
+    };
+
+    std::size_t get_entry_size(std::size_t const n_fits, std::size_t const n_parameters)
+    {
+        return sizeof(EntryHeader) + n_fits * ((n_parameters + 1) * sizeof(REAL) + 2 * sizeof(int));
+    }
+
+    std::string get_entry_name(ResultCache::Key const & key)
+    {
+        char name[33];
+        std::snprintf(
+            name,
+            sizeof(name),
+            "%016llx%016llx",
+            static_cast<unsigned long long>(key.hash[0]),
+            static_cast<unsigned long long>(key.hash[1]));
+
+        return std::string(name) + entry_extension;
+    }
+
+    bool is_entry_name(std::string const & name)
+    {
+        std::size_t const extension_size = sizeof(entry_extension) - 1;
+
+        return name.size() == 32 + extension_size
+            && name.compare(32, extension_size, entry_extension) == 0;
+    }
+}
+
+ResultCache::ResultCache(char const * const directory, std::size_t const max_size) :
+    directory_(directory ? directory : ""),
+    max_size_(max_size),
+    size_(0),
+    n_hits_(0),
+    n_misses_(0)
+{
+    if (directory_.empty())
+    {
+        throw std::runtime_error("no cache directory");
+    }
+
+    if (mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+        throw std::runtime_error("cannot create " + directory_ + ": " + std::strerror(errno));
+    }
+
+    DIR * const entries = opendir(directory_.c_str());
+
+    if (!entries)
+    {
+        throw std::runtime_error("cannot open " + directory_ + ": " + std::strerror(errno));
+    }
+
+    // the entries of earlier processes in the order of their last use
+    std::vector<std::pair<std::time_t, Entry>> found_entries;
+
+    while (dirent const * const directory_entry = readdir(entries))
+    {
+        std::string const name = directory_entry->d_name;
+        struct stat status;
+
+        if (is_entry_name(name) && stat(get_path(name).c_str(), &status) == 0)
+        {
+            Entry const entry = { name, std::size_t(status.st_size) };
+            found_entries.push_back(std::make_pair(status.st_mtime, entry));
+        }
+    }
+
+    closedir(entries);
+
+    std::sort(
+        found_entries.begin(),
+        found_entries.end(),
+        [](std::pair<std::time_t, Entry> const & a, std::pair<std::time_t, Entry> const & b)
+        { return a.first < b.first; });
+
+    for (std::pair<std::time_t, Entry> const & entry : found_entries)
+        use_entry(entry.second.name, entry.second.size);
+
+    evict();
+}
+
+std::string ResultCache::get_path(std::string const & name) const
+{
+    return directory_ + "/" + name;
+}
+
+// moves an entry to the front, adding it if it is new
+void ResultCache::use_entry(std::string const & name, std::size_t const size)
+{
+    std::unordered_map<std::string, Entries::iterator>::iterator const index = entry_index_.find(name);
+
+    if (index != entry_index_.end())
+    {
+        size_ -= index->second->size;
+        entries_.erase(index->second);
+    }
+
+    Entry const entry = { name, size };
+    entries_.push_front(entry);
+    entry_index_[name] = entries_.begin();
+    size_ += size;
+}
+
+void ResultCache::remove_entry(std::string const & name)
+{
+    std::unordered_map<std::string, Entries::iterator>::iterator const index = entry_index_.find(name);
+
+    if (index != entry_index_.end())
+    {
+        size_ -= index->second->size;
+        entries_.erase(index->second);
+        entry_index_.erase(index);
+    }
+
+    unlink(get_path(name).c_str());
+}
+
+void ResultCache::evict()
+{
+    // the name is copied, as removing the entry destroys it
+    while (size_ > max_size_ && !entries_.empty())
+        remove_entry(std::string(entries_.back().name));
+}
+
+bool ResultCache::find(
+    Key const & key,
+    std::size_t const n_fits,
+    std::size_t const n_parameters,
+    REAL * const parameters,
+    int * const states,
+    REAL * const chi_squares,
+    int * const n_iterations)
+{
+    std::string const name = get_entry_name(key);
+    std::string const path = get_path(name);
+    std::size_t const size = get_entry_size(n_fits, n_parameters);
+
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        n_misses_++;
+
+        return false;
+    }
+
+    // a file which was replaced or removed after the check above stays
+    // mapped until it is copied
+    bool valid = std::size_t(status.st_size) == size;
+    bool vanished = false;
+
+    if (valid)
+    try
+    {
+        MappedFile const file(path.c_str(), MappedFile::READ, size);
+        MappedFile::Window const window(file, 0, size);
+
+        EntryHeader header;
+        std::memcpy(&header, window.data(), sizeof(header));
+
+        valid = std::memcmp(header.magic, entry_magic, sizeof(entry_magic)) == 0
+            && header.key[0] == key.hash[0]
+            && header.key[1] == key.hash[1]
+            && header.n_fits == n_fits
+            && header.n_parameters == n_parameters
+            && header.real_size == sizeof(REAL);
+
+        if (valid)
+        {
+            char const * data = window.data() + sizeof(header);
+
+            std::memcpy(parameters, data, n_fits * n_parameters * sizeof(REAL));
+            data += n_fits * n_parameters * sizeof(REAL);
+            std::memcpy(states, data, n_fits * sizeof(int));
+            data += n_fits * sizeof(int);
+            std::memcpy(chi_squares, data, n_fits * sizeof(REAL));
+            data += n_fits * sizeof(REAL);
+            std::memcpy(n_iterations, data, n_fits * sizeof(int));
+        }
+    }
+    catch (std::runtime_error const &)
+    {
+        // the file was removed or shrunk by another process after the check
+        // above; the outputs are only written after the file is mapped
+        valid = false;
+        vanished = true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // damaged files are removed, files which vanished may have been replaced
+    // by a valid one in the meantime
+    if (!valid)
+    {
+        if (!vanished)
+            remove_entry(name);
+
+        n_misses_++;
+
+        return false;
+    }
+
+    // the use is recorded in the file for other processes
+    utimensat(AT_FDCWD, path.c_str(), 0, 0);
+    use_entry(name, size);
+    n_hits_++;
+
+    return true;
+}
+
+void ResultCache::store(
+    Key const & key,
+    std::size_t const n_fits,
+    std::size_t const n_parameters,
+    REAL const * const parameters,
+    int const * const states,
+    REAL const * const chi_squares,
+    int const * const n_iterations)
+{
+    static std::atomic<std::uint64_t> n_stored_entries(0);
+
+    std::size_t const size = get_entry_size(n_fits, n_parameters);
+
+    if (size > max_size_)
+        return;
+
+    EntryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, entry_magic, sizeof(header.magic));
+    header.key[0] = key.hash[0];
+    header.key[1] = key.hash[1];
+    header.n_fits = n_fits;
+    header.n_parameters = std::uint32_t(n_parameters);
+    header.real_size = sizeof(REAL);
+
+    std::string const name = get_entry_name(key);
+    std::string const path = get_path(name);
+    std::string const temporary_path
+        = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(n_stored_entries++);
+
+    // results which cannot be written are not stored
+    std::FILE * const file = std::fopen(temporary_path.c_str(), "wb");
+
+    if (!file)
+        return;
+
+    bool const written
+        = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(parameters, sizeof(REAL), n_fits * n_parameters, file) == n_fits * n_parameters
+        && std::fwrite(states, sizeof(int), n_fits, file) == n_fits
+        && std::fwrite(chi_squares, sizeof(REAL), n_fits, file) == n_fits
+        && std::fwrite(n_iterations, sizeof(int), n_fits, file) == n_fits;
+
+    if (std::fclose(file) != 0 || !written || std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    use_entry(name, size);
+    evict();
+}
+
+void ResultCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // including the entries of other processes
+    if (DIR * const entries = opendir(directory_.c_str()))
+    {
+        while (dirent const * const directory_entry = readdir(entries))
+        {
+            std::string const name = directory_entry->d_name;
+
+            if (is_entry_name(name))
+                unlink(get_path(name).c_str());
+        }
+
+        closedir(entries);
+    }
+
+    entries_.clear();
+    entry_index_.clear();
+    size_ = 0;
+}
+
+ResultCache::Statistics ResultCache::statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Statistics const statistics = { n_hits_, n_misses_, entries_.size(), size_ };
+
+    return statistics;
+}
+
+ResultCache * get_thread_result_cache()
+{
+    return thread_result_cache;
+}
+
+void set_thread_result_cache(ResultCache * const cache)
+{
+    thread_result_cache = cache;
+}
@@ -0,0 +1,106 @@
+#ifndef CPUFIT_RESULT_CACHE_H_INCLUDED
+#define CPUFIT_RESULT_CACHE_H_INCLUDED
+
+#include "result_key.h"
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// stores the results of fit calls in a directory, one file per call, named
+// by a hash of all inputs which change the results; a call with the same
+// inputs copies the results from the memory mapped file instead of fitting
+//
+// The total size of the files is bounded: the least recently used files are
+// removed first. The use of a file is recorded in its modification time, so
+// that the order of use is kept across processes sharing the directory.
+// Files are written under a temporary name and renamed, so that other
+// processes never see incomplete files.
+class ResultCache
+{
+public:
+    typedef ResultKey Key;
+    typedef ResultKeyBuilder KeyBuilder;
+
+    struct Statistics
+    {
+        std::size_t n_hits;
+        std::size_t n_misses;
+        std::size_t n_entries;
+        std::size_t size;
+    };
+
+    // creates the directory if it does not exist
+    ResultCache(char const * directory, std::size_t max_size);
+    virtual ~ResultCache() {}
+
+    // returns false without changing the outputs if there are no results for
+    // the key
+    bool find(
+        Key const & key,
+        std::size_t const n_fits,
+        std::size_t const n_parameters,
+        REAL * parameters,
+        int * states,
+        REAL * chi_squares,
+        int * n_iterations);
+
+    // results larger than the maximum size are not stored
+    void store(
+        Key const & key,
+        std::size_t const n_fits,
+        std::size_t const n_parameters,
+        REAL const * parameters,
+        int const * states,
+        REAL const * chi_squares,
+        int const * n_iterations);
+
+    // removes all results
+    void clear();
+
+    Statistics statistics();
+
+private:
+    ResultCache(ResultCache const &);
+    ResultCache & operator=(ResultCache const &);
+
+    struct Entry
+    {
+        std::string name;
+        std::size_t size;
+    };
+
+    typedef std::list<Entry> Entries;
+
+    std::string get_path(std::string const & name) const;
+    void use_entry(std::string const & name, std::size_t const size);
+    void remove_entry(std::string const & name);
+    void evict();
+
+    std::string const directory_;
+    std::size_t const max_size_;
+
+    std::mutex mutex_;
+    // the most recently used first
+    Entries entries_;
+    std::unordered_map<std::string, Entries::iterator> entry_index_;
+    std::size_t size_;
+    std::size_t n_hits_;
+    std::size_t n_misses_;
+};
+
+// the cache of the fit calls of the calling thread, or a null pointer
+ResultCache * get_thread_result_cache();
+void set_thread_result_cache(ResultCache * cache);
+
+// the handle of the C interface
+struct cpufit_result_cache : ResultCache
+{
+    using ResultCache::ResultCache;
+};
+
+#endif
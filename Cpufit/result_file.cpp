@@ -0,0 +1,612 @@
+#include "result_file.h"
+#include "model_parameters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    std::uint64_t load_word(char const * const value, std::size_t const value_size)
+    {
+        if (value_size == 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, value, 8);
+            return word;
+        }
+
+        std::uint32_t word;
+        std::memcpy(&word, value, 4);
+        return word;
+    }
+
+    void store_word(std::uint64_t const word, char * const value, std::size_t const value_size)
+    {
+        if (value_size == 8)
+        {
+            std::memcpy(value, &word, 8);
+        }
+        else
+        {
+            std::uint32_t const word_32 = std::uint32_t(word);
+            std::memcpy(value, &word_32, 4);
+        }
+    }
+
+    // the difference of two words of a value size, zigzag encoded so that
+    // small negative differences give small numbers
+    std::uint64_t zigzag_difference(std::uint64_t const word, std::uint64_t const previous, std::size_t const value_size)
+    {
+        if (value_size == 8)
+        {
+            std::int64_t const difference = std::int64_t(word - previous);
+            return (std::uint64_t(difference) << 1) ^ std::uint64_t(difference >> 63);
+        }
+
+        std::int32_t const difference = std::int32_t(std::uint32_t(word) - std::uint32_t(previous));
+        return std::uint32_t((std::uint32_t(difference) << 1) ^ std::uint32_t(difference >> 31));
+    }
+
+    std::uint64_t add_zigzag_difference(std::uint64_t const previous, std::uint64_t const zigzag, std::size_t const value_size)
+    {
+        std::uint64_t const difference = (zigzag >> 1) ^ (0 - (zigzag & 1));
+        std::uint64_t const word = previous + difference;
+
+        return value_size == 8 ? word : std::uint32_t(word);
+    }
+
+    int get_bit_width(std::uint64_t const value)
+    {
+        int bit_width = 0;
+
+        while (bit_width < 64 && (value >> bit_width))
+            bit_width++;
+
+        return bit_width;
+    }
+
+    // keeps the sizes of the columns of a block from overflowing
+    std::uint64_t const max_n_block_fits = std::uint64_t(1) << 48;
+
+    std::size_t get_packed_size(std::size_t const n_values, int const bit_width)
+    {
+        return (n_values * bit_width + 63) / 64 * 8;
+    }
+
+    void pack(std::vector<std::uint64_t> const & values, int const bit_width, char * const packed)
+    {
+        std::vector<std::uint64_t> words(get_packed_size(values.size(), bit_width) / 8, 0);
+
+        for (std::size_t i = 0; i < values.size() && bit_width > 0; i++)
+        {
+            std::size_t const bit = i * bit_width;
+            std::size_t const word = bit / 64;
+            std::size_t const shift = bit % 64;
+
+            words[word] |= values[i] << shift;
+
+            if (shift + bit_width > 64)
+                words[word + 1] |= values[i] >> (64 - shift);
+        }
+
+        std::memcpy(packed, words.data(), words.size() * 8);
+    }
+
+    std::uint64_t unpack(char const * const packed, std::size_t const i, int const bit_width)
+    {
+        if (bit_width == 0)
+            return 0;
+
+        std::size_t const bit = i * bit_width;
+        std::size_t const shift = bit % 64;
+
+        std::uint64_t word;
+        std::memcpy(&word, packed + bit / 64 * 8, 8);
+
+        std::uint64_t value = word >> shift;
+
+        if (shift + bit_width > 64)
+        {
+            std::uint64_t next_word;
+            std::memcpy(&next_word, packed + (bit / 64 + 1) * 8, 8);
+            value |= next_word << (64 - shift);
+        }
+
+        return bit_width == 64 ? value : value & ((std::uint64_t(1) << bit_width) - 1);
+    }
+
+    // encodes the values of a column and appends them to the data of a block
+    void encode_column(
+        char const * const values,
+        std::size_t const n_values,
+        std::size_t const value_size,
+        int const encoding,
+        ResultColumn & column,
+        std::vector<char> & data)
+    {
+        column.encoding = std::uint8_t(encoding);
+        column.value_size = std::uint16_t(value_size);
+        column.offset = (data.size() + 7) / 8 * 8;
+
+        if (encoding == RAW_ENCODING || n_values == 0)
+        {
+            column.encoding = RAW_ENCODING;
+            column.size = n_values * value_size;
+            data.resize(column.offset + column.size);
+            std::memcpy(data.data() + column.offset, values, column.size);
+            return;
+        }
+
+        std::vector<std::uint64_t> codes(n_values);
+
+        if (encoding == BIT_PACKED_ENCODING)
+        {
+            column.reference = load_word(values, value_size);
+
+            for (std::size_t i = 1; i < n_values; i++)
+                column.reference = std::min(column.reference, load_word(values + i * value_size, value_size));
+
+            for (std::size_t i = 0; i < n_values; i++)
+                codes[i] = load_word(values + i * value_size, value_size) - column.reference;
+        }
+        else
+        {
+            column.reference = load_word(values, value_size);
+            codes[0] = 0;
+
+            for (std::size_t i = 1; i < n_values; i++)
+            {
+                codes[i] = zigzag_difference(
+                    load_word(values + i * value_size, value_size),
+                    load_word(values + (i - 1) * value_size, value_size),
+                    value_size);
+            }
+        }
+
+        int const bit_width = get_bit_width(*std::max_element(codes.begin(), codes.end()));
+
+        column.bit_width = std::uint8_t(bit_width);
+        column.size = get_packed_size(n_values, bit_width);
+        data.resize(column.offset + column.size);
+        pack(codes, bit_width, data.data() + column.offset);
+    }
+}
+
+ResultWriter::ResultWriter(char const * const path, ModelID const model_id, int const * const column_encodings) :
+    n_parameters_(get_number_of_parameters(model_id)),
+    column_encodings_(n_parameters_ + 3, RAW_ENCODING),
+    file_(0),
+    path_(path ? path : ""),
+    n_fits_(0),
+    writing_(false),
+    closing_(false),
+    executor_(get_executor())
+{
+    if (column_encodings)
+    {
+        for (std::size_t i = 0; i < column_encodings_.size(); i++)
+        {
+            if (column_encodings[i] < RAW_ENCODING || column_encodings[i] > DELTA_ENCODING)
+            {
+                throw std::runtime_error("unknown column encoding");
+            }
+
+            column_encodings_[i] = column_encodings[i];
+        }
+    }
+
+    std::vector<std::string> const names = get_parameter_names(model_id);
+
+    ResultFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, result_file_magic, sizeof(header.magic));
+    header.version = result_file_version;
+    header.model_id = model_id;
+    header.n_parameters = std::uint32_t(n_parameters_);
+    header.real_size = sizeof(REAL);
+    header.size = sizeof(header) + n_parameters_ * result_parameter_name_size;
+
+    std::vector<char> name_data(n_parameters_ * result_parameter_name_size, 0);
+
+    for (std::size_t i = 0; i < n_parameters_; i++)
+        names[i].copy(name_data.data() + i * result_parameter_name_size, result_parameter_name_size - 1);
+
+    file_ = std::fopen(path_.c_str(), "wb");
+
+    if (!file_)
+    {
+        throw std::runtime_error("cannot open " + path_ + ": " + std::strerror(errno));
+    }
+
+    if (std::fwrite(&header, sizeof(header), 1, file_) != 1
+        || std::fwrite(name_data.data(), 1, name_data.size(), file_) != name_data.size()
+        || std::fflush(file_) != 0)
+    {
+        std::fclose(file_);
+        throw std::runtime_error("cannot write " + path_);
+    }
+}
+
+ResultWriter::~ResultWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void ResultWriter::write(
+    std::size_t const n_fits,
+    REAL const * const parameters,
+    int const * const states,
+    REAL const * const chi_squares,
+    int const * const n_iterations)
+{
+    Block block;
+    block.first_fit = n_fits_;
+    block.n_fits = n_fits;
+    block.parameters.assign(parameters, parameters + n_fits * n_parameters_);
+    block.states.assign(states, states + n_fits);
+    block.chi_squares.assign(chi_squares, chi_squares + n_fits);
+    block.n_iterations.assign(n_iterations, n_iterations + n_fits);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    queue_changed_.wait(lock, [this] { return queue_.size() < max_n_queued_blocks || error_; });
+
+    if (closing_)
+    {
+        throw std::runtime_error("result file closed");
+    }
+
+    if (error_)
+    {
+        std::rethrow_exception(error_);
+    }
+
+    queue_.push_back(std::move(block));
+    n_fits_ += n_fits;
+
+    if (writing_)
+    {
+        queue_changed_.notify_all();
+        return;
+    }
+
+    writing_ = true;
+    lock.unlock();
+
+    // an executor without threads for jobs writes the block right away
+    try
+    {
+        executor_->submit([this] { write_blocks(); });
+    }
+    catch (...)
+    {
+        write_blocks();
+    }
+}
+
+void ResultWriter::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (closing_)
+            return;
+
+        closing_ = true;
+        queue_changed_.wait(lock, [this] { return !writing_; });
+    }
+
+    bool const closed = std::fclose(file_) == 0;
+
+    if (error_)
+    {
+        std::rethrow_exception(error_);
+    }
+
+    if (!closed)
+    {
+        throw std::runtime_error("cannot write " + path_);
+    }
+}
+
+// runs until the queue is empty, so that a job does not hold a thread of the
+// executor between blocks
+void ResultWriter::write_blocks()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;)
+    {
+        if (queue_.empty())
+        {
+            writing_ = false;
+            queue_changed_.notify_all();
+            return;
+        }
+
+        Block const & block = queue_.front();
+
+        lock.unlock();
+
+        try
+        {
+            write_block(block);
+        }
+        catch (...)
+        {
+            lock.lock();
+            error_ = std::current_exception();
+            queue_.clear();
+            writing_ = false;
+            queue_changed_.notify_all();
+            return;
+        }
+
+        lock.lock();
+        queue_.pop_front();
+        queue_changed_.notify_all();
+    }
+}
+
+void ResultWriter::write_block(Block const & block)
+{
+    std::size_t const n_columns = n_parameters_ + 3;
+    std::size_t const headers_size = sizeof(ResultBlockHeader) + n_columns * sizeof(ResultColumn);
+
+    std::vector<ResultColumn> columns(n_columns);
+    std::vector<char> data(headers_size);
+    std::memset(columns.data(), 0, n_columns * sizeof(ResultColumn));
+
+    // transposes the parameters of each fit into a column per parameter
+    std::vector<REAL> parameter_column(block.n_fits);
+
+    for (std::size_t parameter_index = 0; parameter_index < n_parameters_; parameter_index++)
+    {
+        for (std::size_t fit_index = 0; fit_index < block.n_fits; fit_index++)
+            parameter_column[fit_index] = block.parameters[fit_index * n_parameters_ + parameter_index];
+
+        encode_column(
+            reinterpret_cast<char const *>(parameter_column.data()), block.n_fits, sizeof(REAL),
+            column_encodings_[parameter_index], columns[parameter_index], data);
+    }
+
+    encode_column(
+        reinterpret_cast<char const *>(block.states.data()), block.n_fits, sizeof(int),
+        column_encodings_[n_parameters_], columns[n_parameters_], data);
+    encode_column(
+        reinterpret_cast<char const *>(block.chi_squares.data()), block.n_fits, sizeof(REAL),
+        column_encodings_[n_parameters_ + 1], columns[n_parameters_ + 1], data);
+    encode_column(
+        reinterpret_cast<char const *>(block.n_iterations.data()), block.n_fits, sizeof(int),
+        column_encodings_[n_parameters_ + 2], columns[n_parameters_ + 2], data);
+
+    // blocks end at an 8 byte boundary, like the columns
+    data.resize((data.size() + 7) / 8 * 8);
+
+    ResultBlockHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = result_block_magic;
+    header.n_columns = std::uint32_t(n_columns);
+    header.first_fit = block.first_fit;
+    header.n_fits = block.n_fits;
+    header.size = data.size();
+
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), columns.data(), n_columns * sizeof(ResultColumn));
+
+    // a reader of the growing file sees whole blocks
+    if (std::fwrite(data.data(), 1, data.size(), file_) != data.size() || std::fflush(file_) != 0)
+    {
+        throw std::runtime_error("cannot write " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+ResultReader::ResultReader(char const * const path) :
+    file_(path, MappedFile::READ, sizeof(ResultFileHeader)),
+    n_fits_(0)
+{
+    mapping_.reset(new MappedFile::Window(file_, 0, file_.size()));
+
+    char const * const data = mapping_->data();
+    std::memcpy(&header_, data, sizeof(header_));
+
+    if (std::memcmp(header_.magic, result_file_magic, sizeof(header_.magic)) != 0
+        || header_.version != result_file_version
+        || header_.size != sizeof(header_) + std::uint64_t(header_.n_parameters) * result_parameter_name_size
+        || header_.size > file_.size()
+        || (header_.real_size != 4 && header_.real_size != 8))
+    {
+        throw std::runtime_error(std::string(path) + " is not a Cpufit result file");
+    }
+
+    for (std::size_t i = 0; i < header_.n_parameters; i++)
+    {
+        char const * const name = data + sizeof(header_) + i * result_parameter_name_size;
+        parameter_names_.push_back(std::string(name, strnlen(name, result_parameter_name_size)));
+    }
+
+    // stops at a block which is not completely written yet
+    std::size_t const n_columns = header_.n_parameters + 3;
+    std::size_t const headers_size = sizeof(ResultBlockHeader) + n_columns * sizeof(ResultColumn);
+
+    for (std::size_t offset = header_.size; offset + headers_size <= file_.size();)
+    {
+        ResultBlockHeader block_header;
+        std::memcpy(&block_header, data + offset, sizeof(block_header));
+
+        if (block_header.magic != result_block_magic
+            || block_header.n_columns != n_columns
+            || block_header.first_fit != n_fits_
+            || block_header.size < headers_size
+            || block_header.size > file_.size() - offset)
+        {
+            break;
+        }
+
+        Block block;
+        block.data = data + offset;
+        block.first_fit = block_header.first_fit;
+        block.n_fits = block_header.n_fits;
+        block.columns.resize(n_columns);
+        std::memcpy(block.columns.data(), data + offset + sizeof(block_header), n_columns * sizeof(ResultColumn));
+
+        // the columns are decoded without further checks
+        for (std::size_t column_index = 0; column_index < n_columns; column_index++)
+        {
+            ResultColumn const & column = block.columns[column_index];
+
+            bool const is_int_column = column_index == n_columns - 3 || column_index == n_columns - 1;
+            std::size_t const value_size = is_int_column ? sizeof(int) : header_.real_size;
+
+            bool const valid
+                = column.value_size == value_size
+                && column.encoding <= DELTA_ENCODING
+                && column.bit_width <= 64
+                && block.n_fits <= max_n_block_fits
+                && column.offset <= block_header.size
+                && column.size <= block_header.size - column.offset
+                && column.size >= (column.encoding == RAW_ENCODING
+                    ? std::size_t(block.n_fits) * value_size
+                    : get_packed_size(std::size_t(block.n_fits), column.bit_width));
+
+            if (!valid)
+            {
+                throw std::runtime_error(std::string(path) + " is corrupt");
+            }
+        }
+
+        blocks_.push_back(block);
+        n_fits_ += std::size_t(block.n_fits);
+        offset += std::size_t(block_header.size);
+    }
+}
+
+std::string const & ResultReader::parameter_name(std::size_t const parameter_index) const
+{
+    if (parameter_index >= parameter_names_.size())
+    {
+        throw std::runtime_error("parameter index out of range");
+    }
+
+    return parameter_names_[parameter_index];
+}
+
+void ResultReader::decode_column(Block const & block, std::size_t const column_index, std::vector<char> & values) const
+{
+    ResultColumn const & column = block.columns[column_index];
+    char const * const data = block.data + column.offset;
+    std::size_t const value_size = column.value_size;
+
+    values.resize(std::size_t(block.n_fits) * value_size);
+
+    if (column.encoding == RAW_ENCODING)
+    {
+        std::memcpy(values.data(), data, values.size());
+        return;
+    }
+
+    std::uint64_t word = column.reference;
+
+    for (std::size_t i = 0; i < block.n_fits; i++)
+    {
+        std::uint64_t const code = unpack(data, i, column.bit_width);
+
+        if (column.encoding == BIT_PACKED_ENCODING)
+            word = column.reference + code;
+        else if (i > 0)
+            word = add_zigzag_difference(word, code, value_size);
+
+        store_word(word, values.data() + i * value_size, value_size);
+    }
+}
+
+void ResultReader::read(
+    std::size_t const first_fit,
+    std::size_t const n_fits,
+    REAL * const parameters,
+    int * const states,
+    REAL * const chi_squares,
+    int * const n_iterations) const
+{
+    if (first_fit + n_fits > n_fits_)
+    {
+        throw std::runtime_error("fits out of range");
+    }
+
+    if (header_.real_size != sizeof(REAL))
+    {
+        throw std::runtime_error("results written in a different precision");
+    }
+
+    std::size_t const n_parameters = header_.n_parameters;
+    std::vector<char> values;
+
+    for (Block const & block : blocks_)
+    {
+        std::size_t const begin = std::max(std::size_t(block.first_fit), first_fit);
+        std::size_t const end = std::min(std::size_t(block.first_fit + block.n_fits), first_fit + n_fits);
+
+        if (begin >= end)
+            continue;
+
+        std::size_t const block_begin = begin - std::size_t(block.first_fit);
+
+        for (std::size_t parameter_index = 0; parameters && parameter_index < n_parameters; parameter_index++)
+        {
+            decode_column(block, parameter_index, values);
+            REAL const * const column = reinterpret_cast<REAL const *>(values.data());
+
+            for (std::size_t fit_index = begin; fit_index < end; fit_index++)
+            {
+                parameters[(fit_index - first_fit) * n_parameters + parameter_index]
+                    = column[fit_index - std::size_t(block.first_fit)];
+            }
+        }
+
+        if (states)
+        {
+            decode_column(block, n_parameters, values);
+            std::memcpy(states + (begin - first_fit), values.data() + block_begin * sizeof(int), (end - begin) * sizeof(int));
+        }
+
+        if (chi_squares)
+        {
+            decode_column(block, n_parameters + 1, values);
+            std::memcpy(chi_squares + (begin - first_fit), values.data() + block_begin * sizeof(REAL), (end - begin) * sizeof(REAL));
+        }
+
+        if (n_iterations)
+        {
+            decode_column(block, n_parameters + 2, values);
+            std::memcpy(n_iterations + (begin - first_fit), values.data() + block_begin * sizeof(int), (end - begin) * sizeof(int));
+        }
+    }
+}
+
+void const * ResultReader::map_column(std::size_t const block_index, std::size_t const column_index, std::size_t & n_values) const
+{
+    if (block_index >= blocks_.size() || column_index >= header_.n_parameters + 3)
+    {
+        throw std::runtime_error("column index out of range");
+    }
+
+    Block const & block = blocks_[block_index];
+    ResultColumn const & column = block.columns[column_index];
+
+    if (column.encoding != RAW_ENCODING)
+    {
+        throw std::runtime_error("only raw columns can be mapped");
+    }
+
+    n_values = std::size_t(block.n_fits);
+
+    return block.data + column.offset;
+}
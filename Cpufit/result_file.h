@@ -0,0 +1,197 @@
+#ifndef CPUFIT_RESULT_FILE_H_INCLUDED
+#define CPUFIT_RESULT_FILE_H_INCLUDED
+
+#include "executor.h"
+#include "mapped_file.h"
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Cpufit result files store fit results column by column in blocks, which are
+// appended to the file as results arrive. A reader finds the complete blocks
+// of a file which is still being written.
+//
+// file:    ResultFileHeader, the names of the parameters in 32 bytes each,
+//          then the blocks
+// block:   ResultBlockHeader, a ResultColumn for each column, then the data of
+//          each column starting at an 8 byte boundary
+// columns: the parameters in the order of the model, the states, the chi
+//          squares and the numbers of iterations
+//
+// Values are stored in the byte order of the writer. The data of a column is
+// either the raw values, or the difference of each value to the smallest one
+// (BIT_PACKED_ENCODING) or the zigzag encoded difference to the previous
+// value (DELTA_ENCODING) in the bits of the value, packed into 64 bit words
+// with the bit width of the largest one. Differences of REAL values are taken
+// of their bit patterns.
+
+char const result_file_magic[8] = { 'C', 'P', 'U', 'F', 'I', 'T', 'R', 0 };
+std::uint32_t const result_file_version = 1;
+std::uint32_t const result_block_magic = 0x4b4c4246;
+std::size_t const result_parameter_name_size = 32;
+
+struct ResultFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::int32_t model_id;
+    std::uint32_t n_parameters;
+    // of the REAL columns
+    std::uint32_t real_size;
+    // including the parameter names
+    std::uint64_t size;
+};
+
+struct ResultBlockHeader
+{
+    std::uint32_t magic;
+    std::uint32_t n_columns;
+    std::uint64_t first_fit;
+    std::uint64_t n_fits;
+    // including the headers
+    std::uint64_t size;
+};
+
+struct ResultColumn
+{
+    std::uint8_t encoding;
+    std::uint8_t bit_width;
+    std::uint16_t value_size;
+    std::uint32_t reserved;
+    // the smallest value or the first value
+    std::uint64_t reference;
+    // from the beginning of the block
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// appends blocks of results to a new result file; the blocks are encoded and
+// written by a job of the executor, so that writing overlaps fitting without
+// a thread of its own
+class ResultWriter
+{
+public:
+    // one encoding per column, or none for raw columns
+    ResultWriter(char const * path, ModelID model_id, int const * column_encodings);
+
+    // closes the file without reporting errors
+    virtual ~ResultWriter();
+
+    // copies the results of a number of fits, which are the next ones of the
+    // file, and waits only if the writing job is behind by several blocks;
+    // rethrows a write error of an earlier block
+    void write(
+        std::size_t n_fits,
+        REAL const * parameters,
+        int const * states,
+        REAL const * chi_squares,
+        int const * n_iterations);
+
+    // writes the remaining blocks
+    void close();
+
+private:
+    ResultWriter(ResultWriter const &);
+    ResultWriter & operator=(ResultWriter const &);
+
+    static std::size_t const max_n_queued_blocks = 4;
+
+    struct Block
+    {
+        std::uint64_t first_fit;
+        std::size_t n_fits;
+        std::vector<REAL> parameters;
+        std::vector<int> states;
+        std::vector<REAL> chi_squares;
+        std::vector<int> n_iterations;
+    };
+
+    void write_blocks();
+    void write_block(Block const & block);
+
+    std::size_t const n_parameters_;
+    std::vector<int> column_encodings_;
+
+    std::FILE * file_;
+    std::string const path_;
+    std::uint64_t n_fits_;
+
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<Block> queue_;
+
+    // a job writes the queued blocks and ends when the queue is empty
+    bool writing_;
+    bool closing_;
+    std::exception_ptr error_;
+
+    std::shared_ptr<Executor> const executor_;
+};
+
+// maps a result file and decodes its columns
+class ResultReader
+{
+public:
+    explicit ResultReader(char const * path);
+    virtual ~ResultReader() {}
+
+    int model_id() const { return header_.model_id; }
+    std::size_t n_parameters() const { return header_.n_parameters; }
+    std::size_t n_fits() const { return n_fits_; }
+    std::size_t n_blocks() const { return blocks_.size(); }
+    std::string const & parameter_name(std::size_t const parameter_index) const;
+
+    // results of fits first_fit ... first_fit + n_fits - 1; null outputs are
+    // skipped
+    void read(
+        std::size_t first_fit,
+        std::size_t n_fits,
+        REAL * parameters,
+        int * states,
+        REAL * chi_squares,
+        int * n_iterations) const;
+
+    // the data of a raw column in the mapped file, without copying
+    void const * map_column(std::size_t block_index, std::size_t column_index, std::size_t & n_values) const;
+
+private:
+    struct Block
+    {
+        char const * data;
+        std::uint64_t first_fit;
+        std::uint64_t n_fits;
+        std::vector<ResultColumn> columns;
+    };
+
+    void decode_column(Block const & block, std::size_t const column_index, std::vector<char> & values) const;
+
+    MappedFile file_;
+    std::unique_ptr<MappedFile::Window> mapping_;
+    ResultFileHeader header_;
+    std::vector<std::string> parameter_names_;
+    std::vector<Block> blocks_;
+    std::size_t n_fits_;
+};
+
+// the handles of the C interface
+struct cpufit_result_writer : ResultWriter
+{
+    using ResultWriter::ResultWriter;
+};
+
+struct cpufit_result_reader : ResultReader
+{
+    using ResultReader::ResultReader;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "result_key.h"
+
+#include <cstring>
+
+namespace
+{
+    // the 64 bit hash function XXH64
+    std::uint64_t const prime_1 = 0x9e3779b185ebca87ull;
+    std::uint64_t const prime_2 = 0xc2b2ae3d27d4eb4full;
+    std::uint64_t const prime_3 = 0x165667b19e3779f9ull;
+    std::uint64_t const prime_4 = 0x85ebca77c2b2ae63ull;
+    std::uint64_t const prime_5 = 0x27d4eb2f165667c5ull;
+
+    std::uint64_t rotate_left(std::uint64_t const value, int const bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    std::uint64_t load_64(unsigned char const * const bytes)
+    {
+        std::uint64_t value;
+        std::memcpy(&value, bytes, 8);
+        return value;
+    }
+
+    std::uint64_t hash_round(std::uint64_t accumulator, std::uint64_t const input)
+    {
+        accumulator += input * prime_2;
+        return rotate_left(accumulator, 31) * prime_1;
+    }
+
+    std::uint64_t merge_round(std::uint64_t accumulator, std::uint64_t const value)
+    {
+        accumulator ^= hash_round(0, value);
+        return accumulator * prime_1 + prime_4;
+    }
+
+    std::uint64_t hash_bytes(void const * const data, std::size_t const size, std::uint64_t const seed)
+    {
+        unsigned char const * bytes = static_cast<unsigned char const *>(data);
+        unsigned char const * const end = bytes + size;
+        std::uint64_t hash;
+
+        if (size >= 32)
+        {
+            std::uint64_t lanes[4] = { seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1 };
+
+            for (; end - bytes >= 32; bytes += 32)
+            {
+                for (int i = 0; i < 4; i++)
+                    lanes[i] = hash_round(lanes[i], load_64(bytes + 8 * i));
+            }
+
+            hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7)
+                + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+
+            for (int i = 0; i < 4; i++)
+                hash = merge_round(hash, lanes[i]);
+        }
+        else
+        {
+            hash = seed + prime_5;
+        }
+
+        hash += size;
+
+        for (; end - bytes >= 8; bytes += 8)
+        {
+            hash ^= hash_round(0, load_64(bytes));
+            hash = rotate_left(hash, 27) * prime_1 + prime_4;
+        }
+
+        if (end - bytes >= 4)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, bytes, 4);
+            hash ^= value * prime_1;
+            hash = rotate_left(hash, 23) * prime_2 + prime_3;
+            bytes += 4;
+        }
+
+        for (; bytes != end; bytes++)
+        {
+            hash ^= *bytes * prime_5;
+            hash = rotate_left(hash, 11) * prime_1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= prime_2;
+        hash ^= hash >> 29;
+        hash *= prime_3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+}
+
+ResultKeyBuilder::ResultKeyBuilder()
+{
+}
+
+void ResultKeyBuilder::add(void const * const data, std::size_t const size)
+{
+    // a missing array differs from an empty one
+    hashes_.push_back(data ? size : ~std::uint64_t(0));
+    hashes_.push_back(hash_bytes(data, data ? size : 0, 0));
+    hashes_.push_back(hash_bytes(data, data ? size : 0, prime_3));
+}
+
+ResultKey ResultKeyBuilder::key() const
+{
+    std::size_t const size = hashes_.size() * sizeof(std::uint64_t);
+    ResultKey const key = { { hash_bytes(hashes_.data(), size, 0), hash_bytes(hashes_.data(), size, prime_3) } };
+
+    return key;
+}
@@ -0,0 +1,35 @@
+#ifndef CPUFIT_RESULT_KEY_H_INCLUDED
+#define CPUFIT_RESULT_KEY_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 128 bits of the hash of the inputs of a fit call, naming its results in the
+// result cache and identifying the batch of a fit journal
+struct ResultKey
+{
+    std::uint64_t hash[2];
+};
+
+// hashes the inputs of a call one array at a time
+class ResultKeyBuilder
+{
+public:
+    ResultKeyBuilder();
+
+    void add(void const * const data, std::size_t const size);
+
+    template<typename T>
+    void add_value(T const value)
+    {
+        add(&value, sizeof(value));
+    }
+
+    ResultKey key() const;
+
+private:
+    std::vector<std::uint64_t> hashes_;
+};
+
+#endif
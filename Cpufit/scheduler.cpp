@@ -0,0 +1,241 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local int thread_priority_class = NORMAL_PRIORITY;
+    thread_local double thread_weight = 1;
+
+    double get_seconds(Scheduler::clock::duration const duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+}
+
+// a new job starts at the virtual time of its class, so that it neither
+// overtakes nor waits for the jobs of the class already running
+Scheduler::Job::Job(
+    Scheduler & scheduler,
+    Executor const * const executor,
+    int const priority_class,
+    double const weight) :
+    scheduler_(scheduler),
+    executor_(executor),
+    priority_class_(priority_class),
+    weight_(weight),
+    virtual_time_(0),
+    request_index_(0),
+    running_(false),
+    next_waiting_job_(0),
+    next_running_job_(0)
+{
+    std::lock_guard<std::mutex> lock(scheduler_.mutex_);
+
+    virtual_time_ = scheduler_.virtual_times_[priority_class_];
+    scheduler_.statistics_[priority_class_].n_batches++;
+}
+
+Scheduler::Job::~Job()
+{
+    scheduler_.release_executor(*this);
+}
+
+void Scheduler::Job::release()
+{
+    scheduler_.release_executor(*this);
+}
+
+Scheduler::Turn::Turn(Job & job) :
+    job_(job)
+{
+    job_.scheduler_.start_chunk(job_);
+}
+
+Scheduler::Turn::~Turn()
+{
+    job_.scheduler_.finish_chunk(job_);
+}
+
+Scheduler::Scheduler() :
+    running_jobs_(0),
+    waiting_jobs_(0),
+    n_requests_(0)
+{
+    std::fill(virtual_times_, virtual_times_ + n_priority_classes, 0.);
+    reset_statistics();
+}
+
+// waiting and running jobs are kept in intrusive lists, so that taking a turn
+// never allocates memory
+void Scheduler::start_chunk(Job & job)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    clock::time_point const request_time = clock::now();
+    job.request_index_ = n_requests_++;
+
+    if (!job.executor_)
+    {
+        job.turn_start_ = request_time;
+        return;
+    }
+
+    if (job.running_)
+    {
+        Job const * const next_job = select_next_job(job.executor_);
+
+        if (next_job && goes_before(*next_job, job))
+            remove_running_job(job);
+    }
+
+    if (!job.running_ && (executor_in_use(job.executor_) || select_next_job(job.executor_)))
+    {
+        job.next_waiting_job_ = waiting_jobs_;
+        waiting_jobs_ = &job;
+
+        turn_finished_.wait(
+            lock,
+            [&] { return !executor_in_use(job.executor_) && select_next_job(job.executor_) == &job; });
+
+        Job ** link = &waiting_jobs_;
+        while (*link != &job)
+            link = &(*link)->next_waiting_job_;
+        *link = job.next_waiting_job_;
+        job.next_waiting_job_ = 0;
+    }
+
+    if (!job.running_)
+    {
+        job.running_ = true;
+        job.next_running_job_ = running_jobs_;
+        running_jobs_ = &job;
+    }
+
+    virtual_times_[job.priority_class_] = job.virtual_time_;
+
+    job.turn_start_ = clock::now();
+    statistics_[job.priority_class_].queueing_time += get_seconds(job.turn_start_ - request_time);
+}
+
+void Scheduler::finish_chunk(Job & job)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    double const service_time = get_seconds(clock::now() - job.turn_start_);
+
+    job.virtual_time_ += service_time / job.weight_;
+
+    Statistics & statistics = statistics_[job.priority_class_];
+    statistics.n_chunks++;
+    statistics.service_time += service_time;
+}
+
+void Scheduler::release_executor(Job & job)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (job.running_)
+        remove_running_job(job);
+}
+
+// lets the jobs waiting for the executor of the job take their turn; called
+// with the mutex locked
+void Scheduler::remove_running_job(Job & job)
+{
+    Job ** link = &running_jobs_;
+    while (*link != &job)
+        link = &(*link)->next_running_job_;
+    *link = job.next_running_job_;
+    job.next_running_job_ = 0;
+    job.running_ = false;
+
+    if (waiting_jobs_)
+        turn_finished_.notify_all();
+}
+
+// jobs of a higher priority class go first, then jobs with a lower virtual
+// time, then earlier requests
+bool Scheduler::goes_before(Job const & job_a, Job const & job_b)
+{
+    if (job_a.priority_class_ != job_b.priority_class_)
+        return job_a.priority_class_ < job_b.priority_class_;
+
+    if (job_a.virtual_time_ != job_b.virtual_time_)
+        return job_a.virtual_time_ < job_b.virtual_time_;
+
+    return job_a.request_index_ < job_b.request_index_;
+}
+
+// the next of the jobs waiting for an executor
+Scheduler::Job * Scheduler::select_next_job(Executor const * const executor) const
+{
+    Job * next_job = 0;
+
+    for (Job * job = waiting_jobs_; job; job = job->next_waiting_job_)
+    {
+        if (job->executor_ == executor && (!next_job || goes_before(*job, *next_job)))
+            next_job = job;
+    }
+
+    return next_job;
+}
+
+bool Scheduler::executor_in_use(Executor const * const executor) const
+{
+    for (Job const * job = running_jobs_; job; job = job->next_running_job_)
+    {
+        if (job->executor_ == executor)
+            return true;
+    }
+
+    return false;
+}
+
+void Scheduler::get_statistics(
+    int const priority_class,
+    std::size_t & n_batches,
+    std::size_t & n_chunks,
+    double & queueing_time,
+    double & service_time) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Statistics const & statistics = statistics_[priority_class];
+
+    n_batches = statistics.n_batches;
+    n_chunks = statistics.n_chunks;
+    queueing_time = statistics.queueing_time;
+    service_time = statistics.service_time;
+}
+
+void Scheduler::reset_statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (Statistics & statistics : statistics_)
+        statistics = Statistics();
+}
+
+Scheduler & get_scheduler()
+{
+    static Scheduler scheduler;
+
+    return scheduler;
+}
+
+void set_thread_scheduling(int const priority_class, double const weight)
+{
+    thread_priority_class = priority_class;
+    thread_weight = weight;
+}
+
+int get_thread_priority_class()
+{
+    return thread_priority_class;
+}
+
+double get_thread_weight()
+{
+    return thread_weight;
+}
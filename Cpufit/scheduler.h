@@ -0,0 +1,122 @@
+#ifndef CPUFIT_SCHEDULER_H_INCLUDED
+#define CPUFIT_SCHEDULER_H_INCLUDED
+
+#include "../Gpufit/constants.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+class Executor;
+
+// grants each executor to one batch of fits at a time, chunk by chunk; batches
+// of a higher priority class go first, batches of the same class share the
+// executor in proportion to their weights
+class Scheduler
+{
+public:
+    static int const n_priority_classes = LOW_PRIORITY + 1;
+
+    typedef std::chrono::steady_clock clock;
+
+    // a job without an executor runs on the calling thread only and never
+    // waits for a turn
+    class Job
+    {
+    public:
+        Job(
+            Scheduler & scheduler,
+            Executor const * const executor,
+            int const priority_class,
+            double const weight);
+        ~Job();
+
+        // gives up the executor until the next turn, e.g. before calling
+        // back the host application
+        void release();
+
+    private:
+        Job(Job const &);
+        Job & operator=(Job const &);
+
+        friend class Scheduler;
+
+        Scheduler & scheduler_;
+        Executor const * const executor_;
+        int const priority_class_;
+        double const weight_;
+
+        // service time divided by the weight, compared between jobs of the
+        // same class
+        double virtual_time_;
+        std::uint64_t request_index_;
+        clock::time_point turn_start_;
+        bool running_;
+        Job * next_waiting_job_;
+        Job * next_running_job_;
+    };
+
+    // the job runs its next chunk while a turn is in scope; between its
+    // chunks, a job keeps the executor unless a waiting job goes before it
+    class Turn
+    {
+    public:
+        explicit Turn(Job & job);
+        ~Turn();
+
+    private:
+        Turn(Turn const &);
+        Turn & operator=(Turn const &);
+
+        Job & job_;
+    };
+
+    Scheduler();
+
+    void get_statistics(
+        int const priority_class,
+        std::size_t & n_batches,
+        std::size_t & n_chunks,
+        double & queueing_time,
+        double & service_time) const;
+
+    void reset_statistics();
+
+private:
+    struct Statistics
+    {
+        std::size_t n_batches;
+        std::size_t n_chunks;
+        double queueing_time;
+        double service_time;
+    };
+
+    void start_chunk(Job & job);
+    void finish_chunk(Job & job);
+    void release_executor(Job & job);
+    void remove_running_job(Job & job);
+    static bool goes_before(Job const & job_a, Job const & job_b);
+    Job * select_next_job(Executor const * const executor) const;
+    bool executor_in_use(Executor const * const executor) const;
+
+    mutable std::mutex mutex_;
+    std::condition_variable turn_finished_;
+
+    Job * running_jobs_;
+    Job * waiting_jobs_;
+    std::uint64_t n_requests_;
+
+    double virtual_times_[n_priority_classes];
+    Statistics statistics_[n_priority_classes];
+};
+
+Scheduler & get_scheduler();
+
+// the priority class and weight of the batches started by the calling thread
+void set_thread_scheduling(int const priority_class, double const weight);
+int get_thread_priority_class();
+double get_thread_weight();
+
+#endif
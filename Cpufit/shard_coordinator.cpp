@@ -0,0 +1,359 @@
+#include "shard_coordinator.h"
+#include "model_parameters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char ** environ;
+
+// the file descriptors of the socket and the shared memory in a worker
+static int const worker_socket = 3;
+static int const worker_memory = 4;
+
+static std::runtime_error system_error(std::string const & what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+static std::string find_executable(std::string const & name)
+{
+    if (name.find('/') != std::string::npos)
+        return name;
+
+    char const * const path = std::getenv("PATH");
+    std::string directories = path ? path : "";
+
+    for (std::size_t begin = 0; begin <= directories.size();)
+    {
+        std::size_t end = directories.find(':', begin);
+        if (end == std::string::npos)
+            end = directories.size();
+
+        std::string const directory = directories.substr(begin, end - begin);
+        std::string const file = (directory.empty() ? "." : directory) + "/" + name;
+
+        if (access(file.c_str(), X_OK) == 0)
+            return file;
+
+        begin = end + 1;
+    }
+
+    throw std::runtime_error("worker executable " + name + " not found");
+}
+
+static std::string describe_exit(int const status)
+{
+    if (WIFEXITED(status))
+        return "exited with status " + std::to_string(WEXITSTATUS(status));
+
+    if (WIFSIGNALED(status))
+        return "was killed by signal " + std::to_string(WTERMSIG(status));
+
+    return "failed";
+}
+
+ShardCoordinator::ShardCoordinator(
+    std::size_t const n_workers,
+    char const * const worker_path,
+    REAL const * const data,
+    REAL const * const weights,
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    int const model_id,
+    REAL const * const initial_parameters,
+    REAL const tolerance,
+    int const max_n_iterations,
+    int const * const parameters_to_fit,
+    int const estimator_id,
+    char const * const user_info,
+    std::size_t const user_info_size)
+    :
+    n_workers_(n_workers ? n_workers : std::max(1u, std::thread::hardware_concurrency())),
+    worker_path_(find_executable(worker_path ? worker_path : "cpufit_worker")),
+    header_(),
+    n_finished_shards_(0)
+{
+    header_.magic = shard_magic;
+    header_.real_size = sizeof(REAL);
+    header_.n_fits = n_fits;
+    header_.n_points = n_points;
+    header_.n_parameters = get_number_of_parameters(static_cast<ModelID>(model_id));
+    header_.user_info_size = user_info ? user_info_size : 0;
+    header_.model_id = model_id;
+    header_.estimator_id = estimator_id;
+    header_.max_n_iterations = max_n_iterations;
+    header_.has_weights = weights ? 1 : 0;
+    header_.tolerance = tolerance;
+
+    set_shard_layout(header_);
+
+    memory_.reset(new SharedMemory(header_.size));
+
+    copy_inputs(data, weights, initial_parameters, parameters_to_fit, user_info);
+    create_shards();
+    set_environment();
+}
+
+ShardCoordinator::~ShardCoordinator()
+{
+    for (std::size_t i = 0; i < workers_.size(); i++)
+        stop_worker(workers_[i]);
+}
+
+void ShardCoordinator::copy_inputs(
+    REAL const * const data,
+    REAL const * const weights,
+    REAL const * const initial_parameters,
+    int const * const parameters_to_fit,
+    char const * const user_info)
+{
+    char * const memory = static_cast<char *>(memory_->data());
+    ShardHeader const & h = header_;
+
+    std::memcpy(memory, &h, sizeof(h));
+    std::memcpy(memory + h.data, data, h.n_fits * h.n_points * sizeof(REAL));
+    std::memcpy(memory + h.initial_parameters, initial_parameters, h.n_fits * h.n_parameters * sizeof(REAL));
+    std::memcpy(memory + h.parameters_to_fit, parameters_to_fit, h.n_parameters * sizeof(int));
+
+    if (weights)
+        std::memcpy(memory + h.weights, weights, h.n_fits * h.n_points * sizeof(REAL));
+
+    if (h.user_info_size)
+        std::memcpy(memory + h.user_info, user_info, h.user_info_size);
+}
+
+// a few shards per worker balance the load if fits take different times
+void ShardCoordinator::create_shards()
+{
+    std::size_t const n_shards = std::min(std::size_t(header_.n_fits), n_workers_ * n_shards_per_worker);
+
+    for (std::size_t shard_index = 0; shard_index < n_shards; shard_index++)
+    {
+        std::uint64_t const first_fit = shard_index * header_.n_fits / n_shards;
+        std::uint64_t const end_fit = (shard_index + 1) * header_.n_fits / n_shards;
+
+        Shard const shard = { first_fit, end_fit - first_fit, 0 };
+        shards_.push_back(shard);
+        pending_shards_.push_back(shard_index);
+    }
+}
+
+// the workers share the hardware threads unless CPUFIT_N_THREADS is set
+void ShardCoordinator::set_environment()
+{
+    bool n_threads_set = false;
+
+    for (char ** variable = environ; *variable; variable++)
+    {
+        environment_.push_back(*variable);
+
+        if (environment_.back().compare(0, 17, "CPUFIT_N_THREADS=") == 0)
+            n_threads_set = true;
+    }
+
+    if (!n_threads_set)
+    {
+        std::size_t const n_threads
+            = std::max(std::size_t(1), std::thread::hardware_concurrency() / n_workers_);
+
+        environment_.push_back("CPUFIT_N_THREADS=" + std::to_string(n_threads));
+    }
+
+    for (std::size_t i = 0; i < environment_.size(); i++)
+        environment_pointers_.push_back(&environment_[i][0]);
+
+    environment_pointers_.push_back(0);
+}
+
+void ShardCoordinator::start_worker()
+{
+    int sockets[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+    {
+        throw system_error("cannot create worker socket");
+    }
+
+    fcntl(sockets[0], F_SETFD, FD_CLOEXEC);
+
+    // above the file descriptors the worker gets, so that moving one into
+    // place cannot overwrite the other
+    int const socket = fcntl(sockets[1], F_DUPFD_CLOEXEC, 10);
+    int const memory = fcntl(memory_->file_descriptor(), F_DUPFD_CLOEXEC, 10);
+    close(sockets[1]);
+
+    std::string socket_argument = std::to_string(worker_socket);
+    std::string memory_argument = std::to_string(worker_memory);
+    char * const arguments[] = { &worker_path_[0], &socket_argument[0], &memory_argument[0], 0 };
+
+    pid_t const pid = socket < 0 || memory < 0 ? -1 : fork();
+
+    if (pid == 0)
+    {
+        // only async-signal-safe calls between fork and exec
+        dup2(socket, worker_socket);
+        dup2(memory, worker_memory);
+        execve(worker_path_.c_str(), arguments, environment_pointers_.data());
+        _exit(127);
+    }
+
+    int const error = errno;
+    close(socket);
+    close(memory);
+
+    if (pid < 0)
+    {
+        close(sockets[0]);
+        errno = error;
+        throw system_error("cannot start worker process");
+    }
+
+    Worker const worker = { pid, sockets[0], no_shard };
+    workers_.push_back(worker);
+}
+
+// a failed send shows as a failed reply
+void ShardCoordinator::assign_shard(std::size_t const worker_index)
+{
+    Worker & worker = workers_[worker_index];
+
+    worker.shard_index = pending_shards_.front();
+    pending_shards_.pop_front();
+
+    Shard & shard = shards_[worker.shard_index];
+    shard.n_attempts++;
+
+    ShardRequest const request = { shard.first_fit, shard.n_fits };
+    send_message(worker.socket, &request, sizeof(request));
+}
+
+void ShardCoordinator::finish_shard(std::size_t const worker_index)
+{
+    Worker & worker = workers_[worker_index];
+    ShardReply reply;
+
+    if (!receive_message(worker.socket, &reply, sizeof(reply))
+        || reply.first_fit != shards_[worker.shard_index].first_fit)
+    {
+        fail_worker(worker_index);
+        return;
+    }
+
+    // errors in the input fail in every worker alike and are not retried
+    if (reply.status != ReturnState::OK)
+    {
+        reply.error[sizeof(reply.error) - 1] = 0;
+        throw std::runtime_error(reply.error);
+    }
+
+    worker.shard_index = no_shard;
+    n_finished_shards_++;
+}
+
+void ShardCoordinator::fail_worker(std::size_t const worker_index)
+{
+    Worker const worker = workers_[worker_index];
+    workers_.erase(workers_.begin() + worker_index);
+
+    std::string const reason = stop_worker(worker);
+    Shard const & shard = shards_[worker.shard_index];
+
+    if (shard.n_attempts >= max_n_attempts)
+    {
+        throw std::runtime_error(
+            "fits " + std::to_string(shard.first_fit)
+            + " to " + std::to_string(shard.first_fit + shard.n_fits - 1)
+            + " failed in " + std::to_string(shard.n_attempts)
+            + " worker processes, the last one " + reason);
+    }
+
+    pending_shards_.push_front(worker.shard_index);
+}
+
+std::string ShardCoordinator::stop_worker(Worker const & worker)
+{
+    close(worker.socket);
+    kill(worker.pid, SIGKILL);
+
+    int status = 0;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR);
+
+    return describe_exit(status);
+}
+
+void ShardCoordinator::run(
+    REAL * const output_parameters,
+    int * const output_states,
+    REAL * const output_chi_squares,
+    int * const output_n_iterations)
+{
+    while (n_finished_shards_ < shards_.size())
+    {
+        // replaces failed workers, but starts no more workers than there are
+        // shards left
+        while (workers_.size() < std::min(n_workers_, shards_.size() - n_finished_shards_))
+            start_worker();
+
+        for (std::size_t i = 0; i < workers_.size() && !pending_shards_.empty(); i++)
+        {
+            if (workers_[i].shard_index == no_shard)
+                assign_shard(i);
+        }
+
+        std::vector<pollfd> sockets;
+        std::vector<std::size_t> worker_indices;
+
+        for (std::size_t i = 0; i < workers_.size(); i++)
+        {
+            if (workers_[i].shard_index == no_shard)
+                continue;
+
+            pollfd const socket = { workers_[i].socket, POLLIN, 0 };
+            sockets.push_back(socket);
+            worker_indices.push_back(i);
+        }
+
+        if (poll(sockets.data(), sockets.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            throw system_error("cannot wait for worker processes");
+        }
+
+        // backwards, because a failed worker is removed
+        for (std::size_t i = sockets.size(); i-- > 0;)
+        {
+            if (sockets[i].revents)
+                finish_shard(worker_indices[i]);
+        }
+    }
+
+    // the workers exit when their socket is closed
+    for (std::size_t i = 0; i < workers_.size(); i++)
+    {
+        close(workers_[i].socket);
+        while (waitpid(workers_[i].pid, 0, 0) < 0 && errno == EINTR);
+    }
+
+    workers_.clear();
+
+    char const * const memory = static_cast<char const *>(memory_->data());
+    ShardHeader const & h = header_;
+
+    std::memcpy(output_parameters, memory + h.output_parameters, h.n_fits * h.n_parameters * sizeof(REAL));
+    std::memcpy(output_states, memory + h.output_states, h.n_fits * sizeof(int));
+    std::memcpy(output_chi_squares, memory + h.output_chi_squares, h.n_fits * sizeof(REAL));
+    std::memcpy(output_n_iterations, memory + h.output_n_iterations, h.n_fits * sizeof(int));
+}
@@ -0,0 +1,102 @@
+#ifndef CPUFIT_SHARD_COORDINATOR_H_INCLUDED
+#define CPUFIT_SHARD_COORDINATOR_H_INCLUDED
+
+#include "shard_protocol.h"
+#include "shared_memory.h"
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+// fits a batch in local worker processes; the batch is split into shards
+// which are handed out to idle workers, and the shards of a worker which
+// dies are retried in a new worker
+class ShardCoordinator
+{
+public:
+    // 0 workers start one per hardware thread; a worker path without a slash
+    // is searched in PATH
+    ShardCoordinator(
+        std::size_t n_workers,
+        char const * worker_path,
+        REAL const * data,
+        REAL const * weights,
+        std::size_t n_fits,
+        std::size_t n_points,
+        int model_id,
+        REAL const * initial_parameters,
+        REAL tolerance,
+        int max_n_iterations,
+        int const * parameters_to_fit,
+        int estimator_id,
+        char const * user_info,
+        std::size_t user_info_size);
+
+    // kills the workers left over by an error
+    ~ShardCoordinator();
+
+    void run(
+        REAL * output_parameters,
+        int * output_states,
+        REAL * output_chi_squares,
+        int * output_n_iterations);
+
+private:
+    ShardCoordinator(ShardCoordinator const &);
+    ShardCoordinator & operator=(ShardCoordinator const &);
+
+    static std::size_t const n_shards_per_worker = 4;
+    static std::size_t const max_n_attempts = 3;
+
+    struct Shard
+    {
+        std::uint64_t first_fit;
+        std::uint64_t n_fits;
+        std::size_t n_attempts;
+    };
+
+    struct Worker
+    {
+        pid_t pid;
+        int socket;
+        // the shard in progress, or none
+        std::size_t shard_index;
+    };
+
+    static std::size_t const no_shard = std::size_t(-1);
+
+    void copy_inputs(
+        REAL const * data,
+        REAL const * weights,
+        REAL const * initial_parameters,
+        int const * parameters_to_fit,
+        char const * user_info);
+    void create_shards();
+    void set_environment();
+
+    void start_worker();
+    void assign_shard(std::size_t const worker_index);
+    void finish_shard(std::size_t const worker_index);
+    void fail_worker(std::size_t const worker_index);
+    std::string stop_worker(Worker const & worker);
+
+    std::size_t const n_workers_;
+    std::string worker_path_;
+    ShardHeader header_;
+    std::unique_ptr<SharedMemory> memory_;
+
+    std::vector<Shard> shards_;
+    std::deque<std::size_t> pending_shards_;
+    std::size_t n_finished_shards_;
+
+    std::vector<Worker> workers_;
+
+    std::vector<std::string> environment_;
+    std::vector<char *> environment_pointers_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "shard_protocol.h"
+
+#include <cerrno>
+
+#include <sys/socket.h>
+
+// arrays start at cache line boundaries, so that workers writing the results
+// of neighbouring shards share as few cache lines as possible
+static std::uint64_t append_array(std::uint64_t & size, std::uint64_t const array_size)
+{
+    std::uint64_t const alignment = 64;
+    std::uint64_t const offset = (size + alignment - 1) / alignment * alignment;
+
+    size = offset + array_size;
+
+    return offset;
+}
+
+void set_shard_layout(ShardHeader & h)
+{
+    std::uint64_t const n_values = h.n_fits * h.n_points;
+
+    h.size = sizeof(ShardHeader);
+
+    h.data = append_array(h.size, n_values * sizeof(REAL));
+    h.weights = append_array(h.size, h.has_weights ? n_values * sizeof(REAL) : 0);
+    h.initial_parameters = append_array(h.size, h.n_fits * h.n_parameters * sizeof(REAL));
+    h.parameters_to_fit = append_array(h.size, h.n_parameters * sizeof(int));
+    h.user_info = append_array(h.size, h.user_info_size);
+    h.output_parameters = append_array(h.size, h.n_fits * h.n_parameters * sizeof(REAL));
+    h.output_states = append_array(h.size, h.n_fits * sizeof(int));
+    h.output_chi_squares = append_array(h.size, h.n_fits * sizeof(REAL));
+    h.output_n_iterations = append_array(h.size, h.n_fits * sizeof(int));
+}
+
+bool send_message(int const socket, void const * const message, std::size_t const size)
+{
+    char const * const bytes = static_cast<char const *>(message);
+
+    for (std::size_t n_sent = 0; n_sent < size;)
+    {
+        ssize_t const n = send(socket, bytes + n_sent, size - n_sent, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return false;
+
+        n_sent += std::size_t(n);
+    }
+
+    return true;
+}
+
+bool receive_message(int const socket, void * const message, std::size_t const size)
+{
+    char * const bytes = static_cast<char *>(message);
+
+    for (std::size_t n_received = 0; n_received < size;)
+    {
+        ssize_t const n = recv(socket, bytes + n_received, size - n_received, 0);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return false;
+
+        n_received += std::size_t(n);
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef CPUFIT_SHARD_PROTOCOL_H_INCLUDED
+#define CPUFIT_SHARD_PROTOCOL_H_INCLUDED
+
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// the messages between a shard coordinator and its worker processes; the
+// coordinator puts the inputs and outputs of a batch into shared memory,
+// starts the workers with the shared memory and one end of a socket pair
+// each, and sends them shards of the batch to fit
+
+std::uint32_t const shard_magic = 0x48534643;
+
+// at the beginning of the shared memory, followed by the arrays at the given
+// byte offsets
+struct ShardHeader
+{
+    std::uint32_t magic;
+    std::uint32_t real_size;
+
+    std::uint64_t n_fits;
+    std::uint64_t n_points;
+    std::uint64_t n_parameters;
+    std::uint64_t user_info_size;
+
+    std::int32_t model_id;
+    std::int32_t estimator_id;
+    std::int32_t max_n_iterations;
+    std::int32_t has_weights;
+    double tolerance;
+
+    std::uint64_t data;
+    std::uint64_t weights;
+    std::uint64_t initial_parameters;
+    std::uint64_t parameters_to_fit;
+    std::uint64_t user_info;
+    std::uint64_t output_parameters;
+    std::uint64_t output_states;
+    std::uint64_t output_chi_squares;
+    std::uint64_t output_n_iterations;
+
+    // of the whole shared memory
+    std::uint64_t size;
+};
+
+// fits first_fit ... first_fit + n_fits - 1; the worker exits when the
+// coordinator closes its socket
+struct ShardRequest
+{
+    std::uint64_t first_fit;
+    std::uint64_t n_fits;
+};
+
+struct ShardReply
+{
+    std::uint64_t first_fit;
+    std::int32_t status;
+    char error[256];
+};
+
+// sets the array offsets and the size of the shared memory from the sizes in
+// the header
+void set_shard_layout(ShardHeader & header);
+
+// transfer a whole message; false if the other process has gone
+bool send_message(int const socket, void const * const message, std::size_t const size);
+bool receive_message(int const socket, void * const message, std::size_t const size);
+
+#endif
@@ -0,0 +1,123 @@
+#include "shared_memory.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::runtime_error system_error(std::string const & what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+SharedMemory::SharedMemory(std::size_t const size) :
+    file_descriptor_(-1),
+    size_(size),
+    data_(0)
+{
+    static std::atomic<unsigned> n_segments(0);
+
+    std::string const name
+        = "/cpufit-" + std::to_string(getpid()) + "-" + std::to_string(n_segments++);
+
+    file_descriptor_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (file_descriptor_ < 0)
+    {
+        throw system_error("cannot create shared memory");
+    }
+
+    shm_unlink(name.c_str());
+
+    if (ftruncate(file_descriptor_, off_t(size_)) != 0)
+    {
+        close(file_descriptor_);
+        throw system_error("cannot resize shared memory");
+    }
+
+    map();
+}
+
+SharedMemory::SharedMemory(std::size_t const size, char const * const memory_file_name) :
+    file_descriptor_(-1),
+    size_(size),
+    data_(0)
+{
+#ifdef __linux__
+    file_descriptor_ = memfd_create(memory_file_name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    errno = ENOSYS;
+#endif
+
+    if (file_descriptor_ < 0)
+    {
+        throw system_error("cannot create memory file");
+    }
+
+    if (ftruncate(file_descriptor_, off_t(size_)) != 0)
+    {
+        close(file_descriptor_);
+        throw system_error("cannot resize memory file");
+    }
+
+#ifdef __linux__
+    if (fcntl(file_descriptor_, F_ADD_SEALS, F_SEAL_SHRINK) != 0)
+    {
+        close(file_descriptor_);
+        throw system_error("cannot seal memory file");
+    }
+#endif
+
+    map();
+}
+
+SharedMemory::SharedMemory(int const file_descriptor) :
+    file_descriptor_(file_descriptor),
+    size_(0),
+    data_(0)
+{
+    struct stat status;
+
+    if (fstat(file_descriptor_, &status) != 0)
+    {
+        throw system_error("cannot access shared memory");
+    }
+
+    size_ = std::size_t(status.st_size);
+
+    map();
+}
+
+bool SharedMemory::cannot_shrink() const
+{
+#ifdef __linux__
+    int const seals = fcntl(file_descriptor_, F_GET_SEALS);
+
+    return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+    return false;
+#endif
+}
+
+SharedMemory::~SharedMemory()
+{
+    munmap(data_, size_);
+    close(file_descriptor_);
+}
+
+void SharedMemory::map()
+{
+    data_ = mmap(0, size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor_, 0);
+
+    if (data_ == MAP_FAILED)
+    {
+        close(file_descriptor_);
+        throw system_error("cannot map shared memory");
+    }
+}
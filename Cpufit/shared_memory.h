@@ -0,0 +1,47 @@
+#ifndef CPUFIT_SHARED_MEMORY_H_INCLUDED
+#define CPUFIT_SHARED_MEMORY_H_INCLUDED
+
+#include <cstddef>
+
+// a POSIX shared memory segment mapped into the address space; the segment
+// is unlinked right after it is created and lives as long as a process keeps
+// its file descriptor open or the segment mapped
+class SharedMemory
+{
+public:
+    // creates a zeroed segment
+    explicit SharedMemory(std::size_t const size);
+
+    // creates a zeroed memory file instead, which is not limited by the size
+    // of /dev/shm and can be passed to another process over a Unix socket;
+    // the file is sealed against shrinking, so that the other process can
+    // rely on the size it has mapped
+    SharedMemory(std::size_t const size, char const * const memory_file_name);
+
+    // maps the whole segment behind a file descriptor inherited from the
+    // process which created it
+    explicit SharedMemory(int const file_descriptor);
+
+    ~SharedMemory();
+
+    void * data() const { return data_; }
+    std::size_t size() const { return size_; }
+    int file_descriptor() const { return file_descriptor_; }
+
+    // the memory file is sealed against shrinking; a process which maps a
+    // file of another process must not touch it otherwise, as the other
+    // process could truncate it at any time
+    bool cannot_shrink() const;
+
+private:
+    SharedMemory(SharedMemory const &);
+    SharedMemory & operator=(SharedMemory const &);
+
+    void map();
+
+    int file_descriptor_;
+    std::size_t size_;
+    void * data_;
+};
+
+#endif
@@ -0,0 +1,362 @@
+#include "spot_detection.h"
+#include "executor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    Buffer<double> get_gaussian_kernel(double const sigma)
+    {
+        std::size_t const radius = std::size_t(std::ceil(3 * sigma));
+        Buffer<double> kernel(2 * radius + 1);
+        double sum = 0;
+
+        for (std::size_t i = 0; i < kernel.size(); i++)
+        {
+            double const x = double(i) - double(radius);
+            kernel[i] = std::exp(-x * x / (2 * sigma * sigma));
+            sum += kernel[i];
+        }
+
+        for (double & value : kernel)
+            value /= sum;
+
+        return kernel;
+    }
+
+    // reflects an index into 0 ... size - 1, mirroring at the pixel edges
+    std::ptrdiff_t reflect(std::ptrdiff_t index, std::ptrdiff_t const size)
+    {
+        while (index < 0 || index >= size)
+            index = index < 0 ? -index - 1 : 2 * size - index - 1;
+
+        return index;
+    }
+
+    // filters the rows, or the columns, of a region of width x height values
+    // with the kernel
+    void convolve(
+        Buffer<double> const & input,
+        Buffer<double> & output,
+        std::size_t const width,
+        std::size_t const height,
+        bool const columns,
+        Buffer<double> const & kernel)
+    {
+        std::ptrdiff_t const radius = std::ptrdiff_t(kernel.size() / 2);
+        std::ptrdiff_t const length = std::ptrdiff_t(columns ? height : width);
+
+        for (std::size_t y = 0; y < height; y++)
+        {
+            for (std::size_t x = 0; x < width; x++)
+            {
+                std::ptrdiff_t const position = std::ptrdiff_t(columns ? y : x);
+                double sum = 0;
+
+                for (std::ptrdiff_t k = -radius; k <= radius; k++)
+                {
+                    std::size_t const i = std::size_t(reflect(position + k, length));
+                    sum += kernel[std::size_t(k + radius)] * (columns ? input[i * width + x] : input[y * width + i]);
+                }
+
+                output[y * width + x] = sum;
+            }
+        }
+    }
+}
+
+std::size_t const SpotDetector::tile_size;
+
+SpotDetector::SpotDetector(
+    std::size_t const width,
+    std::size_t const height,
+    REAL const sigma,
+    REAL const threshold,
+    std::size_t const roi_size)
+    : width_(width)
+    , height_(height)
+    , sigma_(sigma)
+    , threshold_(threshold)
+    , roi_size_(roi_size)
+{
+    if (!(sigma_ > 0))
+    {
+        throw std::runtime_error("sigma must be positive");
+    }
+
+    if (roi_size_ < 3 || roi_size_ > width_ || roi_size_ > height_)
+    {
+        throw std::runtime_error("the ROI size must be at least 3 and fit into the frames");
+    }
+
+    n_tiles_x_ = (width_ + tile_size - 1) / tile_size;
+    n_tiles_y_ = (height_ + tile_size - 1) / tile_size;
+
+    small_kernel_ = get_gaussian_kernel(sigma_);
+    large_kernel_ = get_gaussian_kernel(2 * sigma_);
+
+    radius_ = roi_size_ / 2;
+    margin_ = large_kernel_.size() / 2 + radius_;
+}
+
+void SpotDetector::detect(std::size_t const n_frames, REAL const * frames, Buffer<Spot> & spots) const
+{
+    std::size_t const n_tiles = n_tiles_x_ * n_tiles_y_;
+    Buffer<Buffer<Spot>> tile_spots(n_frames * n_tiles);
+
+    get_executor()->parallel_for(
+        tile_spots.size(),
+        [&](std::size_t const task_index)
+        {
+            std::size_t const frame_index = task_index / n_tiles;
+
+            detect_tile(
+                frame_index,
+                task_index % n_tiles,
+                frames + frame_index * width_ * height_,
+                tile_spots[task_index]);
+        });
+
+    spots.clear();
+
+    for (Buffer<Spot> const & tile : tile_spots)
+        spots.insert(spots.end(), tile.begin(), tile.end());
+
+    // the tiles of a row of tiles are interleaved row by row
+    std::sort(
+        spots.begin(),
+        spots.end(),
+        [](Spot const & a, Spot const & b)
+        {
+            return a.frame != b.frame ? a.frame < b.frame : a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+}
+
+void SpotDetector::detect_tile(
+    std::size_t const frame_index,
+    std::size_t const tile_index,
+    REAL const * frame,
+    Buffer<Spot> & spots) const
+{
+    std::size_t const tile_x = tile_index % n_tiles_x_ * tile_size;
+    std::size_t const tile_y = tile_index / n_tiles_x_ * tile_size;
+    std::size_t const tile_width = std::min(tile_size, width_ - tile_x);
+    std::size_t const tile_height = std::min(tile_size, height_ - tile_y);
+
+    // the tile with its margin inside the frame; filtered values farther
+    // than the kernel radius from a margin inside the frame are exact
+    std::size_t const region_x = tile_x - std::min(tile_x, margin_);
+    std::size_t const region_y = tile_y - std::min(tile_y, margin_);
+    std::size_t const region_width = std::min(width_, tile_x + tile_width + margin_) - region_x;
+    std::size_t const region_height = std::min(height_, tile_y + tile_height + margin_) - region_y;
+    std::size_t const region_size = region_width * region_height;
+
+    Buffer<double> region(region_size);
+
+    for (std::size_t y = 0; y < region_height; y++)
+    {
+        for (std::size_t x = 0; x < region_width; x++)
+            region[y * region_width + x] = frame[(region_y + y) * width_ + region_x + x];
+    }
+
+    Buffer<double> rows(region_size);
+    Buffer<double> small(region_size);
+    Buffer<double> large(region_size);
+
+    convolve(region, rows, region_width, region_height, false, small_kernel_);
+    convolve(rows, small, region_width, region_height, true, small_kernel_);
+    convolve(region, rows, region_width, region_height, false, large_kernel_);
+    convolve(rows, large, region_width, region_height, true, large_kernel_);
+
+    Buffer<double> & filtered = small;
+
+    for (std::size_t i = 0; i < region_size; i++)
+        filtered[i] -= large[i];
+
+    // the noise of the tile from the median absolute deviation
+    Buffer<double> deviations;
+    deviations.reserve(tile_width * tile_height);
+
+    for (std::size_t y = tile_y - region_y; y < tile_y - region_y + tile_height; y++)
+    {
+        for (std::size_t x = tile_x - region_x; x < tile_x - region_x + tile_width; x++)
+            deviations.push_back(filtered[y * region_width + x]);
+    }
+
+    std::size_t const middle = deviations.size() / 2;
+    std::nth_element(deviations.begin(), deviations.begin() + middle, deviations.end());
+    double const median = deviations[middle];
+
+    for (double & deviation : deviations)
+        deviation = std::abs(deviation - median);
+
+    std::nth_element(deviations.begin(), deviations.begin() + middle, deviations.end());
+    double const noise = 1.4826 * deviations[middle];
+    double const threshold = median + threshold_ * noise;
+
+    std::ptrdiff_t const radius = std::ptrdiff_t(radius_);
+
+    for (std::size_t y = tile_y; y < tile_y + tile_height; y++)
+    {
+        for (std::size_t x = tile_x; x < tile_x + tile_width; x++)
+        {
+            // ROIs must be inside the frame
+            if (x < radius_ || x - radius_ + roi_size_ > width_ || y < radius_ || y - radius_ + roi_size_ > height_)
+                continue;
+
+            std::ptrdiff_t const region_column = std::ptrdiff_t(x - region_x);
+            std::ptrdiff_t const region_row = std::ptrdiff_t(y - region_y);
+            double const value = filtered[region_row * region_width + region_column];
+
+            if (!(value > threshold))
+                continue;
+
+            // maxima on a plateau are taken at their first pixel
+            bool maximum = true;
+
+            for (std::ptrdiff_t dy = -radius; dy <= radius && maximum; dy++)
+            {
+                std::ptrdiff_t const row = region_row + dy;
+
+                if (row < 0 || row >= std::ptrdiff_t(region_height))
+                    continue;
+
+                for (std::ptrdiff_t dx = -radius; dx <= radius; dx++)
+                {
+                    std::ptrdiff_t const column = region_column + dx;
+
+                    if (column < 0 || column >= std::ptrdiff_t(region_width) || (dx == 0 && dy == 0))
+                        continue;
+
+                    double const neighbor = filtered[row * region_width + column];
+                    bool const before = dy < 0 || (dy == 0 && dx < 0);
+
+                    if (neighbor > value || (before && neighbor == value))
+                    {
+                        maximum = false;
+                        break;
+                    }
+                }
+            }
+
+            if (maximum)
+            {
+                Spot const spot = { frame_index, x - radius_, y - radius_ };
+                spots.push_back(spot);
+            }
+        }
+    }
+}
+
+void SpotDetector::extract(REAL const * frames, Spot const & spot, REAL * roi) const
+{
+    REAL const * const frame = frames + spot.frame * width_ * height_;
+
+    for (std::size_t y = 0; y < roi_size_; y++)
+    {
+        std::copy(
+            frame + (spot.y + y) * width_ + spot.x,
+            frame + (spot.y + y) * width_ + spot.x + roi_size_,
+            roi + y * roi_size_);
+    }
+}
+
+void SpotDetector::estimate_parameters(ModelID const model_id, REAL const * roi, REAL * parameters) const
+{
+    std::size_t const n_points = roi_size_ * roi_size_;
+
+    // the background from the border pixels
+    double border_sum = 0;
+    std::size_t n_border_pixels = 0;
+    double maximum = roi[0];
+
+    for (std::size_t y = 0; y < roi_size_; y++)
+    {
+        for (std::size_t x = 0; x < roi_size_; x++)
+        {
+            double const value = roi[y * roi_size_ + x];
+            maximum = std::max(maximum, value);
+
+            if (x == 0 || y == 0 || x == roi_size_ - 1 || y == roi_size_ - 1)
+            {
+                border_sum += value;
+                n_border_pixels++;
+            }
+        }
+    }
+
+    double const offset = border_sum / n_border_pixels;
+
+    // the center and the width from the moments of the signal above the
+    // background
+    double sum = 0;
+    double sum_x = 0;
+    double sum_y = 0;
+
+    for (std::size_t i = 0; i < n_points; i++)
+    {
+        double const signal = std::max(0., roi[i] - offset);
+        sum += signal;
+        sum_x += signal * double(i % roi_size_);
+        sum_y += signal * double(i / roi_size_);
+    }
+
+    double const center = (double(roi_size_) - 1) / 2;
+    double const center_x = sum > 0 ? sum_x / sum : center;
+    double const center_y = sum > 0 ? sum_y / sum : center;
+    double variance_x = 0;
+    double variance_y = 0;
+
+    for (std::size_t i = 0; i < n_points; i++)
+    {
+        double const signal = std::max(0., roi[i] - offset);
+        double const dx = double(i % roi_size_) - center_x;
+        double const dy = double(i / roi_size_) - center_y;
+        variance_x += signal * dx * dx;
+        variance_y += signal * dy * dy;
+    }
+
+    double const max_width = double(roi_size_) / 2;
+    double width_x = sum > 0 ? std::sqrt(variance_x / sum) : double(sigma_);
+    double width_y = sum > 0 ? std::sqrt(variance_y / sum) : double(sigma_);
+    width_x = std::min(std::max(width_x, .5), max_width);
+    width_y = std::min(std::max(width_y, .5), max_width);
+
+    double const amplitude = std::max(maximum - offset, 0.);
+
+    switch (model_id)
+    {
+    case GAUSS_2D:
+        parameters[0] = REAL(amplitude);
+        parameters[1] = REAL(center_x);
+        parameters[2] = REAL(center_y);
+        parameters[3] = REAL(std::sqrt(width_x * width_y));
+        parameters[4] = REAL(offset);
+        break;
+    case GAUSS_2D_ELLIPTIC:
+        parameters[0] = REAL(amplitude);
+        parameters[1] = REAL(center_x);
+        parameters[2] = REAL(center_y);
+        parameters[3] = REAL(width_x);
+        parameters[4] = REAL(width_y);
+        parameters[5] = REAL(offset);
+        break;
+    case SPLINE_2D:
+        parameters[0] = REAL(sum);
+        parameters[1] = REAL(center_x);
+        parameters[2] = REAL(center_y);
+        parameters[3] = REAL(offset);
+        break;
+    case SPLINE_3D:
+        parameters[0] = REAL(sum);
+        parameters[1] = REAL(center_x);
+        parameters[2] = REAL(center_y);
+        parameters[3] = 0;
+        parameters[4] = REAL(offset);
+        break;
+    default:
+        throw std::runtime_error("initial parameters can only be estimated for GAUSS_2D, GAUSS_2D_ELLIPTIC, SPLINE_2D and SPLINE_3D");
+    }
+}
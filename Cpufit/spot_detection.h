@@ -0,0 +1,77 @@
+#ifndef CPUFIT_SPOT_DETECTION_H_INCLUDED
+#define CPUFIT_SPOT_DETECTION_H_INCLUDED
+
+#include "allocator.h"
+#include "../Gpufit/constants.h"
+#include "../Gpufit/definitions.h"
+
+#include <cstddef>
+
+// a detected spot, by the first pixel of its ROI
+struct Spot
+{
+    std::size_t frame;
+    std::size_t x;
+    std::size_t y;
+};
+
+// finds spots of about the size of a PSF in frames and cuts ROIs around them
+//
+// Each frame is filtered with a difference of Gaussians of sigma and 2 sigma,
+// computed with separable kernels. Local maxima within roi_size / 2 pixels
+// are spots if their filtered value exceeds threshold times the noise of the
+// filtered frame, which is estimated from the median absolute deviation in
+// each tile of tile_size x tile_size pixels. Maxima with ROIs extending past
+// the border of a frame are skipped. The tiles of all frames are processed in
+// parallel, each with a margin, so that the result does not depend on the
+// tiling except for the noise estimate.
+class SpotDetector
+{
+public:
+    SpotDetector(
+        std::size_t const width,
+        std::size_t const height,
+        REAL const sigma,
+        REAL const threshold,
+        std::size_t const roi_size);
+
+    // spots in the order of frames, rows and columns
+    void detect(std::size_t const n_frames, REAL const * frames, Buffer<Spot> & spots) const;
+
+    // the roi_size x roi_size pixels of a spot
+    void extract(REAL const * frames, Spot const & spot, REAL * roi) const;
+
+    // initial parameters of GAUSS_2D, GAUSS_2D_ELLIPTIC, SPLINE_2D or
+    // SPLINE_3D fits of a ROI from its moments, in the coordinates of the
+    // ROI; the amplitude of spline models is the integrated signal
+    void estimate_parameters(ModelID const model_id, REAL const * roi, REAL * parameters) const;
+
+private:
+    static std::size_t const tile_size = 128;
+
+    void detect_tile(
+        std::size_t const frame_index,
+        std::size_t const tile_index,
+        REAL const * frame,
+        Buffer<Spot> & spots) const;
+
+    std::size_t const width_;
+    std::size_t const height_;
+    REAL const sigma_;
+    REAL const threshold_;
+    std::size_t const roi_size_;
+
+    std::size_t n_tiles_x_;
+    std::size_t n_tiles_y_;
+    // of the non-maximum suppression
+    std::size_t radius_;
+    // of the filter and the non-maximum suppression
+    std::size_t margin_;
+
+    // the difference of the normalized Gaussian kernels is taken after
+    // filtering with each
+    Buffer<double> small_kernel_;
+    Buffer<double> large_kernel_;
+};
+
+#endif
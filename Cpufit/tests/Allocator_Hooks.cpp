@@ -0,0 +1,356 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "Cpufit/tests/allocation_counting.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+struct Arena
+{
+    std::atomic< std::size_t > n_allocations;
+    std::atomic< std::size_t > n_frees;
+    std::atomic< std::size_t > n_bytes;
+};
+
+void * arena_allocate(std::size_t size, void * context)
+{
+    Arena & arena = *static_cast< Arena * >(context);
+
+    arena.n_allocations++;
+    arena.n_bytes += size;
+
+    return std::malloc(size ? size : 1);
+}
+
+void arena_free(void * pointer, std::size_t size, void * context)
+{
+    Arena & arena = *static_cast< Arena * >(context);
+
+    arena.n_frees++;
+    arena.n_bytes -= size;
+
+    std::free(pointer);
+}
+
+BOOST_AUTO_TEST_CASE( Allocator_Hooks )
+{
+    /*
+    Performs a batch of small GAUSS_2D fits and a single GAUSS_1D fit of
+    100000 points, split into chunks, with 2 threads and allocator hooks.
+    - Checks that no memory is allocated outside the hooks during the fits.
+    - Checks that all memory allocated by the hooks is freed.
+    - Checks that the results equal fits without hooks.
+    */
+
+#ifdef _WIN32
+    _putenv_s("CPUFIT_N_THREADS", "2");
+#else
+    setenv("CPUFIT_N_THREADS", "2", 1);
+#endif
+
+    FitInput batch;
+    batch.n_fits = 20;
+    batch.n_points = 25;
+    batch.n_parameters = 5;
+
+    std::vector< REAL > roi(batch.n_points);
+    for (std::size_t fit_index = 0; fit_index < batch.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+        batch.data.insert(batch.data.end(), roi.begin(), roi.end());
+        batch.initial_parameters.insert(batch.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    batch.model_id = GAUSS_2D;
+    batch.estimator_id = LSE;
+    batch.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    batch.tolerance = 1e-6f;
+    batch.max_n_iterations = 20;
+
+    FitInput large;
+    large.n_fits = 1;
+    large.n_points = 100000;
+    large.n_parameters = 4;
+
+    clean_resize(large.data, large.n_points);
+    generate_gauss_1d(large.data, { 100.f, 50000.f, 8000.f, 10.f });
+
+    large.model_id = GAUSS_1D;
+    large.estimator_id = MLE;
+    large.initial_parameters = { 80.f, 49000.f, 9000.f, 8.f };
+    large.parameters_to_fit = { 1, 1, 1, 1 };
+    large.tolerance = 1e-6f;
+    large.max_n_iterations = 20;
+
+    // the fits without hooks also start the thread pool
+    FitOutput batch_reference;
+    FitOutput large_reference;
+    resize_output(batch, batch_reference);
+    resize_output(large, large_reference);
+    BOOST_CHECK(run_fits(batch, batch_reference) == ReturnState::OK);
+    BOOST_CHECK(run_fits(large, large_reference) == ReturnState::OK);
+
+    Arena arena;
+    arena.n_allocations = 0;
+    arena.n_frees = 0;
+    arena.n_bytes = 0;
+
+    int status = cpufit_set_allocator(arena_allocate, arena_free, &arena);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput batch_output;
+    FitOutput large_output;
+    resize_output(batch, batch_output);
+    resize_output(large, large_output);
+
+    forbid_allocations = true;
+    int const batch_status = run_fits(batch, batch_output);
+    int const large_status = run_fits(large, large_output);
+    forbid_allocations = false;
+
+    BOOST_CHECK(batch_status == ReturnState::OK);
+    BOOST_CHECK(large_status == ReturnState::OK);
+    BOOST_CHECK(n_forbidden_allocations == 0);
+    BOOST_CHECK(arena.n_allocations > 0);
+    BOOST_CHECK(arena.n_allocations == arena.n_frees);
+    BOOST_CHECK(arena.n_bytes == 0);
+
+    BOOST_CHECK(batch_output.parameters == batch_reference.parameters);
+    BOOST_CHECK(large_output.parameters == large_reference.parameters);
+
+    status = cpufit_set_allocator(0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    // allocate and free functions can only be set together
+    status = cpufit_set_allocator(arena_allocate, 0, &arena);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
+
+BOOST_AUTO_TEST_CASE( Allocator_Hooks_Replaced_During_Fits )
+{
+    /*
+    Performs batches of small GAUSS_2D fits with 2 threads while another
+    thread keeps replacing the allocator hooks, alternating between two
+    arenas.
+    - Checks that each arena frees all memory it allocated, i.e. that memory
+      is always freed by the hooks it was allocated by.
+    - Checks that the results equal fits without hooks.
+    */
+
+#ifdef _WIN32
+    _putenv_s("CPUFIT_N_THREADS", "2");
+#else
+    setenv("CPUFIT_N_THREADS", "2", 1);
+#endif
+
+    FitInput batch;
+    batch.n_fits = 2000;
+    batch.n_points = 25;
+    batch.n_parameters = 5;
+
+    std::vector< REAL > roi(batch.n_points);
+    for (std::size_t fit_index = 0; fit_index < batch.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index % 20, 2.1f, 1.9f, .9f, 1.f });
+        batch.data.insert(batch.data.end(), roi.begin(), roi.end());
+        batch.initial_parameters.insert(batch.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    batch.model_id = GAUSS_2D;
+    batch.estimator_id = LSE;
+    batch.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    batch.tolerance = 1e-6f;
+    batch.max_n_iterations = 20;
+
+    FitOutput reference;
+    resize_output(batch, reference);
+    BOOST_CHECK(run_fits(batch, reference) == ReturnState::OK);
+
+    Arena arenas[2];
+    for (Arena & arena : arenas)
+    {
+        arena.n_allocations = 0;
+        arena.n_frees = 0;
+        arena.n_bytes = 0;
+    }
+
+    std::atomic< bool > done(false);
+    std::thread replacing_thread(
+        [&]()
+        {
+            for (std::size_t i = 0; !done; i++)
+                cpufit_set_allocator(arena_allocate, arena_free, &arenas[i % 2]);
+        });
+
+    bool results_equal = true;
+    for (int run = 0; run < 10; run++)
+    {
+        FitOutput output;
+        resize_output(batch, output);
+
+        BOOST_CHECK(run_fits(batch, output) == ReturnState::OK);
+        results_equal = results_equal && output.parameters == reference.parameters;
+    }
+
+    done = true;
+    replacing_thread.join();
+
+    BOOST_CHECK(cpufit_set_allocator(0, 0, 0) == ReturnState::OK);
+
+    BOOST_CHECK(results_equal);
+    BOOST_CHECK(arenas[0].n_allocations + arenas[1].n_allocations > 0);
+
+    for (Arena const & arena : arenas)
+    {
+        BOOST_CHECK(arena.n_allocations == arena.n_frees);
+        BOOST_CHECK(arena.n_bytes == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Allocator_Hooks_Filtered_Fits_And_Spot_Detection )
+{
+    /*
+    Detects the spots of two 200x200 frames with 2 threads, and performs a
+    filtered batch of small GAUSS_2D fits, with allocator hooks.
+    - Checks that no memory is allocated outside the hooks.
+    - Checks that all memory allocated by the hooks is freed.
+    - Checks that the results equal those without hooks.
+    */
+
+#ifdef _WIN32
+    _putenv_s("CPUFIT_N_THREADS", "2");
+#else
+    setenv("CPUFIT_N_THREADS", "2", 1);
+#endif
+
+    std::size_t const width = 200;
+    std::size_t const n_frames = 2;
+    std::vector< REAL > frames(n_frames * width * width, 10.f);
+
+    for (std::size_t frame = 0; frame < n_frames; frame++)
+    {
+        for (std::size_t spot = 0; spot < 5; spot++)
+        {
+            REAL const x0 = 20.f + 35.f * spot + frame;
+            REAL const y0 = 30.f + 30.f * spot;
+
+            for (std::size_t y = 0; y < width; y++)
+            {
+                for (std::size_t x = 0; x < width; x++)
+                {
+                    REAL const r2 = (x - x0) * (x - x0) + (y - y0) * (y - y0);
+                    frames[(frame * width + y) * width + x] += 200.f * std::exp(-r2 / (2 * 1.5f * 1.5f));
+                }
+            }
+        }
+    }
+
+    std::size_t const max_n_spots = 20;
+
+    auto const detect_spots = [&](std::size_t & n_spots, std::vector< std::size_t > & corners)
+    {
+        corners.assign(3 * max_n_spots, 0);
+
+        return cpufit_detect_spots(
+            n_frames, width, width, frames.data(), 1.5f, 5.f, 7, GAUSS_2D, max_n_spots,
+            &n_spots, corners.data(), 0, 0);
+    };
+
+    FitInput batch;
+    batch.n_fits = 20;
+    batch.n_points = 25;
+    batch.n_parameters = 5;
+
+    std::vector< REAL > roi(batch.n_points);
+    for (std::size_t fit_index = 0; fit_index < batch.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+        batch.data.insert(batch.data.end(), roi.begin(), roi.end());
+        batch.initial_parameters.insert(batch.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    batch.model_id = GAUSS_2D;
+    batch.estimator_id = LSE;
+    batch.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    batch.tolerance = 1e-6f;
+    batch.max_n_iterations = 20;
+
+    // fits with amplitudes of at least 20 pass
+    std::vector< REAL > parameter_ranges{ 20.f, 1e6f, -1e6f, 1e6f, -1e6f, 1e6f, -1e6f, 1e6f, -1e6f, 1e6f };
+
+    auto const run_filtered_fits = [&](std::size_t & n_fits, std::vector< std::size_t > & indices, FitOutput & o)
+    {
+        resize_output(batch, o);
+        indices.assign(batch.n_fits, 0);
+
+        return cpufit_filtered(
+            batch.n_fits, batch.n_points, batch.data.data(), 0, batch.model_id,
+            batch.initial_parameters.data(), batch.tolerance, batch.max_n_iterations,
+            batch.parameters_to_fit.data(), batch.estimator_id, 0, 0,
+            1 << FitState::CONVERGED, 1e6f, parameter_ranges.data(),
+            &n_fits, indices.data(), o.parameters.data(), o.states.data(), o.chi_squares.data(),
+            o.n_iterations.data());
+    };
+
+    // the calls without hooks also start the thread pool
+    std::size_t reference_n_spots = 0;
+    std::vector< std::size_t > reference_corners;
+    BOOST_CHECK(detect_spots(reference_n_spots, reference_corners) == ReturnState::OK);
+    BOOST_CHECK(reference_n_spots == 10);
+
+    std::size_t reference_n_fits = 0;
+    std::vector< std::size_t > reference_indices;
+    FitOutput reference_output;
+    BOOST_CHECK(run_filtered_fits(reference_n_fits, reference_indices, reference_output) == ReturnState::OK);
+    BOOST_CHECK(reference_n_fits == 10);
+
+    Arena arena;
+    arena.n_allocations = 0;
+    arena.n_frees = 0;
+    arena.n_bytes = 0;
+
+    BOOST_CHECK(cpufit_set_allocator(arena_allocate, arena_free, &arena) == ReturnState::OK);
+
+    std::size_t n_spots = 0;
+    std::vector< std::size_t > corners(3 * max_n_spots);
+    std::size_t n_fits = 0;
+    std::vector< std::size_t > indices(batch.n_fits);
+    FitOutput output;
+    resize_output(batch, output);
+
+    // the output vectors are sized before allocations are forbidden
+    forbid_allocations = true;
+    int const detect_status = cpufit_detect_spots(
+        n_frames, width, width, frames.data(), 1.5f, 5.f, 7, GAUSS_2D, max_n_spots,
+        &n_spots, corners.data(), 0, 0);
+    int const filtered_status = cpufit_filtered(
+        batch.n_fits, batch.n_points, batch.data.data(), 0, batch.model_id,
+        batch.initial_parameters.data(), batch.tolerance, batch.max_n_iterations,
+        batch.parameters_to_fit.data(), batch.estimator_id, 0, 0,
+        1 << FitState::CONVERGED, 1e6f, parameter_ranges.data(),
+        &n_fits, indices.data(), output.parameters.data(), output.states.data(), output.chi_squares.data(),
+        output.n_iterations.data());
+    forbid_allocations = false;
+
+    BOOST_CHECK(cpufit_set_allocator(0, 0, 0) == ReturnState::OK);
+
+    BOOST_CHECK(detect_status == ReturnState::OK);
+    BOOST_CHECK(filtered_status == ReturnState::OK);
+    BOOST_CHECK(n_forbidden_allocations == 0);
+    BOOST_CHECK(arena.n_allocations > 0);
+    BOOST_CHECK(arena.n_allocations == arena.n_frees);
+    BOOST_CHECK(arena.n_bytes == 0);
+
+    BOOST_CHECK(n_spots == reference_n_spots);
+    BOOST_CHECK(corners == reference_corners);
+    BOOST_CHECK(n_fits == reference_n_fits);
+    BOOST_CHECK(indices == reference_indices);
+    BOOST_CHECK(output.parameters == reference_output.parameters);
+}
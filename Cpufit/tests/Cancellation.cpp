@@ -0,0 +1,206 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// runs the chunks on the calling thread, sleeps after each chunk and cancels
+// the fit call after a number of chunks
+struct ChunkExecutor
+{
+    std::size_t n_chunks;
+    std::size_t n_chunks_before_cancel;
+    int chunk_sleep_time;
+    cpufit_cancellation_token * cancellation_token;
+};
+
+void chunk_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void * executor_context)
+{
+    ChunkExecutor & executor = *static_cast< ChunkExecutor * >(executor_context);
+
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(executor.chunk_sleep_time));
+
+    if (++executor.n_chunks == executor.n_chunks_before_cancel)
+        cpufit_cancel(executor.cancellation_token);
+}
+
+struct ProgressReport
+{
+    std::chrono::steady_clock::time_point time;
+    std::size_t n_finished_fits;
+    std::size_t n_fits;
+};
+
+void record_progress(std::size_t n_finished_fits, std::size_t n_fits, void * progress_context)
+{
+    std::vector< ProgressReport > & reports = *static_cast< std::vector< ProgressReport > * >(progress_context);
+
+    reports.push_back({ std::chrono::steady_clock::now(), n_finished_fits, n_fits });
+}
+
+int run_cancellable_fit(
+    FitInput & i,
+    FitOutput & o,
+    cpufit_cancellation_token * cancellation_token,
+    std::vector< ProgressReport > & reports)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    return cpufit_cancellable
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            0,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            cancellation_token,
+            record_progress,
+            &reports,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Cancellation_Between_Chunks )
+{
+    /*
+    Performs 10 chunks of 256 GAUSS_2D fits on one thread and cancels the
+    call after the third chunk.
+    - Checks that the fits of the first three chunks converged.
+    - Checks that the other fits are cancelled and return their initial
+      parameters.
+    - Checks that the last progress report counts the finished fits.
+    */
+
+    cpufit_cancellation_token * const cancellation_token = cpufit_create_cancellation_token();
+    BOOST_CHECK(cancellation_token);
+
+    ChunkExecutor executor{ 0, 3, 0, cancellation_token };
+    BOOST_CHECK(cpufit_set_executor(chunk_parallel_for, 0, 1, &executor) == ReturnState::OK);
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 10 * 256, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    FitOutput output;
+    std::vector< ProgressReport > reports;
+    int const status = run_cancellable_fit(input, output, cancellation_token, reports);
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(executor.n_chunks == 3);
+
+    std::size_t const n_finished_fits = 3 * 256;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        if (fit_index < n_finished_fits)
+        {
+            BOOST_CHECK(output.states[fit_index] == FitState::CONVERGED);
+        }
+        else
+        {
+            BOOST_CHECK(output.states[fit_index] == FitState::CANCELLED);
+            BOOST_CHECK(output.n_iterations[fit_index] == 0);
+
+            for (std::size_t i = 0; i < input.n_parameters; i++)
+            {
+                std::size_t const index = fit_index * input.n_parameters + i;
+                BOOST_CHECK(output.parameters[index] == input.initial_parameters[index]);
+            }
+        }
+    }
+
+    BOOST_CHECK(!reports.empty());
+    BOOST_CHECK(reports.back().n_finished_fits == n_finished_fits);
+    BOOST_CHECK(reports.back().n_fits == input.n_fits);
+
+    cpufit_set_executor(0, 0, 0, 0);
+    BOOST_CHECK(cpufit_destroy_cancellation_token(cancellation_token) == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( Progress_Reports )
+{
+    /*
+    Performs 10 chunks of 256 GAUSS_2D fits on one thread, each chunk taking
+    at least 30 ms.
+    - Checks that progress reports are at least 100 ms apart, except the last
+      one.
+    - Checks that the reported number of finished fits increases up to the
+      number of fits.
+    */
+
+    ChunkExecutor executor{ 0, 0, 30, 0 };
+    BOOST_CHECK(cpufit_set_executor(chunk_parallel_for, 0, 1, &executor) == ReturnState::OK);
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 10 * 256, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    FitOutput output;
+    std::vector< ProgressReport > reports;
+    int const status = run_cancellable_fit(input, output, 0, reports);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    BOOST_CHECK(reports.size() >= 2);
+    BOOST_CHECK(reports.back().n_finished_fits == input.n_fits);
+
+    for (std::size_t i = 1; i < reports.size(); i++)
+    {
+        BOOST_CHECK(reports[i].n_finished_fits >= reports[i - 1].n_finished_fits);
+
+        if (i + 1 < reports.size())
+            BOOST_CHECK(reports[i].time - reports[i - 1].time >= std::chrono::milliseconds(100));
+    }
+
+    cpufit_set_executor(0, 0, 0, 0);
+}
+
+BOOST_AUTO_TEST_CASE( Cancelled_Before_Start )
+{
+    /*
+    Performs GAUSS_2D fits with a cancellation token cancelled beforehand.
+    - Checks that all fits are cancelled.
+    - Checks that cancelling without a token is rejected.
+    */
+
+    cpufit_cancellation_token * const cancellation_token = cpufit_create_cancellation_token();
+    BOOST_CHECK(cpufit_cancel(cancellation_token) == ReturnState::OK);
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 10, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    FitOutput output;
+    std::vector< ProgressReport > reports;
+    int const status = run_cancellable_fit(input, output, cancellation_token, reports);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+        BOOST_CHECK(output.states[fit_index] == FitState::CANCELLED);
+
+    BOOST_CHECK(output.parameters == input.initial_parameters);
+
+    cpufit_destroy_cancellation_token(cancellation_token);
+
+    BOOST_CHECK(cpufit_cancel(0) == ReturnState::ERROR);
+}
@@ -0,0 +1,639 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// a configuration file and the files it names in a temporary directory
+struct CommandLineFiles
+{
+    CommandLineFiles()
+    {
+        char directory_template[] = "/tmp/cpufit_cli_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(directory_template));
+        directory = directory_template;
+    }
+
+    ~CommandLineFiles()
+    {
+        for (char const * name : { "config", "data", "initial_parameters", "results", "output", "stack.tif", "results.rois" })
+            std::remove(path(name).c_str());
+
+        rmdir(directory.c_str());
+    }
+
+    std::string path(char const * const name) const
+    {
+        return directory + "/" + name;
+    }
+
+    // runs cpufit_cli, which is built next to the test, and keeps what it
+    // prints in the file "output"
+    int run(std::string const & config)
+    {
+        std::ofstream(path("config")) << config;
+
+        std::string const test_path = boost::unit_test::framework::master_test_suite().argv[0];
+        std::size_t const slash = test_path.rfind('/');
+        std::string const cli_path
+            = (slash == std::string::npos ? std::string(".") : test_path.substr(0, slash)) + "/cpufit_cli";
+        std::string const config_path = path("config");
+        std::string const output_path = path("output");
+
+        pid_t const pid = fork();
+        BOOST_REQUIRE(pid >= 0);
+
+        if (pid == 0)
+        {
+            int const output = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            dup2(output, 1);
+            dup2(output, 2);
+            execl(cli_path.c_str(), cli_path.c_str(), config_path.c_str(), (char *)0);
+            _exit(127);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+
+        std::stringstream text;
+        text << std::ifstream(output_path).rdbuf();
+        output = text.str();
+
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    std::string directory;
+    std::string output;
+};
+
+template< typename T > void write_file(std::string const & path, std::vector< T > const & values)
+{
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast< char const * >(values.data()), values.size() * sizeof(T));
+}
+
+// builds a TIFF or BigTIFF file of 16 bit pages in the given byte order;
+// the strips of each page are stored in reverse order with gaps between them
+std::vector< char > make_tiff(
+    std::vector< std::uint16_t > const & samples,
+    std::size_t const width,
+    std::size_t const height,
+    bool const big_tiff,
+    bool const big_endian,
+    std::size_t const rows_per_strip)
+{
+    std::vector< char > file;
+
+    auto put = [&](std::uint64_t const value, std::size_t const size) {
+        for (std::size_t i = 0; i < size; i++)
+            file.push_back(char(value >> 8 * (big_endian ? size - 1 - i : i)));
+    };
+
+    auto patch = [&](std::size_t const offset, std::uint64_t const value, std::size_t const size) {
+        for (std::size_t i = 0; i < size; i++)
+            file[offset + i] = char(value >> 8 * (big_endian ? size - 1 - i : i));
+    };
+
+    std::size_t const offset_size = big_tiff ? 8 : 4;
+
+    file.push_back(big_endian ? 'M' : 'I');
+    file.push_back(big_endian ? 'M' : 'I');
+    put(big_tiff ? 43 : 42, 2);
+
+    if (big_tiff)
+    {
+        put(8, 2);
+        put(0, 2);
+    }
+
+    std::size_t next_ifd_offset_position = file.size();
+    put(0, offset_size);
+
+    std::size_t const n_pages = samples.size() / (width * height);
+    std::size_t const n_strips = (height + rows_per_strip - 1) / rows_per_strip;
+
+    for (std::size_t page = 0; page < n_pages; page++)
+    {
+        std::vector< std::uint64_t > strip_offsets(n_strips);
+        std::vector< std::uint64_t > strip_byte_counts(n_strips);
+
+        for (std::size_t strip = n_strips; strip-- > 0;)
+        {
+            std::size_t const first_row = strip * rows_per_strip;
+            std::size_t const n_rows = std::min(rows_per_strip, height - first_row);
+
+            file.insert(file.end(), 3, char(0xee));
+            strip_offsets[strip] = file.size();
+            strip_byte_counts[strip] = n_rows * width * 2;
+
+            for (std::size_t i = 0; i < n_rows * width; i++)
+                put(samples[(page * height + first_row) * width + i], 2);
+        }
+
+        // arrays of strip offsets and byte counts
+        file.resize((file.size() + 7) / 8 * 8);
+        std::size_t const arrays_offset = file.size();
+
+        for (std::uint64_t const offset : strip_offsets)
+            put(offset, offset_size);
+
+        for (std::uint64_t const count : strip_byte_counts)
+            put(count, offset_size);
+
+        patch(next_ifd_offset_position, file.size(), offset_size);
+
+        std::vector< std::array< std::uint64_t, 4 > > const entries{ {
+            { { 256, 4, 1, width } },
+            { { 257, 4, 1, height } },
+            { { 258, 3, 1, 16 } },
+            { { 259, 3, 1, 1 } },
+            { { 262, 3, 1, 1 } },
+            { { 273, big_tiff ? 16u : 4u, n_strips, n_strips > 1 ? arrays_offset : strip_offsets[0] } },
+            { { 277, 3, 1, 1 } },
+            { { 278, 4, 1, rows_per_strip } },
+            { { 279, big_tiff ? 16u : 4u, n_strips, n_strips > 1 ? arrays_offset + n_strips * offset_size : strip_byte_counts[0] } },
+            { { 339, 3, 1, 1 } } } };
+
+        put(entries.size(), big_tiff ? 8 : 2);
+
+        for (std::array< std::uint64_t, 4 > const & entry : entries)
+        {
+            put(entry[0], 2);
+            put(entry[1], 2);
+            put(entry[2], offset_size);
+
+            // a short value in the entry is left aligned
+            std::size_t const value_size = entry[1] == 3 ? 2 : entry[1] == 4 ? 4 : 8;
+            put(entry[3], value_size);
+            put(0, offset_size - value_size);
+        }
+
+        next_ifd_offset_position = file.size();
+        put(0, offset_size);
+    }
+
+    return file;
+}
+
+void generate_camera_gauss_2d(FitInput & i, std::vector< std::uint16_t > & samples, std::size_t const n_fits)
+{
+    /*
+    Builds GAUSS_2D fits with Poisson noise, as 16 bit camera samples with an
+    offset of 100 and a gain of 2, and the data converted with these values.
+    */
+
+    i.n_fits = n_fits;
+    i.n_points = 25;
+    i.n_parameters = 5;
+
+    std::vector< REAL > roi(i.n_points);
+    std::poisson_distribution< int > noise_generator;
+    std::uniform_real_distribution< REAL > center(1.5f, 2.5f);
+
+    samples.clear();
+    i.data.clear();
+    i.initial_parameters.clear();
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        std::vector< REAL > const true_parameters{ { 200.f, center(rng), center(rng), 1.f, 10.f } };
+        generate_gauss_2d(roi, true_parameters);
+
+        for (REAL const value : roi)
+        {
+            noise_generator = std::poisson_distribution< int >(value);
+            std::uint16_t const sample = std::uint16_t(100 + 2 * noise_generator(rng));
+            samples.push_back(sample);
+            i.data.push_back((REAL(sample) - 100) * REAL(.5));
+        }
+
+        std::vector< REAL > const initial{ { 150.f, 2.f, 2.f, 1.2f, 8.f } };
+        i.initial_parameters.insert(i.initial_parameters.end(), initial.begin(), initial.end());
+    }
+
+    i.model_id = GAUSS_2D;
+    i.estimator_id = MLE;
+    i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    i.tolerance = 1e-5f;
+    i.max_n_iterations = 30;
+    i.user_info_.clear();
+    i.weights_.clear();
+}
+
+void read_result_file(std::string const & path, FitInput const & i, FitOutput & o)
+{
+    cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+    BOOST_REQUIRE(reader);
+
+    int model_id = -1;
+    std::size_t n_parameters = 0;
+    std::size_t n_fits = 0;
+    std::size_t n_blocks = 0;
+
+    BOOST_CHECK(cpufit_get_result_header(reader, &model_id, &n_parameters, &n_fits, &n_blocks) == ReturnState::OK);
+    BOOST_CHECK(model_id == i.model_id);
+    BOOST_CHECK(n_parameters == i.n_parameters);
+    BOOST_REQUIRE(n_fits == i.n_fits);
+
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    BOOST_CHECK(
+        cpufit_read_results(
+            reader,
+            0,
+            n_fits,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()) == ReturnState::OK);
+
+    cpufit_close_result_reader(reader);
+}
+
+BOOST_AUTO_TEST_CASE( Command_Line_Tool_INI )
+{
+    /*
+    Runs cpufit_cli with an INI file on 16 bit camera samples in batches
+    which do not divide the number of fits.
+    - Checks that the results in the result file equal the results of cpufit
+      with the converted data.
+    - Checks that the statistics are printed.
+    */
+
+    FitInput input;
+    std::vector< std::uint16_t > samples;
+    generate_camera_gauss_2d(input, samples, 2000);
+
+    CommandLineFiles files;
+    write_file(files.path("data"), samples);
+
+    int const exit_status = files.run(
+        "; fits camera samples\n"
+        "[input]\n"
+        "data_file = data\n"
+        "data_type = uint16\n"
+        "n_points = 25\n"
+        "camera_offset = 100\n"
+        "gain = 0.5\n"
+        "initial_parameters = 150, 2, 2, 1.2, 8\n"
+        "\n"
+        "[fit]\n"
+        "model = GAUSS_2D\n"
+        "estimator = MLE\n"
+        "tolerance = 1e-5\n"
+        "max_iterations = 30\n"
+        "\n"
+        "[output]\n"
+        "file = " + files.path("results") + "\n"
+        "encodings = raw, raw, raw, raw, raw, bit_packed, raw, bit_packed\n"
+        "\n"
+        "[pipeline]\n"
+        "batch_size = 300\n");
+
+    BOOST_CHECK_MESSAGE(exit_status == 0, files.output);
+    BOOST_CHECK(files.output.find("2000 fits in ") != std::string::npos);
+    BOOST_CHECK(files.output.find("fits/s") != std::string::npos);
+    BOOST_CHECK(files.output.find("fit:") != std::string::npos);
+
+    FitOutput file_output;
+    read_result_file(files.path("results"), input, file_output);
+
+    FitOutput direct_output;
+    clean_resize(direct_output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(direct_output.states, input.n_fits);
+    clean_resize(direct_output.chi_squares, input.n_fits);
+    clean_resize(direct_output.n_iterations, input.n_fits);
+
+    int const status
+        = cpufit
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            direct_output.parameters.data(),
+            direct_output.states.data(),
+            direct_output.chi_squares.data(),
+            direct_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(file_output.parameters == direct_output.parameters);
+    BOOST_CHECK(file_output.states == direct_output.states);
+    BOOST_CHECK(file_output.chi_squares == direct_output.chi_squares);
+    BOOST_CHECK(file_output.n_iterations == direct_output.n_iterations);
+}
+
+BOOST_AUTO_TEST_CASE( Command_Line_Tool_JSON )
+{
+    /*
+    Runs cpufit_cli with a JSON file on REAL samples, with initial parameters
+    from a file and constraints.
+    - Checks that the results in the result file equal the results of
+      cpufit_constrained.
+    */
+
+    FitInput input;
+    std::vector< std::uint16_t > samples;
+    generate_camera_gauss_2d(input, samples, 500);
+    input.estimator_id = LSE;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+        input.initial_parameters[fit_index * input.n_parameters] += REAL(fit_index % 7);
+
+    CommandLineFiles files;
+    write_file(files.path("data"), input.data);
+    write_file(files.path("initial_parameters"), input.initial_parameters);
+
+    std::string const real_type = sizeof(REAL) == 4 ? "float32" : "float64";
+
+    int const exit_status = files.run(
+        "{\n"
+        "    \"input\": {\n"
+        "        \"data_file\": \"data\",\n"
+        "        \"data_type\": \"" + real_type + "\",\n"
+        "        \"n_points\": 25,\n"
+        "        \"n_fits\": 500,\n"
+        "        \"initial_parameters_file\": \"initial_parameters\"\n"
+        "    },\n"
+        "    \"fit\": {\n"
+        "        \"model\": \"GAUSS_2D\",\n"
+        "        \"estimator\": \"LSE\",\n"
+        "        \"tolerance\": 1e-5,\n"
+        "        \"max_iterations\": 30,\n"
+        "        \"parameters_to_fit\": [1, 1, 1, 1, 1],\n"
+        "        \"constraint_types\": [\"LOWER\", \"NONE\", \"NONE\", \"LOWER_UPPER\", \"NONE\"],\n"
+        "        \"constraints\": [0, 0, 0, 0, 0, 0, 0.5, 1.1, 0, 0]\n"
+        "    },\n"
+        "    \"output\": { \"file\": \"results\" },\n"
+        "    \"pipeline\": { \"batch_size\": 64 }\n"
+        "}\n");
+
+    BOOST_CHECK_MESSAGE(exit_status == 0, files.output);
+
+    FitOutput file_output;
+    read_result_file(files.path("results"), input, file_output);
+
+    std::vector< REAL > constraints;
+    std::vector< int > constraint_types{ { LOWER, NONE, NONE, LOWER_UPPER, NONE } };
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        std::vector< REAL > const fit_constraints{ { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, .5f, 1.1f, 0.f, 0.f } };
+        constraints.insert(constraints.end(), fit_constraints.begin(), fit_constraints.end());
+    }
+
+    FitOutput direct_output;
+    clean_resize(direct_output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(direct_output.states, input.n_fits);
+    clean_resize(direct_output.chi_squares, input.n_fits);
+    clean_resize(direct_output.n_iterations, input.n_fits);
+
+    int const status
+        = cpufit_constrained
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            constraints.data(),
+            constraint_types.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            direct_output.parameters.data(),
+            direct_output.states.data(),
+            direct_output.chi_squares.data(),
+            direct_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(file_output.parameters == direct_output.parameters);
+    BOOST_CHECK(file_output.states == direct_output.states);
+    BOOST_CHECK(file_output.n_iterations == direct_output.n_iterations);
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        REAL const width = file_output.parameters[fit_index * input.n_parameters + 3];
+        BOOST_CHECK(width >= .5f && width <= 1.1f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Command_Line_Tool_Errors )
+{
+    /*
+    Runs cpufit_cli with invalid configurations.
+    - Checks the exit status and the error message for a missing setting, an
+      unknown model, a data file of the wrong size and invalid JSON.
+    */
+
+    CommandLineFiles files;
+    write_file(files.path("data"), std::vector< float >(100));
+
+    std::string const input
+        = "[input]\ndata_file = data\ndata_type = float32\nn_points = 25\ninitial_parameters = 1, 1, 1, 1, 1\n";
+    std::string const output = "[output]\nfile = results\n";
+
+    BOOST_CHECK(files.run(input + output) == 1);
+    BOOST_CHECK(files.output.find("missing setting fit.model") != std::string::npos);
+
+    BOOST_CHECK(files.run(input + "[fit]\nmodel = GAUSS_5D\n" + output) == 1);
+    BOOST_CHECK(files.output.find("unknown value GAUSS_5D") != std::string::npos);
+
+    BOOST_CHECK(files.run(input + "n_fits = 5\n[fit]\nmodel = GAUSS_2D\n" + output) == 1);
+    BOOST_CHECK(files.output.find("is smaller than") != std::string::npos);
+
+    BOOST_CHECK(files.run("{ \"input\": { \"data_file\": } }") == 1);
+    BOOST_CHECK(files.output.find("JSON error") != std::string::npos);
+
+    // a whole number of ROIs is fitted
+    BOOST_CHECK_MESSAGE(files.run(input + "[fit]\nmodel = GAUSS_2D\n" + output) == 0, files.output);
+    BOOST_CHECK(files.output.find("4 fits in ") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( Command_Line_Tool_TIFF )
+{
+    /*
+    Runs cpufit_cli on a stack of 16 bit 5x5 pages as raw file, and as TIFF
+    and BigTIFF files in both byte orders with one and several strips per
+    page.
+    - Checks that the results of the TIFF files equal the results of the raw
+      file.
+    - Checks that compressed TIFF files are rejected.
+    */
+
+    FitInput input;
+    std::vector< std::uint16_t > samples;
+    generate_camera_gauss_2d(input, samples, 300);
+
+    CommandLineFiles files;
+    write_file(files.path("data"), samples);
+
+    std::string const settings
+        = "n_points = 25\n"
+        "camera_offset = 100\n"
+        "gain = 0.5\n"
+        "initial_parameters = 150, 2, 2, 1.2, 8\n"
+        "[fit]\n"
+        "model = GAUSS_2D\n"
+        "estimator = MLE\n"
+        "[output]\n"
+        "file = results\n"
+        "[pipeline]\n"
+        "batch_size = 128\n";
+
+    BOOST_REQUIRE(files.run("[input]\ndata_file = data\ndata_type = uint16\n" + settings) == 0);
+
+    FitOutput raw_output;
+    read_result_file(files.path("results"), input, raw_output);
+
+    for (int big_tiff = 0; big_tiff < 2; big_tiff++)
+    {
+        for (int big_endian = 0; big_endian < 2; big_endian++)
+        {
+            for (std::size_t const rows_per_strip : { 5, 2 })
+            {
+                std::vector< char > const tiff = make_tiff(samples, 5, 5, big_tiff, big_endian, rows_per_strip);
+                write_file(files.path("stack.tif"), tiff);
+
+                BOOST_CHECK_MESSAGE(files.run("[input]\ndata_file = stack.tif\n" + settings) == 0, files.output);
+
+                FitOutput tiff_output;
+                read_result_file(files.path("results"), input, tiff_output);
+
+                BOOST_CHECK(tiff_output.parameters == raw_output.parameters);
+                BOOST_CHECK(tiff_output.states == raw_output.states);
+            }
+        }
+    }
+
+    // compression 32773 (PackBits) in the first page
+    std::vector< char > tiff = make_tiff(samples, 5, 5, false, false, 5);
+    std::size_t const first_ifd_offset = std::uint8_t(tiff[4]) | std::uint8_t(tiff[5]) << 8 | std::uint8_t(tiff[6]) << 16;
+    std::size_t const compression_value_offset = first_ifd_offset + 2 + 3 * 12 + 8;
+    tiff[compression_value_offset] = char(0x05);
+    tiff[compression_value_offset + 1] = char(0x80);
+    write_file(files.path("stack.tif"), tiff);
+
+    BOOST_CHECK(files.run("[input]\ndata_file = stack.tif\n" + settings) == 1);
+    BOOST_CHECK(files.output.find("only uncompressed TIFF files are supported") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( Command_Line_Tool_Detection )
+{
+    /*
+    Runs cpufit_cli with spot detection on a TIFF stack of 20 frames of
+    64 x 48 pixels with two spots each, in batches of 6 frames.
+    - Checks that the ROI file holds the frame and the corner of each spot.
+    - Checks that the fitted centers in frame coordinates equal the true
+      centers.
+    */
+
+    std::size_t const n_frames{ 20 };
+    std::size_t const width{ 64 };
+    std::size_t const height{ 48 };
+
+    std::vector< std::uint16_t > samples;
+    std::vector< std::array< REAL, 3 > > spots;
+    std::poisson_distribution< int > noise_generator;
+    std::uniform_real_distribution< REAL > position(-.5f, .5f);
+
+    for (std::size_t frame = 0; frame < n_frames; frame++)
+    {
+        spots.push_back({ { REAL(frame), 15.f + position(rng), 20.f + position(rng) } });
+        spots.push_back({ { REAL(frame), 45.f + position(rng), 30.f + position(rng) } });
+
+        for (std::size_t y = 0; y < height; y++)
+        {
+            for (std::size_t x = 0; x < width; x++)
+            {
+                REAL value = 10.f;
+
+                for (std::size_t i = spots.size() - 2; i < spots.size(); i++)
+                {
+                    REAL const dx = REAL(x) - spots[i][1];
+                    REAL const dy = REAL(y) - spots[i][2];
+                    value += 300.f * std::exp(-(dx * dx + dy * dy) / (2 * 1.2f * 1.2f));
+                }
+
+                noise_generator = std::poisson_distribution< int >(value);
+                samples.push_back(std::uint16_t(noise_generator(rng)));
+            }
+        }
+    }
+
+    CommandLineFiles files;
+    write_file(files.path("stack.tif"), make_tiff(samples, width, height, false, false, 7));
+
+    int const exit_status = files.run(
+        "[input]\n"
+        "data_file = stack.tif\n"
+        "[detection]\n"
+        "sigma = 1.2\n"
+        "threshold = 6\n"
+        "roi_size = 9\n"
+        "[fit]\n"
+        "model = GAUSS_2D\n"
+        "estimator = MLE\n"
+        "tolerance = 1e-6\n"
+        "[output]\n"
+        "file = results\n"
+        "[pipeline]\n"
+        "batch_size = 6\n");
+
+    BOOST_REQUIRE_MESSAGE(exit_status == 0, files.output);
+    BOOST_CHECK(files.output.find("40 spots in 20 frames") != std::string::npos);
+
+    FitInput input;
+    input.model_id = GAUSS_2D;
+    input.n_parameters = 5;
+    input.n_fits = spots.size();
+
+    FitOutput output;
+    read_result_file(files.path("results"), input, output);
+
+    std::vector< std::uint64_t > corners(3 * spots.size());
+    std::ifstream roi_file(files.path("results.rois"), std::ios::binary | std::ios::ate);
+    BOOST_REQUIRE(std::size_t(roi_file.tellg()) == corners.size() * sizeof(std::uint64_t));
+    roi_file.seekg(0);
+    roi_file.read(reinterpret_cast< char * >(corners.data()), corners.size() * sizeof(std::uint64_t));
+
+    // the spots of a frame are found in the order of rows
+    for (std::size_t i = 0; i < spots.size(); i++)
+    {
+        BOOST_CHECK(corners[3 * i] == std::uint64_t(spots[i][0]));
+        BOOST_CHECK(output.states[i] == FitState::CONVERGED);
+        BOOST_CHECK(std::abs(REAL(corners[3 * i + 1]) + output.parameters[5 * i + 1] - spots[i][1]) < .2f);
+        BOOST_CHECK(std::abs(REAL(corners[3 * i + 2]) + output.parameters[5 * i + 2] - spots[i][2]) < .2f);
+    }
+}
@@ -0,0 +1,142 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CallResult
+{
+    int status;
+    std::string error;
+    std::array< REAL, 5 > parameters;
+};
+
+void run_call(std::size_t const call_index, std::vector< REAL > const & roi, CallResult & result)
+{
+    /*
+    Every third call fails with one of two errors, the others fit a GAUSS_2D
+    peak. The error message is read twice, before and after a yield, so
+    another thread may fail in between.
+    */
+
+    std::vector< REAL > data = roi;
+    std::array< REAL, 5 > initial_parameters{ { 8.f, 2.f, 2.f, 1.f, 0.f } };
+    std::array< int, 5 > parameters_to_fit{ { 1, 1, 1, 1, 1 } };
+    int state;
+    REAL chi_square;
+    int n_iterations;
+
+    if (call_index % 3 == 2)
+    {
+        std::array< std::size_t, 2 > point_offsets{ { 0, 0 } };
+
+        result.status
+            = cpufit_ragged
+            (
+                1,
+                point_offsets.data(),
+                data.data(),
+                0,
+                GAUSS_2D,
+                initial_parameters.data(),
+                1e-6f,
+                20,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                result.parameters.data(),
+                &state,
+                &chi_square,
+                &n_iterations
+            );
+    }
+    else
+    {
+        result.status
+            = cpufit
+            (
+                1,
+                data.size(),
+                data.data(),
+                0,
+                call_index % 3 == 1 ? -1 : GAUSS_2D,
+                initial_parameters.data(),
+                1e-6f,
+                20,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                result.parameters.data(),
+                &state,
+                &chi_square,
+                &n_iterations
+            );
+    }
+
+    std::string const error = cpufit_get_last_error();
+    std::this_thread::yield();
+
+    result.error = cpufit_get_last_error();
+
+    if (error != result.error)
+        result.error = "changed by another thread";
+}
+
+BOOST_AUTO_TEST_CASE( Concurrent_Calls )
+{
+    /*
+    Performs 300 cpufit calls from concurrent threads.
+    - Checks that successful calls give the result of a single call.
+    - Checks that each thread sees the error message of its own call only.
+    */
+
+    std::size_t const n_calls{ 300 };
+
+    std::vector< REAL > roi(25);
+    generate_gauss_2d(roi, { 10.f, 2.1f, 1.9f, .9f, 1.f });
+
+    CallResult reference;
+    run_call(0, roi, reference);
+    BOOST_CHECK(reference.status == ReturnState::OK);
+
+    std::vector< CallResult > results(n_calls);
+    std::vector< std::thread > threads;
+
+    for (std::size_t call_index = 0; call_index < n_calls; call_index++)
+    {
+        threads.emplace_back(run_call, call_index, std::cref(roi), std::ref(results[call_index]));
+    }
+
+    for (std::thread & thread : threads)
+        thread.join();
+
+    for (std::size_t call_index = 0; call_index < n_calls; call_index++)
+    {
+        CallResult const & result = results[call_index];
+
+        switch (call_index % 3)
+        {
+        case 0:
+            BOOST_CHECK(result.status == ReturnState::OK);
+            BOOST_CHECK(result.error.empty());
+            BOOST_CHECK(result.parameters == reference.parameters);
+            break;
+        case 1:
+            BOOST_CHECK(result.status == ReturnState::ERROR);
+            BOOST_CHECK(result.error == "unknown model ID");
+            break;
+        case 2:
+            BOOST_CHECK(result.status == ReturnState::ERROR);
+            BOOST_CHECK(result.error == "point offsets must be strictly increasing");
+            break;
+        }
+    }
+}
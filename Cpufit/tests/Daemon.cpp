@@ -0,0 +1,541 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "Cpufit/cpufit_client.h"
+#include "Cpufit/daemon_protocol.h"
+#include "Cpufit/shard_protocol.h"
+#include "Cpufit/shared_memory.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// runs cpufitd, which is built next to the test, on a socket in a temporary
+// directory
+struct Daemon
+{
+    Daemon()
+    {
+        char directory_template[] = "/tmp/cpufitd_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(directory_template));
+
+        directory = directory_template;
+        socket_path = directory + "/cpufitd.sock";
+
+        std::string const test_path = boost::unit_test::framework::master_test_suite().argv[0];
+        std::size_t const slash = test_path.rfind('/');
+        std::string daemon_path
+            = (slash == std::string::npos ? std::string(".") : test_path.substr(0, slash)) + "/cpufitd";
+
+        pid = fork();
+        BOOST_REQUIRE(pid >= 0);
+
+        if (pid == 0)
+        {
+            execl(daemon_path.c_str(), daemon_path.c_str(), socket_path.c_str(), (char *)0);
+            _exit(127);
+        }
+
+        // waits until the daemon listens
+        for (int i = 0; i < 200; i++)
+        {
+            if (cpufit_client * const client = cpufit_client_connect(socket_path.c_str()))
+            {
+                cpufit_client_disconnect(client);
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        }
+
+        BOOST_FAIL("cpufitd did not start");
+    }
+
+    ~Daemon()
+    {
+        stop();
+        rmdir(directory.c_str());
+    }
+
+    void stop()
+    {
+        if (pid <= 0)
+            return;
+
+        kill(pid, SIGTERM);
+        waitpid(pid, 0, 0);
+        pid = 0;
+    }
+
+    std::string directory;
+    std::string socket_path;
+    pid_t pid;
+};
+
+// LINEAR_1D fits with x coordinates per fit
+void generate_linear_1d(FitInput & i, std::size_t const n_fits, REAL const x_offset)
+{
+    i.n_fits = n_fits;
+    i.n_points = 4;
+    i.n_parameters = 2;
+
+    i.data.clear();
+    i.user_info_.clear();
+    i.initial_parameters.clear();
+
+    for (std::size_t fit_index = 0; fit_index < i.n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < i.n_points; point_index++)
+        {
+            REAL const x = x_offset + REAL(point_index * point_index) + REAL(fit_index % 7);
+
+            i.user_info_.push_back(x);
+            i.data.push_back(3 - 2 * x + (point_index % 2 ? .1f : -.1f));
+        }
+
+        i.initial_parameters.insert(i.initial_parameters.end(), { 0, 0 });
+    }
+
+    i.model_id = LINEAR_1D;
+    i.estimator_id = LSE;
+    i.parameters_to_fit = { 1, 1 };
+    i.tolerance = 1e-6f;
+    i.max_n_iterations = 10;
+}
+
+int run_remote_fit(cpufit_client * client, FitInput & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    return cpufit_remote
+        (
+            client,
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
+
+void run_local_fit(FitInput & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+bool identical(FitOutput const & a, FitOutput const & b)
+{
+    return a.states == b.states
+        && a.n_iterations == b.n_iterations
+        && a.chi_squares == b.chi_squares
+        && a.parameters == b.parameters;
+}
+
+BOOST_AUTO_TEST_CASE( Remote_Fits )
+{
+    /*
+    Performs GAUSS_2D fits with Poisson noise in cpufitd, in batches of 500,
+    100 and 2000 fits over one connection.
+    - Checks that the results are identical to fits in this process.
+    */
+
+    Daemon daemon;
+
+    cpufit_client * const client = cpufit_client_connect(daemon.socket_path.c_str());
+    BOOST_REQUIRE(client);
+
+    for (std::size_t n_fits : { 500, 100, 2000 })
+    {
+        FitInput input;
+        generate_gauss_2d_fits(
+            input,
+            n_fits,
+            { 100.f, 2.f, 2.f, .8f, 2.f },
+            { 80.f, 2.2f, 1.8f, 1.f, 1.f },
+            true,
+            MLE);
+
+        FitOutput remote_output;
+        int const status = run_remote_fit(client, input, remote_output);
+        BOOST_CHECK(status == ReturnState::OK);
+
+        FitOutput output;
+        run_local_fit(input, output);
+
+        BOOST_CHECK(identical(remote_output, output));
+    }
+
+    BOOST_CHECK(cpufit_client_disconnect(client) == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( Concurrent_Clients )
+{
+    /*
+    Performs GAUSS_2D fits in cpufitd from 3 clients at the same time.
+    - Checks that the results of each client are identical to fits in this
+      process.
+    */
+
+    Daemon daemon;
+
+    std::size_t const n_clients = 3;
+    std::vector< FitInput > inputs(n_clients);
+    std::vector< FitOutput > remote_outputs(n_clients);
+    std::vector< int > states(n_clients, ReturnState::ERROR);
+
+    for (std::size_t i = 0; i < n_clients; i++)
+    {
+        generate_gauss_2d_fits(
+            inputs[i],
+            300 + 100 * i,
+            { 100.f, 2.f, 2.f, .8f, 2.f },
+            { 80.f, 2.2f, 1.8f, 1.f, 1.f },
+            true,
+            MLE);
+    }
+
+    std::vector< std::thread > clients;
+
+    for (std::size_t i = 0; i < n_clients; i++)
+    {
+        clients.emplace_back([&, i]()
+        {
+            cpufit_client * const client = cpufit_client_connect(daemon.socket_path.c_str());
+
+            if (client)
+            {
+                states[i] = run_remote_fit(client, inputs[i], remote_outputs[i]);
+                cpufit_client_disconnect(client);
+            }
+        });
+    }
+
+    for (std::thread & client : clients)
+        client.join();
+
+    for (std::size_t i = 0; i < n_clients; i++)
+    {
+        BOOST_CHECK(states[i] == ReturnState::OK);
+
+        FitOutput output;
+        run_local_fit(inputs[i], output);
+
+        BOOST_CHECK(identical(remote_outputs[i], output));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Cached_User_Info )
+{
+    /*
+    Performs LINEAR_1D fits with 80 kB of x coordinates in user_info, which
+    cpufitd caches, from two clients, and again with other x coordinates of
+    the same size.
+    - Checks that the results are identical to fits in this process.
+    */
+
+    Daemon daemon;
+
+    cpufit_client * const first_client = cpufit_client_connect(daemon.socket_path.c_str());
+    cpufit_client * const second_client = cpufit_client_connect(daemon.socket_path.c_str());
+    BOOST_REQUIRE(first_client && second_client);
+
+    for (REAL const x_offset : { 0.f, 0.f, 5.f })
+    {
+        FitInput input;
+        generate_linear_1d(input, 5000, x_offset);
+
+        FitOutput output;
+        run_local_fit(input, output);
+
+        for (cpufit_client * const client : { first_client, second_client })
+        {
+            FitOutput remote_output;
+            int const status = run_remote_fit(client, input, remote_output);
+            BOOST_CHECK(status == ReturnState::OK);
+
+            BOOST_CHECK(identical(remote_output, output));
+        }
+    }
+
+    cpufit_client_disconnect(first_client);
+    cpufit_client_disconnect(second_client);
+}
+
+BOOST_AUTO_TEST_CASE( Daemon_Stopped )
+{
+    /*
+    Stops cpufitd while a client is connected.
+    - Checks that fits of the client fail.
+    - Checks that new clients cannot connect.
+    */
+
+    Daemon daemon;
+
+    cpufit_client * const client = cpufit_client_connect(daemon.socket_path.c_str());
+    BOOST_REQUIRE(client);
+
+    daemon.stop();
+
+    FitInput input;
+    generate_gauss_2d_fits(
+        input,
+        10,
+        { 100.f, 2.f, 2.f, .8f, 2.f },
+        { 80.f, 2.2f, 1.8f, 1.f, 1.f },
+        true,
+        MLE);
+
+    FitOutput output;
+    int const status = run_remote_fit(client, input, output);
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_client_get_last_error()) == "connection to cpufitd lost");
+
+    cpufit_client_disconnect(client);
+
+    BOOST_CHECK(!cpufit_client_connect(daemon.socket_path.c_str()));
+}
+
+// sends a batch in a memory file to cpufitd without the client library
+DaemonReply send_raw_batch(
+    std::string const & socket_path,
+    int const file_descriptor,
+    ResultKey const & user_info_key = ResultKey())
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int const client = socket(AF_UNIX, SOCK_STREAM, 0);
+    BOOST_REQUIRE(client >= 0);
+    BOOST_REQUIRE(connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+
+    DaemonRequest request = DaemonRequest();
+    request.magic = daemon_magic;
+    request.has_memory_file = 1;
+    request.has_user_info = 1;
+    request.user_info_key = user_info_key;
+
+    DaemonReply reply = DaemonReply();
+    BOOST_REQUIRE(send_request(client, request, file_descriptor));
+    BOOST_REQUIRE(receive_message(client, &reply, sizeof(reply)));
+
+    close(client);
+
+    reply.error[sizeof(reply.error) - 1] = 0;
+
+    return reply;
+}
+
+// a GAUSS_2D batch laid out with the given number of parameters
+ShardHeader get_gauss_2d_header(std::uint64_t const n_fits, std::uint64_t const n_parameters)
+{
+    ShardHeader h = ShardHeader();
+    h.magic = shard_magic;
+    h.real_size = sizeof(REAL);
+    h.n_fits = n_fits;
+    h.n_points = 25;
+    h.n_parameters = n_parameters;
+    h.model_id = GAUSS_2D;
+    h.estimator_id = LSE;
+    h.max_n_iterations = 20;
+    h.tolerance = 1e-6;
+
+    set_shard_layout(h);
+
+    return h;
+}
+
+BOOST_AUTO_TEST_CASE( Malformed_Batches )
+{
+    /*
+    Sends batches with malformed headers and memory files directly to
+    cpufitd: a GAUSS_2D batch which claims 1 parameter and is laid out for
+    it, a batch whose number of values overflows, and a memory file which is
+    not sealed against shrinking.
+    - Checks that cpufitd rejects each batch with an error.
+    - Checks that cpufitd still fits the batches of a regular client.
+    */
+
+    Daemon daemon;
+
+    {
+        ShardHeader const h = get_gauss_2d_header(10, 1);
+        SharedMemory memory(h.size, "malformed_batch");
+        std::memcpy(memory.data(), &h, sizeof(h));
+
+        DaemonReply const reply = send_raw_batch(daemon.socket_path, memory.file_descriptor());
+        BOOST_CHECK(reply.status == ReturnState::ERROR);
+        BOOST_CHECK(std::string(reply.error) == "batch larger than its memory file");
+    }
+
+    {
+        ShardHeader h = get_gauss_2d_header(10, 5);
+        SharedMemory memory(h.size, "malformed_batch");
+
+        h.n_points = std::uint64_t(1) << 40;
+        h.n_fits = std::uint64_t(1) << 30;
+        std::memcpy(memory.data(), &h, sizeof(h));
+
+        DaemonReply const reply = send_raw_batch(daemon.socket_path, memory.file_descriptor());
+        BOOST_CHECK(reply.status == ReturnState::ERROR);
+        BOOST_CHECK(std::string(reply.error) == "batch larger than its memory file");
+    }
+
+    {
+        ShardHeader const h = get_gauss_2d_header(10, 5);
+
+        int const file_descriptor = memfd_create("unsealed_batch", MFD_CLOEXEC);
+        BOOST_REQUIRE(file_descriptor >= 0);
+        BOOST_REQUIRE(ftruncate(file_descriptor, off_t(h.size)) == 0);
+        BOOST_REQUIRE(pwrite(file_descriptor, &h, sizeof(h), 0) == ssize_t(sizeof(h)));
+
+        DaemonReply const reply = send_raw_batch(daemon.socket_path, file_descriptor);
+        BOOST_CHECK(reply.status == ReturnState::ERROR);
+        BOOST_CHECK(std::string(reply.error) == "memory file not sealed against shrinking");
+
+        close(file_descriptor);
+    }
+
+    cpufit_client * const client = cpufit_client_connect(daemon.socket_path.c_str());
+    BOOST_REQUIRE(client);
+
+    FitInput input;
+    generate_gauss_2d_fits(
+        input,
+        100,
+        { 100.f, 2.f, 2.f, .8f, 2.f },
+        { 80.f, 2.2f, 1.8f, 1.f, 1.f },
+        true,
+        MLE);
+
+    FitOutput remote_output;
+    BOOST_CHECK(run_remote_fit(client, input, remote_output) == ReturnState::OK);
+
+    FitOutput output;
+    run_local_fit(input, output);
+
+    BOOST_CHECK(identical(remote_output, output));
+
+    cpufit_client_disconnect(client);
+}
+
+BOOST_AUTO_TEST_CASE( Planted_User_Info )
+{
+    /*
+    Sends a LINEAR_1D batch with 80 kB of x coordinates in user_info directly
+    to cpufitd, claiming the key of other x coordinates, then fits with the
+    other x coordinates from a regular client.
+    - Checks that the results of the regular client are identical to fits in
+      this process.
+    */
+
+    Daemon daemon;
+
+    FitInput input;
+    generate_linear_1d(input, 5000, 0.f);
+
+    FitInput planted_input;
+    generate_linear_1d(planted_input, 5000, 5.f);
+
+    ShardHeader h = ShardHeader();
+    h.magic = shard_magic;
+    h.real_size = sizeof(REAL);
+    h.n_fits = planted_input.n_fits;
+    h.n_points = planted_input.n_points;
+    h.n_parameters = planted_input.n_parameters;
+    h.user_info_size = planted_input.user_info_size();
+    h.model_id = planted_input.model_id;
+    h.estimator_id = planted_input.estimator_id;
+    h.max_n_iterations = planted_input.max_n_iterations;
+    h.tolerance = planted_input.tolerance;
+
+    set_shard_layout(h);
+
+    SharedMemory memory(h.size, "planted_user_info");
+    char * const bytes = static_cast<char *>(memory.data());
+
+    std::memcpy(bytes, &h, sizeof(h));
+    std::memcpy(bytes + h.data, planted_input.data.data(), planted_input.data.size() * sizeof(REAL));
+    std::memcpy(
+        bytes + h.initial_parameters,
+        planted_input.initial_parameters.data(),
+        planted_input.initial_parameters.size() * sizeof(REAL));
+    std::memcpy(
+        bytes + h.parameters_to_fit,
+        planted_input.parameters_to_fit.data(),
+        planted_input.parameters_to_fit.size() * sizeof(int));
+    std::memcpy(bytes + h.user_info, planted_input.user_info(), h.user_info_size);
+
+    DaemonReply const reply = send_raw_batch(
+        daemon.socket_path,
+        memory.file_descriptor(),
+        get_user_info_key(input.user_info(), input.user_info_size()));
+    BOOST_CHECK(reply.status == ReturnState::OK);
+
+    cpufit_client * const client = cpufit_client_connect(daemon.socket_path.c_str());
+    BOOST_REQUIRE(client);
+
+    FitOutput output;
+    run_local_fit(input, output);
+
+    FitOutput remote_output;
+    BOOST_CHECK(run_remote_fit(client, input, remote_output) == ReturnState::OK);
+    BOOST_CHECK(identical(remote_output, output));
+
+    cpufit_client_disconnect(client);
+}
@@ -0,0 +1,199 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// runs the fits in their order on the calling thread
+void run_sequentially(std::size_t n_tasks, cpufit_task_function task, void * task_context, void *)
+{
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+}
+
+int run_deadline_fit(FitInput & i, FitOutput & o, double const time_budget, std::vector< int > & priorities)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    return cpufit_deadline
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            0,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            time_budget,
+            priorities.empty() ? 0 : priorities.data(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Deadline_Not_Reached )
+{
+    /*
+    Performs GAUSS_2D fits with a time budget of 100 s.
+    - Checks that the results equal fits without a time budget.
+    */
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 10, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    std::vector< int > no_priorities;
+    FitOutput output;
+    int const status = run_deadline_fit(input, output, 100., no_priorities);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput reference;
+    clean_resize(reference.parameters, input.n_fits * input.n_parameters);
+    clean_resize(reference.states, input.n_fits);
+    clean_resize(reference.chi_squares, input.n_fits);
+    clean_resize(reference.n_iterations, input.n_fits);
+
+    cpufit
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            reference.parameters.data(),
+            reference.states.data(),
+            reference.chi_squares.data(),
+            reference.n_iterations.data()
+        );
+
+    BOOST_CHECK(output.states == reference.states);
+    BOOST_CHECK(output.n_iterations == reference.n_iterations);
+    BOOST_CHECK(output.parameters == reference.parameters);
+}
+
+BOOST_AUTO_TEST_CASE( Deadline_Exceeded )
+{
+    /*
+    Performs GAUSS_2D fits with a time budget of 1 ns.
+    - Checks that all fits are skipped and return their initial parameters.
+    - Checks that a time budget of zero is rejected.
+    */
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 100, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    std::vector< int > no_priorities;
+    FitOutput output;
+    int status = run_deadline_fit(input, output, 1e-9, no_priorities);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        BOOST_CHECK(output.states[fit_index] == FitState::DEADLINE_EXCEEDED);
+        BOOST_CHECK(output.n_iterations[fit_index] == 0);
+    }
+
+    BOOST_CHECK(output.parameters == input.initial_parameters);
+
+    status = run_deadline_fit(input, output, 0., no_priorities);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
+
+BOOST_AUTO_TEST_CASE( Deadline_Unbounded )
+{
+    /*
+    Performs GAUSS_2D fits with time budgets beyond the range of the clock.
+    - Checks that budgets of 1e12 s and of infinity never expire and give the
+      results of a budget of 100 s.
+    - Checks that a time budget which is not a number is rejected.
+    */
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 10, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    std::vector< int > no_priorities;
+    FitOutput reference;
+    BOOST_CHECK(run_deadline_fit(input, reference, 100., no_priorities) == ReturnState::OK);
+
+    for (double const time_budget : { 1e12, std::numeric_limits< double >::max(), double(INFINITY) })
+    {
+        FitOutput output;
+        BOOST_CHECK(run_deadline_fit(input, output, time_budget, no_priorities) == ReturnState::OK);
+
+        for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+            BOOST_CHECK(output.states[fit_index] == FitState::CONVERGED);
+
+        BOOST_CHECK(output.n_iterations == reference.n_iterations);
+        BOOST_CHECK(output.parameters == reference.parameters);
+    }
+
+    FitOutput output;
+    int const status = run_deadline_fit(input, output, double(NAN), no_priorities);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
+
+BOOST_AUTO_TEST_CASE( Deadline_Priorities )
+{
+    /*
+    Performs 20000 GAUSS_2D fits on one thread with a time budget too short
+    for all of them. Every other fit has a high priority.
+    - Checks that some fits exceed the deadline.
+    - Checks that low priority fits are only started after all high priority
+      fits.
+    */
+
+    BOOST_CHECK(cpufit_set_executor(run_sequentially, 0, 1, 0) == ReturnState::OK);
+
+    FitInput input;
+    generate_gauss_2d_fits(input, 20000, { 10.f, 2.1f, 1.9f, .9f, 1.f }, { 8.f, 2.f, 2.f, 1.f, 0.f }, false, LSE);
+
+    std::vector< int > priorities(input.n_fits);
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+        priorities[fit_index] = fit_index % 2;
+
+    FitOutput output;
+    int const status = run_deadline_fit(input, output, .01, priorities);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    std::size_t n_exceeded = 0;
+    bool low_priority_started = false;
+    bool high_priority_skipped = false;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        bool const skipped = output.n_iterations[fit_index] == 0;
+
+        n_exceeded += output.states[fit_index] == FitState::DEADLINE_EXCEEDED;
+
+        if (priorities[fit_index])
+            high_priority_skipped |= skipped;
+        else
+            low_priority_started |= !skipped;
+    }
+
+    BOOST_CHECK(n_exceeded > 0);
+    BOOST_CHECK(!(low_priority_started && high_priority_skipped));
+
+    cpufit_set_executor(0, 0, 0, 0);
+}
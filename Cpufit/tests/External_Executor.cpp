@@ -0,0 +1,152 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+struct CountingExecutor
+{
+    std::size_t n_parallel_for_calls;
+    std::size_t n_tasks;
+};
+
+void counting_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void * executor_context)
+{
+    CountingExecutor & executor = *static_cast<CountingExecutor *>(executor_context);
+
+    executor.n_parallel_for_calls++;
+    executor.n_tasks += n_tasks;
+
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+}
+
+std::size_t count_threads()
+{
+    std::size_t n_threads = 0;
+
+#ifdef __linux__
+    DIR * const directory = opendir("/proc/self/task");
+
+    if (directory)
+    {
+        while (dirent * entry = readdir(directory))
+        {
+            if (entry->d_name[0] != '.')
+                n_threads++;
+        }
+        closedir(directory);
+    }
+#endif
+
+    return n_threads;
+}
+
+void run_gauss_2d_fits(FitInput & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            0,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( External_Executor )
+{
+    /*
+    Performs a batch of GAUSS_2D fits on a registered executor, and after
+    unregistering it, on the internal thread pool of 4 threads.
+    - Checks that the fits run on the executor.
+    - Checks that Cpufit doesn't start threads while the executor is registered.
+    - Checks that both runs give the same results.
+    */
+
+#ifdef _WIN32
+    _putenv_s("CPUFIT_N_THREADS", "4");
+#else
+    setenv("CPUFIT_N_THREADS", "4", 1);
+#endif
+
+    FitInput input;
+    input.n_fits = 100;
+    input.n_points = 25;
+    input.n_parameters = 5;
+
+    std::vector< REAL > roi(input.n_points);
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+        input.data.insert(input.data.end(), roi.begin(), roi.end());
+        input.initial_parameters.insert(input.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    input.model_id = GAUSS_2D;
+    input.estimator_id = LSE;
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 20;
+
+    std::size_t const n_threads_before = count_threads();
+
+    CountingExecutor executor{ 0, 0 };
+    int status = cpufit_set_executor(counting_parallel_for, 0, 4, &executor);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput executor_output;
+    run_gauss_2d_fits(input, executor_output);
+
+    BOOST_CHECK(executor.n_parallel_for_calls == 1);
+    BOOST_CHECK(executor.n_tasks == input.n_fits);
+    BOOST_CHECK(count_threads() == n_threads_before);
+
+    status = cpufit_set_executor(0, 0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput pool_output;
+    run_gauss_2d_fits(input, pool_output);
+
+    BOOST_CHECK(executor.n_parallel_for_calls == 1);
+    BOOST_CHECK(executor_output.states == pool_output.states);
+    BOOST_CHECK(executor_output.n_iterations == pool_output.n_iterations);
+    BOOST_CHECK(executor_output.parameters == pool_output.parameters);
+    BOOST_CHECK(executor_output.chi_squares == pool_output.chi_squares);
+
+    // an executor with zero threads is rejected
+    status = cpufit_set_executor(counting_parallel_for, 0, 0, &executor);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
@@ -0,0 +1,349 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs the chunks of all clients on the calling thread, logs which client ran
+// each chunk and holds the first chunk until it is opened
+struct GatedExecutor
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool open;
+    std::vector< int > clients;
+};
+
+thread_local int client = 0;
+
+void gated_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void * executor_context)
+{
+    GatedExecutor & executor = *static_cast< GatedExecutor * >(executor_context);
+
+    {
+        std::unique_lock< std::mutex > lock(executor.mutex);
+        executor.clients.push_back(client);
+        executor.changed.notify_all();
+        executor.changed.wait(lock, [&] { return executor.open; });
+    }
+
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+}
+
+// Boost.Test checks are made on the main thread, from the number of converged
+// fits
+void run_client_with_progress(
+    int const client_id,
+    int const priority_class,
+    double const weight,
+    std::size_t const n_fits,
+    std::size_t & n_converged_fits,
+    cpufit_progress_function const progress,
+    void * const progress_context)
+{
+    client = client_id;
+    n_converged_fits = 0;
+
+    if (cpufit_set_scheduling(priority_class, weight) != ReturnState::OK)
+        return;
+
+    std::size_t const n_points = 25;
+    std::size_t const n_parameters = 5;
+
+    std::vector< REAL > roi(n_points);
+    generate_gauss_2d(roi, { 10.f, 2.1f, 1.9f, .9f, 1.f });
+
+    std::vector< REAL > data;
+    std::vector< REAL > initial_parameters;
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        data.insert(data.end(), roi.begin(), roi.end());
+        initial_parameters.insert(initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    std::vector< int > parameters_to_fit(n_parameters, 1);
+    std::vector< REAL > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< REAL > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int const status
+        = cpufit_cancellable
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            1e-6f,
+            20,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            0,
+            progress,
+            progress_context,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    if (status == ReturnState::OK)
+        n_converged_fits = std::count(output_states.begin(), output_states.end(), FitState::CONVERGED);
+}
+
+void run_client(
+    int const client_id,
+    int const priority_class,
+    double const weight,
+    std::size_t const n_fits,
+    std::size_t & n_converged_fits)
+{
+    run_client_with_progress(client_id, priority_class, weight, n_fits, n_converged_fits, 0, 0);
+}
+
+// waits until a client of the priority class has started its batch and
+// requested its first chunk
+void wait_for_batches(int const priority_class, std::size_t const n_batches)
+{
+    std::size_t n_started_batches = 0;
+    std::size_t n_chunks;
+    double queueing_time;
+    double service_time;
+
+    while (n_started_batches < n_batches)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        cpufit_get_scheduler_statistics(
+            priority_class, &n_started_batches, &n_chunks, &queueing_time, &service_time);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+BOOST_AUTO_TEST_CASE( Priority_Classes )
+{
+    /*
+    Runs a low priority batch of 20 chunks. While its first chunk runs, a high
+    priority batch of 1 chunk is started.
+    - Checks that the high priority batch runs right after the first chunk of
+      the low priority batch.
+    - Checks the statistics of both classes.
+    */
+
+    GatedExecutor executor;
+    executor.open = false;
+    BOOST_CHECK(cpufit_set_executor(gated_parallel_for, 0, 1, &executor) == ReturnState::OK);
+    BOOST_CHECK(cpufit_reset_scheduler_statistics() == ReturnState::OK);
+
+    std::size_t n_low_priority_fits = 0;
+    std::size_t n_high_priority_fits = 0;
+
+    std::thread low_priority_client(
+        run_client, 1, LOW_PRIORITY, 1., 20 * 256, std::ref(n_low_priority_fits));
+
+    {
+        std::unique_lock< std::mutex > lock(executor.mutex);
+        executor.changed.wait(lock, [&] { return !executor.clients.empty(); });
+    }
+
+    std::thread high_priority_client(
+        run_client, 2, HIGH_PRIORITY, 1., 10, std::ref(n_high_priority_fits));
+    wait_for_batches(HIGH_PRIORITY, 1);
+
+    {
+        std::lock_guard< std::mutex > lock(executor.mutex);
+        executor.open = true;
+    }
+    executor.changed.notify_all();
+
+    high_priority_client.join();
+    low_priority_client.join();
+
+    BOOST_CHECK(n_low_priority_fits == 20 * 256);
+    BOOST_CHECK(n_high_priority_fits == 10);
+
+    BOOST_CHECK(executor.clients.size() == 21);
+    BOOST_CHECK(executor.clients[0] == 1);
+    BOOST_CHECK(executor.clients[1] == 2);
+
+    std::size_t n_batches;
+    std::size_t n_chunks;
+    double queueing_time;
+    double service_time;
+
+    cpufit_get_scheduler_statistics(HIGH_PRIORITY, &n_batches, &n_chunks, &queueing_time, &service_time);
+    BOOST_CHECK(n_batches == 1);
+    BOOST_CHECK(n_chunks == 1);
+    BOOST_CHECK(queueing_time > 0);
+
+    double const high_priority_queueing_time = queueing_time;
+
+    cpufit_get_scheduler_statistics(LOW_PRIORITY, &n_batches, &n_chunks, &queueing_time, &service_time);
+    BOOST_CHECK(n_batches == 1);
+    BOOST_CHECK(n_chunks == 20);
+    BOOST_CHECK(service_time >= high_priority_queueing_time);
+
+    // outputs which are not needed are null pointers
+    std::size_t n_high_priority_chunks = 0;
+    int const status = cpufit_get_scheduler_statistics(HIGH_PRIORITY, 0, &n_high_priority_chunks, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(n_high_priority_chunks == 1);
+
+    cpufit_set_executor(0, 0, 0, 0);
+}
+
+BOOST_AUTO_TEST_CASE( Weighted_Fair_Sharing )
+{
+    /*
+    Runs two normal priority batches of 30 chunks each, with weights 1 and 3.
+    - Checks that the batch with weight 3 runs more chunks while both batches
+      are running.
+    - Checks that invalid priority classes and weights are rejected.
+    */
+
+    GatedExecutor executor;
+    executor.open = false;
+    BOOST_CHECK(cpufit_set_executor(gated_parallel_for, 0, 1, &executor) == ReturnState::OK);
+    BOOST_CHECK(cpufit_reset_scheduler_statistics() == ReturnState::OK);
+
+    std::size_t n_light_fits = 0;
+    std::size_t n_heavy_fits = 0;
+
+    std::thread light_client(
+        run_client, 1, NORMAL_PRIORITY, 1., 30 * 256, std::ref(n_light_fits));
+
+    {
+        std::unique_lock< std::mutex > lock(executor.mutex);
+        executor.changed.wait(lock, [&] { return !executor.clients.empty(); });
+    }
+
+    std::thread heavy_client(
+        run_client, 2, NORMAL_PRIORITY, 3., 30 * 256, std::ref(n_heavy_fits));
+    wait_for_batches(NORMAL_PRIORITY, 2);
+
+    {
+        std::lock_guard< std::mutex > lock(executor.mutex);
+        executor.open = true;
+    }
+    executor.changed.notify_all();
+
+    heavy_client.join();
+    light_client.join();
+
+    BOOST_CHECK(n_light_fits == 30 * 256);
+    BOOST_CHECK(n_heavy_fits == 30 * 256);
+
+    BOOST_CHECK(executor.clients.size() == 60);
+
+    // the first 30 chunks end before either batch has finished
+    std::size_t const n_heavy_chunks = std::count(executor.clients.begin(), executor.clients.begin() + 30, 2);
+    BOOST_CHECK(n_heavy_chunks > 15);
+
+    cpufit_set_executor(0, 0, 0, 0);
+
+    BOOST_CHECK(cpufit_set_scheduling(3, 1.) == ReturnState::ERROR);
+    BOOST_CHECK(cpufit_set_scheduling(NORMAL_PRIORITY, 0.) == ReturnState::ERROR);
+}
+
+// holds the calling thread in the last progress report of a batch until it is
+// opened
+struct BlockingProgress
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool blocked;
+    bool open;
+};
+
+void block_last_report(std::size_t n_finished_fits, std::size_t n_fits, void * progress_context)
+{
+    if (n_finished_fits != n_fits)
+        return;
+
+    BlockingProgress & progress = *static_cast< BlockingProgress * >(progress_context);
+
+    std::unique_lock< std::mutex > lock(progress.mutex);
+    progress.blocked = true;
+    progress.changed.notify_all();
+    progress.changed.wait(lock, [&] { return progress.open; });
+}
+
+BOOST_AUTO_TEST_CASE( Blocking_Progress_Callback )
+{
+    /*
+    Runs a batch of 10 fits whose progress callback blocks after the last
+    chunk, and meanwhile a batch of 10 chunks.
+    - Checks that the second batch finishes within 10 seconds while the
+      callback of the first batch is blocked.
+    */
+
+    GatedExecutor executor;
+    executor.open = true;
+    BOOST_CHECK(cpufit_set_executor(gated_parallel_for, 0, 1, &executor) == ReturnState::OK);
+
+    BlockingProgress progress;
+    progress.blocked = false;
+    progress.open = false;
+
+    std::size_t n_blocked_fits = 0;
+    std::size_t n_fits = 0;
+
+    std::thread blocked_client(
+        run_client_with_progress, 1, NORMAL_PRIORITY, 1., 10, std::ref(n_blocked_fits), block_last_report, &progress);
+
+    {
+        std::unique_lock< std::mutex > lock(progress.mutex);
+        progress.changed.wait(lock, [&] { return progress.blocked; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool client_finished = false;
+
+    std::thread client(
+        [&]
+        {
+            run_client(2, NORMAL_PRIORITY, 1., 10 * 256, n_fits);
+
+            std::lock_guard< std::mutex > lock(mutex);
+            client_finished = true;
+            finished.notify_all();
+        });
+
+    {
+        std::unique_lock< std::mutex > lock(mutex);
+        BOOST_CHECK(finished.wait_for(lock, std::chrono::seconds(10), [&] { return client_finished; }));
+    }
+
+    {
+        std::lock_guard< std::mutex > lock(progress.mutex);
+        progress.open = true;
+    }
+    progress.changed.notify_all();
+
+    client.join();
+    blocked_client.join();
+
+    BOOST_CHECK(n_blocked_fits == 10);
+    BOOST_CHECK(n_fits == 10 * 256);
+
+    cpufit_set_executor(0, 0, 0, 0);
+}
@@ -0,0 +1,428 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// the input and output files of a batch in a temporary directory
+struct BatchFiles
+{
+    BatchFiles()
+    {
+        char directory_template[] = "/tmp/cpufit_files_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(directory_template));
+        directory = directory_template;
+    }
+
+    ~BatchFiles()
+    {
+        for (char const * name : { "data", "weights", "initial_parameters", "parameters", "states", "chi_squares", "n_iterations", "journal" })
+            std::remove(path(name).c_str());
+
+        rmdir(directory.c_str());
+    }
+
+    std::string path(char const * const name) const
+    {
+        return directory + "/" + name;
+    }
+
+    std::string directory;
+};
+
+template< typename T > void write_file(std::string const & path, std::vector< T > const & values)
+{
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast< char const * >(values.data()), values.size() * sizeof(T));
+}
+
+template< typename T > std::vector< T > read_file(std::string const & path, std::size_t const n_values)
+{
+    std::vector< T > values(n_values);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    BOOST_CHECK(std::size_t(file.tellg()) == n_values * sizeof(T));
+
+    file.seekg(0);
+    file.read(reinterpret_cast< char * >(values.data()), n_values * sizeof(T));
+
+    return values;
+}
+
+int run_file_fit(FitInput & i, BatchFiles const & files, std::size_t const memory_budget)
+{
+    write_file(files.path("data"), i.data);
+    write_file(files.path("initial_parameters"), i.initial_parameters);
+
+    if (i.weights())
+        write_file(files.path("weights"), i.weights_);
+
+    return cpufit_fit_files
+        (
+            i.n_fits,
+            i.n_points,
+            files.path("data").c_str(),
+            i.weights() ? files.path("weights").c_str() : 0,
+            i.model_id,
+            files.path("initial_parameters").c_str(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            memory_budget,
+            files.path("parameters").c_str(),
+            files.path("states").c_str(),
+            files.path("chi_squares").c_str(),
+            files.path("n_iterations").c_str()
+        );
+}
+
+void check_file_outputs(FitInput & i, BatchFiles const & files)
+{
+    FitOutput o;
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    BOOST_CHECK(read_file< REAL >(files.path("parameters"), i.n_fits * i.n_parameters) == o.parameters);
+    BOOST_CHECK(read_file< int >(files.path("states"), i.n_fits) == o.states);
+    BOOST_CHECK(read_file< REAL >(files.path("chi_squares"), i.n_fits) == o.chi_squares);
+    BOOST_CHECK(read_file< int >(files.path("n_iterations"), i.n_fits) == o.n_iterations);
+}
+
+// the peak resident set size of the process in kB, which is reset to the
+// current one if possible
+long get_peak_resident_set_size(bool const reset)
+{
+    if (reset)
+        std::ofstream("/proc/self/clear_refs") << "5";
+
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::atol(line.c_str() + 6);
+    }
+
+    return 0;
+}
+
+// the Poisson distributed data are weighted by their inverse variances
+void generate_noisy_gauss_2d(FitInput & input)
+{
+    generate_gauss_2d_fits(input, 3000, { 100.f, 2.f, 2.f, .8f, 2.f }, { 80.f, 2.2f, 1.8f, 1.f, 1.f }, true, LSE);
+
+    for (REAL const value : input.data)
+        input.weights_.push_back(1 / std::max(value, REAL(1)));
+}
+
+int run_resumable_file_fit(FitInput & i, BatchFiles const & files, std::size_t const memory_budget)
+{
+    return cpufit_fit_files_resumable
+        (
+            i.n_fits,
+            i.n_points,
+            files.path("data").c_str(),
+            files.path("weights").c_str(),
+            i.model_id,
+            files.path("initial_parameters").c_str(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            memory_budget,
+            files.path("parameters").c_str(),
+            files.path("states").c_str(),
+            files.path("chi_squares").c_str(),
+            files.path("n_iterations").c_str(),
+            files.path("journal").c_str(),
+            0.
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Files )
+{
+    /*
+    Performs 3000 GAUSS_2D fits with Poisson noise and weights from files, with
+    a memory budget of 64 kB, which splits the batch into windows of 138
+    fits.
+    - Checks that the output files are identical to the results of a fit in
+      memory.
+    */
+
+    FitInput input;
+    generate_noisy_gauss_2d(input);
+
+    BatchFiles files;
+    int const status = run_file_fit(input, files, 64 * 1024);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    check_file_outputs(input, files);
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Files_Resume )
+{
+    /*
+    Performs 3000 GAUSS_2D fits from files in windows of 138 fits with a
+    journal and a checkpoint after every window, and resumes the batch with
+    the journal cut off after 5 windows and in the middle of the next record.
+    - Checks that the resumed batch keeps the outputs of the first 690 fits
+      and gives outputs identical to a fit in memory.
+    - Checks that the batch resumes with a memory budget of 20 kB.
+    - Checks that a journal of a different batch is rejected, also if only
+      the data file differs.
+    */
+
+    FitInput input;
+    generate_noisy_gauss_2d(input);
+
+    BatchFiles files;
+    BOOST_CHECK(run_file_fit(input, files, 64 * 1024) == ReturnState::OK);
+    BOOST_CHECK(run_resumable_file_fit(input, files, 64 * 1024) == ReturnState::OK);
+    check_file_outputs(input, files);
+
+    // a header of 32 bytes and records of 16 bytes
+    std::size_t const n_windows = (input.n_fits + 137) / 138;
+    std::ifstream journal(files.path("journal"), std::ios::binary | std::ios::ate);
+    BOOST_CHECK(std::size_t(journal.tellg()) == 32 + n_windows * 16);
+    journal.close();
+
+    BOOST_REQUIRE(truncate(files.path("journal").c_str(), 32 + 5 * 16 + 7) == 0);
+
+    std::vector< REAL > parameters
+        = read_file< REAL >(files.path("parameters"), input.n_fits * input.n_parameters);
+    std::vector< REAL > const fitted_parameters = parameters;
+
+    // completed fits are not fitted again
+    parameters[0] = -1.f;
+    std::fill(parameters.begin() + 690 * input.n_parameters, parameters.end(), 0.f);
+    write_file(files.path("parameters"), parameters);
+
+    BOOST_CHECK(run_resumable_file_fit(input, files, 64 * 1024) == ReturnState::OK);
+
+    parameters = read_file< REAL >(files.path("parameters"), input.n_fits * input.n_parameters);
+    BOOST_CHECK(parameters[0] == -1.f);
+
+    parameters[0] = fitted_parameters[0];
+    BOOST_CHECK(parameters == fitted_parameters);
+    write_file(files.path("parameters"), parameters);
+    check_file_outputs(input, files);
+
+    // the journal identifies the batch independently of the memory budget
+    BOOST_REQUIRE(truncate(files.path("journal").c_str(), 32 + 5 * 16) == 0);
+    std::fill(parameters.begin() + 690 * input.n_parameters, parameters.end(), 0.f);
+    write_file(files.path("parameters"), parameters);
+
+    BOOST_CHECK(run_resumable_file_fit(input, files, 20 * 1024) == ReturnState::OK);
+    check_file_outputs(input, files);
+
+    std::vector< REAL > data = read_file< REAL >(files.path("data"), input.n_fits * input.n_points);
+    data.back() += 1.f;
+    write_file(files.path("data"), data);
+
+    BOOST_CHECK(run_resumable_file_fit(input, files, 64 * 1024) == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == files.path("journal") + " is the journal of a different batch");
+
+    data.back() -= 1.f;
+    write_file(files.path("data"), data);
+
+    input.tolerance = 1e-5f;
+    BOOST_CHECK(run_resumable_file_fit(input, files, 64 * 1024) == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == files.path("journal") + " is the journal of a different batch");
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Files_Custom_X )
+{
+    /*
+    Performs 1000 LINEAR_1D fits from files, each with its own x coordinates
+    in user_info, with a memory budget of 4 kB.
+    - Checks that the output files are identical to the results of a fit in
+      memory.
+    */
+
+    FitInput input;
+    input.n_fits = 1000;
+    input.n_points = 4;
+    input.n_parameters = 2;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        {
+            REAL const x = REAL(point_index * point_index) + REAL(fit_index % 11);
+
+            input.user_info_.push_back(x);
+            input.data.push_back(REAL(fit_index % 5) - x + (point_index % 2 ? .1f : -.1f));
+        }
+
+        input.initial_parameters.insert(input.initial_parameters.end(), { 0, 0 });
+    }
+
+    input.model_id = LINEAR_1D;
+    input.estimator_id = LSE;
+    input.parameters_to_fit = { 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 10;
+
+    BatchFiles files;
+    int const status = run_file_fit(input, files, 4 * 1024);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    check_file_outputs(input, files);
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Files_Bounded_Memory )
+{
+    /*
+    Performs 100000 LINEAR_1D fits of 64 points from a 25 MB data file with a
+    memory budget of 1 MB.
+    - Checks that the peak resident set size grows by less than 8 MB.
+    - Checks that the fits converged.
+    */
+
+    std::size_t const n_fits = 100000;
+    std::size_t const n_points = 64;
+
+    BatchFiles files;
+
+    {
+        std::vector< REAL > data(1000 * n_points);
+
+        for (std::size_t point_index = 0; point_index < data.size(); point_index++)
+            data[point_index] = 1 + 2 * REAL(point_index % n_points);
+
+        std::ofstream file(files.path("data"), std::ios::binary);
+
+        for (std::size_t i = 0; i < n_fits / 1000; i++)
+            file.write(reinterpret_cast< char const * >(data.data()), data.size() * sizeof(REAL));
+
+        std::vector< REAL > initial_parameters(n_fits * 2, 0);
+        write_file(files.path("initial_parameters"), initial_parameters);
+    }
+
+    std::vector< int > parameters_to_fit{ 1, 1 };
+
+    long const initial_peak = get_peak_resident_set_size(true);
+
+    int const status
+        = cpufit_fit_files
+        (
+            n_fits,
+            n_points,
+            files.path("data").c_str(),
+            0,
+            LINEAR_1D,
+            files.path("initial_parameters").c_str(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            1 << 20,
+            files.path("parameters").c_str(),
+            files.path("states").c_str(),
+            files.path("chi_squares").c_str(),
+            files.path("n_iterations").c_str()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(get_peak_resident_set_size(false) - initial_peak < 8 * 1024);
+
+    std::vector< int > const states = read_file< int >(files.path("states"), n_fits);
+    BOOST_CHECK(std::count(states.begin(), states.end(), int(FitState::CONVERGED)) == long(n_fits));
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Files_Errors )
+{
+    /*
+    Fits GAUSS_2D from a missing data file and from a data file which is too
+    small.
+    - Checks that both are rejected.
+    */
+
+    FitInput input;
+    input.n_fits = 10;
+    input.n_points = 25;
+    input.n_parameters = 5;
+    input.data.assign(input.n_fits * input.n_points, 1.f);
+    input.initial_parameters.assign(input.n_fits * input.n_parameters, 1.f);
+    input.model_id = GAUSS_2D;
+    input.estimator_id = LSE;
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 20;
+
+    BatchFiles files;
+    BOOST_CHECK(run_file_fit(input, files, 0) == ReturnState::OK);
+
+    input.n_fits = 11;
+    BOOST_CHECK(run_file_fit(input, files, 0) == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == files.path("data") + " is smaller than 1100 bytes");
+
+    std::remove(files.path("data").c_str());
+
+    int const status
+        = cpufit_fit_files
+        (
+            input.n_fits,
+            input.n_points,
+            files.path("data").c_str(),
+            0,
+            input.model_id,
+            files.path("initial_parameters").c_str(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            0,
+            files.path("parameters").c_str(),
+            files.path("states").c_str(),
+            files.path("chi_squares").c_str(),
+            files.path("n_iterations").c_str()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()).find("cannot open") == 0);
+}
@@ -0,0 +1,346 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+struct FitStatistics
+{
+    std::vector< REAL > variances;
+    std::vector< REAL > reduced_chi_squares;
+    std::vector< REAL > residual_rms;
+};
+
+void run_fit_with_statistics(FitInput & i, FitOutput & o, FitStatistics & s)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+    clean_resize(s.variances, i.n_fits * i.n_parameters);
+    clean_resize(s.reduced_chi_squares, i.n_fits);
+    clean_resize(s.residual_rms, i.n_fits);
+
+    int const status
+        = cpufit_with_statistics
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data(),
+            s.variances.data(),
+            s.reduced_chi_squares.data(),
+            s.residual_rms.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Statistics_MLE )
+{
+    /*
+    Performs 2000 GAUSS_2D fits with MLE of ROIs with Poisson noise and the
+    same true parameters.
+    - Checks that the fitted parameters equal those of cpufit.
+    - Checks that the mean variance of each parameter is close to the
+      variance of the fitted values.
+    - Checks that the reduced chi-square is close to 1.
+    */
+
+    FitInput input;
+    input.n_fits = 2000;
+    input.n_points = 49;
+    input.n_parameters = 5;
+
+    std::vector< REAL > roi(input.n_points);
+    generate_gauss_2d(roi, { 200.f, 3.f, 3.f, 1.2f, 10.f });
+    std::poisson_distribution< int > noise_generator;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        {
+            noise_generator = std::poisson_distribution< int >(roi[point_index]);
+            input.data.push_back(REAL(noise_generator(rng)));
+        }
+
+        input.initial_parameters.insert(input.initial_parameters.end(), { 150.f, 2.8f, 3.1f, 1.f, 8.f });
+    }
+
+    input.model_id = GAUSS_2D;
+    input.estimator_id = MLE;
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 30;
+
+    FitOutput output;
+    FitStatistics statistics;
+    run_fit_with_statistics(input, output, statistics);
+
+    FitOutput plain_output;
+    clean_resize(plain_output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(plain_output.states, input.n_fits);
+    clean_resize(plain_output.chi_squares, input.n_fits);
+    clean_resize(plain_output.n_iterations, input.n_fits);
+
+    cpufit
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            plain_output.parameters.data(),
+            plain_output.states.data(),
+            plain_output.chi_squares.data(),
+            plain_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(output.parameters == plain_output.parameters);
+    BOOST_CHECK(output.states == plain_output.states);
+    BOOST_CHECK(output.chi_squares == plain_output.chi_squares);
+
+    double mean_reduced_chi_square = 0;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        BOOST_CHECK(output.states[fit_index] == FitState::CONVERGED);
+        mean_reduced_chi_square += statistics.reduced_chi_squares[fit_index] / input.n_fits;
+        BOOST_CHECK(std::abs(
+            statistics.reduced_chi_squares[fit_index] * (input.n_points - input.n_parameters)
+            - output.chi_squares[fit_index]) < 1e-3f * output.chi_squares[fit_index]);
+    }
+
+    BOOST_CHECK(std::abs(mean_reduced_chi_square - 1) < .1);
+
+    for (std::size_t i = 0; i < input.n_parameters; i++)
+    {
+        double mean = 0;
+        double mean_variance = 0;
+
+        for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+        {
+            mean += output.parameters[fit_index * input.n_parameters + i] / input.n_fits;
+            mean_variance += statistics.variances[fit_index * input.n_parameters + i] / input.n_fits;
+        }
+
+        double variance = 0;
+
+        for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+        {
+            double const deviation = output.parameters[fit_index * input.n_parameters + i] - mean;
+            variance += deviation * deviation / (input.n_fits - 1);
+        }
+
+        BOOST_CHECK(mean_variance > 0);
+        BOOST_CHECK(std::abs(mean_variance / variance - 1) < .15);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Statistics_LSE )
+{
+    /*
+    Performs an unweighted LINEAR_1D fit of 20 points with an alternating
+    deviation of 0.5, and a fit with a fixed slope.
+    - Checks the residual RMS of 0.5 and the reduced chi-square.
+    - Checks the variances of the linear regression scaled by the reduced
+      chi-square.
+    - Checks a variance of 0 for the fixed slope.
+    */
+
+    FitInput input;
+    input.n_fits = 1;
+    input.n_points = 20;
+    input.n_parameters = 2;
+
+    for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        input.data.push_back(1.f + 2.f * point_index + (point_index % 4 < 2 ? .5f : -.5f));
+
+    input.model_id = LINEAR_1D;
+    input.estimator_id = LSE;
+    input.initial_parameters = { 0.f, 1.f };
+    input.parameters_to_fit = { 1, 1 };
+    input.tolerance = 1e-8f;
+    input.max_n_iterations = 20;
+
+    FitOutput output;
+    FitStatistics statistics;
+    run_fit_with_statistics(input, output, statistics);
+
+    BOOST_CHECK(output.states[0] == FitState::CONVERGED);
+
+    double const n = double(input.n_points);
+    double const sum_x = n * (n - 1) / 2;
+    double const sum_xx = (n - 1) * n * (2 * n - 1) / 6;
+    double const determinant = n * sum_xx - sum_x * sum_x;
+    double const reduced_chi_square = output.chi_squares[0] / (n - 2);
+
+    BOOST_CHECK(std::abs(statistics.residual_rms[0] - std::sqrt(output.chi_squares[0] / n)) < 1e-5);
+    BOOST_CHECK(std::abs(statistics.residual_rms[0] - .5) < .02);
+    BOOST_CHECK(std::abs(statistics.reduced_chi_squares[0] - reduced_chi_square) < 1e-5);
+    BOOST_CHECK(std::abs(statistics.variances[0] / (reduced_chi_square * sum_xx / determinant) - 1) < 1e-4);
+    BOOST_CHECK(std::abs(statistics.variances[1] / (reduced_chi_square * n / determinant) - 1) < 1e-4);
+
+    input.initial_parameters = { 0.f, 2.f };
+    input.parameters_to_fit = { 1, 0 };
+    run_fit_with_statistics(input, output, statistics);
+
+    BOOST_CHECK(output.states[0] == FitState::CONVERGED);
+    BOOST_CHECK(statistics.variances[1] == 0);
+    BOOST_CHECK(std::abs(statistics.variances[0] / (output.chi_squares[0] / (n - 1) / n) - 1) < 1e-4);
+}
+
+// the diagonal of the inverse of the Fisher information of a GAUSS_2D ROI
+// with Poisson noise, from the analytic derivatives of the model
+std::vector< double > calc_gauss_2d_crlb(std::vector< REAL > const & p, std::size_t const size)
+{
+    std::size_t const n = 5;
+    std::vector< double > fisher(n * 2 * n, 0.);
+
+    for (std::size_t y = 0; y < size; y++)
+    {
+        for (std::size_t x = 0; x < size; x++)
+        {
+            double const dx = double(x) - p[1];
+            double const dy = double(y) - p[2];
+            double const r2 = (dx * dx + dy * dy) / (double(p[3]) * p[3]);
+            double const e = std::exp(-r2 / 2);
+            double const value = p[0] * e + p[4];
+
+            double const derivatives[n] = {
+                e,
+                p[0] * e * dx / (double(p[3]) * p[3]),
+                p[0] * e * dy / (double(p[3]) * p[3]),
+                p[0] * e * r2 / p[3],
+                1. };
+
+            for (std::size_t i = 0; i < n; i++)
+                for (std::size_t j = 0; j < n; j++)
+                    fisher[i * 2 * n + j] += derivatives[i] * derivatives[j] / value;
+        }
+    }
+
+    // Gauss-Jordan elimination of [F | I]
+    for (std::size_t i = 0; i < n; i++)
+        fisher[i * 2 * n + n + i] = 1.;
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        double const pivot = fisher[i * 2 * n + i];
+
+        for (std::size_t j = 0; j < 2 * n; j++)
+            fisher[i * 2 * n + j] /= pivot;
+
+        for (std::size_t k = 0; k < n; k++)
+        {
+            if (k == i)
+                continue;
+
+            double const factor = fisher[k * 2 * n + i];
+
+            for (std::size_t j = 0; j < 2 * n; j++)
+                fisher[k * 2 * n + j] -= factor * fisher[i * 2 * n + j];
+        }
+    }
+
+    std::vector< double > crlb(n);
+
+    for (std::size_t i = 0; i < n; i++)
+        crlb[i] = fisher[i * 2 * n + n + i];
+
+    return crlb;
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Statistics_MLE_Low_Counts )
+{
+    /*
+    Performs 200 GAUSS_2D fits with MLE of 11x11 ROIs with Poisson noise, an
+    amplitude of 10 and a background of 0.2 counts, so that most pixels have
+    no counts.
+    - Checks that the variances of the converged fits equal the CRLB at the
+      fitted parameters, the inverse of the analytic Fisher information of
+      the model.
+    */
+
+    std::size_t const size = 11;
+
+    FitInput input;
+    input.n_fits = 200;
+    input.n_points = size * size;
+    input.n_parameters = 5;
+
+    std::vector< REAL > roi(input.n_points);
+    generate_gauss_2d(roi, { 10.f, 5.f, 5.f, 1.3f, .2f });
+    std::poisson_distribution< int > noise_generator;
+    std::size_t n_zeros = 0;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        {
+            noise_generator = std::poisson_distribution< int >(roi[point_index]);
+            input.data.push_back(REAL(noise_generator(rng)));
+            n_zeros += input.data.back() == 0 ? 1 : 0;
+        }
+
+        input.initial_parameters.insert(input.initial_parameters.end(), { 8.f, 4.8f, 5.2f, 1.5f, .3f });
+    }
+
+    BOOST_CHECK(n_zeros > input.data.size() / 2);
+
+    input.model_id = GAUSS_2D;
+    input.estimator_id = MLE;
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 50;
+
+    FitOutput output;
+    FitStatistics statistics;
+    run_fit_with_statistics(input, output, statistics);
+
+    std::size_t n_converged = 0;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        if (output.states[fit_index] != FitState::CONVERGED)
+            continue;
+
+        n_converged++;
+
+        std::vector< REAL > const parameters(
+            output.parameters.begin() + fit_index * input.n_parameters,
+            output.parameters.begin() + (fit_index + 1) * input.n_parameters);
+
+        std::vector< double > const crlb = calc_gauss_2d_crlb(parameters, size);
+
+        for (std::size_t i = 0; i < input.n_parameters; i++)
+        {
+            BOOST_CHECK(std::abs(statistics.variances[fit_index * input.n_parameters + i] / crlb[i] - 1) < 1e-3);
+        }
+    }
+
+    BOOST_CHECK(n_converged > input.n_fits / 2);
+}
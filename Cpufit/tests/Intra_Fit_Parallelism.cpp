@@ -0,0 +1,174 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+void set_number_of_threads(char const * n_threads)
+{
+#ifdef _WIN32
+    _putenv_s("CPUFIT_N_THREADS", n_threads);
+#else
+    setenv("CPUFIT_N_THREADS", n_threads, 1);
+#endif
+}
+
+void run_fits(FitInput & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            0,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+// runs the single fit of input 4 times in one batch, as many fits as threads,
+// and checks that every fit gives the result of the single fit
+void check_batch_of_single_fit(FitInput input, FitOutput const & single_output)
+{
+    std::size_t const n_fits = 4;
+    std::vector< REAL > const single_data = input.data;
+    std::vector< REAL > const single_initial_parameters = input.initial_parameters;
+
+    input.n_fits = n_fits;
+    input.data.clear();
+    input.initial_parameters.clear();
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        input.data.insert(input.data.end(), single_data.begin(), single_data.end());
+        input.initial_parameters.insert(
+            input.initial_parameters.end(),
+            single_initial_parameters.begin(),
+            single_initial_parameters.end());
+    }
+
+    FitOutput batch_output;
+    run_fits(input, batch_output);
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK(batch_output.states[fit_index] == single_output.states[0]);
+        BOOST_CHECK(batch_output.n_iterations[fit_index] == single_output.n_iterations[0]);
+        BOOST_CHECK(batch_output.chi_squares[fit_index] == single_output.chi_squares[0]);
+
+        for (std::size_t i = 0; i < input.n_parameters; i++)
+        {
+            BOOST_CHECK(batch_output.parameters[fit_index * input.n_parameters + i] == single_output.parameters[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Intra_Fit_Parallelism )
+{
+    /*
+    Performs a GAUSS_1D fit of 100000 points, whose sums are split into
+    chunks of points, with 4 threads.
+    - No noise is added.
+    - Checks fitted parameters equalling the true parameters.
+    - Checks that the fit gives the same result as the same fit in a batch
+      with as many fits as threads, where each fit runs on one thread.
+    */
+
+    set_number_of_threads("4");
+
+    FitInput input;
+    input.n_fits = 1;
+    input.n_points = 100000;
+    input.n_parameters = 4;
+
+    std::vector< REAL > const true_parameters{ { 100.f, 50000.f, 8000.f, 10.f } };
+
+    clean_resize(input.data, input.n_points);
+    generate_gauss_1d(input.data, true_parameters);
+
+    input.model_id = GAUSS_1D;
+    input.estimator_id = MLE;
+    input.initial_parameters = { 80.f, 49000.f, 9000.f, 8.f };
+    input.parameters_to_fit = { 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 50;
+
+    FitOutput single_output;
+    run_fits(input, single_output);
+
+    BOOST_CHECK(single_output.states[0] == FitState::CONVERGED);
+
+    for (std::size_t i = 0; i < input.n_parameters; i++)
+    {
+        BOOST_CHECK(std::abs(single_output.parameters[i] - true_parameters[i]) < 1e-3f * true_parameters[i]);
+    }
+
+    check_batch_of_single_fit(input, single_output);
+}
+
+BOOST_AUTO_TEST_CASE( Intra_Fit_Parallelism_2D )
+{
+    /*
+    Performs a GAUSS_2D fit of 317 x 317 points, whose model values and
+    derivatives are calculated in chunks of points not aligned to the rows of
+    the image, with 4 threads.
+    - No noise is added.
+    - Checks fitted parameters equalling the true parameters.
+    - Checks that the fit gives the same result as the same fit in a batch
+      with as many fits as threads, where each fit runs on one thread.
+    */
+
+    set_number_of_threads("4");
+
+    FitInput input;
+    input.n_fits = 1;
+    input.n_points = 317 * 317;
+    input.n_parameters = 5;
+
+    std::vector< REAL > const true_parameters{ { 100.f, 158.f, 158.f, 40.f, 10.f } };
+
+    clean_resize(input.data, input.n_points);
+    generate_gauss_2d(input.data, true_parameters);
+
+    input.model_id = GAUSS_2D;
+    input.estimator_id = MLE;
+    input.initial_parameters = { 80.f, 150.f, 165.f, 45.f, 8.f };
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 50;
+
+    FitOutput single_output;
+    run_fits(input, single_output);
+
+    BOOST_CHECK(single_output.states[0] == FitState::CONVERGED);
+
+    for (std::size_t i = 0; i < input.n_parameters; i++)
+    {
+        BOOST_CHECK(std::abs(single_output.parameters[i] - true_parameters[i]) < 1e-3f * true_parameters[i]);
+    }
+
+    check_batch_of_single_fit(input, single_output);
+}
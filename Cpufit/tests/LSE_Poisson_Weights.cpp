@@ -0,0 +1,160 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+void generate_poisson_gauss_2d(FitInput & i)
+{
+    /*
+    Builds a batch of GAUSS_2D fits with photon counting data and the
+    explicit Neyman weights 1 / max(data, 1).
+    */
+
+    i.n_fits = 10;
+    i.n_points = 25;
+    i.n_parameters = 5;
+
+    clean_resize(i.data, i.n_fits * i.n_points);
+    clean_resize(i.weights_, i.n_fits * i.n_points);
+    clean_resize(i.initial_parameters, i.n_fits * i.n_parameters);
+
+    std::vector< REAL > single_fit(i.n_points);
+    std::poisson_distribution< int > noise_generator;
+
+    for (std::size_t fit_index = 0; fit_index < i.n_fits; fit_index++)
+    {
+        std::vector< REAL > const true_parameters
+            { { 100.f + fit_index, 2.f, 2.f, .8f, 2.f } };
+
+        generate_gauss_2d(single_fit, true_parameters);
+
+        for (std::size_t point_index = 0; point_index < i.n_points; point_index++)
+        {
+            std::size_t const index = fit_index * i.n_points + point_index;
+
+            noise_generator = std::poisson_distribution< int >(single_fit[point_index]);
+            i.data[index] = REAL(noise_generator(rng));
+            i.weights_[index] = 1 / std::max(i.data[index], REAL(1));
+        }
+
+        std::vector< REAL > const initial_parameters
+            { { 80.f, 1.8f, 2.2f, 1.f, 1.f } };
+
+        std::copy(
+            initial_parameters.begin(),
+            initial_parameters.end(),
+            i.initial_parameters.begin() + fit_index * i.n_parameters);
+    }
+
+    i.model_id = GAUSS_2D;
+    i.estimator_id = LSE;
+    i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    i.tolerance = 1e-6f;
+    i.max_n_iterations = 20;
+    i.user_info_.clear();
+}
+
+void run_fit(FitInput & i, FitOutput & o, REAL * weights)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            weights,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( LSE_Poisson_Neyman )
+{
+    /*
+    Performs GAUSS_2D fits with LSE and explicit weights 1 / max(data, 1),
+    and with LSE_POISSON_NEYMAN and no weights.
+    - Checks that both estimators give identical results.
+    */
+
+    FitInput input;
+    generate_poisson_gauss_2d(input);
+    BOOST_CHECK(input.sanity_check());
+
+    FitOutput weighted_output;
+    run_fit(input, weighted_output, input.weights());
+
+    input.estimator_id = LSE_POISSON_NEYMAN;
+
+    FitOutput implicit_output;
+    run_fit(input, implicit_output, 0);
+
+    BOOST_CHECK(weighted_output.states == implicit_output.states);
+    BOOST_CHECK(weighted_output.n_iterations == implicit_output.n_iterations);
+    BOOST_CHECK(close_or_equal(weighted_output.parameters, implicit_output.parameters, 1e-5));
+    BOOST_CHECK(close_or_equal(weighted_output.chi_squares, implicit_output.chi_squares, 1e-5));
+
+    // a weight vector is ignored by the estimator
+    FitOutput ignored_weights_output;
+    run_fit(input, ignored_weights_output, input.weights());
+
+    BOOST_CHECK(ignored_weights_output.parameters == implicit_output.parameters);
+}
+
+BOOST_AUTO_TEST_CASE( LSE_Poisson_Pearson )
+{
+    /*
+    Performs a noise free GAUSS_1D fit with LSE_POISSON_PEARSON.
+    - Checks fitted parameters equalling the true parameters.
+    */
+
+    FitInput input;
+
+    input.n_fits = 1;
+    input.n_points = 9;
+    input.n_parameters = 4;
+
+    clean_resize(input.data, input.n_points);
+    std::vector< REAL > const true_parameters{ { 40.f, 4.f, 1.2f, 3.f } };
+    generate_gauss_1d(input.data, true_parameters);
+
+    input.model_id = GAUSS_1D;
+    input.estimator_id = LSE_POISSON_PEARSON;
+    input.initial_parameters = { 30.f, 3.5f, 1.f, 2.f };
+    input.parameters_to_fit = { 1, 1, 1, 1 };
+    input.tolerance = 1e-8f;
+    input.max_n_iterations = 50;
+
+    FitOutput output;
+    run_fit(input, output, 0);
+
+    BOOST_CHECK(output.states[0] == FitState::CONVERGED);
+    BOOST_CHECK(output.chi_squares[0] < 1e-4f);
+
+    for (std::size_t i = 0; i < input.n_parameters; i++)
+    {
+        BOOST_CHECK(std::abs(output.parameters[i] - true_parameters[i]) < 1e-3f * std::abs(true_parameters[i]));
+    }
+}
@@ -0,0 +1,175 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( Mixed_Models )
+{
+    /*
+    Performs GAUSS_2D and GAUSS_2D_ELLIPTIC fits in one batch, interleaved.
+    - Doesn't use user_info or weights.
+    - No noise is added.
+    - Checks that each fit gives the same result as a batch of fits with
+      the same model.
+    - Checks that parameter offsets not matching the models are rejected.
+    */
+
+    std::size_t const n_fits{ 6 };
+    std::size_t const n_points{ 25 };
+    std::size_t const n_parameters_gauss{ 5 };
+    std::size_t const n_parameters_elliptic{ 6 };
+
+    std::vector< REAL > data;
+    std::vector< int > model_ids;
+    std::vector< std::size_t > parameter_offsets{ 0 };
+    std::vector< REAL > initial_parameters;
+    std::vector< int > parameters_to_fit;
+
+    std::vector< REAL > gauss_data;
+    std::vector< REAL > gauss_initial_parameters;
+    std::vector< REAL > elliptic_data;
+    std::vector< REAL > elliptic_initial_parameters;
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        std::vector< REAL > roi(n_points);
+        std::vector< REAL > initial;
+
+        if (fit_index % 2)
+        {
+            generate_gauss_2d_elliptic(roi, { 10.f + fit_index, 2.1f, 1.9f, .8f, 1.1f, 1.f });
+            initial = { 8.f, 2.f, 2.f, 1.f, 1.f, 0.f };
+            model_ids.push_back(GAUSS_2D_ELLIPTIC);
+
+            elliptic_data.insert(elliptic_data.end(), roi.begin(), roi.end());
+            elliptic_initial_parameters.insert(elliptic_initial_parameters.end(), initial.begin(), initial.end());
+        }
+        else
+        {
+            generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+            initial = { 8.f, 2.f, 2.f, 1.f, 0.f };
+            model_ids.push_back(GAUSS_2D);
+
+            gauss_data.insert(gauss_data.end(), roi.begin(), roi.end());
+            gauss_initial_parameters.insert(gauss_initial_parameters.end(), initial.begin(), initial.end());
+        }
+
+        data.insert(data.end(), roi.begin(), roi.end());
+        initial_parameters.insert(initial_parameters.end(), initial.begin(), initial.end());
+        parameters_to_fit.insert(parameters_to_fit.end(), initial.size(), 1);
+        parameter_offsets.push_back(initial_parameters.size());
+    }
+
+    REAL const tolerance{ 1e-6f };
+    int const max_n_iterations{ 20 };
+
+    std::vector< REAL > output_parameters(initial_parameters.size());
+    std::vector< int > output_states(n_fits);
+    std::vector< REAL > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int status
+        = cpufit_mixed_models
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            model_ids.data(),
+            parameter_offsets.data(),
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (int elliptic = 0; elliptic < 2; elliptic++)
+    {
+        std::size_t const n_parameters = elliptic ? n_parameters_elliptic : n_parameters_gauss;
+        std::size_t const n_model_fits = n_fits / 2;
+
+        std::vector< int > model_parameters_to_fit(n_parameters, 1);
+        std::vector< REAL > model_parameters(n_model_fits * n_parameters);
+        std::vector< int > model_states(n_model_fits);
+        std::vector< REAL > model_chi_squares(n_model_fits);
+        std::vector< int > model_n_iterations(n_model_fits);
+
+        status
+            = cpufit
+            (
+                n_model_fits,
+                n_points,
+                elliptic ? elliptic_data.data() : gauss_data.data(),
+                0,
+                elliptic ? GAUSS_2D_ELLIPTIC : GAUSS_2D,
+                elliptic ? elliptic_initial_parameters.data() : gauss_initial_parameters.data(),
+                tolerance,
+                max_n_iterations,
+                model_parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                model_parameters.data(),
+                model_states.data(),
+                model_chi_squares.data(),
+                model_n_iterations.data()
+            );
+
+        BOOST_CHECK(status == ReturnState::OK);
+
+        for (std::size_t i = 0; i < n_model_fits; i++)
+        {
+            std::size_t const fit_index = 2 * i + elliptic;
+
+            BOOST_CHECK(output_states[fit_index] == FitState::CONVERGED);
+            BOOST_CHECK(output_states[fit_index] == model_states[i]);
+            BOOST_CHECK(output_n_iterations[fit_index] == model_n_iterations[i]);
+            BOOST_CHECK(output_chi_squares[fit_index] == model_chi_squares[i]);
+
+            for (std::size_t j = 0; j < n_parameters; j++)
+            {
+                BOOST_CHECK(output_parameters[parameter_offsets[fit_index] + j] == model_parameters[i * n_parameters + j]);
+            }
+        }
+    }
+
+    // parameter offsets not matching the number of model parameters are rejected
+    model_ids[0] = GAUSS_2D_ELLIPTIC;
+
+    status
+        = cpufit_mixed_models
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            model_ids.data(),
+            parameter_offsets.data(),
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
@@ -0,0 +1,131 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( Per_Fit_Parameters_To_Fit )
+{
+    /*
+    Performs GAUSS_2D fits with free width and fits with fixed width in one
+    batch, interleaved.
+    - Doesn't use user_info or weights.
+    - No noise is added.
+    - Checks that each fit gives the same result as a batch with the same
+      global parameters_to_fit.
+    */
+
+    std::size_t const n_fits{ 6 };
+    std::size_t const n_points{ 25 };
+    std::size_t const n_parameters{ 5 };
+
+    std::vector< REAL > data;
+    std::vector< REAL > initial_parameters;
+    std::vector< int > parameters_to_fit;
+
+    std::array< int, n_parameters > const free_width{ { 1, 1, 1, 1, 1 } };
+    std::array< int, n_parameters > const fixed_width{ { 1, 1, 1, 0, 1 } };
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        std::vector< REAL > roi(n_points);
+        std::vector< REAL > const true_parameters
+            { { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f } };
+        generate_gauss_2d(roi, true_parameters);
+        data.insert(data.end(), roi.begin(), roi.end());
+
+        std::vector< REAL > const initial{ { 8.f, 2.f, 2.f, .9f, 0.f } };
+        initial_parameters.insert(initial_parameters.end(), initial.begin(), initial.end());
+
+        std::array< int, n_parameters > const & mask
+            = fit_index % 2 ? fixed_width : free_width;
+        parameters_to_fit.insert(parameters_to_fit.end(), mask.begin(), mask.end());
+    }
+
+    REAL const tolerance{ 1e-6f };
+    int const max_n_iterations{ 20 };
+
+    std::vector< REAL > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< REAL > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int status
+        = cpufit_per_fit_parameters_to_fit
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (int fixed = 0; fixed < 2; fixed++)
+    {
+        std::array< int, n_parameters > mask = fixed ? fixed_width : free_width;
+
+        std::vector< REAL > global_parameters(n_fits * n_parameters);
+        std::vector< int > global_states(n_fits);
+        std::vector< REAL > global_chi_squares(n_fits);
+        std::vector< int > global_n_iterations(n_fits);
+
+        status
+            = cpufit
+            (
+                n_fits,
+                n_points,
+                data.data(),
+                0,
+                GAUSS_2D,
+                initial_parameters.data(),
+                tolerance,
+                max_n_iterations,
+                mask.data(),
+                LSE,
+                0,
+                0,
+                global_parameters.data(),
+                global_states.data(),
+                global_chi_squares.data(),
+                global_n_iterations.data()
+            );
+
+        BOOST_CHECK(status == ReturnState::OK);
+
+        for (std::size_t fit_index = fixed; fit_index < n_fits; fit_index += 2)
+        {
+            BOOST_CHECK(output_states[fit_index] == FitState::CONVERGED);
+            BOOST_CHECK(output_states[fit_index] == global_states[fit_index]);
+            BOOST_CHECK(output_n_iterations[fit_index] == global_n_iterations[fit_index]);
+            BOOST_CHECK(output_chi_squares[fit_index] == global_chi_squares[fit_index]);
+
+            for (std::size_t i = 0; i < n_parameters; i++)
+            {
+                std::size_t const index = fit_index * n_parameters + i;
+                BOOST_CHECK(output_parameters[index] == global_parameters[index]);
+            }
+
+            if (fixed)
+            {
+                BOOST_CHECK(output_parameters[fit_index * n_parameters + 3] == .9f);
+            }
+        }
+    }
+}
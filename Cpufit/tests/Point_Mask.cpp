@@ -0,0 +1,177 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+void generate_hot_pixel_gauss_2d(FitInput & i)
+{
+    /*
+    Builds two 5x5 GAUSS_2D fits, each with one hot pixel at a different
+    position.
+    */
+
+    i.n_fits = 2;
+    i.n_points = 25;
+    i.n_parameters = 5;
+
+    std::vector< REAL > const true_parameters{ { 10.f, 2.1f, 1.9f, .8f, 2.f } };
+
+    std::vector< REAL > single_fit(i.n_points);
+    generate_gauss_2d(single_fit, true_parameters);
+
+    i.data.clear();
+    i.data.insert(i.data.end(), single_fit.begin(), single_fit.end());
+    i.data.insert(i.data.end(), single_fit.begin(), single_fit.end());
+
+    i.data[3] = 1000.f;
+    i.data[i.n_points + 21] = 1000.f;
+
+    i.initial_parameters = { 8.f, 2.f, 2.f, 1.f, 1.f, 8.f, 2.f, 2.f, 1.f, 1.f };
+    i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    i.model_id = GAUSS_2D;
+    i.estimator_id = LSE;
+    i.tolerance = 1e-7f;
+    i.max_n_iterations = 30;
+    i.user_info_.clear();
+}
+
+int run_masked_fit(FitInput & i, FitOutput & o, std::size_t const n_point_masks, std::vector< char > & point_mask)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    return cpufit_masked
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            n_point_masks,
+            point_mask.data(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Point_Mask_LSE )
+{
+    /*
+    Performs GAUSS_2D fits with hot pixels excluded by per fit point masks.
+    - Checks that the result equals a fit with zero weights at the hot pixels.
+    - Checks fitted parameters equalling the true parameters.
+    */
+
+    FitInput input;
+    generate_hot_pixel_gauss_2d(input);
+
+    std::vector< char > point_mask(input.n_fits * input.n_points, 1);
+    point_mask[3] = 0;
+    point_mask[input.n_points + 21] = 0;
+
+    FitOutput masked_output;
+    int const status = run_masked_fit(input, masked_output, input.n_fits, point_mask);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    input.weights_.resize(point_mask.size());
+    for (std::size_t i = 0; i < point_mask.size(); i++)
+        input.weights_[i] = REAL(point_mask[i]);
+
+    FitOutput weighted_output;
+    clean_resize(weighted_output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(weighted_output.states, input.n_fits);
+    clean_resize(weighted_output.chi_squares, input.n_fits);
+    clean_resize(weighted_output.n_iterations, input.n_fits);
+
+    cpufit
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            input.weights(),
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            weighted_output.parameters.data(),
+            weighted_output.states.data(),
+            weighted_output.chi_squares.data(),
+            weighted_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(masked_output.states == weighted_output.states);
+    BOOST_CHECK(close_or_equal(masked_output.parameters, weighted_output.parameters));
+
+    std::array< REAL, 5 > const true_parameters{ { 10.f, 2.1f, 1.9f, .8f, 2.f } };
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        BOOST_CHECK(masked_output.states[fit_index] == FitState::CONVERGED);
+
+        for (std::size_t i = 0; i < input.n_parameters; i++)
+        {
+            REAL const fitted = masked_output.parameters[fit_index * input.n_parameters + i];
+            BOOST_CHECK(std::abs(fitted - true_parameters[i]) < 1e-3f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Point_Mask_MLE )
+{
+    /*
+    Performs GAUSS_2D fits with MLE and one point mask shared by all fits,
+    which excludes both hot pixels.
+    - Checks fitted parameters equalling the true parameters.
+    - Checks that a wrong number of point masks is rejected.
+    */
+
+    FitInput input;
+    generate_hot_pixel_gauss_2d(input);
+    input.estimator_id = MLE;
+
+    std::vector< char > point_mask(input.n_points, 1);
+    point_mask[3] = 0;
+    point_mask[21] = 0;
+
+    FitOutput output;
+    int status = run_masked_fit(input, output, 1, point_mask);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    std::array< REAL, 5 > const true_parameters{ { 10.f, 2.1f, 1.9f, .8f, 2.f } };
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        BOOST_CHECK(output.states[fit_index] == FitState::CONVERGED);
+        BOOST_CHECK(output.chi_squares[fit_index] < 1e-4f);
+
+        for (std::size_t i = 0; i < input.n_parameters; i++)
+        {
+            REAL const fitted = output.parameters[fit_index * input.n_parameters + i];
+            BOOST_CHECK(std::abs(fitted - true_parameters[i]) < 1e-3f);
+        }
+    }
+
+    status = run_masked_fit(input, output, 3, point_mask);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
@@ -0,0 +1,299 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( Ragged_Batch_Gauss_2D )
+{
+    /*
+    Performs GAUSS_2D fits of 5x5, 7x7 and 4x4 ROIs in one ragged batch.
+    - Doesn't use user_info or weights.
+    - No noise is added.
+    - Checks that each fit gives the same result as a single fit of its ROI.
+    */
+
+    std::size_t const n_fits{ 4 };
+    std::size_t const n_parameters{ 5 };
+
+    std::array< std::size_t, n_fits > const sizes{ { 5, 7, 4, 7 } };
+    std::vector< std::size_t > point_offsets{ 0 };
+
+    std::vector< REAL > data;
+    std::vector< REAL > initial_parameters;
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        std::size_t const size = sizes[fit_index];
+        REAL const center = (size - 1) / REAL(2);
+
+        std::vector< REAL > roi(size * size);
+        std::vector< REAL > const true_parameters{ { 10.f, center, center, 1.f, 1.f } };
+        generate_gauss_2d(roi, true_parameters);
+
+        data.insert(data.end(), roi.begin(), roi.end());
+        point_offsets.push_back(data.size());
+
+        std::vector< REAL > const initial{ { 8.f, center - .3f, center + .2f, 1.2f, 0.f } };
+        initial_parameters.insert(initial_parameters.end(), initial.begin(), initial.end());
+    }
+
+    REAL const tolerance{ 1e-6f };
+    int const max_n_iterations{ 20 };
+    std::array< int, n_parameters > parameters_to_fit{ { 1, 1, 1, 1, 1 } };
+
+    std::vector< REAL > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< REAL > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int const status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        std::array< REAL, n_parameters > single_parameters;
+        int single_state;
+        REAL single_chi_square;
+        int single_n_iterations;
+
+        int const single_status
+            = cpufit
+            (
+                1,
+                point_offsets[fit_index + 1] - point_offsets[fit_index],
+                data.data() + point_offsets[fit_index],
+                0,
+                GAUSS_2D,
+                initial_parameters.data() + fit_index * n_parameters,
+                tolerance,
+                max_n_iterations,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                single_parameters.data(),
+                &single_state,
+                &single_chi_square,
+                &single_n_iterations
+            );
+
+        BOOST_CHECK(single_status == ReturnState::OK);
+        BOOST_CHECK(output_states[fit_index] == FitState::CONVERGED);
+        BOOST_CHECK(output_states[fit_index] == single_state);
+        BOOST_CHECK(output_n_iterations[fit_index] == single_n_iterations);
+        BOOST_CHECK(output_chi_squares[fit_index] == single_chi_square);
+
+        for (std::size_t i = 0; i < n_parameters; i++)
+        {
+            BOOST_CHECK(output_parameters[fit_index * n_parameters + i] == single_parameters[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Ragged_Batch_Custom_X )
+{
+    /*
+    Performs two LINEAR_1D fits of 3 and 5 points in one ragged batch.
+    - Uses user_info for custom x coordinate values of every data point.
+    - No noise is added.
+    - Checks fitted parameters equalling the true parameters.
+    - Checks that invalid point offsets and user info are rejected.
+    */
+
+    std::size_t const n_fits{ 2 };
+    std::size_t const n_parameters{ 2 };
+
+    std::array< std::size_t, n_fits + 1 > point_offsets{ { 0, 3, 8 } };
+
+    std::array< REAL, 8 > user_info{ { 0, 1, 2, -1, -.5f, 0, .5f, 1 } };
+    std::array< REAL, 8 > data{ { 1, 3, 5, -4, -2.5f, -1, .5f, 2 } };
+
+    std::array< REAL, n_fits * n_parameters > initial_parameters{ { 0, 1, 0, 1 } };
+    std::array< int, n_parameters > parameters_to_fit{ { 1, 1 } };
+
+    std::array< REAL, n_fits * n_parameters > output_parameters;
+    std::array< int, n_fits > output_states;
+    std::array< REAL, n_fits > output_chi_squares;
+    std::array< int, n_fits > output_n_iterations;
+
+    int status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            LINEAR_1D,
+            initial_parameters.data(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            user_info.size() * sizeof(REAL),
+            reinterpret_cast< char * >(user_info.data()),
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(output_states[0] == FitState::CONVERGED);
+    BOOST_CHECK(output_states[1] == FitState::CONVERGED);
+
+    BOOST_CHECK(std::abs(output_parameters[0] - 1) < 1e-5f);
+    BOOST_CHECK(std::abs(output_parameters[1] - 2) < 1e-5f);
+    BOOST_CHECK(std::abs(output_parameters[2] + 1) < 1e-5f);
+    BOOST_CHECK(std::abs(output_parameters[3] - 3) < 1e-5f);
+
+    // user info with one x value per fit size is rejected
+    status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            LINEAR_1D,
+            initial_parameters.data(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            5 * sizeof(REAL),
+            reinterpret_cast< char * >(user_info.data()),
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+
+    // empty fits are rejected
+    point_offsets = { { 0, 3, 3 } };
+
+    status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            LINEAR_1D,
+            initial_parameters.data(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "point offsets must be strictly increasing");
+}
+
+BOOST_AUTO_TEST_CASE( Ragged_Batch_Image_Sizes )
+{
+    /*
+    Performs ragged batches of 2D models with fits of the wrong size.
+    - Checks that a GAUSS_2D fit of 30 points is rejected.
+    - Checks that a SPLINE_2D fit of 16 points with a 5x5 spline is rejected.
+    */
+
+    std::size_t const n_fits{ 2 };
+
+    std::array< std::size_t, n_fits + 1 > point_offsets{ { 0, 25, 55 } };
+    std::vector< REAL > data(55, 1.f);
+
+    std::array< REAL, n_fits * 5 > initial_parameters{ { 1, 2, 2, 1, 0, 1, 2, 2, 1, 0 } };
+    std::array< int, 5 > parameters_to_fit{ { 1, 1, 1, 1, 1 } };
+
+    std::array< REAL, n_fits * 5 > output_parameters;
+    std::array< int, n_fits > output_states;
+    std::array< REAL, n_fits > output_chi_squares;
+    std::array< int, n_fits > output_n_iterations;
+
+    int status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "number of points of fit 1 is not a square number");
+
+    // the spline dimensions precede its coefficients
+    point_offsets = { { 0, 25, 41 } };
+    std::array< REAL, 4 > user_info{ { 5, 5, 4, 4 } };
+
+    status
+        = cpufit_ragged
+        (
+            n_fits,
+            point_offsets.data(),
+            data.data(),
+            0,
+            SPLINE_2D,
+            initial_parameters.data(),
+            1e-6f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            user_info.size() * sizeof(REAL),
+            reinterpret_cast< char * >(user_info.data()),
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "number of points of fit 1 does not match the spline dimensions");
+}
@@ -0,0 +1,201 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "Cpufit/tests/allocation_counting.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( Real_Time_Mode )
+{
+    /*
+    Performs batches of small GAUSS_2D fits and single GAUSS_1D fits of 50000
+    points, split into chunks, in real-time mode with 2 threads.
+    - Checks that the results equal fits without real-time mode.
+    - Checks that no memory is allocated during the fits, neither by operator
+      new nor by the allocator hooks.
+    - Checks the latency statistics of the batches.
+    - Checks that invalid settings are rejected.
+    */
+
+    FitInput batch;
+    batch.n_fits = 20;
+    batch.n_points = 25;
+    batch.n_parameters = 5;
+
+    std::vector< REAL > roi(batch.n_points);
+    for (std::size_t fit_index = 0; fit_index < batch.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+        batch.data.insert(batch.data.end(), roi.begin(), roi.end());
+        batch.initial_parameters.insert(batch.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    batch.model_id = GAUSS_2D;
+    batch.estimator_id = LSE;
+    batch.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    batch.tolerance = 1e-6f;
+    batch.max_n_iterations = 20;
+
+    FitInput large;
+    large.n_fits = 1;
+    large.n_points = 50000;
+    large.n_parameters = 4;
+
+    clean_resize(large.data, large.n_points);
+    generate_gauss_1d(large.data, { 100.f, 25000.f, 4000.f, 10.f });
+
+    large.model_id = GAUSS_1D;
+    large.estimator_id = MLE;
+    large.initial_parameters = { 80.f, 24500.f, 4500.f, 8.f };
+    large.parameters_to_fit = { 1, 1, 1, 1 };
+    large.tolerance = 1e-6f;
+    large.max_n_iterations = 20;
+
+    FitOutput batch_reference;
+    FitOutput large_reference;
+    resize_output(batch, batch_reference);
+    resize_output(large, large_reference);
+    BOOST_CHECK(run_fits(batch, batch_reference) == ReturnState::OK);
+    BOOST_CHECK(run_fits(large, large_reference) == ReturnState::OK);
+
+    int status = cpufit_set_real_time_mode(1, 2, 1 << 22);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    status = cpufit_set_allocator(counting_allocate, counting_free, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    status = cpufit_reset_latency_statistics();
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput batch_output;
+    FitOutput large_output;
+    resize_output(batch, batch_output);
+    resize_output(large, large_output);
+
+    std::size_t const n_repetitions = 5;
+    std::size_t n_failed_batches = 0;
+
+    forbid_allocations = true;
+    for (std::size_t i = 0; i < n_repetitions; i++)
+    {
+        n_failed_batches += run_fits(batch, batch_output) != ReturnState::OK;
+        n_failed_batches += run_fits(large, large_output) != ReturnState::OK;
+    }
+    forbid_allocations = false;
+
+    BOOST_CHECK(n_failed_batches == 0);
+    BOOST_CHECK(n_forbidden_allocations == 0);
+    BOOST_CHECK(n_hook_allocations == 0);
+
+    BOOST_CHECK(batch_output.parameters == batch_reference.parameters);
+    BOOST_CHECK(large_output.parameters == large_reference.parameters);
+
+    std::size_t n_batches = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    status = cpufit_get_latency_statistics(&n_batches, &p50, &p99, &max);
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(n_batches == 2 * n_repetitions);
+    BOOST_CHECK(p50 > 0);
+    BOOST_CHECK(p50 <= p99);
+    BOOST_CHECK(p99 <= max);
+
+    // outputs which are not needed are null pointers
+    std::size_t n_counted_batches = 0;
+    status = cpufit_get_latency_statistics(&n_counted_batches, 0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(n_counted_batches == n_batches);
+
+    cpufit_reset_latency_statistics();
+    cpufit_get_latency_statistics(&n_batches, &p50, &p99, &max);
+    BOOST_CHECK(n_batches == 0);
+    BOOST_CHECK(max == 0);
+
+    cpufit_set_allocator(0, 0, 0);
+
+    status = cpufit_set_real_time_mode(0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    // threads and workspaces are required
+    status = cpufit_set_real_time_mode(1, 0, 1 << 20);
+    BOOST_CHECK(status == ReturnState::ERROR);
+
+    status = cpufit_set_real_time_mode(1, 2, 0);
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
+
+BOOST_AUTO_TEST_CASE( Real_Time_Mode_Keeps_Executor )
+{
+    /*
+    Performs batches of small GAUSS_2D fits with an executor of the host
+    application, switching real-time mode on and off.
+    - Checks that the real-time pool replaces the executor while enabled.
+    - Checks that disabling real-time mode restores the executor.
+    - Checks that an executor set while real-time mode is enabled is kept
+      when it is disabled.
+    */
+
+    FitInput batch;
+    batch.n_fits = 20;
+    batch.n_points = 25;
+    batch.n_parameters = 5;
+
+    std::vector< REAL > roi(batch.n_points);
+    for (std::size_t fit_index = 0; fit_index < batch.n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 10.f + fit_index, 2.1f, 1.9f, .9f, 1.f });
+        batch.data.insert(batch.data.end(), roi.begin(), roi.end());
+        batch.initial_parameters.insert(batch.initial_parameters.end(), { 8.f, 2.f, 2.f, 1.f, 0.f });
+    }
+
+    batch.model_id = GAUSS_2D;
+    batch.estimator_id = LSE;
+    batch.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    batch.tolerance = 1e-6f;
+    batch.max_n_iterations = 20;
+
+    FitOutput output;
+    resize_output(batch, output);
+
+    int status = cpufit_set_executor(counting_parallel_for, 0, 4, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    n_executor_calls = 0;
+    BOOST_CHECK(run_fits(batch, output) == ReturnState::OK);
+    BOOST_CHECK(n_executor_calls == 1);
+
+    status = cpufit_set_real_time_mode(1, 2, 1 << 20);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    BOOST_CHECK(run_fits(batch, output) == ReturnState::OK);
+    BOOST_CHECK(n_executor_calls == 1);
+
+    status = cpufit_set_real_time_mode(0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    BOOST_CHECK(run_fits(batch, output) == ReturnState::OK);
+    BOOST_CHECK(n_executor_calls == 2);
+
+    // the host replaces the real-time pool
+    cpufit_set_executor(0, 0, 0, 0);
+
+    status = cpufit_set_real_time_mode(1, 2, 1 << 20);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    status = cpufit_set_executor(counting_parallel_for, 0, 4, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    status = cpufit_set_real_time_mode(0, 0, 0);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    BOOST_CHECK(run_fits(batch, output) == ReturnState::OK);
+    BOOST_CHECK(n_executor_calls == 3);
+
+    cpufit_set_executor(0, 0, 0, 0);
+}
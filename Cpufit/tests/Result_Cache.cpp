@@ -0,0 +1,341 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+// a temporary cache directory, removed with its files
+struct CacheDirectory
+{
+    CacheDirectory()
+    {
+        char directory_template[] = "/tmp/cpufit_cache_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(directory_template));
+        path = directory_template;
+    }
+
+    ~CacheDirectory()
+    {
+        for (std::string const & name : names())
+            std::remove((path + "/" + name).c_str());
+
+        rmdir(path.c_str());
+    }
+
+    std::vector< std::string > names() const
+    {
+        std::vector< std::string > names;
+        DIR * const directory = opendir(path.c_str());
+
+        while (dirent const * const entry = readdir(directory))
+        {
+            if (entry->d_name[0] != '.')
+                names.push_back(entry->d_name);
+        }
+
+        closedir(directory);
+
+        return names;
+    }
+
+    std::string path;
+};
+
+void generate_cached_gauss_2d(FitInput & i, REAL const amplitude)
+{
+    i.n_fits = 50;
+    i.n_points = 25;
+    i.n_parameters = 5;
+
+    std::vector< REAL > roi(i.n_points);
+    std::vector< REAL > const true_parameters{ { amplitude, 2.1f, 1.9f, 1.f, 1.f } };
+    generate_gauss_2d(roi, true_parameters);
+
+    i.data.clear();
+    i.initial_parameters.clear();
+
+    for (std::size_t fit_index = 0; fit_index < i.n_fits; fit_index++)
+    {
+        i.data.insert(i.data.end(), roi.begin(), roi.end());
+
+        std::vector< REAL > const initial{ { amplitude * .8f, 2.f, 2.f, 1.2f, 0.f } };
+        i.initial_parameters.insert(i.initial_parameters.end(), initial.begin(), initial.end());
+    }
+
+    i.model_id = GAUSS_2D;
+    i.estimator_id = LSE;
+    i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    i.tolerance = 1e-6f;
+    i.max_n_iterations = 20;
+    i.user_info_.clear();
+    i.weights_.clear();
+}
+
+// fits with outputs filled with garbage
+void run_cached_fit(FitInput & i, FitOutput & o)
+{
+    o.parameters.assign(i.n_fits * i.n_parameters, -1.f);
+    o.states.assign(i.n_fits, -1);
+    o.chi_squares.assign(i.n_fits, -1.f);
+    o.n_iterations.assign(i.n_fits, -1);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+struct CacheStatistics
+{
+    std::size_t n_hits;
+    std::size_t n_misses;
+    std::size_t n_entries;
+    std::size_t size;
+};
+
+CacheStatistics get_statistics(cpufit_result_cache * const cache)
+{
+    CacheStatistics s;
+    BOOST_CHECK(
+        cpufit_get_result_cache_statistics(cache, &s.n_hits, &s.n_misses, &s.n_entries, &s.size) == ReturnState::OK);
+
+    return s;
+}
+
+BOOST_AUTO_TEST_CASE( Result_Cache_Hits )
+{
+    /*
+    Repeats GAUSS_2D fits with a result cache.
+    - Checks that a repeated call returns the results of the first call from
+      the cache.
+    - Checks that a different tolerance, data value or user info misses.
+    - Checks that clearing the cache removes its files.
+    - Checks that calls without a cache set are not cached.
+    */
+
+    CacheDirectory directory;
+    cpufit_result_cache * const cache = cpufit_open_result_cache(directory.path.c_str(), 1 << 20);
+    BOOST_REQUIRE(cache);
+    BOOST_CHECK(cpufit_set_result_cache(cache) == ReturnState::OK);
+
+    FitInput input;
+    generate_cached_gauss_2d(input, 10.f);
+
+    FitOutput first_output;
+    run_cached_fit(input, first_output);
+
+    CacheStatistics statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits == 0);
+    BOOST_CHECK(statistics.n_misses == 1);
+    BOOST_CHECK(statistics.n_entries == 1);
+    BOOST_CHECK(directory.names().size() == 1);
+
+    FitOutput cached_output;
+    run_cached_fit(input, cached_output);
+
+    statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits == 1);
+    BOOST_CHECK(cached_output.parameters == first_output.parameters);
+    BOOST_CHECK(cached_output.states == first_output.states);
+    BOOST_CHECK(cached_output.chi_squares == first_output.chi_squares);
+    BOOST_CHECK(cached_output.n_iterations == first_output.n_iterations);
+
+    FitOutput output;
+
+    input.tolerance = 1e-5f;
+    run_cached_fit(input, output);
+    input.tolerance = 1e-6f;
+
+    input.data[100] += 1e-3f;
+    run_cached_fit(input, output);
+    input.data[100] -= 1e-3f;
+
+    // LSE ignores user info, which is still part of the key
+    input.user_info_.assign(4, 0);
+    run_cached_fit(input, output);
+    input.user_info_.clear();
+
+    statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits == 1);
+    BOOST_CHECK(statistics.n_misses == 4);
+    BOOST_CHECK(statistics.n_entries == 4);
+
+    BOOST_CHECK(cpufit_clear_result_cache(cache) == ReturnState::OK);
+    BOOST_CHECK(directory.names().empty());
+    BOOST_CHECK(get_statistics(cache).n_entries == 0);
+
+    run_cached_fit(input, output);
+    BOOST_CHECK(get_statistics(cache).n_misses == 5);
+    BOOST_CHECK(output.parameters == first_output.parameters);
+
+    BOOST_CHECK(cpufit_set_result_cache(0) == ReturnState::OK);
+    run_cached_fit(input, output);
+    BOOST_CHECK(get_statistics(cache).n_hits == 1);
+
+    BOOST_CHECK(cpufit_close_result_cache(cache) == ReturnState::OK);
+}
+
+BOOST_AUTO_TEST_CASE( Result_Cache_Eviction )
+{
+    /*
+    Fills a result cache which holds two sets of results.
+    - Checks that the least recently used results are removed.
+    - Checks that a cache opened again finds the stored results.
+    - Checks that a damaged file is a miss and is removed.
+    */
+
+    CacheDirectory directory;
+
+    FitInput inputs[3];
+    for (int i = 0; i < 3; i++)
+        generate_cached_gauss_2d(inputs[i], 10.f + i);
+
+    cpufit_result_cache * cache = cpufit_open_result_cache(directory.path.c_str(), 1 << 20);
+    BOOST_REQUIRE(cache);
+    cpufit_set_result_cache(cache);
+
+    FitOutput output;
+    run_cached_fit(inputs[0], output);
+    std::size_t const entry_size = get_statistics(cache).size;
+    cpufit_close_result_cache(cache);
+
+    // the entry of the first fits is found and used after the second
+    cache = cpufit_open_result_cache(directory.path.c_str(), 2 * entry_size + entry_size / 2);
+    BOOST_REQUIRE(cache);
+    cpufit_set_result_cache(cache);
+    BOOST_CHECK(get_statistics(cache).n_entries == 1);
+
+    run_cached_fit(inputs[1], output);
+    run_cached_fit(inputs[0], output);
+    run_cached_fit(inputs[2], output);
+
+    CacheStatistics statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits == 1);
+    BOOST_CHECK(statistics.n_entries == 2);
+    BOOST_CHECK(statistics.size == 2 * entry_size);
+    BOOST_CHECK(directory.names().size() == 2);
+
+    run_cached_fit(inputs[0], output);
+    run_cached_fit(inputs[2], output);
+    run_cached_fit(inputs[1], output);
+
+    statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits == 3);
+    BOOST_CHECK(statistics.n_misses == 3);
+
+    // truncated entries
+    for (std::string const & name : directory.names())
+        truncate((directory.path + "/" + name).c_str(), 10);
+
+    run_cached_fit(inputs[2], output);
+    BOOST_CHECK(get_statistics(cache).n_misses == 4);
+    BOOST_CHECK(output.states[0] == FitState::CONVERGED);
+
+    cpufit_close_result_cache(cache);
+
+    BOOST_CHECK(cpufit_open_result_cache(0, 0) == 0);
+}
+
+void * allocate_counted(std::size_t const size, void * const context)
+{
+    ++*static_cast<std::size_t *>(context);
+    return std::malloc(size);
+}
+
+void free_counted(void * const pointer, std::size_t, void *)
+{
+    std::free(pointer);
+}
+
+BOOST_AUTO_TEST_CASE( Result_Cache_Removed_Entries_And_Allocator_Hooks )
+{
+    /*
+    Repeats GAUSS_2D fits with a result cache while another thread removes its
+    files, then with allocator hooks.
+    - Checks that entries removed while they are read are misses, not errors.
+    - Checks that calls with allocator hooks bypass the cache.
+    */
+
+    CacheDirectory directory;
+    cpufit_result_cache * const cache = cpufit_open_result_cache(directory.path.c_str(), 1 << 20);
+    BOOST_REQUIRE(cache);
+    BOOST_CHECK(cpufit_set_result_cache(cache) == ReturnState::OK);
+
+    FitInput input;
+    generate_cached_gauss_2d(input, 10.f);
+
+    FitOutput first_output;
+    run_cached_fit(input, first_output);
+
+    std::atomic<bool> done(false);
+    std::thread remover([&]()
+    {
+        while (!done)
+        {
+            for (std::string const & name : directory.names())
+                std::remove((directory.path + "/" + name).c_str());
+        }
+    });
+
+    std::size_t const n_calls = 5000;
+    FitOutput output;
+
+    for (std::size_t i = 0; i < n_calls; i++)
+    {
+        run_cached_fit(input, output);
+        BOOST_CHECK(output.parameters == first_output.parameters);
+    }
+
+    done = true;
+    remover.join();
+
+    CacheStatistics statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits + statistics.n_misses == n_calls + 1);
+
+    // the entry is stored again and found without hooks
+    run_cached_fit(input, output);
+    run_cached_fit(input, output);
+    statistics = get_statistics(cache);
+    BOOST_CHECK(statistics.n_hits + statistics.n_misses == n_calls + 3);
+
+    std::size_t n_allocations = 0;
+    BOOST_CHECK(cpufit_set_allocator(allocate_counted, free_counted, &n_allocations) == ReturnState::OK);
+    run_cached_fit(input, output);
+    BOOST_CHECK(cpufit_set_allocator(0, 0, 0) == ReturnState::OK);
+
+    BOOST_CHECK(n_allocations > 0);
+    BOOST_CHECK(output.parameters == first_output.parameters);
+    BOOST_CHECK(get_statistics(cache).n_hits + get_statistics(cache).n_misses == n_calls + 3);
+
+    BOOST_CHECK(cpufit_set_result_cache(0) == ReturnState::OK);
+    BOOST_CHECK(cpufit_close_result_cache(cache) == ReturnState::OK);
+}
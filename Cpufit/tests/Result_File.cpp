@@ -0,0 +1,473 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "Cpufit/result_file.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the results of GAUSS_2D fits with Poisson noise
+void fit_gauss_2d(std::size_t const n_fits, FitOutput & o)
+{
+    std::size_t const n_points = 25;
+    std::size_t const n_parameters = 5;
+
+    std::vector< REAL > data;
+    std::vector< REAL > initial_parameters;
+    std::vector< REAL > roi(n_points);
+    std::poisson_distribution< int > noise_generator;
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        generate_gauss_2d(roi, { 100.f, 2.f, 2.f, .8f, 2.f });
+
+        for (std::size_t point_index = 0; point_index < n_points; point_index++)
+        {
+            noise_generator = std::poisson_distribution< int >(roi[point_index]);
+            data.push_back(REAL(noise_generator(rng)));
+        }
+
+        initial_parameters.insert(initial_parameters.end(), { 80.f, 2.2f, 1.8f, 1.f, 1.f });
+    }
+
+    std::vector< int > parameters_to_fit{ 1, 1, 1, 1, 1 };
+
+    clean_resize(o.parameters, n_fits * n_parameters);
+    clean_resize(o.states, n_fits);
+    clean_resize(o.chi_squares, n_fits);
+    clean_resize(o.n_iterations, n_fits);
+
+    int const status
+        = cpufit
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            1e-6f,
+            20,
+            parameters_to_fit.data(),
+            MLE,
+            0,
+            0,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+// writes the results in blocks of the given sizes
+void write_result_file(
+    std::string const & path,
+    FitOutput & o,
+    std::vector< std::size_t > const & block_sizes,
+    int * column_encodings)
+{
+    cpufit_result_writer * const writer = cpufit_open_result_writer(path.c_str(), GAUSS_2D, column_encodings);
+    BOOST_REQUIRE(writer);
+
+    std::size_t first_fit = 0;
+
+    for (std::size_t const n_fits : block_sizes)
+    {
+        int const status
+            = cpufit_write_results
+            (
+                writer,
+                n_fits,
+                o.parameters.data() + first_fit * 5,
+                o.states.data() + first_fit,
+                o.chi_squares.data() + first_fit,
+                o.n_iterations.data() + first_fit
+            );
+
+        BOOST_CHECK(status == ReturnState::OK);
+        first_fit += n_fits;
+    }
+
+    BOOST_CHECK(cpufit_close_result_writer(writer) == ReturnState::OK);
+}
+
+std::size_t get_file_size(std::string const & path)
+{
+    struct stat status;
+    stat(path.c_str(), &status);
+
+    return std::size_t(status.st_size);
+}
+
+BOOST_AUTO_TEST_CASE( Result_File_Encodings )
+{
+    /*
+    Writes the results of 1000 GAUSS_2D fits in blocks of 100, 400 and 500
+    fits, raw, with all columns bit packed and with all columns delta encoded.
+    - Checks the header, the parameter names and the number of blocks.
+    - Checks that all results and a range across blocks are read back
+      unchanged.
+    - Checks that encoding makes the file smaller.
+    */
+
+    FitOutput output;
+    fit_gauss_2d(1000, output);
+
+    std::string const path = "Result_File_Encodings.cpufit";
+    std::size_t raw_size = 0;
+
+    for (int const encoding : { RAW_ENCODING, BIT_PACKED_ENCODING, DELTA_ENCODING })
+    {
+        std::vector< int > encodings(5 + 3, encoding);
+        write_result_file(path, output, { 100, 400, 500 }, encodings.data());
+
+        cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+        BOOST_REQUIRE(reader);
+
+        int model_id;
+        std::size_t n_parameters;
+        std::size_t n_fits;
+        std::size_t n_blocks;
+        BOOST_CHECK(cpufit_get_result_header(reader, &model_id, &n_parameters, &n_fits, &n_blocks) == ReturnState::OK);
+        BOOST_CHECK(model_id == GAUSS_2D);
+        BOOST_CHECK(n_parameters == 5);
+        BOOST_CHECK(n_fits == 1000);
+        BOOST_CHECK(n_blocks == 3);
+
+        BOOST_CHECK(std::string(cpufit_get_result_parameter_name(reader, 0)) == "amplitude");
+        BOOST_CHECK(std::string(cpufit_get_result_parameter_name(reader, 4)) == "offset");
+        BOOST_CHECK(!cpufit_get_result_parameter_name(reader, 5));
+
+        FitOutput read_output;
+        clean_resize(read_output.parameters, 1000 * 5);
+        clean_resize(read_output.states, 1000);
+        clean_resize(read_output.chi_squares, 1000);
+        clean_resize(read_output.n_iterations, 1000);
+
+        int status
+            = cpufit_read_results
+            (
+                reader,
+                0,
+                1000,
+                read_output.parameters.data(),
+                read_output.states.data(),
+                read_output.chi_squares.data(),
+                read_output.n_iterations.data()
+            );
+
+        BOOST_CHECK(status == ReturnState::OK);
+        BOOST_CHECK(read_output.parameters == output.parameters);
+        BOOST_CHECK(read_output.states == output.states);
+        BOOST_CHECK(read_output.chi_squares == output.chi_squares);
+        BOOST_CHECK(read_output.n_iterations == output.n_iterations);
+
+        // fits 50 ... 549, states only
+        std::vector< int > states(500);
+        status = cpufit_read_results(reader, 50, 500, 0, states.data(), 0, 0);
+        BOOST_CHECK(status == ReturnState::OK);
+        BOOST_CHECK(std::equal(states.begin(), states.end(), output.states.begin() + 50));
+
+        status = cpufit_read_results(reader, 900, 101, 0, states.data(), 0, 0);
+        BOOST_CHECK(status == ReturnState::ERROR);
+
+        BOOST_CHECK(cpufit_close_result_reader(reader) == ReturnState::OK);
+
+        if (encoding == RAW_ENCODING)
+            raw_size = get_file_size(path);
+        else
+            BOOST_CHECK(get_file_size(path) < raw_size);
+    }
+
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( Result_File_Mapped_Columns )
+{
+    /*
+    Writes the results of 300 GAUSS_2D fits in blocks of 200 and 100 fits with
+    raw parameters and bit packed states and numbers of iterations.
+    - Checks that raw columns are mapped without copying.
+    - Checks that bit packed columns are not mapped.
+    */
+
+    FitOutput output;
+    fit_gauss_2d(300, output);
+
+    std::string const path = "Result_File_Mapped_Columns.cpufit";
+    std::vector< int > encodings{ 0, 0, 0, 0, 0, BIT_PACKED_ENCODING, RAW_ENCODING, DELTA_ENCODING };
+    write_result_file(path, output, { 200, 100 }, encodings.data());
+
+    cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+    BOOST_REQUIRE(reader);
+
+    std::size_t n_values = 0;
+    REAL const * const center_x
+        = static_cast< REAL const * >(cpufit_map_result_column(reader, 1, 1, &n_values));
+
+    BOOST_REQUIRE(center_x);
+    BOOST_CHECK(n_values == 100);
+
+    for (std::size_t i = 0; i < n_values; i++)
+        BOOST_CHECK(center_x[i] == output.parameters[(200 + i) * 5 + 1]);
+
+    REAL const * const chi_squares
+        = static_cast< REAL const * >(cpufit_map_result_column(reader, 0, 6, &n_values));
+
+    BOOST_REQUIRE(chi_squares);
+    BOOST_CHECK(std::equal(chi_squares, chi_squares + n_values, output.chi_squares.begin()));
+
+    BOOST_CHECK(!cpufit_map_result_column(reader, 0, 5, &n_values));
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "only raw columns can be mapped");
+
+    cpufit_close_result_reader(reader);
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( Result_File_Truncated )
+{
+    /*
+    Writes the results of 300 GAUSS_2D fits in blocks of 100 fits and cuts
+    off the end of the last block, as if it was still being written.
+    - Checks that the reader finds the two complete blocks.
+    - Checks that unknown encodings and files are rejected.
+    */
+
+    FitOutput output;
+    fit_gauss_2d(300, output);
+
+    std::string const path = "Result_File_Truncated.cpufit";
+    write_result_file(path, output, { 100, 100, 100 }, 0);
+
+    BOOST_CHECK(truncate(path.c_str(), off_t(get_file_size(path) - 8)) == 0);
+
+    cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+    BOOST_REQUIRE(reader);
+
+    int model_id;
+    std::size_t n_parameters;
+    std::size_t n_fits;
+    std::size_t n_blocks;
+    cpufit_get_result_header(reader, &model_id, &n_parameters, &n_fits, &n_blocks);
+    BOOST_CHECK(n_fits == 200);
+    BOOST_CHECK(n_blocks == 2);
+
+    std::vector< REAL > parameters(200 * 5);
+    BOOST_CHECK(cpufit_read_results(reader, 0, 200, parameters.data(), 0, 0, 0) == ReturnState::OK);
+    BOOST_CHECK(std::equal(parameters.begin(), parameters.end(), output.parameters.begin()));
+
+    cpufit_close_result_reader(reader);
+
+    std::vector< int > encodings(8, 3);
+    BOOST_CHECK(!cpufit_open_result_writer(path.c_str(), GAUSS_2D, encodings.data()));
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "unknown column encoding");
+
+    std::remove(path.c_str());
+
+    BOOST_CHECK(!cpufit_open_result_reader(path.c_str()));
+}
+
+// an executor of a host application which runs parallel_for() on the calling
+// thread and queues jobs until the application runs them
+struct HostExecutor
+{
+    std::vector< std::function< void() > > jobs;
+};
+
+void host_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void *)
+{
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+}
+
+void host_submit(cpufit_job_function job, void * job_context, void * executor_context)
+{
+    HostExecutor & executor = *static_cast<HostExecutor *>(executor_context);
+
+    executor.jobs.push_back([job, job_context] { job(job_context); });
+}
+
+void check_result_file(std::string const & path, FitOutput const & o)
+{
+    cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+    BOOST_REQUIRE(reader);
+
+    std::size_t const n_fits = o.states.size();
+
+    FitOutput read_output;
+    clean_resize(read_output.parameters, n_fits * 5);
+    clean_resize(read_output.states, n_fits);
+    clean_resize(read_output.chi_squares, n_fits);
+    clean_resize(read_output.n_iterations, n_fits);
+
+    int const status
+        = cpufit_read_results
+        (
+            reader,
+            0,
+            n_fits,
+            read_output.parameters.data(),
+            read_output.states.data(),
+            read_output.chi_squares.data(),
+            read_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(read_output.parameters == o.parameters);
+    BOOST_CHECK(read_output.states == o.states);
+    BOOST_CHECK(read_output.chi_squares == o.chi_squares);
+    BOOST_CHECK(read_output.n_iterations == o.n_iterations);
+
+    cpufit_close_result_reader(reader);
+}
+
+BOOST_AUTO_TEST_CASE( Result_File_External_Executor )
+{
+    /*
+    Writes the results of 300 GAUSS_2D fits in blocks of 100 fits with an
+    executor registered which queues jobs, and with an executor without a
+    submit function.
+    - Checks that the blocks are written by one job of the executor, which
+      writes nothing before it runs.
+    - Checks that without a submit function the blocks are written when they
+      arrive.
+    - Checks that the results are read back unchanged.
+    */
+
+    FitOutput output;
+    fit_gauss_2d(300, output);
+
+    std::string const path = "Result_File_External_Executor.cpufit";
+
+    HostExecutor executor;
+    BOOST_REQUIRE(cpufit_set_executor(host_parallel_for, host_submit, 2, &executor) == ReturnState::OK);
+
+    cpufit_result_writer * const writer = cpufit_open_result_writer(path.c_str(), GAUSS_2D, 0);
+    BOOST_REQUIRE(writer);
+
+    std::size_t const header_size = get_file_size(path);
+
+    for (std::size_t first_fit = 0; first_fit < 300; first_fit += 100)
+    {
+        int const status
+            = cpufit_write_results
+            (
+                writer,
+                100,
+                output.parameters.data() + first_fit * 5,
+                output.states.data() + first_fit,
+                output.chi_squares.data() + first_fit,
+                output.n_iterations.data() + first_fit
+            );
+
+        BOOST_CHECK(status == ReturnState::OK);
+    }
+
+    BOOST_CHECK(executor.jobs.size() == 1);
+    BOOST_CHECK(get_file_size(path) == header_size);
+
+    for (std::size_t i = 0; i < executor.jobs.size(); i++)
+        executor.jobs[i]();
+
+    BOOST_CHECK(get_file_size(path) > header_size);
+    BOOST_CHECK(cpufit_close_result_writer(writer) == ReturnState::OK);
+
+    check_result_file(path, output);
+
+    BOOST_REQUIRE(cpufit_set_executor(host_parallel_for, 0, 2, &executor) == ReturnState::OK);
+
+    write_result_file(path, output, { 100, 100, 100 }, 0);
+    check_result_file(path, output);
+
+    BOOST_CHECK(cpufit_set_executor(0, 0, 0, 0) == ReturnState::OK);
+
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( Result_File_Corrupt_Columns )
+{
+    /*
+    Writes the results of 100 GAUSS_2D fits with bit packed columns and
+    changes the column headers of the block: a value size which does not
+    match the column, a bit width of 65, a packed column and a raw column
+    which are shorter than their values, and a column which ends beyond the
+    block.
+    - Checks that each file is rejected as corrupt.
+    */
+
+    FitOutput output;
+    fit_gauss_2d(100, output);
+
+    std::string const path = "Result_File_Corrupt_Columns.cpufit";
+    std::vector< int > encodings(8, BIT_PACKED_ENCODING);
+    encodings[0] = RAW_ENCODING;
+    write_result_file(path, output, { 100 }, encodings.data());
+
+    std::vector< char > file;
+    {
+        std::ifstream stream(path, std::ios::binary);
+        file.assign(std::istreambuf_iterator< char >(stream), std::istreambuf_iterator< char >());
+    }
+
+    std::size_t const columns_offset
+        = sizeof(ResultFileHeader) + 5 * result_parameter_name_size + sizeof(ResultBlockHeader);
+
+    auto const get_column = [&](std::vector< char > const & f, std::size_t const column_index)
+    {
+        ResultColumn column;
+        std::memcpy(&column, f.data() + columns_offset + column_index * sizeof(ResultColumn), sizeof(column));
+        return column;
+    };
+
+    auto const check_corrupt = [&](std::size_t const column_index, std::function< void(ResultColumn &) > const & change)
+    {
+        std::vector< char > corrupt_file = file;
+        ResultColumn column = get_column(file, column_index);
+        change(column);
+        std::memcpy(corrupt_file.data() + columns_offset + column_index * sizeof(ResultColumn), &column, sizeof(column));
+
+        {
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(corrupt_file.data(), std::streamsize(corrupt_file.size()));
+        }
+
+        BOOST_CHECK(!cpufit_open_result_reader(path.c_str()));
+        BOOST_CHECK(std::string(cpufit_get_last_error()) == path + " is corrupt");
+    };
+
+    BOOST_REQUIRE(get_column(file, 0).encoding == RAW_ENCODING);
+    BOOST_REQUIRE(get_column(file, 1).encoding == BIT_PACKED_ENCODING);
+    BOOST_REQUIRE(get_column(file, 1).bit_width > 0);
+
+    cpufit_result_reader * const reader = cpufit_open_result_reader(path.c_str());
+    BOOST_CHECK(reader);
+    cpufit_close_result_reader(reader);
+
+    check_corrupt(5, [](ResultColumn & c) { c.value_size = 8; });
+    check_corrupt(1, [](ResultColumn & c) { c.value_size = 64; });
+    check_corrupt(1, [](ResultColumn & c) { c.bit_width = 65; });
+    check_corrupt(1, [](ResultColumn & c) { c.size -= 8; });
+    check_corrupt(0, [](ResultColumn & c) { c.size = 4; });
+    check_corrupt(2, [](ResultColumn & c) { c.offset = ~std::uint64_t(0) - 4; });
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,184 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( Result_Filter )
+{
+    /*
+    Performs 20000 GAUSS_2D fits with Poisson noise and centers partly
+    outside of the ROIs, in two blocks, and keeps the converged fits with a
+    chi-square below the median and an x center between 1.5 and 3.
+    - Checks that the compacted outputs equal the accepted fits of an
+      unfiltered fit, with their indices in increasing order.
+    - Checks that a filter accepting all fits returns all fits.
+    */
+
+    FitInput input;
+    input.n_fits = 20000;
+    input.n_points = 25;
+    input.n_parameters = 5;
+
+    std::vector< REAL > roi(input.n_points);
+    std::poisson_distribution< int > noise_generator;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        REAL const x = 1.f + 3.f * REAL(fit_index % 7) / 6.f;
+        generate_gauss_2d(roi, { 100.f, x, 2.f, .8f, 2.f });
+
+        for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        {
+            noise_generator = std::poisson_distribution< int >(roi[point_index]);
+            input.data.push_back(REAL(noise_generator(rng)));
+        }
+
+        input.initial_parameters.insert(input.initial_parameters.end(), { 80.f, 2.f, 2.f, 1.f, 1.f });
+    }
+
+    input.model_id = GAUSS_2D;
+    input.estimator_id = MLE;
+    input.parameters_to_fit = { 1, 1, 1, 1, 1 };
+    input.tolerance = 1e-4f;
+    input.max_n_iterations = 10;
+
+    FitOutput full_output;
+    clean_resize(full_output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(full_output.states, input.n_fits);
+    clean_resize(full_output.chi_squares, input.n_fits);
+    clean_resize(full_output.n_iterations, input.n_fits);
+
+    int status
+        = cpufit
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            full_output.parameters.data(),
+            full_output.states.data(),
+            full_output.chi_squares.data(),
+            full_output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    std::vector< REAL > sorted_chi_squares = full_output.chi_squares;
+    std::nth_element(sorted_chi_squares.begin(), sorted_chi_squares.begin() + input.n_fits / 2, sorted_chi_squares.end());
+    REAL const max_chi_square = sorted_chi_squares[input.n_fits / 2];
+
+    REAL const infinity = std::numeric_limits< REAL >::infinity();
+    std::vector< REAL > parameter_ranges
+        { -infinity, infinity, 1.5f, 3.f, -infinity, infinity, -infinity, infinity, -infinity, infinity };
+
+    std::size_t n_accepted_fits = 0;
+    std::vector< std::size_t > fit_indices(input.n_fits);
+    FitOutput output;
+    clean_resize(output.parameters, input.n_fits * input.n_parameters);
+    clean_resize(output.states, input.n_fits);
+    clean_resize(output.chi_squares, input.n_fits);
+    clean_resize(output.n_iterations, input.n_fits);
+
+    status
+        = cpufit_filtered
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            1 << FitState::CONVERGED,
+            max_chi_square,
+            parameter_ranges.data(),
+            &n_accepted_fits,
+            fit_indices.data(),
+            output.parameters.data(),
+            output.states.data(),
+            output.chi_squares.data(),
+            output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    std::size_t n_expected_fits = 0;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        REAL const * const parameters = full_output.parameters.data() + fit_index * input.n_parameters;
+
+        if (full_output.states[fit_index] != FitState::CONVERGED
+            || !(full_output.chi_squares[fit_index] <= max_chi_square)
+            || !(parameters[1] >= 1.5f && parameters[1] <= 3.f))
+            continue;
+
+        BOOST_REQUIRE(n_expected_fits < n_accepted_fits);
+        BOOST_CHECK(fit_indices[n_expected_fits] == fit_index);
+        BOOST_CHECK(output.states[n_expected_fits] == full_output.states[fit_index]);
+        BOOST_CHECK(output.chi_squares[n_expected_fits] == full_output.chi_squares[fit_index]);
+        BOOST_CHECK(output.n_iterations[n_expected_fits] == full_output.n_iterations[fit_index]);
+        BOOST_CHECK(std::equal(
+            parameters,
+            parameters + input.n_parameters,
+            output.parameters.begin() + n_expected_fits * input.n_parameters));
+
+        n_expected_fits++;
+    }
+
+    BOOST_CHECK(n_accepted_fits == n_expected_fits);
+    BOOST_CHECK(n_accepted_fits > input.n_fits / 10);
+    BOOST_CHECK(n_accepted_fits < input.n_fits / 2);
+
+    // all states, no chi-square bound and no parameter ranges
+    status
+        = cpufit_filtered
+        (
+            input.n_fits,
+            input.n_points,
+            input.data.data(),
+            0,
+            input.model_id,
+            input.initial_parameters.data(),
+            input.tolerance,
+            input.max_n_iterations,
+            input.parameters_to_fit.data(),
+            input.estimator_id,
+            0,
+            0,
+            ~0,
+            infinity,
+            0,
+            &n_accepted_fits,
+            fit_indices.data(),
+            output.parameters.data(),
+            output.states.data(),
+            output.chi_squares.data(),
+            output.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(n_accepted_fits == input.n_fits);
+    BOOST_CHECK(output.parameters == full_output.parameters);
+    BOOST_CHECK(output.states == full_output.states);
+    BOOST_CHECK(fit_indices[input.n_fits - 1] == input.n_fits - 1);
+}
@@ -0,0 +1,221 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the worker executable is built next to the test
+std::string get_worker_path()
+{
+    std::string const test_path = boost::unit_test::framework::master_test_suite().argv[0];
+    std::size_t const slash = test_path.rfind('/');
+
+    return (slash == std::string::npos ? std::string(".") : test_path.substr(0, slash)) + "/cpufit_worker";
+}
+
+int run_sharded_fit(FitInput & i, FitOutput & o, std::size_t const n_workers, std::string const & worker_path)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    return cpufit_sharded
+        (
+            n_workers,
+            worker_path.c_str(),
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
+
+void run_single_process_fit(FitInput & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+
+    int const status
+        = cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            i.weights(),
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            i.user_info_size(),
+            i.user_info(),
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+}
+
+void check_identical(FitOutput const & a, FitOutput const & b)
+{
+    BOOST_CHECK(a.states == b.states);
+    BOOST_CHECK(a.n_iterations == b.n_iterations);
+    BOOST_CHECK(a.chi_squares == b.chi_squares);
+    BOOST_CHECK(a.parameters == b.parameters);
+}
+
+BOOST_AUTO_TEST_CASE( Sharded_Fits )
+{
+    /*
+    Performs 1000 GAUSS_2D fits with Poisson noise in 3 worker processes.
+    - Checks that the results are identical to a fit in this process.
+    */
+
+    FitInput input;
+    generate_gauss_2d_fits(
+        input,
+        1000,
+        { 100.f, 2.f, 2.f, .8f, 2.f },
+        { 80.f, 2.f, 2.f, 1.f, 1.f },
+        true,
+        MLE);
+
+    FitOutput sharded_output;
+    int const status = run_sharded_fit(input, sharded_output, 3, get_worker_path());
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput output;
+    run_single_process_fit(input, output);
+
+    check_identical(sharded_output, output);
+}
+
+BOOST_AUTO_TEST_CASE( Sharded_Fits_Custom_X )
+{
+    /*
+    Performs 20 LINEAR_1D fits, each with its own x coordinates in user_info,
+    and with weights in 2 worker processes.
+    - Checks that the results are identical to a fit in this process.
+    */
+
+    FitInput input;
+    input.n_fits = 20;
+    input.n_points = 4;
+    input.n_parameters = 2;
+
+    for (std::size_t fit_index = 0; fit_index < input.n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < input.n_points; point_index++)
+        {
+            REAL const x = REAL(fit_index) + REAL(point_index * point_index);
+
+            input.user_info_.push_back(x);
+            input.data.push_back(REAL(fit_index) - 2 * x + (point_index % 2 ? .1f : -.1f));
+            input.weights_.push_back(1 + REAL(point_index));
+        }
+
+        input.initial_parameters.insert(input.initial_parameters.end(), { 0, 0 });
+    }
+
+    input.model_id = LINEAR_1D;
+    input.estimator_id = LSE;
+    input.parameters_to_fit = { 1, 1 };
+    input.tolerance = 1e-6f;
+    input.max_n_iterations = 10;
+
+    FitOutput sharded_output;
+    int const status = run_sharded_fit(input, sharded_output, 2, get_worker_path());
+    BOOST_CHECK(status == ReturnState::OK);
+
+    FitOutput output;
+    run_single_process_fit(input, output);
+
+    check_identical(sharded_output, output);
+}
+
+BOOST_AUTO_TEST_CASE( Worker_Failure )
+{
+    /*
+    Performs GAUSS_2D fits in 2 worker processes, of which the first one is
+    killed before it fits its shard.
+    - Checks that the shard is retried and the results are identical to a fit
+      in this process.
+    - Checks that the call fails once a shard failed in 3 worker processes.
+    - Checks that an unknown model is rejected.
+    */
+
+    char directory[] = "/tmp/cpufit_sharding_XXXXXX";
+    BOOST_REQUIRE(mkdtemp(directory));
+
+    std::string const marker = std::string(directory) + "/killed";
+    std::string const script = std::string(directory) + "/worker.sh";
+
+    std::ofstream(script)
+        << "#!/bin/sh\n"
+        << "if mkdir " << marker << " 2>/dev/null; then kill -9 $$; fi\n"
+        << "exec " << get_worker_path() << " \"$@\"\n";
+    chmod(script.c_str(), 0700);
+
+    FitInput input;
+    generate_gauss_2d_fits(
+        input,
+        100,
+        { 100.f, 2.f, 2.f, .8f, 2.f },
+        { 80.f, 2.f, 2.f, 1.f, 1.f },
+        true,
+        MLE);
+
+    FitOutput sharded_output;
+    int status = run_sharded_fit(input, sharded_output, 2, script);
+    BOOST_CHECK(status == ReturnState::OK);
+
+    struct stat marker_status;
+    BOOST_CHECK(stat(marker.c_str(), &marker_status) == 0);
+
+    FitOutput output;
+    run_single_process_fit(input, output);
+
+    check_identical(sharded_output, output);
+
+    rmdir(marker.c_str());
+    std::remove(script.c_str());
+    rmdir(directory);
+
+    // a worker which always fails
+    status = run_sharded_fit(input, sharded_output, 2, "/bin/false");
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()).find("failed in 3 worker processes") != std::string::npos);
+
+    input.model_id = -1;
+    status = run_sharded_fit(input, sharded_output, 2, get_worker_path());
+    BOOST_CHECK(status == ReturnState::ERROR);
+    BOOST_CHECK(std::string(cpufit_get_last_error()) == "unknown model ID");
+}
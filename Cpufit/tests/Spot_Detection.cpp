@@ -0,0 +1,218 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const frame_width{ 200 };
+std::size_t const frame_height{ 150 };
+
+// the centers of the spots in each frame, one across the border of two tiles
+std::vector< std::array< REAL, 2 > > const spot_centers{ {
+    { { 20.3f, 30.6f } },
+    { { 127.6f, 60.2f } },
+    { { 170.f, 131.4f } },
+    { { 60.5f, 100.5f } } } };
+
+void generate_frames(std::vector< REAL > & frames, std::size_t const n_frames)
+{
+    /*
+    Builds frames with Gaussian spots of amplitude 200, width 1.3 and
+    offset 10, shifted by the frame index, with Poisson noise.
+    */
+
+    frames.resize(n_frames * frame_width * frame_height);
+    std::poisson_distribution< int > noise_generator;
+
+    for (std::size_t frame = 0; frame < n_frames; frame++)
+    {
+        for (std::size_t y = 0; y < frame_height; y++)
+        {
+            for (std::size_t x = 0; x < frame_width; x++)
+            {
+                REAL value = 10.f;
+
+                for (std::array< REAL, 2 > const & center : spot_centers)
+                {
+                    REAL const dx = REAL(x) - center[0] - REAL(frame);
+                    REAL const dy = REAL(y) - center[1];
+                    value += 200.f * std::exp(-(dx * dx + dy * dy) / (2 * 1.3f * 1.3f));
+                }
+
+                noise_generator = std::poisson_distribution< int >(value);
+                frames[(frame * frame_height + y) * frame_width + x] = REAL(noise_generator(rng));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Spot_Detection_Gauss_2D )
+{
+    /*
+    Detects spots in three frames of two by two tiles and fits their ROIs
+    with GAUSS_2D and the estimated initial parameters.
+    - Checks that each spot is found once and no other spot is found.
+    - Checks that the initial parameters are close to the true parameters.
+    - Checks that the fitted centers equal the true centers.
+    */
+
+    std::size_t const n_frames{ 3 };
+    std::size_t const roi_size{ 9 };
+    std::size_t const n_points{ roi_size * roi_size };
+    std::size_t const n_parameters{ 5 };
+    std::size_t const max_n_spots{ 100 };
+
+    std::vector< REAL > frames;
+    generate_frames(frames, n_frames);
+
+    std::size_t n_spots = 0;
+    std::vector< std::size_t > corners(3 * max_n_spots);
+    std::vector< REAL > rois(max_n_spots * n_points);
+    std::vector< REAL > initial_parameters(max_n_spots * n_parameters);
+
+    int status
+        = cpufit_detect_spots
+        (
+            n_frames,
+            frame_width,
+            frame_height,
+            frames.data(),
+            1.3f,
+            5.f,
+            roi_size,
+            GAUSS_2D,
+            max_n_spots,
+            &n_spots,
+            corners.data(),
+            rois.data(),
+            initial_parameters.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_REQUIRE(n_spots == n_frames * spot_centers.size());
+
+    std::vector< REAL > parameters(n_spots * n_parameters);
+    std::vector< int > states(n_spots);
+    std::vector< REAL > chi_squares(n_spots);
+    std::vector< int > n_iterations(n_spots);
+    std::array< int, n_parameters > parameters_to_fit{ { 1, 1, 1, 1, 1 } };
+
+    status
+        = cpufit
+        (
+            n_spots,
+            n_points,
+            rois.data(),
+            0,
+            GAUSS_2D,
+            initial_parameters.data(),
+            1e-6f,
+            20,
+            parameters_to_fit.data(),
+            MLE,
+            0,
+            0,
+            parameters.data(),
+            states.data(),
+            chi_squares.data(),
+            n_iterations.data()
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+
+    for (std::size_t frame = 0; frame < n_frames; frame++)
+    {
+        for (std::array< REAL, 2 > const & center : spot_centers)
+        {
+            REAL const x = center[0] + REAL(frame);
+            REAL const y = center[1];
+            std::size_t n_matches = 0;
+
+            for (std::size_t i = 0; i < n_spots; i++)
+            {
+                REAL const * const initial = initial_parameters.data() + i * n_parameters;
+                REAL const * const fitted = parameters.data() + i * n_parameters;
+
+                if (corners[3 * i] != frame
+                    || std::abs(REAL(corners[3 * i + 1]) + initial[1] - x) > 1.f
+                    || std::abs(REAL(corners[3 * i + 2]) + initial[2] - y) > 1.f)
+                {
+                    continue;
+                }
+
+                n_matches++;
+
+                BOOST_CHECK(std::abs(initial[0] - 200.f) < 60.f);
+                BOOST_CHECK(std::abs(initial[3] - 1.3f) < .5f);
+                BOOST_CHECK(std::abs(initial[4] - 10.f) < 5.f);
+
+                BOOST_CHECK(states[i] == FitState::CONVERGED);
+                BOOST_CHECK(std::abs(REAL(corners[3 * i + 1]) + fitted[1] - x) < .2f);
+                BOOST_CHECK(std::abs(REAL(corners[3 * i + 2]) + fitted[2] - y) < .2f);
+                BOOST_CHECK(std::abs(fitted[3] - 1.3f) < .2f);
+            }
+
+            BOOST_CHECK(n_matches == 1);
+        }
+    }
+
+    // spots are ordered by frame, row and column
+    for (std::size_t i = 1; i < n_spots; i++)
+    {
+        BOOST_CHECK(corners[3 * i - 3] < corners[3 * i]
+            || (corners[3 * i - 3] == corners[3 * i] && corners[3 * i - 1] <= corners[3 * i + 2]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Spot_Detection_Outputs )
+{
+    /*
+    Detects spots with fewer outputs than spots and with invalid arguments.
+    - Checks that all spots are counted and the first ones are returned
+      without ROIs and initial parameters.
+    - Checks that ROIs larger than the frames and models without initial
+      parameter estimates are rejected.
+    */
+
+    std::vector< REAL > frames;
+    generate_frames(frames, 1);
+
+    std::size_t n_spots = 0;
+    std::array< std::size_t, 6 > corners;
+
+    int status
+        = cpufit_detect_spots
+        (
+            1,
+            frame_width,
+            frame_height,
+            frames.data(),
+            1.3f,
+            5.f,
+            7,
+            GAUSS_2D,
+            2,
+            &n_spots,
+            corners.data(),
+            0,
+            0
+        );
+
+    BOOST_CHECK(status == ReturnState::OK);
+    BOOST_CHECK(n_spots == spot_centers.size());
+    BOOST_CHECK(corners[0] == 0);
+    BOOST_CHECK(std::abs(REAL(corners[1] + 3) - spot_centers[0][0]) <= 1.f);
+    BOOST_CHECK(std::abs(REAL(corners[2] + 3) - spot_centers[0][1]) <= 1.f);
+
+    status = cpufit_detect_spots(1, frame_width, frame_height, frames.data(), 1.3f, 5.f, 151, GAUSS_2D, 2, &n_spots, corners.data(), 0, 0);
+    BOOST_CHECK(status == ReturnState::ERROR);
+
+    std::array< REAL, 2 * 4 > initial_parameters;
+    status = cpufit_detect_spots(1, frame_width, frame_height, frames.data(), 1.3f, 5.f, 7, LINEAR_1D, 2, &n_spots, corners.data(), 0, initial_parameters.data());
+    BOOST_CHECK(status == ReturnState::ERROR);
+}
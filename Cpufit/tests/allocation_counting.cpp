@@ -0,0 +1,128 @@
+#include "Cpufit/tests/allocation_counting.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic< bool > forbid_allocations(false);
+std::atomic< std::size_t > n_forbidden_allocations(0);
+
+void * operator new(std::size_t size)
+{
+    if (forbid_allocations)
+        n_forbidden_allocations++;
+
+    void * const pointer = std::malloc(size ? size : 1);
+
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void * operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+    if (forbid_allocations)
+        n_forbidden_allocations++;
+
+    return std::malloc(size ? size : 1);
+}
+
+// the deletes are not inlined, so that the compiler pairs them with the
+// replaced operator new instead of seeing std::free called on its pointers
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+NOINLINE void operator delete(void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+NOINLINE void operator delete(void * pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// the array forms are replaced as well, so that every delete matches a new
+// backed by std::malloc
+
+void * operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void * operator new[](std::size_t size, std::nothrow_t const & nothrow) noexcept
+{
+    return operator new(size, nothrow);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[](void * pointer, std::size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+std::atomic< std::size_t > n_hook_allocations(0);
+
+void * counting_allocate(std::size_t size, void *)
+{
+    n_hook_allocations++;
+
+    return std::malloc(size ? size : 1);
+}
+
+void counting_free(void * pointer, std::size_t, void *)
+{
+    std::free(pointer);
+}
+
+std::size_t n_executor_calls = 0;
+
+void counting_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void *)
+{
+    n_executor_calls++;
+
+    for (std::size_t i = 0; i < n_tasks; i++)
+        task(task_context, i);
+}
+
+void resize_output(FitInput const & i, FitOutput & o)
+{
+    clean_resize(o.parameters, i.n_fits * i.n_parameters);
+    clean_resize(o.states, i.n_fits);
+    clean_resize(o.chi_squares, i.n_fits);
+    clean_resize(o.n_iterations, i.n_fits);
+}
+
+int run_fits(FitInput & i, FitOutput & o)
+{
+    return cpufit
+        (
+            i.n_fits,
+            i.n_points,
+            i.data.data(),
+            0,
+            i.model_id,
+            i.initial_parameters.data(),
+            i.tolerance,
+            i.max_n_iterations,
+            i.parameters_to_fit.data(),
+            i.estimator_id,
+            0,
+            0,
+            o.parameters.data(),
+            o.states.data(),
+            o.chi_squares.data(),
+            o.n_iterations.data()
+        );
+}
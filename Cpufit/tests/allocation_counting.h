@@ -0,0 +1,36 @@
+#ifndef CPUFIT_TESTS_ALLOCATION_COUNTING_H_INCLUDED
+#define CPUFIT_TESTS_ALLOCATION_COUNTING_H_INCLUDED
+
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <atomic>
+#include <cstddef>
+
+// while allocations are forbidden, every call of the global operator new,
+// including those from within Cpufit, is counted as an error; the test
+// linking allocation_counting.cpp replaces the global operators new and delete
+extern std::atomic< bool > forbid_allocations;
+extern std::atomic< std::size_t > n_forbidden_allocations;
+
+// allocator hooks which count their allocations
+extern std::atomic< std::size_t > n_hook_allocations;
+
+void * counting_allocate(std::size_t size, void * allocator_context);
+void counting_free(void * pointer, std::size_t size, void * allocator_context);
+
+// an executor which counts its calls and runs the tasks on the calling thread
+extern std::size_t n_executor_calls;
+
+void counting_parallel_for(
+    std::size_t n_tasks,
+    cpufit_task_function task,
+    void * task_context,
+    void * executor_context);
+
+void resize_output(FitInput const & i, FitOutput & o);
+
+// fits without weights and user info into outputs sized by resize_output
+int run_fits(FitInput & i, FitOutput & o);
+
+#endif
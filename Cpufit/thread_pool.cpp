@@ -0,0 +1,446 @@
+#include "thread_pool.h"
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // lets the other hardware thread of the core run while a thread spins
+    void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+ThreadPool::ThreadPool(std::size_t const n_threads, std::vector<std::vector<int>> const & numa_nodes) :
+    real_time_(false),
+    n_nodes_(std::max(std::size_t(1), std::min(numa_nodes.size(), n_threads))),
+    task_ranges_(new TaskRange[n_nodes_]),
+    n_jobs_(0),
+    caller_workspace_in_use_(false),
+    task_(0),
+    task_context_(0),
+    n_busy_workers_(0),
+    accepting_workers_(false),
+    generation_(0),
+    stop_(false),
+    workspace_size_(0),
+    workers_pinned_(true),
+    n_ready_workers_(0)
+{
+    start_workers(n_threads, numa_nodes);
+}
+
+ThreadPool::ThreadPool(
+    std::size_t const n_threads,
+    std::vector<std::vector<int>> const & numa_nodes,
+    std::size_t const workspace_size) :
+    real_time_(true),
+    n_nodes_(std::max(std::size_t(1), std::min(numa_nodes.size(), n_threads))),
+    task_ranges_(new TaskRange[n_nodes_]),
+    n_jobs_(0),
+    caller_workspace_in_use_(false),
+    task_(0),
+    task_context_(0),
+    n_busy_workers_(0),
+    accepting_workers_(false),
+    generation_(0),
+    stop_(false),
+    workspace_size_(workspace_size),
+    workers_pinned_(false),
+    n_ready_workers_(0)
+{
+    // the workspaces of the workers are created and zeroed by the workers
+    // once they are pinned, so that their pages are on the nodes of the
+    // workers
+    workspaces_.resize(std::max(std::size_t(1), n_threads));
+    workspaces_[0].reset(new Workspace(workspace_size));
+
+    start_workers(n_threads, numa_nodes);
+
+    workers_pinned_ = true;
+
+    while (n_ready_workers_ != workers_.size())
+        cpu_relax();
+
+    if (error_)
+    {
+        stop_ = true;
+
+        for (std::thread & worker : workers_)
+            worker.join();
+
+        std::rethrow_exception(error_);
+    }
+}
+
+// the thread calling run() is one of the threads and belongs to the first
+// node, the workers are assigned to the nodes in contiguous blocks; with more
+// than one node, workers are pinned to the CPUs of their node, real-time
+// workers are pinned to single CPUs of the node whose tasks they process,
+// leaving the first CPU of the first node to the caller
+void ThreadPool::start_workers(std::size_t const n_threads, std::vector<std::vector<int>> const & numa_nodes)
+{
+    for (std::size_t i = 1; i < n_threads; i++)
+    {
+        std::size_t const node = i * n_nodes_ / n_threads;
+
+        if (real_time_)
+            workers_.emplace_back(&ThreadPool::spin, this, i, node);
+        else
+            workers_.emplace_back(&ThreadPool::work, this, node);
+
+        if (real_time_ && !numa_nodes.empty())
+        {
+            std::vector<int> const & node_cpus = numa_nodes[node];
+            std::size_t const first_thread_of_node = (node * n_threads + n_nodes_ - 1) / n_nodes_;
+
+            pin_thread(
+                workers_.back(),
+                std::vector<int>(1, node_cpus[(i - first_thread_of_node) % node_cpus.size()]));
+        }
+        else if (n_nodes_ > 1)
+        {
+            pin_thread(workers_.back(), numa_nodes[node]);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+
+    for (std::thread & worker : workers_)
+        worker.join();
+}
+
+std::size_t ThreadPool::n_threads() const
+{
+    return workers_.size() + 1;
+}
+
+bool ThreadPool::uses_workers(std::size_t const n_tasks) const
+{
+    return !workers_.empty() && n_tasks > 1;
+}
+
+// runs task(0) ... task(n_tasks - 1) and returns when all tasks are finished;
+// a pool busy with another caller runs the tasks on the calling thread; only
+// the workers which are idle join, so a long job does not hold up the call
+void ThreadPool::run(std::size_t const n_tasks, cpufit_task_function task, void * task_context)
+{
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+
+    if (!run_lock.owns_lock() || workers_.empty() || n_tasks < 2)
+    {
+        for (std::size_t i = 0; i < n_tasks; i++)
+            task(task_context, i);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        if (!real_time_)
+            lock.lock();
+
+        task_ = task;
+        task_context_ = task_context;
+
+        for (std::size_t node = 0; node < n_nodes_; node++)
+        {
+            task_ranges_[node].next = n_tasks * node / n_nodes_;
+            task_ranges_[node].end = n_tasks * (node + 1) / n_nodes_;
+        }
+
+        error_ = nullptr;
+        accepting_workers_ = true;
+        generation_++;
+    }
+
+    if (!real_time_)
+        start_.notify_all();
+
+    process_tasks(0);
+
+    // workers which have not joined until all tasks are taken are not
+    // waited for
+    if (real_time_)
+    {
+        accepting_workers_ = false;
+
+        while (n_busy_workers_ != 0)
+            cpu_relax();
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        accepting_workers_ = false;
+        done_.wait(lock, [this] { return n_busy_workers_ == 0; });
+    }
+
+    task_ = 0;
+
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+// runs a job on a worker, or on the calling thread if there are no workers
+void ThreadPool::submit(std::function<void()> job)
+{
+    if (workers_.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+        n_jobs_++;
+    }
+    start_.notify_one();
+}
+
+Workspace * ThreadPool::acquire_workspace()
+{
+    if (workspaces_.empty() || caller_workspace_in_use_.exchange(true))
+        return 0;
+
+    return workspaces_[0].get();
+}
+
+void ThreadPool::release_workspace(Workspace *)
+{
+    caller_workspace_in_use_ = false;
+}
+
+bool ThreadPool::pop_job(std::function<void()> & job)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (jobs_.empty())
+        return false;
+
+    job = std::move(jobs_.front());
+    jobs_.pop_front();
+    n_jobs_--;
+
+    return true;
+}
+
+// workers join parallel_for() calls before they run queued jobs, and finish
+// the queued jobs before they stop
+void ThreadPool::work(std::size_t const node)
+{
+    std::size_t generation = 0;
+
+    for (;;)
+    {
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&] { return stop_ || generation_ != generation || !jobs_.empty(); });
+
+            // a call which started while the worker ran a job may be over
+            if (generation_ != generation && !accepting_workers_)
+                generation = generation_;
+
+            if (generation_ != generation)
+            {
+                generation = generation_;
+                n_busy_workers_++;
+            }
+            else if (!jobs_.empty())
+            {
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+                n_jobs_--;
+            }
+            else if (stop_)
+            {
+                return;
+            }
+            else
+            {
+                continue;
+            }
+        }
+
+        if (job)
+        {
+            try
+            {
+                job();
+            }
+            catch (...)
+            {
+            }
+            continue;
+        }
+
+        process_tasks(node);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--n_busy_workers_ == 0)
+            done_.notify_one();
+    }
+}
+
+// real-time workers poll for parallel_for() calls and jobs without taking a
+// lock, and finish the queued jobs before they stop
+void ThreadPool::spin(std::size_t const worker_index, std::size_t const node)
+{
+    while (!workers_pinned_)
+        cpu_relax();
+
+    try
+    {
+        workspaces_[worker_index].reset(new Workspace(workspace_size_));
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+            error_ = std::current_exception();
+    }
+
+    n_ready_workers_++;
+
+    set_thread_workspace(workspaces_[worker_index].get());
+
+    std::size_t generation = 0;
+    std::function<void()> job;
+
+    while (!stop_)
+    {
+        std::size_t const current_generation = generation_;
+
+        if (current_generation != generation)
+        {
+            // the caller waits for the worker once it is counted; a call
+            // which is over by then is skipped
+            generation = current_generation;
+            n_busy_workers_++;
+
+            if (accepting_workers_)
+                process_tasks(node);
+
+            n_busy_workers_--;
+        }
+        else if (n_jobs_ != 0 && pop_job(job))
+        {
+            try
+            {
+                job();
+            }
+            catch (...)
+            {
+            }
+            job = nullptr;
+        }
+        else
+        {
+            cpu_relax();
+        }
+    }
+
+    while (pop_job(job))
+    {
+        try
+        {
+            job();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    set_thread_workspace(0);
+}
+
+void ThreadPool::process_tasks(std::size_t const node)
+{
+    for (std::size_t k = 0; k < n_nodes_; k++)
+    {
+        TaskRange & range = task_ranges_[(node + k) % n_nodes_];
+
+        for (std::size_t i = range.next++; i < range.end; i = range.next++)
+        {
+            try
+            {
+                task_(task_context_, i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+// the number of threads defaults to the number of hardware threads and can be
+// set by the environment variable CPUFIT_N_THREADS
+static std::size_t get_default_number_of_threads()
+{
+    char const * const n_threads = std::getenv("CPUFIT_N_THREADS");
+
+    if (n_threads && std::atoi(n_threads) > 0)
+        return std::size_t(std::atoi(n_threads));
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// NUMA placement is switched off by setting CPUFIT_NUMA to 0
+static std::vector<std::vector<int>> get_default_numa_nodes()
+{
+    char const * const numa = std::getenv("CPUFIT_NUMA");
+
+    if (numa && std::string(numa) == "0")
+        return std::vector<std::vector<int>>();
+
+    return get_numa_nodes();
+}
+
+std::shared_ptr<ThreadPool> get_thread_pool()
+{
+    static std::shared_ptr<ThreadPool> const thread_pool
+        = std::make_shared<ThreadPool>(get_default_number_of_threads(), get_default_numa_nodes());
+
+    return thread_pool;
+}
+
+// without a known NUMA topology, e.g. in containers without node sysfs, the
+// workers are pinned to the CPUs of the process as one node
+std::shared_ptr<ThreadPool> create_real_time_thread_pool(std::size_t const n_threads, std::size_t const workspace_size)
+{
+    std::vector<std::vector<int>> numa_nodes = get_numa_nodes();
+
+    if (numa_nodes.empty())
+    {
+        std::vector<int> const cpus = get_allowed_cpus();
+
+        if (!cpus.empty())
+            numa_nodes.push_back(cpus);
+    }
+
+    return std::make_shared<ThreadPool>(n_threads, numa_nodes, workspace_size);
+}
@@ -0,0 +1,93 @@
+#ifndef CPUFIT_THREAD_POOL_H_INCLUDED
+#define CPUFIT_THREAD_POOL_H_INCLUDED
+
+#include "executor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool : public Executor
+{
+public:
+    ThreadPool(std::size_t const n_threads, std::vector<std::vector<int>> const & numa_nodes);
+
+    // the real-time pool pins each worker to one CPU, keeps its workers
+    // spinning instead of waiting on condition variables and preallocates a
+    // workspace for each thread
+    ThreadPool(
+        std::size_t const n_threads,
+        std::vector<std::vector<int>> const & numa_nodes,
+        std::size_t const workspace_size);
+
+    virtual ~ThreadPool();
+
+    std::size_t n_threads() const;
+    void run(std::size_t const n_tasks, cpufit_task_function task, void * task_context);
+    bool uses_workers(std::size_t const n_tasks) const;
+    void submit(std::function<void()> job);
+
+    Workspace * acquire_workspace();
+    void release_workspace(Workspace * workspace);
+
+private:
+    struct TaskRange
+    {
+        std::atomic<std::size_t> next;
+        std::size_t end;
+    };
+
+    void start_workers(std::size_t const n_threads, std::vector<std::vector<int>> const & numa_nodes);
+    void work(std::size_t const node);
+    void spin(std::size_t const worker_index, std::size_t const node);
+    void process_tasks(std::size_t const node);
+    bool pop_job(std::function<void()> & job);
+
+    bool const real_time_;
+    std::vector<std::thread> workers_;
+
+    // each NUMA node works on a contiguous range of tasks before it helps
+    // the other nodes
+    std::size_t n_nodes_;
+    std::unique_ptr<TaskRange[]> task_ranges_;
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    std::deque<std::function<void()>> jobs_;
+    std::atomic<std::size_t> n_jobs_;
+
+    // workspace 0 belongs to the thread calling run()
+    std::vector<std::unique_ptr<Workspace>> workspaces_;
+    std::atomic<bool> caller_workspace_in_use_;
+
+    cpufit_task_function task_;
+    void * task_context_;
+    std::atomic<std::size_t> n_busy_workers_;
+
+    // workers may join the current parallel_for() call; workers busy with a
+    // job when it starts do not hold it up
+    std::atomic<bool> accepting_workers_;
+    std::atomic<std::size_t> generation_;
+    std::exception_ptr error_;
+    std::atomic<bool> stop_;
+
+    // real-time workers create their workspaces after they are pinned
+    std::size_t const workspace_size_;
+    std::atomic<bool> workers_pinned_;
+    std::atomic<std::size_t> n_ready_workers_;
+};
+
+std::shared_ptr<ThreadPool> get_thread_pool();
+std::shared_ptr<ThreadPool> create_real_time_thread_pool(std::size_t const n_threads, std::size_t const workspace_size);
+
+#endif
@@ -20,10 +20,10 @@ enum ModelID {
 };
 
 // estimator ID
-enum EstimatorID { LSE = 0, MLE = 1 };
+enum EstimatorID { LSE = 0, MLE = 1, LSE_POISSON_NEYMAN = 2, LSE_POISSON_PEARSON = 3 };
 
 // fit state
-enum FitState { CONVERGED = 0, MAX_ITERATION = 1, SINGULAR_HESSIAN = 2, NEG_CURVATURE_MLE = 3, GPU_NOT_READY = 4 };
+enum FitState { CONVERGED = 0, MAX_ITERATION = 1, SINGULAR_HESSIAN = 2, NEG_CURVATURE_MLE = 3, GPU_NOT_READY = 4, DEADLINE_EXCEEDED = 5, CANCELLED = 6 };
 
 // return state
 enum ReturnState { OK = 0, ERROR = -1 };
@@ -37,4 +37,10 @@ enum Bound { LOWER_BOUND = 0, UPPER_BOUND = 1 };
 // constraint type
 enum ConstraintType { NONE = 0, LOWER = 1, UPPER = 2, LOWER_UPPER = 3 };
 
+// priority class of concurrent fit calls (Cpufit only)
+enum PriorityClass { HIGH_PRIORITY = 0, NORMAL_PRIORITY = 1, LOW_PRIORITY = 2 };
+
+// encoding of a column in a result file (Cpufit only)
+enum ColumnEncoding { RAW_ENCODING = 0, BIT_PACKED_ENCODING = 1, DELTA_ENCODING = 2 };
+
 #endif
@@ -3,6 +3,7 @@
 
 #include "lse.cuh"
 #include "mle.cuh"
+#include "lse_poisson.cuh"
 
 __device__ void calculate_chi_square(
     int const estimator_id,
@@ -23,6 +24,10 @@ __device__ void calculate_chi_square(
     case MLE:
         calculate_chi_square_mle(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
         break;
+    case LSE_POISSON_NEYMAN:
+    case LSE_POISSON_PEARSON:
+        calculate_chi_square_lse_poisson(estimator_id, chi_square, point_index, data, value);
+        break;
     default:
         assert(0); // unknown estimator ID
     }
@@ -48,6 +53,10 @@ __device__ void calculate_gradient(
     case MLE:
         calculate_gradient_mle(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
         break;
+    case LSE_POISSON_NEYMAN:
+    case LSE_POISSON_PEARSON:
+        calculate_gradient_lse_poisson(estimator_id, gradient, point_index, parameter_index, data, value, derivative);
+        break;
     default:
         assert(0); // unknown estimator ID
     }
@@ -76,6 +85,11 @@ __device__ void calculate_hessian(
         calculate_hessian_mle
         (hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
         break;
+    case LSE_POISSON_NEYMAN:
+    case LSE_POISSON_PEARSON:
+        calculate_hessian_lse_poisson
+        (estimator_id, hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative);
+        break;
     default:
         assert(0); // unknown estimator ID
     }
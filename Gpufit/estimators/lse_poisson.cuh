@@ -0,0 +1,181 @@
+#ifndef GPUFIT_LSE_POISSON_CUH_INCLUDED
+#define GPUFIT_LSE_POISSON_CUH_INCLUDED
+
+/* Description of the calculate_poisson_weight function
+* =====================================================
+*
+* This function calculates the implicit weight of a data point for the Poisson
+* weighted LSE estimators. The weight is the inverse of the estimated variance,
+* which is taken from the data (Neyman) or from the fitting curve (Pearson).
+* The variance estimate is bounded below by 1 to avoid division by zero for
+* empty pixels.
+*
+* Parameters:
+*
+* estimator_id: The estimator ID (LSE_POISSON_NEYMAN or LSE_POISSON_PEARSON).
+*
+* point_index: The data point index.
+*
+* data: An input vector of data values.
+*
+* value: An input vector of fitting curve values.
+*
+* Calling the calculate_poisson_weight function
+* =============================================
+*
+* This __device__ function can be only called from a __global__ function or an other
+* __device__ function.
+*
+*/
+
+__device__ REAL calculate_poisson_weight(
+    int const estimator_id,
+    int const point_index,
+    REAL const * data,
+    REAL const * value)
+{
+    REAL const variance
+        = estimator_id == LSE_POISSON_PEARSON
+        ? value[point_index]
+        : data[point_index];
+
+    return 1 / max(variance, REAL(1));
+}
+
+/* Description of the calculate_chi_square_lse_poisson function
+* =============================================================
+*
+* This function calculates the chi-square values for the Poisson weighted LSE
+* estimators. The weights are derived from the data or the fitting curve values
+* by calculate_poisson_weight instead of being read from a weight vector.
+*
+* Parameters:
+*
+* estimator_id: The estimator ID (LSE_POISSON_NEYMAN or LSE_POISSON_PEARSON).
+*
+* chi_square: An output vector of chi-square values for each data point.
+*
+* point_index: The data point index.
+*
+* data: An input vector of data values.
+*
+* value: An input vector of fitting curve values.
+*
+* Calling the calculate_chi_square_lse_poisson function
+* =====================================================
+*
+* This __device__ function can be only called from a __global__ function or an other
+* __device__ function.
+*
+*/
+
+__device__ void calculate_chi_square_lse_poisson(
+    int const estimator_id,
+    volatile REAL * chi_square,
+    int const point_index,
+    REAL const * data,
+    REAL const * value)
+{
+    REAL const deviation = value[point_index] - data[point_index];
+
+    chi_square[point_index]
+        = deviation * deviation
+        * calculate_poisson_weight(estimator_id, point_index, data, value);
+}
+
+/* Description of the calculate_hessian_lse_poisson function
+* ==========================================================
+*
+* This function calculates the hessian matrix values of the Poisson weighted LSE
+* estimators. The weights are treated as constant within one iteration.
+*
+* Parameters:
+*
+* estimator_id: The estimator ID (LSE_POISSON_NEYMAN or LSE_POISSON_PEARSON).
+*
+* hessian: An output vector of values of the hessian matrix for each data point.
+*
+* point_index: The data point index.
+*
+* parameter_index_i: Index of the hessian column.
+*
+* parameter_index_j: Index of the hessian row.
+*
+* data: An input vector of data values.
+*
+* value: An input vector of fitting curve values.
+*
+* derivative: An input vector of partial derivative values of the fitting
+*             curve with respect to the fitting parameters for each data point.
+*
+* Calling the calculate_hessian_lse_poisson function
+* ==================================================
+*
+* This __device__ function can be only called from a __global__ function or an other
+* __device__ function.
+*
+*/
+
+__device__ void calculate_hessian_lse_poisson(
+    int const estimator_id,
+    double * hessian,
+    int const point_index,
+    int const parameter_index_i,
+    int const parameter_index_j,
+    REAL const * data,
+    REAL const * value,
+    REAL const * derivative)
+{
+    *hessian
+        += derivative[parameter_index_i] * derivative[parameter_index_j]
+        * calculate_poisson_weight(estimator_id, point_index, data, value);
+}
+
+/* Description of the calculate_gradient_lse_poisson function
+* ===========================================================
+*
+* This function calculates the gradient values of the Poisson weighted LSE
+* estimators based on previously calculated fitting curve derivative values.
+*
+* Parameters:
+*
+* estimator_id: The estimator ID (LSE_POISSON_NEYMAN or LSE_POISSON_PEARSON).
+*
+* gradient: An output vector of values of the gradient vector for each data point.
+*
+* point_index: The data point index.
+*
+* parameter_index: The parameter index.
+*
+* data: An input vector of data values.
+*
+* value: An input vector of fitting curve values.
+*
+* derivative: An input vector of partial derivative values of the fitting
+*             curve with respect to the fitting parameters for each data point.
+*
+* Calling the calculate_gradient_lse_poisson function
+* ===================================================
+*
+* This __device__ function can be only called from a __global__ function or an other
+* __device__ function.
+*
+*/
+
+__device__ void calculate_gradient_lse_poisson(
+    int const estimator_id,
+    volatile REAL * gradient,
+    int const point_index,
+    int const parameter_index,
+    REAL const * data,
+    REAL const * value,
+    REAL const * derivative)
+{
+    REAL const deviation = data[point_index] - value[point_index];
+
+    gradient[point_index]
+        = derivative[parameter_index] * deviation
+        * calculate_poisson_weight(estimator_id, point_index, data, value);
+}
+
+#endif
@@ -3,7 +3,7 @@
 
 #include <string>
 
-std::string last_error ;
+thread_local std::string last_error ;
 
 int gpufit
 (
@@ -16,7 +16,17 @@ public enum Estimator {
     /**
      * Poisson maximum likelihood estimator
      */
-    MLE(1);
+    MLE(1),
+
+    /**
+     * Least-squares estimator with Poisson weights derived from the data (Neyman)
+     */
+    LSE_POISSON_NEYMAN(2),
+
+    /**
+     * Least-squares estimator with Poisson weights derived from the model (Pearson)
+     */
+    LSE_POISSON_PEARSON(3);
 
     public final int id;
 
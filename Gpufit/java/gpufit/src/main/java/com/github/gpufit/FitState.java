@@ -31,7 +31,17 @@ public enum FitState {
     /**
      * GPU not ready
      */
-    GPU_NOT_READY(4);
+    GPU_NOT_READY(4),
+
+    /**
+     * Time budget exceeded, fit truncated or skipped (Cpufit only)
+     */
+    DEADLINE_EXCEEDED(5),
+
+    /**
+     * Fit call cancelled before the fit started (Cpufit only)
+     */
+    CANCELLED(6);
 
     /**
      * Id is the same as the output of the Gpufit fit.
@@ -2,6 +2,8 @@ classdef EstimatorID
     properties (Constant = true)
         LSE = 0
         MLE = 1
+        LSE_POISSON_NEYMAN = 2
+        LSE_POISSON_PEARSON = 3
     end
     methods (Static)
         function v = validID(id)
@@ -65,6 +65,8 @@ class ModelID:
 class EstimatorID:
     LSE = 0
     MLE = 1
+    LSE_POISSON_NEYMAN = 2
+    LSE_POISSON_PEARSON = 3
 
 
 class ConstraintType:
@@ -0,0 +1,150 @@
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    Fits a number of frames, each a batch of fits, and prints the latency
+    statistics of the batches
+*/
+void run_frames(
+    std::string const & mode,
+    std::size_t const n_frames,
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    std::vector<REAL> & data,
+    std::vector<REAL> & initial_parameters,
+    std::vector<int> & parameters_to_fit)
+{
+    std::size_t const n_parameters = parameters_to_fit.size();
+
+    std::vector<REAL> output_parameters(n_fits * n_parameters);
+    std::vector<int> output_states(n_fits);
+    std::vector<REAL> output_chi_squares(n_fits);
+    std::vector<int> output_n_iterations(n_fits);
+
+    cpufit_reset_latency_statistics();
+
+    for (std::size_t frame = 0; frame < n_frames; frame++)
+    {
+        int const status
+            = cpufit
+            (
+                n_fits,
+                n_points,
+                data.data() + (frame % 10) * n_fits * n_points,
+                0,
+                GAUSS_2D,
+                initial_parameters.data(),
+                0.0001f,
+                10,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                output_parameters.data(),
+                output_states.data(),
+                output_chi_squares.data(),
+                output_n_iterations.data()
+            );
+
+        if (status != ReturnState::OK)
+        {
+            std::cout << "Error in cpufit: " << cpufit_get_last_error() << std::endl;
+            return;
+        }
+    }
+
+    std::size_t n_batches;
+    double p50, p99, max;
+    cpufit_get_latency_statistics(&n_batches, &p50, &p99, &max);
+
+    std::cout << std::setw(10) << mode << std::setw(3) << "|";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(10) << p50 << std::setw(10) << p99 << std::setw(10) << max << std::endl;
+}
+
+/*
+Measures the tail latency of closed-loop fitting, where each camera frame is
+a batch of small fits that must finish before the next frame arrives. The
+batches run on the internal thread pool and in real-time mode, with pinned,
+spinning workers and preallocated workspaces.
+
+The number of threads is set by the environment variable CPUFIT_N_THREADS
+(default: number of hardware threads). For meaningful results, the threads
+should not be shared with other processes.
+
+No weights, Model: GAUSS_2D, Estimator: LSE
+*/
+int main(int argc, char * argv[])
+{
+    std::cout << "------------------------" << std::endl;
+    std::cout << "Cpufit latency benchmark" << std::endl;
+    std::cout << "------------------------" << std::endl << std::endl;
+
+    char const * const n_threads_setting = std::getenv("CPUFIT_N_THREADS");
+    std::size_t const n_threads
+        = n_threads_setting && std::atoi(n_threads_setting) > 0
+        ? std::size_t(std::atoi(n_threads_setting))
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    // 10 different frames of 200 5x5 GAUSS_2D fits
+    std::size_t const n_frames = 5000;
+    std::size_t const n_fits = 200;
+    std::size_t const n_points = 25;
+
+    std::vector<REAL> data(10 * n_fits * n_points);
+    std::vector<REAL> initial_parameters(n_fits * 5);
+    std::vector<int> parameters_to_fit(5, 1);
+
+    std::uniform_real_distribution<REAL> uniform_dist(-.2f, .2f);
+    std::normal_distribution<REAL> noise(0, 5);
+    std::vector<REAL> roi(n_points);
+
+    for (std::size_t i = 0; i < 10 * n_fits; i++)
+    {
+        std::vector<REAL> const true_parameters
+            { { 500.f, 2.f + uniform_dist(rng), 2.f + uniform_dist(rng), 1.f, 10.f } };
+
+        generate_gauss_2d(roi, true_parameters);
+
+        for (std::size_t j = 0; j < n_points; j++)
+            data[i * n_points + j] = roi[j] + noise(rng);
+    }
+
+    for (std::size_t i = 0; i < n_fits; i++)
+    {
+        std::vector<REAL> const initial{ { 450.f, 2.f, 2.f, 1.2f, 8.f } };
+        std::copy(initial.begin(), initial.end(), initial_parameters.begin() + i * 5);
+    }
+
+    std::cout << n_threads << " threads, " << n_frames << " frames of " << n_fits << " fits" << std::endl << std::endl;
+
+    std::cout << std::setw(10) << "Mode" << std::setw(3) << "|";
+    std::cout << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    std::cout << std::setw(10) << "" << std::setw(3) << "|";
+    std::cout << std::setw(30) << "(microseconds)" << std::endl;
+    std::cout << "-------------------------------------------" << std::endl;
+
+    run_frames("default", n_frames, n_fits, n_points, data, initial_parameters, parameters_to_fit);
+
+    if (cpufit_set_real_time_mode(1, n_threads, 1 << 20) != ReturnState::OK)
+    {
+        std::cout << "Error in cpufit: " << cpufit_get_last_error() << std::endl;
+        return 1;
+    }
+
+    run_frames("real-time", n_frames, n_fits, n_points, data, initial_parameters, parameters_to_fit);
+
+    cpufit_set_real_time_mode(0, 0, 0);
+
+    std::cout << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "Cpufit/cpufit.h"
+#include "tests/utils.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+    Prints an environment variable or a default text
+*/
+void print_setting(char const * name, char const * default_value)
+{
+    char const * const value = std::getenv(name);
+
+    std::cout << std::setw(20) << std::left << name;
+    std::cout << (value ? value : default_value) << std::endl;
+}
+
+/*
+    Runs Cpufit and returns the execution time in milliseconds
+*/
+double run_cpufit(
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    std::vector<REAL> & data,
+    int const model_id,
+    std::vector<REAL> & initial_parameters,
+    std::vector<int> & parameters_to_fit)
+{
+    std::size_t const n_parameters = parameters_to_fit.size();
+
+    std::vector<REAL> output_parameters(n_fits * n_parameters);
+    std::vector<int> output_states(n_fits);
+    std::vector<REAL> output_chi_squares(n_fits);
+    std::vector<int> output_n_iterations(n_fits);
+
+    std::chrono::high_resolution_clock::time_point const t0 = std::chrono::high_resolution_clock::now();
+
+    int const status
+        = cpufit
+        (
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            model_id,
+            initial_parameters.data(),
+            0.0001f,
+            10,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    std::chrono::duration<double, std::milli> const dt = std::chrono::high_resolution_clock::now() - t0;
+
+    if (status != ReturnState::OK)
+        std::cout << "Error in cpufit: " << cpufit_get_last_error() << std::endl;
+
+    return dt.count();
+}
+
+/*
+Measures the Cpufit throughput for batches of small fits, which run one fit
+per thread, and the execution time of single large fits, which are split
+across the threads.
+
+The thread layout is set by environment variables:
+
+    CPUFIT_N_THREADS    number of threads (default: number of hardware threads)
+    CPUFIT_NUMA         0 disables NUMA placement (default: enabled)
+
+To compare 1- and 2-socket layouts on a 2-socket server, run e.g.
+
+    numactl --cpunodebind=0 --membind=0 ./Cpufit_Scaling_Benchmark
+    CPUFIT_NUMA=0 ./Cpufit_Scaling_Benchmark
+    ./Cpufit_Scaling_Benchmark
+
+No weights, Models: GAUSS_2D and GAUSS_1D, Estimator: LSE
+*/
+int main(int argc, char * argv[])
+{
+    std::cout << "------------------------" << std::endl;
+    std::cout << "Cpufit scaling benchmark" << std::endl;
+    std::cout << "------------------------" << std::endl << std::endl;
+
+    print_setting("CPUFIT_N_THREADS", "hardware threads");
+    print_setting("CPUFIT_NUMA", "1");
+    std::cout << std::endl;
+
+    // batches of 5x5 GAUSS_2D fits
+    std::size_t const n_points_2d = 25;
+    std::vector<std::size_t> const n_fits_all{ 1000, 10000, 100000, 1000000 };
+    std::size_t const max_n_fits = n_fits_all.back();
+
+    std::vector<REAL> data(max_n_fits * n_points_2d);
+    std::vector<REAL> initial_parameters(max_n_fits * 5);
+    std::vector<int> parameters_to_fit(5, 1);
+
+    std::uniform_real_distribution<REAL> uniform_dist(-.2f, .2f);
+    std::normal_distribution<REAL> noise(0, 5);
+    std::vector<REAL> roi(n_points_2d);
+
+    for (std::size_t i = 0; i < max_n_fits; i++)
+    {
+        std::vector<REAL> const true_parameters
+            { { 500.f, 2.f + uniform_dist(rng), 2.f + uniform_dist(rng), 1.f, 10.f } };
+
+        generate_gauss_2d(roi, true_parameters);
+
+        for (std::size_t j = 0; j < n_points_2d; j++)
+            data[i * n_points_2d + j] = roi[j] + noise(rng);
+
+        std::vector<REAL> const initial{ { 450.f, 2.f, 2.f, 1.2f, 8.f } };
+        std::copy(initial.begin(), initial.end(), initial_parameters.begin() + i * 5);
+    }
+
+    std::cout << std::right;
+    std::cout << std::setw(10) << "Number" << std::setw(3) << "|";
+    std::cout << std::setw(14) << "Cpufit speed" << std::endl;
+    std::cout << std::setw(10) << "of fits" << std::setw(3) << "|";
+    std::cout << std::setw(14) << "(fits/s)" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+
+    for (std::size_t const n_fits : n_fits_all)
+    {
+        double const dt = run_cpufit(n_fits, n_points_2d, data, GAUSS_2D, initial_parameters, parameters_to_fit);
+
+        std::cout << std::setw(10) << n_fits << std::setw(3) << "|";
+        std::cout << std::setw(14) << std::fixed << std::setprecision(0) << n_fits / dt * 1000 << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // single GAUSS_1D fits of many points
+    std::vector<std::size_t> const n_points_all{ 100000, 1000000, 10000000 };
+
+    std::cout << std::setw(10) << "Number" << std::setw(3) << "|";
+    std::cout << std::setw(14) << "Cpufit time" << std::endl;
+    std::cout << std::setw(10) << "of points" << std::setw(3) << "|";
+    std::cout << std::setw(14) << "(ms)" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+
+    for (std::size_t const n_points : n_points_all)
+    {
+        std::vector<REAL> const true_parameters
+            { { 100.f, REAL(n_points) / 2, REAL(n_points) / 10, 10.f } };
+
+        std::vector<REAL> line(n_points);
+        generate_gauss_1d(line, true_parameters);
+
+        std::vector<REAL> initial
+            { { 90.f, REAL(n_points) * .49f, REAL(n_points) * .11f, 9.f } };
+        std::vector<int> line_parameters_to_fit(4, 1);
+
+        double const dt = run_cpufit(1, n_points, line, GAUSS_1D, initial, line_parameters_to_fit);
+
+        std::cout << std::setw(10) << n_points << std::setw(3) << "|";
+        std::cout << std::setw(14) << std::fixed << std::setprecision(1) << dt << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    return 0;
+}
@@ -36,7 +36,7 @@ void generate_gauss_2d(std::vector< REAL > & v, std::vector< REAL > const & p)
         {
             REAL const argx = ((i - p[1]) * (i - p[1]));
             REAL const ex = exp(-(argx + argy) / (2 * p[3] * p[3]));
-            v[j * n + i] = p[0] * ex + p[3];
+            v[j * n + i] = p[0] * ex + p[4];
         }
     }
 }
@@ -56,7 +56,54 @@ void generate_gauss_2d_elliptic(std::vector< REAL > & v, std::vector< REAL > con
         {
             REAL const argx = ((i - p[1]) * (i - p[1])) / (2 * p[3] * p[3]);
             REAL const ex = exp(-(argx + argy));
-            v[j * n + i] = p[0] * ex + p[3];
+            v[j * n + i] = p[0] * ex + p[5];
         }
     }
 }
+
+void generate_gauss_2d_fits(
+	FitInput & i,
+	std::size_t const n_fits,
+	std::vector< REAL > const & true_parameters,
+	std::vector< REAL > const & initial_parameters,
+	bool const poisson_noise,
+	int const estimator_id)
+{
+	i.n_fits = n_fits;
+	i.n_points = 25;
+	i.n_parameters = 5;
+
+	i.data.clear();
+	i.weights_.clear();
+	i.initial_parameters.clear();
+	i.user_info_.clear();
+
+	std::vector< REAL > roi(i.n_points);
+	generate_gauss_2d(roi, true_parameters);
+
+	std::poisson_distribution< int > noise_generator;
+
+	for (std::size_t fit_index = 0; fit_index < i.n_fits; fit_index++)
+	{
+		for (std::size_t point_index = 0; point_index < i.n_points; point_index++)
+		{
+			if (poisson_noise)
+			{
+				noise_generator = std::poisson_distribution< int >(roi[point_index]);
+				i.data.push_back(REAL(noise_generator(rng)));
+			}
+			else
+			{
+				i.data.push_back(roi[point_index]);
+			}
+		}
+
+		i.initial_parameters.insert(i.initial_parameters.end(), initial_parameters.begin(), initial_parameters.end());
+	}
+
+	i.model_id = GAUSS_2D;
+	i.estimator_id = estimator_id;
+	i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+	i.tolerance = 1e-6f;
+	i.max_n_iterations = 20;
+}
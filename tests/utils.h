@@ -174,4 +174,16 @@ struct FitOutput
 	std::vector< int > n_iterations;
 };
 
+/*
+Fills i with n_fits GAUSS_2D fits of 5x5 points of the same true parameters, all starting at the same initial parameters.
+With noise, the data are Poisson distributed counts with the Gaussian as their means.
+*/
+void generate_gauss_2d_fits(
+	FitInput & i,
+	std::size_t const n_fits,
+	std::vector< REAL > const & true_parameters,
+	std::vector< REAL > const & initial_parameters,
+	bool const poisson_noise,
+	int const estimator_id);
+
 #endif
\ No newline at end of file